@@ -5,6 +5,7 @@
 
 #include <command.h>
 #include <common.h>
+#include <serial.h>
 
 __weak void reset_cpu(ulong addr)
 {
@@ -15,6 +16,7 @@ __weak void reset_cpu(ulong addr)
 int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
 {
 	printf("Resetting the board...\n");
+	serial_flush();
 
 	reset_cpu(0);
 
@@ -19,11 +19,20 @@
 
 #undef __HAVE_ARCH_STRRCHR
 #undef __HAVE_ARCH_STRCHR
+#if CONFIG_IS_ENABLED(USE_ARCH_MEMCPY)
+#define __HAVE_ARCH_MEMCPY
+#define __HAVE_ARCH_MEMMOVE
+#else
 #undef __HAVE_ARCH_MEMCPY
 #undef __HAVE_ARCH_MEMMOVE
+#endif
 #undef __HAVE_ARCH_MEMCHR
 #undef __HAVE_ARCH_MEMZERO
+#if CONFIG_IS_ENABLED(USE_ARCH_MEMSET)
+#define __HAVE_ARCH_MEMSET
+#else
 #undef __HAVE_ARCH_MEMSET
+#endif
 
 #ifdef CONFIG_MARCO_MEMSET
 #define memset(_p, _v, _n)	\
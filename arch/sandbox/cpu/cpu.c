@@ -4,10 +4,12 @@
  */
 
 #include <common.h>
+#include <decomp_parallel.h>
 #include <dm.h>
 #include <errno.h>
 #include <linux/libfdt.h>
 #include <os.h>
+#include <profile.h>
 #include <asm/io.h>
 #include <asm/setjmp.h>
 #include <asm/state.h>
@@ -278,6 +280,25 @@ done:
 	return 0;
 }
 
+#ifdef CONFIG_PROFILER
+int arch_profile_start(uint period_us)
+{
+	return os_profile_start(period_us, profile_sample);
+}
+
+void arch_profile_stop(void)
+{
+	os_profile_stop();
+}
+#endif
+
+#ifdef CONFIG_DECOMP_PARALLEL
+void arch_run_parallel(int (*func)(void *arg), void *const args[], int count)
+{
+	os_run_parallel(func, args, count);
+}
+#endif
+
 ulong timer_get_boot_us(void)
 {
 	static uint64_t base_count;
@@ -3,17 +3,23 @@
  * Copyright (c) 2011 The Chromium OS Authors.
  */
 
+/* For the register names in ucontext_t */
+#define _GNU_SOURCE
+
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <setjmp.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <termios.h>
 #include <time.h>
+#include <ucontext.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -827,3 +833,115 @@ void *os_find_text_base(void)
 
 	return base;
 }
+
+static void (*os_profile_func)(unsigned long pc, unsigned long sp,
+			       unsigned long fp);
+
+static void os_profile_handler(int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = context;
+	unsigned long pc, sp, fp;
+
+#if defined(__x86_64__)
+	pc = uc->uc_mcontext.gregs[REG_RIP];
+	sp = uc->uc_mcontext.gregs[REG_RSP];
+	fp = uc->uc_mcontext.gregs[REG_RBP];
+#elif defined(__i386__)
+	pc = uc->uc_mcontext.gregs[REG_EIP];
+	sp = uc->uc_mcontext.gregs[REG_ESP];
+	fp = uc->uc_mcontext.gregs[REG_EBP];
+#elif defined(__aarch64__)
+	pc = uc->uc_mcontext.pc;
+	sp = uc->uc_mcontext.sp;
+	fp = uc->uc_mcontext.regs[29];
+#endif
+	os_profile_func(pc, sp, fp);
+}
+
+int os_profile_start(unsigned int period_us,
+		     void (*sample)(unsigned long pc, unsigned long sp,
+				    unsigned long fp))
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+	struct itimerval timer;
+	struct sigaction act;
+
+	os_profile_func = sample;
+	memset(&act, '\0', sizeof(act));
+	act.sa_sigaction = os_profile_handler;
+	act.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&act.sa_mask);
+	if (sigaction(SIGPROF, &act, NULL))
+		return -errno;
+
+	timer.it_interval.tv_sec = period_us / 1000000;
+	timer.it_interval.tv_usec = period_us % 1000000;
+	timer.it_value = timer.it_interval;
+	if (setitimer(ITIMER_PROF, &timer, NULL))
+		return -errno;
+
+	return 0;
+#else
+	return -ENOSYS;
+#endif
+}
+
+void os_profile_stop(void)
+{
+	struct itimerval timer;
+
+	memset(&timer, '\0', sizeof(timer));
+	setitimer(ITIMER_PROF, &timer, NULL);
+	signal(SIGPROF, SIG_IGN);
+}
+
+/* Maximum number of threads used by os_run_parallel() */
+#define OS_MAX_THREADS	32
+
+struct os_parallel {
+	int (*func)(void *arg);
+	void *const *args;
+	int count;
+	int next;
+};
+
+static void *os_parallel_thread(void *data)
+{
+	struct os_parallel *par = data;
+	int i;
+
+	while (i = __atomic_fetch_add(&par->next, 1, __ATOMIC_RELAXED),
+	       i < par->count)
+		par->func(par->args[i]);
+
+	return NULL;
+}
+
+void os_run_parallel(int (*func)(void *arg), void *const args[], int count)
+{
+	pthread_t threads[OS_MAX_THREADS];
+	struct os_parallel par;
+	long cpus;
+	int i, num;
+
+	par.func = func;
+	par.args = args;
+	par.count = count;
+	par.next = 0;
+
+	/* this thread does its share too */
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus > count)
+		cpus = count;
+	if (cpus > OS_MAX_THREADS)
+		cpus = OS_MAX_THREADS;
+	num = cpus - 1;
+	for (i = 0; i < num; i++) {
+		if (pthread_create(&threads[i], NULL, os_parallel_thread, &par))
+			break;
+	}
+	num = i;
+	os_parallel_thread(&par);
+	for (i = 0; i < num; i++)
+		pthread_join(threads[i], NULL);
+}
@@ -9,6 +9,7 @@
 #include <spl.h>
 #include <asm/spl.h>
 #include <asm/state.h>
+#include <dm/util.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -63,6 +64,10 @@ void spl_board_init(void)
 		     uclass_next_device(&dev))
 			;
 	}
+
+	/* Show the hierarchy worked out by dtoc, for comparison */
+	if (state->show_spl_dm_tree)
+		dm_dump_all();
 }
 
 void __noreturn jump_to_image_no_args(struct spl_image_info *spl_image)
@@ -293,6 +293,15 @@ static int sandbox_cmdline_cb_show_of_platdata(struct sandbox_state *state,
 }
 SANDBOX_CMDLINE_OPT(show_of_platdata, 0, "Show of-platdata in SPL");
 
+static int sandbox_cmdline_cb_show_spl_dm_tree(struct sandbox_state *state,
+					       const char *arg)
+{
+	state->show_spl_dm_tree = true;
+
+	return 0;
+}
+SANDBOX_CMDLINE_OPT(show_spl_dm_tree, 0, "Show the device tree bound in SPL");
+
 int board_run_command(const char *cmdline)
 {
 	printf("## Commands are disabled. Please enable CONFIG_CMDLINE.\n");
@@ -14,29 +14,33 @@ extern char *strrchr(const char *s, int c);
 #undef __HAVE_ARCH_STRCHR
 extern char *strchr(const char *s, int c);
 
-#ifdef CONFIG_X86_64
+/*
+ * 32-bit code uses string.c and 64-bit code string_64.c. The 32-bit SPL of
+ * a 64-bit build has neither, so uses the generic versions.
+ */
+#if !defined(CONFIG_X86_64) || CONFIG_IS_ENABLED(X86_64)
 
-#undef __HAVE_ARCH_MEMCPY
+#define __HAVE_ARCH_MEMCPY
 extern void *memcpy(void *, const void *, __kernel_size_t);
 
-#undef __HAVE_ARCH_MEMMOVE
+#define __HAVE_ARCH_MEMMOVE
 extern void *memmove(void *, const void *, __kernel_size_t);
 
-#undef __HAVE_ARCH_MEMSET
+#define __HAVE_ARCH_MEMSET
 extern void *memset(void *, int, __kernel_size_t);
 
 #else
 
-#define __HAVE_ARCH_MEMCPY
+#undef __HAVE_ARCH_MEMCPY
 extern void *memcpy(void *, const void *, __kernel_size_t);
 
-#define __HAVE_ARCH_MEMMOVE
+#undef __HAVE_ARCH_MEMMOVE
 extern void *memmove(void *, const void *, __kernel_size_t);
 
-#define __HAVE_ARCH_MEMSET
+#undef __HAVE_ARCH_MEMSET
 extern void *memset(void *, int, __kernel_size_t);
 
-#endif /* CONFIG_X86_64 */
+#endif
 
 #undef __HAVE_ARCH_MEMCHR
 extern void *memchr(const void *, int, __kernel_size_t);
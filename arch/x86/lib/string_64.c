@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * String functions for x86_64
+ *
+ * These use the string instructions, copying eight bytes at a time and then
+ * the remaining bytes. This is close to the best on most CPUs and needs no
+ * FPU/vector state.
+ */
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+#include <asm/string.h>
+
+void *memcpy(void *dstpp, const void *srcpp, size_t len)
+{
+	unsigned long d0, d1, d2;
+
+	asm volatile("rep movsq\n\t"
+		     "movq %4, %%rcx\n\t"
+		     "rep movsb"
+		     : "=&c" (d0), "=&D" (d1), "=&S" (d2)
+		     : "0" (len / 8), "g" (len & 7), "1" (dstpp), "2" (srcpp)
+		     : "memory");
+
+	return dstpp;
+}
+
+void *memmove(void *dest, const void *src, size_t n)
+{
+	unsigned long d0, d1, d2;
+
+	/* A forward copy is fine unless dest is inside the source */
+	if ((unsigned long)dest - (unsigned long)src >= n)
+		return memcpy(dest, src, n);
+
+	/* Copy the odd bytes at the end, then whole words, going backwards */
+	asm volatile("std\n\t"
+		     "rep movsb\n\t"
+		     "movq %4, %%rcx\n\t"
+		     "subq $7, %%rsi\n\t"
+		     "subq $7, %%rdi\n\t"
+		     "rep movsq\n\t"
+		     "cld"
+		     : "=&c" (d0), "=&D" (d1), "=&S" (d2)
+		     : "0" (n & 7), "g" (n / 8), "1" (dest + n - 1),
+		       "2" (src + n - 1)
+		     : "memory");
+
+	return dest;
+}
+
+void *memset(void *dstpp, int c, size_t len)
+{
+	unsigned long d0, d1;
+
+	asm volatile("rep stosq\n\t"
+		     "movq %3, %%rcx\n\t"
+		     "rep stosb"
+		     : "=&c" (d0), "=&D" (d1)
+		     : "a" (0x0101010101010101UL * (u8)c), "g" (len & 7),
+		       "0" (len / 8), "1" (dstpp)
+		     : "memory");
+
+	return dstpp;
+}
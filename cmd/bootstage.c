@@ -4,6 +4,8 @@
  */
 
 #include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
 
 static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 			       char * const argv[])
@@ -57,10 +59,66 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+static int do_bootstage_export(cmd_tbl_t *cmdtp, int flag, int argc,
+			       char * const argv[])
+{
+	enum bootstage_export_fmt fmt;
+	ulong addr, size;
+	char *buf;
+	int len;
+
+	if (argc != 2 && argc != 4)
+		return CMD_RET_USAGE;
+	if (!strcmp(argv[1], "chrome"))
+		fmt = BOOTSTAGE_EXPORT_CHROME;
+	else if (!strcmp(argv[1], "folded"))
+		fmt = BOOTSTAGE_EXPORT_FOLDED;
+	else
+		return CMD_RET_USAGE;
+
+	if (argc == 2) {
+		len = bootstage_export(fmt, NULL, 0);
+		if (len < 0)
+			return CMD_RET_FAILURE;
+		/* Allow for open spans growing longer meanwhile */
+		size = len + 64;
+		buf = malloc(size);
+		if (!buf) {
+			printf("Out of memory\n");
+			return CMD_RET_FAILURE;
+		}
+		bootstage_export(fmt, buf, size);
+		puts(buf);
+		free(buf);
+
+		return 0;
+	}
+
+	addr = simple_strtoul(argv[2], NULL, 16);
+	size = simple_strtoul(argv[3], NULL, 16);
+	buf = map_sysmem(addr, size);
+	len = bootstage_export(fmt, buf, size);
+	unmap_sysmem(buf);
+	if (len < 0)
+		return CMD_RET_FAILURE;
+	if (len >= size) {
+		printf("Not enough space: need %#x bytes\n", len + 1);
+		return CMD_RET_FAILURE;
+	}
+	env_set_hex("filesize", len);
+
+	return 0;
+}
+#endif
+
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	U_BOOT_CMD_MKENT(export, 4, 0, do_bootstage_export, "", ""),
+#endif
 };
 
 /*
@@ -85,10 +143,16 @@ static int do_boostage(cmd_tbl_t *cmdtp, int flag, int argc,
 }
 
 
-U_BOOT_CMD(bootstage, 4, 1, do_boostage,
+U_BOOT_CMD(bootstage, 5, 1, do_boostage,
 	"Boot stage command",
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
 	"unstash [<start> [<size>]]  - Unstash data from memory"
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	"\nexport chrome|folded [<start> <size>]\n"
+	"                            - Export timing spans as Chrome trace\n"
+	"                              JSON or folded stacks, to memory or\n"
+	"                              the console"
+#endif
 );
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Apply a bsdiff patch from one partition to another
+ */
+
+#include <common.h>
+#include <bspatch.h>
+#include <command.h>
+#include <hash.h>
+#include <mapmem.h>
+#include <part.h>
+
+static int do_bspatch(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	struct blk_desc *old_dev, *new_dev;
+	disk_partition_t old_part, new_part;
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+	const char *algo_name = NULL;
+	struct hash_algo *algo;
+	u64 old_size = 0;
+	ulong addr, len;
+	void *patch;
+	int ret;
+
+	if (argc != 6 && argc != 8 && argc != 9)
+		return CMD_RET_USAGE;
+	if (blk_get_device_part_str(argv[1], argv[2], &old_dev, &old_part,
+				    1) < 0 ||
+	    blk_get_device_part_str(argv[1], argv[3], &new_dev, &new_part,
+				    1) < 0)
+		return CMD_RET_FAILURE;
+	addr = simple_strtoul(argv[4], NULL, 16);
+	len = simple_strtoul(argv[5], NULL, 16);
+	if (argc > 6) {
+		algo_name = argv[6];
+		if (hash_lookup_algo(algo_name, &algo)) {
+			printf("Unknown hash algorithm '%s'\n", algo_name);
+			return CMD_RET_FAILURE;
+		}
+		if (strlen(argv[7]) != algo->digest_size * 2 ||
+		    hash_parse_string(algo_name, argv[7], digest)) {
+			printf("Invalid %s digest\n", algo_name);
+			return CMD_RET_FAILURE;
+		}
+	}
+	if (argc > 8)
+		old_size = simple_strtoull(argv[8], NULL, 16);
+
+	patch = map_sysmem(addr, len);
+	ret = bspatch_blk(patch, len, old_dev, &old_part, old_size, new_dev,
+			  &new_part, algo_name, digest);
+	unmap_sysmem(patch);
+	switch (ret) {
+	case 0:
+		return CMD_RET_SUCCESS;
+	case -EBADMSG:
+		printf("New image does not match %s digest\n", algo_name);
+		break;
+	case -ENOSPC:
+		puts("Image too large for partition\n");
+		break;
+	case -EINTR:
+		puts("Aborted\n");
+		break;
+	default:
+		printf("Failed to apply patch (err=%d)\n", ret);
+		break;
+	}
+
+	return CMD_RET_FAILURE;
+}
+
+U_BOOT_CMD(
+	bspatch, 9, 0, do_bspatch,
+	"apply a bsdiff patch from one partition to another",
+	"<interface> <olddev[:part]> <newdev[:part]> <addr> <len> [<algo> <digest> [<oldsize>]]\n"
+	"    - apply the bsdiff patch of <len> bytes at <addr> to the old\n"
+	"      image, writing the new image to another partition of the same\n"
+	"      interface. If <algo> is given, the new image is checked\n"
+	"      against the hex <digest>. <oldsize> is the size of the old\n"
+	"      image in bytes (hex), if it does not fill its partition."
+);
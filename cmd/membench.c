@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Compare the speed of the string functions with the generic versions
+ */
+
+#include <common.h>
+#include <command.h>
+#include <console.h>
+#include <div64.h>
+#include <malloc.h>
+
+enum {
+	BENCH_MEMCPY,
+	BENCH_MEMMOVE,
+	BENCH_MEMSET,
+	BENCH_MEMCMP,
+
+	BENCH_COUNT,
+};
+
+static const char *const bench_name[BENCH_COUNT] = {
+	"memcpy", "memmove", "memset", "memcmp",
+};
+
+/*
+ * Copies of the generic versions in lib/string.c, which are not built when
+ * the architecture provides its own
+ */
+static void *gen_memcpy(void *dest, const void *src, size_t count)
+{
+	unsigned long *dl = (unsigned long *)dest, *sl = (unsigned long *)src;
+	char *d8, *s8;
+
+	if ((((ulong)dest | (ulong)src) & (sizeof(*dl) - 1)) == 0) {
+		while (count >= sizeof(*dl)) {
+			*dl++ = *sl++;
+			count -= sizeof(*dl);
+		}
+	}
+	d8 = (char *)dl;
+	s8 = (char *)sl;
+	while (count--)
+		*d8++ = *s8++;
+
+	return dest;
+}
+
+static void *gen_memmove(void *dest, const void *src, size_t count)
+{
+	unsigned long *dl, *sl;
+	char *tmp, *s;
+
+	if (dest <= src)
+		return gen_memcpy(dest, src, count);
+
+	tmp = (char *)dest + count;
+	s = (char *)src + count;
+	if ((((ulong)dest ^ (ulong)src) & (sizeof(*dl) - 1)) == 0) {
+		while (count && ((ulong)tmp & (sizeof(*dl) - 1))) {
+			*--tmp = *--s;
+			count--;
+		}
+		dl = (unsigned long *)tmp;
+		sl = (unsigned long *)s;
+		while (count >= sizeof(*dl)) {
+			*--dl = *--sl;
+			count -= sizeof(*dl);
+		}
+		tmp = (char *)dl;
+		s = (char *)sl;
+	}
+	while (count--)
+		*--tmp = *--s;
+
+	return dest;
+}
+
+static void *gen_memset(void *s, int c, size_t count)
+{
+	unsigned long *sl = (unsigned long *)s;
+	unsigned long cl = 0;
+	char *s8;
+	int i;
+
+	if (((ulong)s & (sizeof(*sl) - 1)) == 0) {
+		for (i = 0; i < sizeof(*sl); i++) {
+			cl <<= 8;
+			cl |= c & 0xff;
+		}
+		while (count >= sizeof(*sl)) {
+			*sl++ = cl;
+			count -= sizeof(*sl);
+		}
+	}
+	s8 = (char *)sl;
+	while (count--)
+		*s8++ = c;
+
+	return s;
+}
+
+static int gen_memcmp(const void *cs, const void *ct, size_t count)
+{
+	const unsigned long *l1 = cs, *l2 = ct;
+	const unsigned char *su1, *su2;
+	int res = 0;
+
+	if ((((ulong)cs | (ulong)ct) & (sizeof(*l1) - 1)) == 0) {
+		while (count >= sizeof(*l1) && *l1 == *l2) {
+			l1++;
+			l2++;
+			count -= sizeof(*l1);
+		}
+	}
+	for (su1 = (const unsigned char *)l1, su2 = (const unsigned char *)l2;
+	     count > 0; ++su1, ++su2, count--) {
+		res = *su1 - *su2;
+		if (res)
+			break;
+	}
+
+	return res;
+}
+
+/*
+ * Run one function @count times, returning the speed in MB/s. With @offset,
+ * the destination is misaligned with respect to the source. memmove() moves
+ * the source up by a little, so that it has to copy backwards.
+ */
+static ulong membench_run(int func, bool generic, u8 *dst, u8 *src,
+			  int offset, ulong size, uint count)
+{
+	ulong start, us;
+	uint i;
+
+	dst += offset;
+	start = timer_get_us();
+	for (i = 0; i < count; i++) {
+		switch (func) {
+		case BENCH_MEMCPY:
+			if (generic)
+				gen_memcpy(dst, src, size);
+			else
+				memcpy(dst, src, size);
+			break;
+		case BENCH_MEMMOVE:
+			if (generic)
+				gen_memmove(src + 64 + offset, src, size);
+			else
+				memmove(src + 64 + offset, src, size);
+			break;
+		case BENCH_MEMSET:
+			if (generic)
+				gen_memset(dst, i, size);
+			else
+				memset(dst, i, size);
+			break;
+		case BENCH_MEMCMP:
+			if (generic ? gen_memcmp(dst, src, size) :
+			    memcmp(dst, src, size))
+				return 0;
+			break;
+		}
+	}
+	us = max(timer_get_us() - start, 1UL);
+
+	return lldiv((u64)size * count, us);
+}
+
+static int do_membench(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	ulong size = 0x100000;
+	uint count = 16;
+	u8 *dst, *src;
+	int func, offset;
+
+	if (argc > 3)
+		return CMD_RET_USAGE;
+	if (argc > 1)
+		size = simple_strtoul(argv[1], NULL, 16);
+	if (argc > 2)
+		count = simple_strtoul(argv[2], NULL, 10);
+	if (!size || !count)
+		return CMD_RET_USAGE;
+
+	/* Leave room for the misaligned runs and for memmove() */
+	dst = memalign(64, size + 128);
+	src = memalign(64, size + 128);
+	if (!dst || !src) {
+		printf("Cannot allocate %#lx bytes\n", size);
+		free(dst);
+		free(src);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("%#lx bytes x %u, MB/s:\n", size, count);
+	printf("%-8s %-10s %8s %8s\n", "", "", "arch", "generic");
+	for (func = 0; func < BENCH_COUNT; func++) {
+		for (offset = 0; offset < 2; offset++) {
+			/* memcmp() compares equal areas, to see all of them */
+			memset(dst, '\0', size + 128);
+			memset(src, '\0', size + 128);
+			printf("%-8s %-10s %8lu %8lu\n", bench_name[func],
+			       offset ? "misaligned" : "aligned",
+			       membench_run(func, false, dst, src, offset, size,
+					    count),
+			       membench_run(func, true, dst, src, offset, size,
+					    count));
+			if (ctrlc())
+				goto out;
+		}
+	}
+out:
+	free(src);
+	free(dst);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	membench, 3, 0, do_membench,
+	"compare the speed of the string functions with the generic ones",
+	"[<size> [<count>]]\n"
+	"    - time memcpy(), memmove(), memset() and memcmp() on <size>\n"
+	"      bytes (hex, default 0x100000), <count> times (default 16), for\n"
+	"      aligned and misaligned buffers"
+);
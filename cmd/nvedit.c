@@ -25,6 +25,7 @@
 
 #include <common.h>
 #include <cli.h>
+#include <cli_hush.h>
 #include <command.h>
 #include <console.h>
 #include <environment.h>
@@ -258,6 +259,10 @@ static int _do_env_set(int flag, int argc, char * const argv[], int env_flag)
 
 	env_id++;
 
+	/* the script held in the variable will not be run again as it is */
+	if (CONFIG_IS_ENABLED(HUSH_CACHE))
+		hush_cache_drop(env_get(name));
+
 	/* Delete only ? */
 	if (argc < 3 || argv[2] == NULL) {
 		int rc = hdelete_r(name, &env_htab, env_flag);
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Control the statistical profiler
+ */
+
+#include <common.h>
+#include <command.h>
+#include <mapmem.h>
+#include <profile.h>
+
+/* Default time between samples in microseconds */
+#define PROFILE_PERIOD_US	1000
+
+static int do_profile_start(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	uint period_us = PROFILE_PERIOD_US;
+	int ret;
+
+	if (argc > 1)
+		period_us = simple_strtoul(argv[1], NULL, 10);
+	if (!period_us)
+		return CMD_RET_USAGE;
+
+	ret = profile_start(period_us);
+	if (ret == -ENOSYS) {
+		printf("Sampling is not supported on this architecture\n");
+		return CMD_RET_FAILURE;
+	} else if (ret) {
+		printf("Cannot start profiler (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static int do_profile_stop(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	profile_stop();
+
+	return 0;
+}
+
+static int do_profile_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	profile_print_stats();
+
+	return 0;
+}
+
+static int do_profile_samples(cmd_tbl_t *cmdtp, int flag, int argc,
+			      char * const argv[])
+{
+	size_t buff_size, buff_ptr, avail, used;
+	uint needed;
+	char *buff;
+	int ret;
+
+	if (argc == 3) {
+		buff_size = simple_strtoul(argv[2], NULL, 16);
+		buff = map_sysmem(simple_strtoul(argv[1], NULL, 16),
+				  buff_size);
+		buff_ptr = 0;
+	} else if (argc == 1) {
+		/* Follow on from data written by 'trace' or 'profile' */
+		buff_size = env_get_ulong("profsize", 16, 0);
+		buff = map_sysmem(env_get_ulong("profbase", 16, 0),
+				  buff_size);
+		buff_ptr = env_get_ulong("profoffset", 16, 0);
+	} else {
+		return CMD_RET_USAGE;
+	}
+	if (buff_ptr > buff_size)
+		return CMD_RET_USAGE;
+
+	avail = buff_size - buff_ptr;
+	ret = profile_list_samples(buff + buff_ptr, avail, &needed);
+	if (ret) {
+		printf("Error: not enough space (%#x bytes needed)\n", needed);
+		return CMD_RET_FAILURE;
+	}
+	used = needed;
+	printf("Samples dumped to %08lx, size %#zx\n",
+	       (ulong)map_to_sysmem(buff + buff_ptr), used);
+	env_set_hex("profbase", map_to_sysmem(buff));
+	env_set_hex("profsize", buff_size);
+	env_set_hex("profoffset", buff_ptr + used);
+
+	return 0;
+}
+
+static cmd_tbl_t cmd_profile_sub[] = {
+	U_BOOT_CMD_MKENT(start, 2, 0, do_profile_start, "", ""),
+	U_BOOT_CMD_MKENT(stop, 1, 0, do_profile_stop, "", ""),
+	U_BOOT_CMD_MKENT(stats, 1, 0, do_profile_stats, "", ""),
+	U_BOOT_CMD_MKENT(samples, 3, 0, do_profile_samples, "", ""),
+};
+
+static int do_profile(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	cmd_tbl_t *cp;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* drop sub-command argument */
+	argc--;
+	argv++;
+
+	cp = find_cmd_tbl(argv[0], cmd_profile_sub,
+			  ARRAY_SIZE(cmd_profile_sub));
+	if (!cp)
+		return CMD_RET_USAGE;
+
+	return cp->cmd(cmdtp, flag, argc, argv);
+}
+
+U_BOOT_CMD(
+	profile,	4,	1,	do_profile,
+	"statistical profiler",
+	"start [<period_us>]      - start taking samples (default every 1ms)\n"
+	"profile stop                     - stop taking samples\n"
+	"profile stats                    - show how many samples were taken\n"
+	"profile samples [<addr> <size>]  - dump samples into buffer"
+);
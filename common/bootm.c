@@ -8,6 +8,7 @@
 #include <common.h>
 #include <bootstage.h>
 #include <bzlib.h>
+#include <decomp_parallel.h>
 #include <errno.h>
 #include <fdt_support.h>
 #include <lmb.h>
@@ -15,6 +16,7 @@
 #include <mapmem.h>
 #include <asm/io.h>
 #include <linux/lzo.h>
+#include <u-boot/lz4.h>
 #include <lzma/LzmaTypes.h>
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
@@ -366,6 +368,15 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 	 * this, image_len will be set to the number of uncompressed bytes
 	 * loaded, ret will be non-zero on error.
 	 */
+#ifdef CONFIG_DECOMP_PARALLEL
+	/* images made of several independent parts can be split up */
+	if (!decomp_parallel(comp, load_buf, unc_len, image_buf, image_len,
+			     &image_len)) {
+		*load_end = load + image_len;
+		puts("OK\n");
+		return 0;
+	}
+#endif
 	switch (comp) {
 	case IH_COMP_NONE:
 		if (load == image_start)
@@ -425,6 +436,16 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		size_t size = unc_len;
+
+		ret = zstd_decompress(image_buf, image_len, load_buf, &size);
+		/* Only -ENOSPC means that the image is too large */
+		image_len = ret && ret != -ENOSPC ? 0 : size;
+		break;
+	}
+#endif /* CONFIG_ZSTD */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return BOOTM_ERR_UNIMPLEMENTED;
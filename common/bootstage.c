@@ -28,10 +28,47 @@ struct bootstage_record {
 	enum bootstage_id id;
 };
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+enum {
+	SPAN_COUNT	= CONFIG_BOOTSTAGE_SPAN_COUNT,
+	SPAN_NAME_LEN	= 32,
+};
+
+/**
+ * struct bootstage_span - A period of time spent doing something
+ *
+ * @start_us: Time when the span started
+ * @end_us: Time when the span ended, or 0 if it is still open
+ * @child_us: Time spent in spans nested inside this one
+ * @parent: Index of the span which this one is nested in, or -1 if none
+ * @id: Bootstage ID for spans from bootstage_start(), else 0
+ * @gen: Generation of this slot, since a dropped span's slot is reused
+ * @kind: What sort of span this is, e.g. "probe"
+ * @name: What the span is about, e.g. the device name
+ */
+struct bootstage_span {
+	ulong start_us;
+	ulong end_us;
+	ulong child_us;
+	int parent;
+	enum bootstage_id id;
+	uint gen;
+	const char *kind;
+	char name[SPAN_NAME_LEN];
+};
+#endif
+
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
 	struct bootstage_record record[RECORD_COUNT];
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	struct bootstage_span *span;	/* allocated after relocation */
+	uint span_count;
+	uint span_dropped;
+	int span_open;			/* innermost open span, or -1 */
+	uint span_gen;			/* generation of the next span */
+#endif
 };
 
 enum {
@@ -174,6 +211,152 @@ ulong bootstage_mark_code(const char *file, const char *func, int linenum)
 	return bootstage_mark_name(BOOTSTAGE_ID_ALLOC, str);
 }
 
+/**
+ * Get a record name as a printable string
+ *
+ * @param buf	Buffer to put name if needed
+ * @param len	Length of buffer
+ * @param rec	Boot stage record to get the name from
+ * @return pointer to name, either from the record or pointing to buf.
+ */
+static const char *get_record_name(char *buf, int len,
+				   const struct bootstage_record *rec)
+{
+	if (rec->name)
+		return rec->name;
+	else if (rec->id >= BOOTSTAGE_ID_USER)
+		snprintf(buf, len, "user_%d", rec->id - BOOTSTAGE_ID_USER);
+	else
+		snprintf(buf, len, "id=%d", rec->id);
+
+	return buf;
+}
+
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+/*
+ * The number returned by bootstage_span_begin() holds the slot and its
+ * generation, so that a stale number cannot end a later span in that slot
+ */
+#define SPAN_GEN_MAX	(INT_MAX / SPAN_COUNT)
+
+static int span_begin(struct bootstage_data *data, const char *kind,
+		      const char *name, enum bootstage_id id)
+{
+	struct bootstage_span *span;
+
+	if (!data)
+		return -ENOENT;
+	if (!data->span) {
+		/* There are too many spans to record them before relocation */
+		if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+			return -EAGAIN;
+		data->span = calloc(SPAN_COUNT, sizeof(*data->span));
+		if (!data->span)
+			return -ENOMEM;
+		data->span_open = -1;
+	}
+	if (data->span_count == SPAN_COUNT) {
+		data->span_dropped++;
+		return -ENOSPC;
+	}
+
+	span = &data->span[data->span_count];
+	span->start_us = timer_get_boot_us();
+	span->end_us = 0;
+	span->child_us = 0;
+	span->parent = data->span_open;
+	span->id = id;
+	span->gen = data->span_gen++ % SPAN_GEN_MAX;
+	span->kind = kind;
+	strlcpy(span->name, name ? name : "", sizeof(span->name));
+	data->span_open = data->span_count;
+
+	return span->gen * SPAN_COUNT + data->span_count++;
+}
+
+static void span_end(struct bootstage_data *data, int idx)
+{
+	struct bootstage_span *span;
+	ulong now, duration;
+	int i;
+
+	if (!data || !data->span || idx < 0 || idx >= data->span_count)
+		return;
+
+	/* Only an open span can be ended */
+	for (i = data->span_open; i != -1 && i != idx;)
+		i = data->span[i].parent;
+	if (i == -1)
+		return;
+
+	/* End any spans which were left open inside this one too */
+	now = timer_get_boot_us();
+	do {
+		i = data->span_open;
+		span = &data->span[i];
+		span->end_us = now;
+		duration = now - span->start_us;
+		data->span_open = span->parent;
+
+		/* Drop short spans with nothing inside, to save space */
+		if (i == data->span_count - 1 &&
+		    duration < CONFIG_BOOTSTAGE_SPAN_MIN_US)
+			data->span_count--;
+		else if (span->parent != -1)
+			data->span[span->parent].child_us += duration;
+	} while (i != idx);
+}
+
+static void span_begin_stage(struct bootstage_data *data,
+			     const struct bootstage_record *rec)
+{
+	char buf[20];
+
+	span_begin(data, "stage", get_record_name(buf, sizeof(buf), rec),
+		   rec->id);
+}
+
+/* End the innermost open span started by bootstage_start() for an ID */
+static void span_end_stage(struct bootstage_data *data, enum bootstage_id id)
+{
+	int i;
+
+	if (!data->span)
+		return;
+	for (i = data->span_open; i != -1; i = data->span[i].parent) {
+		if (data->span[i].id == id) {
+			span_end(data, i);
+			break;
+		}
+	}
+}
+
+int bootstage_span_begin(const char *kind, const char *name)
+{
+	return span_begin(gd->bootstage, kind, name, 0);
+}
+
+void bootstage_span_end(int span)
+{
+	struct bootstage_data *data = gd->bootstage;
+	int idx = span % SPAN_COUNT;
+
+	if (!data || !data->span || span < 0 || idx >= data->span_count ||
+	    data->span[idx].gen != span / SPAN_COUNT)
+		return;
+	span_end(data, idx);
+}
+#else
+static void span_begin_stage(struct bootstage_data *data,
+			     const struct bootstage_record *rec)
+{
+}
+
+static void span_end_stage(struct bootstage_data *data, enum bootstage_id id)
+{
+}
+#endif
+
 uint32_t bootstage_start(enum bootstage_id id, const char *name)
 {
 	struct bootstage_data *data = gd->bootstage;
@@ -183,6 +366,7 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name)
 	if (rec) {
 		rec->start_us = start_us;
 		rec->name = name;
+		span_begin_stage(data, rec);
 	}
 
 	return start_us;
@@ -198,31 +382,11 @@ uint32_t bootstage_accum(enum bootstage_id id)
 		return 0;
 	duration = (uint32_t)timer_get_boot_us() - rec->start_us;
 	rec->time_us += duration;
+	span_end_stage(data, id);
 
 	return duration;
 }
 
-/**
- * Get a record name as a printable string
- *
- * @param buf	Buffer to put name if needed
- * @param len	Length of buffer
- * @param rec	Boot stage record to get the name from
- * @return pointer to name, either from the record or pointing to buf.
- */
-static const char *get_record_name(char *buf, int len,
-				   const struct bootstage_record *rec)
-{
-	if (rec->name)
-		return rec->name;
-	else if (rec->id >= BOOTSTAGE_ID_USER)
-		snprintf(buf, len, "user_%d", rec->id - BOOTSTAGE_ID_USER);
-	else
-		snprintf(buf, len, "id=%d", rec->id);
-
-	return buf;
-}
-
 static uint32_t print_time_record(struct bootstage_record *rec, uint32_t prev)
 {
 	char buf[20];
@@ -341,8 +505,164 @@ void bootstage_report(void)
 		if (rec->start_us)
 			prev = print_time_record(rec, -1);
 	}
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	if (data->span_dropped)
+		printf("\nDropped %u spans\n"
+		       "Please increase CONFIG_BOOTSTAGE_SPAN_COUNT\n",
+		       data->span_dropped);
+#endif
+}
+
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+/* Everything runs on one CPU, so all events go in the same process/thread */
+#define EXPORT_IDS	"\"pid\":1,\"tid\":1"
+
+/* Text being exported, which is counted even when it does not fit */
+struct export_buf {
+	char *buf;
+	int size;
+	int len;
+};
+
+static void export_printf(struct export_buf *out, const char *fmt, ...)
+{
+	int room = out->len < out->size ? out->size - out->len : 0;
+	va_list args;
+
+	va_start(args, fmt);
+	out->len += vsnprintf(room ? out->buf + out->len : NULL, room, fmt,
+			      args);
+	va_end(args);
+}
+
+/*
+ * Write a name, escaping it for a JSON string, or for the folded format,
+ * where spaces and semicolons separate fields
+ */
+static void export_name(struct export_buf *out, const char *name, bool json)
+{
+	char buf[SPAN_NAME_LEN * 2];
+	int len = 0;
+	char ch;
+
+	for (; *name; name++) {
+		if (len > sizeof(buf) - 3) {
+			buf[len] = '\0';
+			export_printf(out, "%s", buf);
+			len = 0;
+		}
+		ch = *name;
+		if ((u8)ch < ' ')
+			continue;
+		if (json) {
+			if (ch == '"' || ch == '\\')
+				buf[len++] = '\\';
+		} else if (ch == ' ' || ch == ';') {
+			ch = '_';
+		}
+		buf[len++] = ch;
+	}
+	buf[len] = '\0';
+	export_printf(out, "%s", buf);
+}
+
+static ulong span_duration(const struct bootstage_span *span, ulong now)
+{
+	return (span->end_us ? span->end_us : now) - span->start_us;
+}
+
+static void export_chrome(struct export_buf *out, struct bootstage_data *data,
+			  ulong now)
+{
+	const struct bootstage_record *rec;
+	const struct bootstage_span *span;
+	const char *sep = "";
+	char buf[20];
+	int i;
+
+	export_printf(out, "{\"traceEvents\":[\n");
+	/* Marks are instant events; accumulated time is covered by spans */
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		if (rec->start_us)
+			continue;
+		export_printf(out, "%s{\"name\":\"", sep);
+		export_name(out, get_record_name(buf, sizeof(buf), rec), true);
+		export_printf(out, "\",\"cat\":\"mark\",\"ph\":\"i\",");
+		export_printf(out, "\"s\":\"g\",\"ts\":%lu,%s}", rec->time_us,
+			      EXPORT_IDS);
+		sep = ",\n";
+	}
+	for (i = 0; i < data->span_count; i++) {
+		span = &data->span[i];
+		export_printf(out, "%s{\"name\":\"", sep);
+		export_name(out, span->name, true);
+		export_printf(out, "\",\"cat\":\"%s\",", span->kind);
+		export_printf(out, "\"ph\":\"X\",");
+		export_printf(out, "\"ts\":%lu,\"dur\":%lu,%s}", span->start_us,
+			      span_duration(span, now), EXPORT_IDS);
+		sep = ",\n";
+	}
+	export_printf(out, "\n]}\n");
 }
 
+/* Write the stack of spans leading to (and including) a span */
+static void export_stack(struct export_buf *out, struct bootstage_data *data,
+			 int idx)
+{
+	const struct bootstage_span *span = &data->span[idx];
+
+	if (span->parent != -1) {
+		export_stack(out, data, span->parent);
+		export_printf(out, ";");
+	}
+	export_printf(out, "%s:", span->kind);
+	export_name(out, span->name, false);
+}
+
+static void export_folded(struct export_buf *out, struct bootstage_data *data,
+			  ulong now)
+{
+	const struct bootstage_span *span;
+	ulong self_us;
+	int i;
+
+	for (i = 0; i < data->span_count; i++) {
+		span = &data->span[i];
+		self_us = span_duration(span, now) - span->child_us;
+		if (!self_us)
+			continue;
+		export_stack(out, data, i);
+		export_printf(out, " %lu\n", self_us);
+	}
+}
+
+int bootstage_export(enum bootstage_export_fmt fmt, char *buf, int size)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct export_buf out;
+	ulong now = timer_get_boot_us();
+
+	if (!data)
+		return -ENOENT;
+	out.buf = buf;
+	out.size = size;
+	out.len = 0;
+
+	switch (fmt) {
+	case BOOTSTAGE_EXPORT_CHROME:
+		export_chrome(&out, data, now);
+		break;
+	case BOOTSTAGE_EXPORT_FOLDED:
+		export_folded(&out, data, now);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return out.len;
+}
+#endif
+
 /**
  * Append data to a memory buffer
  *
@@ -6,6 +6,7 @@
  */
 
 #include <common.h>
+#include <dma.h>
 #include <malloc.h>
 #include <errno.h>
 #include <bouncebuf.h>
@@ -46,8 +47,8 @@ int bounce_buffer_start(struct bounce_buffer *state, void *data,
 			return -ENOMEM;
 
 		if (state->flags & GEN_BB_READ)
-			memcpy(state->bounce_buffer, state->user_buffer,
-				state->len);
+			dma_copy(state->bounce_buffer, state->user_buffer,
+				 state->len);
 	}
 
 	/*
@@ -74,7 +75,7 @@ int bounce_buffer_stop(struct bounce_buffer *state)
 		return 0;
 
 	if (state->flags & GEN_BB_WRITE)
-		memcpy(state->user_buffer, state->bounce_buffer, state->len);
+		dma_copy(state->user_buffer, state->bounce_buffer, state->len);
 
 	free(state->bounce_buffer);
 
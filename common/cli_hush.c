@@ -83,6 +83,7 @@
 #include <cli.h>
 #include <cli_hush.h>
 #include <command.h>        /* find_cmd */
+#include <linux/xxhash.h>
 #ifndef CONFIG_SYS_PROMPT_HUSH_PS2
 #define CONFIG_SYS_PROMPT_HUSH_PS2	"> "
 #endif
@@ -1533,7 +1534,7 @@ shell_terminal_error:
  */
 static int run_pipe_real(struct pipe *pi)
 {
-	int i;
+	int i, sp;
 #ifndef __U_BOOT__
 	int nextin, nextout;
 	int pipefds[2];				/* pipefds[0] is for reading */
@@ -1618,6 +1619,8 @@ static int run_pipe_real(struct pipe *pi)
 			}
 			return EXIT_SUCCESS;   /* don't worry about errors in set_local_var() yet */
 		}
+		/* the pipe may be run again, so leave child->sp alone */
+		sp = child->sp;
 		for (i = 0; is_assignment(child->argv[i]); i++) {
 			p = insert_var_value(child->argv[i]);
 #ifndef __U_BOOT__
@@ -1626,11 +1629,11 @@ static int run_pipe_real(struct pipe *pi)
 			set_local_var(p, 0);
 #endif
 			if (p != child->argv[i]) {
-				child->sp--;
+				sp--;
 				free(p);
 			}
 		}
-		if (child->sp) {
+		if (sp) {
 			char * str = NULL;
 
 			str = make_string(child->argv + i,
@@ -1764,6 +1767,7 @@ static int run_list_real(struct pipe *pi)
 	char **list = NULL;
 	char **save_list = NULL;
 	struct pipe *rpipe;
+	struct pipe *for_pipe = NULL;
 	int flag_rep = 0;
 #ifndef __U_BOOT__
 	int save_num_progs;
@@ -1802,7 +1806,8 @@ static int run_list_real(struct pipe *pi)
 				/* check Ctrl-C */
 				ctrlc();
 				if ((had_ctrlc())) {
-					return 1;
+					rcode = 1;
+					goto out;
 				}
 #endif
 				flag_restore = 0;
@@ -1832,6 +1837,7 @@ static int run_list_real(struct pipe *pi)
 					pi->progs->argv[0]);
 				save_list = list;
 				save_name = pi->progs->argv[0];
+				for_pipe = pi;
 				pi->progs->argv[0] = NULL;
 				flag_rep = 1;
 			}
@@ -1902,7 +1908,8 @@ static int run_list_real(struct pipe *pi)
 #else
 		if (rcode < -1) {
 			last_return_code = -rcode - 2;
-			return -2;	/* exit */
+			rcode = -2;	/* exit */
+			goto out;
 		}
 		last_return_code=(rcode == 0) ? 0 : 1;
 #endif
@@ -1920,6 +1927,21 @@ static int run_list_real(struct pipe *pi)
 			skip_more_in_this_rmode=rmode;
 #ifndef __U_BOOT__
 		checkjobs(NULL);
+#endif
+	}
+out:
+	/*
+	 * If we left a "for" loop early, put back its variable name so that
+	 * the list is as it was parsed and can be run again
+	 */
+	if (list) {
+		free(for_pipe->progs->argv[0]);
+		while (*list)
+			free(*list++);
+		free(save_list);
+		for_pipe->progs->argv[0] = save_name;
+#ifndef __U_BOOT__
+		for_pipe->progs->glob_result.gl_pathv[0] = save_name;
 #endif
 	}
 	return rcode;
@@ -3179,6 +3201,65 @@ static void update_ifs_map(void)
 	mapset(ifs, 2);            /* also flow through if quoted */
 }
 
+#if CONFIG_IS_ENABLED(HUSH_CACHE)
+/*
+ * Scripts which are run over and over, such as those in the environment
+ * run by bootcmd, are kept in parsed form so that they need not be parsed
+ * again. This includes commands which are parsed again after their
+ * variables are substituted, e.g. "run bootcmd_${target}" in a loop.
+ * Entries are looked up by the script text and the parser flags. Apart
+ * from those, the parse only depends on $IFS, so nothing is cached while
+ * that is set.
+ *
+ * Running a pipe list does not change it (see run_list_real()), so the
+ * same lists can be run each time. An entry which is running is not
+ * used again until it finishes, e.g. for a script which runs itself.
+ */
+struct hush_cache_entry {
+	char *text;			/* script, or NULL if unused */
+	u32 hash;			/* xxh32() of the text */
+	int flag;			/* parser flags (FLAG_...) */
+	struct pipe **lists;		/* pipe list for each line parsed */
+	int count;			/* number of lists */
+	int busy;			/* number of runs in progress */
+	int stale;			/* free once it is no longer busy */
+	int broken;			/* not all of the script was parsed */
+	ulong used;			/* when the entry was last used */
+};
+
+static struct hush_cache_entry hush_cache[CONFIG_HUSH_CACHE_ENTRIES];
+static ulong hush_cache_clock;
+
+/* Entry being filled in by parse_stream_outer(), or NULL */
+static struct hush_cache_entry *hush_cache_fill;
+
+static void hush_cache_free(struct hush_cache_entry *ent)
+{
+	int i;
+
+	for (i = 0; i < ent->count; i++)
+		free_pipe_list(ent->lists[i], 0);
+	free(ent->lists);
+	free(ent->text);
+	memset(ent, '\0', sizeof(*ent));
+}
+
+/* Keep a list which has been parsed and run, instead of freeing it */
+static void hush_cache_keep(struct hush_cache_entry *ent, struct pipe *pi)
+{
+	struct pipe **lists;
+
+	lists = realloc(ent->lists, (ent->count + 1) * sizeof(*lists));
+	if (!lists) {
+		free_pipe_list(pi, 0);
+		ent->broken = 1;
+		return;
+	}
+	lists[ent->count++] = pi;
+	ent->lists = lists;
+}
+#endif
+
 /* most recursion does not come through here, the exeception is
  * from builtin_source() */
 static int parse_stream_outer(struct in_str *inp, int flag)
@@ -3189,6 +3270,12 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 	int rcode;
 #ifdef __U_BOOT__
 	int code = 1;
+#endif
+#if CONFIG_IS_ENABLED(HUSH_CACHE)
+	struct hush_cache_entry *fill = hush_cache_fill;
+
+	/* only lists parsed here are wanted, not those of nested scripts */
+	hush_cache_fill = NULL;
 #endif
 	do {
 		ctx.type = flag;
@@ -3212,9 +3299,23 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 			done_pipe(&ctx,PIPE_SEQ);
 #ifndef __U_BOOT__
 			run_list(ctx.list_head);
+#else
+#if CONFIG_IS_ENABLED(HUSH_CACHE)
+			if (fill) {
+				code = run_list_real(ctx.list_head);
+				hush_cache_keep(fill, ctx.list_head);
+			} else {
+				code = run_list(ctx.list_head);
+			}
 #else
 			code = run_list(ctx.list_head);
+#endif
 			if (code == -2) {	/* exit */
+#if CONFIG_IS_ENABLED(HUSH_CACHE)
+				/* the rest of the script is not parsed */
+				if (fill)
+					fill->broken = 1;
+#endif
 				b_free(&temp);
 				code = 0;
 				/* XXX hackish way to not allow exit from main loop */
@@ -3235,6 +3336,10 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 #ifdef __U_BOOT__
 			if (inp->__promptme == 0) printf("<INTERRUPT>\n");
 			inp->__promptme = 1;
+#endif
+#if CONFIG_IS_ENABLED(HUSH_CACHE)
+			if (fill)
+				fill->broken = 1;
 #endif
 			temp.nonnull = 0;
 			temp.quote = 0;
@@ -3255,7 +3360,7 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 #ifndef __U_BOOT__
 static int parse_string_outer(const char *s, int flag)
 #else
-int parse_string_outer(const char *s, int flag)
+static int parse_string_outer_real(const char *s, int flag)
 #endif	/* __U_BOOT__ */
 {
 	struct in_str input;
@@ -3283,6 +3388,129 @@ int parse_string_outer(const char *s, int flag)
 #endif
 }
 
+#ifdef __U_BOOT__
+#if CONFIG_IS_ENABLED(HUSH_CACHE)
+static struct hush_cache_entry *hush_cache_find(const char *s, u32 hash,
+						int flag)
+{
+	struct hush_cache_entry *ent;
+
+	for (ent = hush_cache; ent < hush_cache + ARRAY_SIZE(hush_cache);
+	     ent++) {
+		if (ent->text && !ent->stale && ent->hash == hash &&
+		    ent->flag == flag && !strcmp(ent->text, s))
+			return ent;
+	}
+
+	return NULL;
+}
+
+/* Add a parsed script to the cache, replacing the least recently used */
+static void hush_cache_add(struct hush_cache_entry *new)
+{
+	struct hush_cache_entry *ent, *victim = NULL;
+
+	/* a nested run of the same script may have got there first */
+	if (new->broken || hush_cache_find(new->text, new->hash, new->flag)) {
+		hush_cache_free(new);
+		return;
+	}
+	for (ent = hush_cache; ent < hush_cache + ARRAY_SIZE(hush_cache);
+	     ent++) {
+		if (ent->busy)
+			continue;
+		if (!ent->text) {
+			victim = ent;
+			break;
+		}
+		if (!victim || ent->used < victim->used)
+			victim = ent;
+	}
+	if (!victim) {
+		hush_cache_free(new);
+		return;
+	}
+	if (victim->text)
+		hush_cache_free(victim);
+	*victim = *new;
+	victim->used = ++hush_cache_clock;
+}
+
+/* Run a cached script, as parse_stream_outer() would */
+static int hush_cache_run(struct hush_cache_entry *ent)
+{
+	int code = 1;
+	int i;
+
+	ent->busy++;
+	ent->used = ++hush_cache_clock;
+	for (i = 0; i < ent->count; i++) {
+		code = run_list_real(ent->lists[i]);
+		if (code == -2) {	/* exit */
+			code = 0;
+			break;
+		}
+		if (code == -1)
+			flag_repeat = 0;
+	}
+	if (!--ent->busy && ent->stale)
+		hush_cache_free(ent);
+
+	return (code != 0) ? 1 : 0;
+}
+
+void hush_cache_drop(const char *s)
+{
+	struct hush_cache_entry *ent;
+
+	if (!s)
+		return;
+	for (ent = hush_cache; ent < hush_cache + ARRAY_SIZE(hush_cache);
+	     ent++) {
+		if (!ent->text || strcmp(ent->text, s))
+			continue;
+		if (ent->busy)
+			ent->stale = 1;
+		else
+			hush_cache_free(ent);
+	}
+}
+
+int parse_string_outer(const char *s, int flag)
+{
+	struct hush_cache_entry new, *ent;
+	int rcode;
+
+	if (!s || !*s || env_get("IFS"))
+		return parse_string_outer_real(s, flag);
+
+	memset(&new, '\0', sizeof(new));
+	new.hash = xxh32(s, strlen(s), 0);
+	new.flag = flag;
+	ent = hush_cache_find(s, new.hash, flag);
+	if (ent && !ent->busy)
+		return hush_cache_run(ent);
+	new.text = strdup(s);
+	if (ent || !new.text) {
+		free(new.text);
+		return parse_string_outer_real(s, flag);
+	}
+
+	hush_cache_fill = &new;
+	rcode = parse_string_outer_real(s, flag);
+	hush_cache_fill = NULL;
+	hush_cache_add(&new);
+
+	return rcode;
+}
+#else
+int parse_string_outer(const char *s, int flag)
+{
+	return parse_string_outer_real(s, flag);
+}
+#endif /* HUSH_CACHE */
+#endif /* __U_BOOT__ */
+
 #ifndef __U_BOOT__
 static int parse_file_outer(FILE *f)
 #else
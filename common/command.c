@@ -11,8 +11,11 @@
 #include <common.h>
 #include <command.h>
 #include <console.h>
+#include <malloc.h>
 #include <linux/ctype.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /*
  * Use puts() instead of printf() to avoid printf buffer overflow
  * for long help messages
@@ -116,10 +119,89 @@ cmd_tbl_t *find_cmd_tbl(const char *cmd, cmd_tbl_t *table, int table_len)
 	return NULL;	/* not found or ambiguous command */
 }
 
+#ifdef CONFIG_CMDLINE
+/*
+ * Commands sorted by name, so they can be found with a binary search. The
+ * linker list is sorted by the C identifier of each command, which is not
+ * always the same as its name (e.g. "?"), so it cannot be searched as is.
+ */
+static cmd_tbl_t **cmd_index;
+static int cmd_index_count;
+
+static int cmd_index_cmp(const void *a, const void *b)
+{
+	const cmd_tbl_t *cmda = *(const cmd_tbl_t **)a;
+	const cmd_tbl_t *cmdb = *(const cmd_tbl_t **)b;
+
+	return strcmp(cmda->name, cmdb->name);
+}
+
+static int cmd_index_build(void)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	cmd_tbl_t **index;
+	int i;
+
+	index = malloc(count * sizeof(*index));
+	if (!index)
+		return -ENOMEM;
+	for (i = 0; i < count; i++)
+		index[i] = start + i;
+	qsort(index, count, sizeof(*index), cmd_index_cmp);
+	cmd_index = index;
+	cmd_index_count = count;
+
+	return 0;
+}
+
+/* find command in the index, with the same rules as find_cmd_tbl() */
+static cmd_tbl_t *find_cmd_index(const char *cmd)
+{
+	const char *p;
+	int lo, hi, mid;
+	int len;
+
+	len = ((p = strchr(cmd, '.')) == NULL) ? strlen(cmd) : (p - cmd);
+
+	/* find the first command starting with (or after) cmd */
+	lo = 0;
+	hi = cmd_index_count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (strncmp(cmd_index[mid]->name, cmd, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == cmd_index_count || strncmp(cmd_index[lo]->name, cmd, len))
+		return NULL;
+
+	/* a full match sorts before the commands it is an abbreviation of */
+	if (!cmd_index[lo]->name[len])
+		return cmd_index[lo];
+
+	/* otherwise it must be the only command with this abbreviation */
+	if (lo + 1 < cmd_index_count &&
+	    !strncmp(cmd_index[lo + 1]->name, cmd, len))
+		return NULL;
+
+	return cmd_index[lo];
+}
+#endif /* CONFIG_CMDLINE */
+
 cmd_tbl_t *find_cmd(const char *cmd)
 {
 	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
 	const int len = ll_entry_count(cmd_tbl_t, cmd);
+
+#ifdef CONFIG_CMDLINE
+	/* the index is only built once malloc() memory is here to stay */
+	if (cmd && (gd->flags & GD_FLG_RELOC) &&
+	    (cmd_index || !cmd_index_build()))
+		return find_cmd_index(cmd);
+#endif
+
 	return find_cmd_tbl(cmd, start, len);
 }
 
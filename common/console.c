@@ -76,10 +76,13 @@ static int on_silent(const char *name, const char *value, enum env_op op,
 		return 0;
 #endif
 
-	if (value != NULL)
+	if (value) {
 		gd->flags |= GD_FLG_SILENT;
-	else
+	} else {
 		gd->flags &= ~GD_FLG_SILENT;
+		/* Send any output which was held while silent */
+		serial_flush();
+	}
 
 	return 0;
 }
@@ -511,8 +514,12 @@ void putc(const char c)
 		membuff_putbyte(&gd->console_out, c);
 #endif
 #ifdef CONFIG_SILENT_CONSOLE
-	if (gd->flags & GD_FLG_SILENT)
+	if (gd->flags & GD_FLG_SILENT) {
+		/* The serial TX buffer holds on to it until no longer silent */
+		if (IS_ENABLED(CONFIG_SERIAL_TX_BUFFER_SILENT))
+			serial_putc(c);
 		return;
+	}
 #endif
 
 #ifdef CONFIG_DISABLE_CONSOLE
@@ -559,8 +566,12 @@ void puts(const char *s)
 		membuff_put(&gd->console_out, s, strlen(s));
 #endif
 #ifdef CONFIG_SILENT_CONSOLE
-	if (gd->flags & GD_FLG_SILENT)
+	if (gd->flags & GD_FLG_SILENT) {
+		/* The serial TX buffer holds on to it until no longer silent */
+		if (IS_ENABLED(CONFIG_SERIAL_TX_BUFFER_SILENT))
+			serial_puts(s);
 		return;
+	}
 #endif
 
 #ifdef CONFIG_DISABLE_CONSOLE
@@ -34,6 +34,7 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 		pr_err("g_dnl_register failed");
 		return CMD_RET_FAILURE;
 	}
+	dfu_set_write_async(true);
 
 	while (1) {
 		if (g_dnl_detach()) {
@@ -81,8 +82,10 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 
 		WATCHDOG_RESET();
 		usb_gadget_handle_interrupts(usbctrl_index);
+		dfu_write_poll();
 	}
 exit:
+	dfu_set_write_async(false);
 	g_dnl_unregister();
 	usb_gadget_release(usbctrl_index);
 
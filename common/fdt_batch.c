@@ -0,0 +1,653 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Batched edits to a flat device tree
+ *
+ * See include/fdt_batch.h for an overview.
+ */
+
+#include <common.h>
+#include <fdt_batch.h>
+#include <fdt_support.h>
+#include <malloc.h>
+
+/* Maximum depth of the tree that fdt_batch_apply() can handle */
+#define FDT_BATCH_MAX_DEPTH	32
+
+/* Space needed for a property in the struct and strings blocks */
+static int fdt_batch_prop_space(const char *name, int len)
+{
+	return sizeof(struct fdt_property) + ALIGN(len, FDT_TAGSIZE) +
+		strlen(name) + 1;
+}
+
+static int fdt_batch_grow(void **arrayp, int *sizep, int item_size)
+{
+	int size = *sizep ? *sizep * 2 : 16;
+	void *array;
+
+	array = realloc(*arrayp, size * item_size);
+	if (!array)
+		return -FDT_ERR_NOSPACE;
+	*arrayp = array;
+	*sizep = size;
+
+	return 0;
+}
+
+static int fdt_batch_add_node(struct fdt_batch *batch, int offset,
+			      const char *name)
+{
+	struct fdt_batch_node *node;
+	int ret;
+
+	if (batch->node_count == batch->node_size) {
+		ret = fdt_batch_grow((void **)&batch->nodes, &batch->node_size,
+				     sizeof(*batch->nodes));
+		if (ret)
+			return ret;
+	}
+	node = &batch->nodes[batch->node_count];
+	memset(node, '\0', sizeof(*node));
+	node->offset = offset;
+	if (name) {
+		node->name = strdup(name);
+		if (!node->name)
+			return -FDT_ERR_NOSPACE;
+	}
+	node->first_prop = -1;
+	node->last_prop = -1;
+	node->first_child = -1;
+	node->next_sibling = -1;
+
+	return batch->node_count++;
+}
+
+static bool fdt_batch_valid(struct fdt_batch *batch, int node)
+{
+	return node >= 0 && node < batch->node_count;
+}
+
+int fdt_batch_init(struct fdt_batch *batch, void *fdt)
+{
+	memset(batch, '\0', sizeof(*batch));
+	batch->fdt = fdt;
+
+	return fdt_check_header(fdt);
+}
+
+void fdt_batch_uninit(struct fdt_batch *batch)
+{
+	int i;
+
+	for (i = 0; i < batch->node_count; i++)
+		free(batch->nodes[i].name);
+	for (i = 0; i < batch->prop_count; i++) {
+		free(batch->props[i].name);
+		free(batch->props[i].val);
+	}
+	free(batch->nodes);
+	free(batch->props);
+	batch->nodes = NULL;
+	batch->props = NULL;
+	batch->node_count = 0;
+	batch->node_size = 0;
+	batch->prop_count = 0;
+	batch->prop_size = 0;
+	batch->extra = 0;
+}
+
+int fdt_batch_node(struct fdt_batch *batch, int nodeoffset)
+{
+	int i;
+
+	if (nodeoffset < 0)
+		return nodeoffset;
+	/* Fixups only touch a small number of nodes, so just search them */
+	for (i = 0; i < batch->node_count; i++) {
+		if (batch->nodes[i].offset == nodeoffset)
+			return i;
+	}
+
+	return fdt_batch_add_node(batch, nodeoffset, NULL);
+}
+
+int fdt_batch_path(struct fdt_batch *batch, const char *path)
+{
+	return fdt_batch_node(batch, fdt_path_offset(batch->fdt, path));
+}
+
+int fdt_batch_find_subnode(struct fdt_batch *batch, int parent,
+			   const char *name)
+{
+	struct fdt_batch_node *pnode;
+	int handle, offset;
+
+	if (!fdt_batch_valid(batch, parent))
+		return -FDT_ERR_BADOFFSET;
+	pnode = &batch->nodes[parent];
+	if (pnode->offset >= 0) {
+		offset = fdt_subnode_offset(batch->fdt, pnode->offset, name);
+		if (offset >= 0)
+			return fdt_batch_node(batch, offset);
+		if (offset != -FDT_ERR_NOTFOUND)
+			return offset;
+	}
+	for (handle = pnode->first_child; handle != -1;
+	     handle = batch->nodes[handle].next_sibling) {
+		if (!strcmp(batch->nodes[handle].name, name))
+			return handle;
+	}
+
+	return -FDT_ERR_NOTFOUND;
+}
+
+int fdt_batch_add_subnode(struct fdt_batch *batch, int parent,
+			  const char *name)
+{
+	int handle;
+
+	if (!fdt_batch_valid(batch, parent))
+		return -FDT_ERR_BADOFFSET;
+	handle = fdt_batch_add_node(batch, -1, name);
+	if (handle < 0)
+		return handle;
+	/* Put it first, as fdt_add_subnode() does */
+	batch->nodes[handle].next_sibling = batch->nodes[parent].first_child;
+	batch->nodes[parent].first_child = handle;
+	batch->extra += 2 * FDT_TAGSIZE + ALIGN(strlen(name) + 1, FDT_TAGSIZE);
+
+	return handle;
+}
+
+int fdt_batch_subnode(struct fdt_batch *batch, int parent, const char *name)
+{
+	int handle;
+
+	handle = fdt_batch_find_subnode(batch, parent, name);
+	if (handle != -FDT_ERR_NOTFOUND)
+		return handle;
+
+	return fdt_batch_add_subnode(batch, parent, name);
+}
+
+/* Find the change to a property, or add a new one */
+static struct fdt_batch_prop *fdt_batch_get_prop(struct fdt_batch *batch,
+						 int node, const char *name)
+{
+	struct fdt_batch_node *bnode = &batch->nodes[node];
+	struct fdt_batch_prop *prop;
+	int i;
+
+	for (i = bnode->first_prop; i != -1; i = batch->props[i].next) {
+		if (!strcmp(batch->props[i].name, name))
+			return &batch->props[i];
+	}
+	if (batch->prop_count == batch->prop_size) {
+		if (fdt_batch_grow((void **)&batch->props, &batch->prop_size,
+				   sizeof(*batch->props)))
+			return NULL;
+	}
+	prop = &batch->props[batch->prop_count];
+	memset(prop, '\0', sizeof(*prop));
+	prop->name = strdup(name);
+	if (!prop->name)
+		return NULL;
+	prop->next = -1;
+	if (bnode->last_prop == -1)
+		bnode->first_prop = batch->prop_count;
+	else
+		batch->props[bnode->last_prop].next = batch->prop_count;
+	bnode->last_prop = batch->prop_count++;
+
+	return prop;
+}
+
+int fdt_batch_setprop(struct fdt_batch *batch, int node, const char *name,
+		      const void *val, int len)
+{
+	struct fdt_batch_prop *prop;
+	void *copy = NULL;
+
+	if (!fdt_batch_valid(batch, node))
+		return -FDT_ERR_BADOFFSET;
+	if (len < 0)
+		return -FDT_ERR_BADVALUE;
+	if (len) {
+		copy = malloc(len);
+		if (!copy)
+			return -FDT_ERR_NOSPACE;
+		memcpy(copy, val, len);
+	}
+	prop = fdt_batch_get_prop(batch, node, name);
+	if (!prop) {
+		free(copy);
+		return -FDT_ERR_NOSPACE;
+	}
+	free(prop->val);
+	prop->val = copy;
+	prop->len = len;
+	prop->del = false;
+	batch->extra += fdt_batch_prop_space(name, len);
+
+	return 0;
+}
+
+int fdt_batch_fixup_by_path(struct fdt_batch *batch, const char *path,
+			    const char *name, const void *val, int len,
+			    bool create)
+{
+	int offset, node;
+
+	offset = fdt_path_offset(batch->fdt, path);
+	if (offset < 0)
+		return offset;
+	if (!create && !fdt_get_property(batch->fdt, offset, name, NULL))
+		return 0;
+	node = fdt_batch_node(batch, offset);
+	if (node < 0)
+		return node;
+
+	return fdt_batch_setprop(batch, node, name, val, len);
+}
+
+int fdt_batch_delprop(struct fdt_batch *batch, int node, const char *name)
+{
+	struct fdt_batch_prop *prop;
+
+	if (!fdt_batch_valid(batch, node))
+		return -FDT_ERR_BADOFFSET;
+	prop = fdt_batch_get_prop(batch, node, name);
+	if (!prop)
+		return -FDT_ERR_NOSPACE;
+	free(prop->val);
+	prop->val = NULL;
+	prop->len = 0;
+	prop->del = true;
+
+	return 0;
+}
+
+int fdt_batch_delnode(struct fdt_batch *batch, int node)
+{
+	if (!fdt_batch_valid(batch, node))
+		return -FDT_ERR_BADOFFSET;
+	batch->nodes[node].del = true;
+
+	return 0;
+}
+
+/**
+ * struct fdt_batch_out - the new copy of the tree, as it is written
+ *
+ * The structure block is written straight into @buf. The old strings block
+ * is kept as it is, so existing properties can be copied without looking up
+ * their names; names which are not in it are collected in @strings and
+ * added to the end.
+ *
+ * @buf: Buffer for the new tree
+ * @size: Size of @buf
+ * @pos: Offset in @buf of the end of what has been written
+ * @old_strings: Strings block of the old tree
+ * @old_size: Size of @old_strings in bytes
+ * @strings: Strings to add after the old strings block
+ * @strings_len: Number of bytes used in @strings
+ * @found: Offsets of names already found in @old_strings
+ * @found_count: Number of entries used in @found
+ */
+struct fdt_batch_out {
+	char *buf;
+	int size;
+	int pos;
+	const char *old_strings;
+	int old_size;
+	char *strings;
+	int strings_len;
+	int *found;
+	int found_count;
+};
+
+static int fdt_batch_write(struct fdt_batch_out *out, const void *data,
+			   int len)
+{
+	int space = ALIGN(len, FDT_TAGSIZE);
+
+	if (out->pos + space > out->size)
+		return -FDT_ERR_NOSPACE;
+	memcpy(out->buf + out->pos, data, len);
+	memset(out->buf + out->pos + len, '\0', space - len);
+	out->pos += space;
+
+	return 0;
+}
+
+static int fdt_batch_write_tag(struct fdt_batch_out *out, uint32_t tag)
+{
+	fdt32_t val = cpu_to_fdt32(tag);
+
+	return fdt_batch_write(out, &val, sizeof(val));
+}
+
+/* Find a property name in the strings block, adding it if needed */
+static int fdt_batch_string(struct fdt_batch_out *out, const char *name)
+{
+	int len = strlen(name) + 1;
+	int i;
+
+	/* Check the names seen so far before searching the whole block */
+	for (i = 0; i < out->found_count; i++) {
+		if (!strcmp(out->old_strings + out->found[i], name))
+			return out->found[i];
+	}
+	for (i = 0; i < out->strings_len; i += strlen(out->strings + i) + 1) {
+		if (!strcmp(out->strings + i, name))
+			return out->old_size + i;
+	}
+	for (i = 0; i < out->old_size;
+	     i += strnlen(out->old_strings + i, out->old_size - i) + 1) {
+		if (!strcmp(out->old_strings + i, name)) {
+			out->found[out->found_count++] = i;
+			return i;
+		}
+	}
+	/* fdt_batch_apply() allocates enough space for every name */
+	memcpy(out->strings + out->strings_len, name, len);
+	out->strings_len += len;
+
+	return out->old_size + out->strings_len - len;
+}
+
+/* Write a property, looking up its name unless @nameoff is already known */
+static int fdt_batch_write_prop(struct fdt_batch_out *out, const char *name,
+				int nameoff, const void *val, int len)
+{
+	struct fdt_property prop;
+	int ret;
+
+	if (nameoff < 0)
+		nameoff = fdt_batch_string(out, name);
+	prop.tag = cpu_to_fdt32(FDT_PROP);
+	prop.len = cpu_to_fdt32(len);
+	prop.nameoff = cpu_to_fdt32(nameoff);
+	ret = fdt_batch_write(out, &prop, sizeof(prop));
+	if (!ret && len)
+		ret = fdt_batch_write(out, val, len);
+
+	return ret;
+}
+
+/* Write out the new properties and subnodes of a node, if not done yet */
+static int fdt_batch_flush(struct fdt_batch *batch, struct fdt_batch_out *out,
+			   int node)
+{
+	struct fdt_batch_node *bnode;
+	int i, ret;
+
+	if (node == -1 || batch->nodes[node].done)
+		return 0;
+	bnode = &batch->nodes[node];
+	bnode->done = true;
+	for (i = bnode->first_prop; i != -1; i = batch->props[i].next) {
+		struct fdt_batch_prop *prop = &batch->props[i];
+
+		if (prop->done || prop->del)
+			continue;
+		ret = fdt_batch_write_prop(out, prop->name, -1, prop->val,
+					   prop->len);
+		if (ret)
+			return ret;
+		prop->done = true;
+	}
+	for (i = bnode->first_child; i != -1;
+	     i = batch->nodes[i].next_sibling) {
+		const char *name = batch->nodes[i].name;
+
+		if (batch->nodes[i].del)
+			continue;
+		ret = fdt_batch_write_tag(out, FDT_BEGIN_NODE);
+		if (!ret)
+			ret = fdt_batch_write(out, name, strlen(name) + 1);
+		if (!ret)
+			ret = fdt_batch_flush(batch, out, i);
+		if (!ret)
+			ret = fdt_batch_write_tag(out, FDT_END_NODE);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Write out an existing property, or its replacement */
+static int fdt_batch_copy_prop(struct fdt_batch *batch,
+			       struct fdt_batch_out *out, int node, int offset,
+			       int next)
+{
+	const struct fdt_property *fprop;
+	const char *name;
+	int i;
+
+	if (node != -1 && batch->nodes[node].first_prop != -1) {
+		struct fdt_batch_node *bnode = &batch->nodes[node];
+
+		fprop = fdt_get_property_by_offset(batch->fdt, offset, NULL);
+		if (!fprop)
+			return -FDT_ERR_BADSTRUCTURE;
+		name = fdt_string(batch->fdt, fdt32_to_cpu(fprop->nameoff));
+		if (!name)
+			return -FDT_ERR_BADSTRUCTURE;
+		for (i = bnode->first_prop; i != -1;
+		     i = batch->props[i].next) {
+			struct fdt_batch_prop *prop = &batch->props[i];
+
+			if (strcmp(prop->name, name))
+				continue;
+			prop->done = true;
+			if (prop->del)
+				return 0;
+			return fdt_batch_write_prop(out, name,
+					fdt32_to_cpu(fprop->nameoff),
+					prop->val, prop->len);
+		}
+	}
+
+	/* The name offset is still valid, so copy the property as it is */
+	return fdt_batch_write(out, fdt_offset_ptr(batch->fdt, offset,
+						   next - offset),
+			       next - offset);
+}
+
+struct fdt_batch_order {
+	int offset;
+	int node;
+};
+
+static int fdt_batch_order_cmp(const void *a, const void *b)
+{
+	const struct fdt_batch_order *oa = a, *ob = b;
+
+	return oa->offset - ob->offset;
+}
+
+/*
+ * Copy the tree structure from batch->fdt to @out, making the edits as we go.
+ * @order lists the existing nodes in the batch, in the order they appear in
+ * the tree, so we can find them without searching.
+ */
+static int fdt_batch_copy(struct fdt_batch *batch, struct fdt_batch_out *out,
+			  struct fdt_batch_order *order, int order_count)
+{
+	int stack[FDT_BATCH_MAX_DEPTH];
+	int offset, next;
+	int depth = -1;
+	int skip = -1;
+	int pos = 0;
+	uint32_t tag;
+	int ret = 0;
+
+	offset = 0;
+	do {
+		tag = fdt_next_tag(batch->fdt, offset, &next);
+		switch (tag) {
+		case FDT_BEGIN_NODE: {
+			int node = -1;
+
+			if (++depth >= FDT_BATCH_MAX_DEPTH)
+				return -FDT_ERR_BADSTRUCTURE;
+			if (skip != -1)
+				break;
+			while (pos < order_count && order[pos].offset < offset)
+				pos++;
+			if (pos < order_count && order[pos].offset == offset)
+				node = order[pos].node;
+			if (node != -1 && batch->nodes[node].del) {
+				skip = depth;
+				break;
+			}
+			/* New subnodes go before the existing ones */
+			if (depth)
+				ret = fdt_batch_flush(batch, out,
+						      stack[depth - 1]);
+			if (!ret)
+				ret = fdt_batch_write(out,
+					fdt_offset_ptr(batch->fdt, offset,
+						       next - offset),
+					next - offset);
+			stack[depth] = node;
+			break;
+		}
+		case FDT_PROP:
+			if (skip == -1)
+				ret = fdt_batch_copy_prop(batch, out,
+							  stack[depth], offset,
+							  next);
+			break;
+		case FDT_END_NODE:
+			if (depth < 0)
+				return -FDT_ERR_BADSTRUCTURE;
+			if (skip == depth) {
+				skip = -1;
+			} else if (skip == -1) {
+				ret = fdt_batch_flush(batch, out, stack[depth]);
+				if (!ret)
+					ret = fdt_batch_write_tag(out,
+								  FDT_END_NODE);
+			}
+			depth--;
+			break;
+		case FDT_NOP:
+			break;
+		case FDT_END:
+			ret = fdt_batch_write_tag(out, FDT_END);
+			break;
+		default:
+			return -FDT_ERR_BADSTRUCTURE;
+		}
+		if (ret)
+			return ret;
+		offset = next;
+	} while (tag != FDT_END);
+
+	return 0;
+}
+
+int fdt_batch_apply(struct fdt_batch *batch)
+{
+	struct fdt_batch_order *order = NULL;
+	struct fdt_batch_out out;
+	void *fdt = batch->fdt;
+	int order_count = 0;
+	int strings_size = 0;
+	int rsv_size, i, ret;
+
+	if (!batch->node_count)
+		return 0;
+	ret = fdt_check_header(fdt);
+	if (ret)
+		return ret;
+
+	memset(&out, '\0', sizeof(out));
+	out.size = fdt_totalsize(fdt) + batch->extra;
+	out.buf = malloc(out.size);
+	out.old_strings = fdt + fdt_off_dt_strings(fdt);
+	out.old_size = fdt_size_dt_strings(fdt);
+	for (i = 0; i < batch->prop_count; i++)
+		strings_size += strlen(batch->props[i].name) + 1;
+	out.strings = malloc(strings_size + 1);
+	out.found = malloc((batch->prop_count + 1) * sizeof(int));
+	order = malloc(batch->node_count * sizeof(*order));
+	if (!out.buf || !out.strings || !out.found || !order) {
+		ret = -FDT_ERR_NOSPACE;
+		goto done;
+	}
+	for (i = 0; i < batch->node_count; i++) {
+		if (batch->nodes[i].offset >= 0) {
+			order[order_count].offset = batch->nodes[i].offset;
+			order[order_count++].node = i;
+		}
+	}
+	qsort(order, order_count, sizeof(*order), fdt_batch_order_cmp);
+
+	/* The header and reserve map are the same, apart from the sizes */
+	rsv_size = (fdt_num_mem_rsv(fdt) + 1) *
+		sizeof(struct fdt_reserve_entry);
+	out.pos = ALIGN(sizeof(struct fdt_header), 8);
+	if (out.pos + rsv_size > out.size) {
+		ret = -FDT_ERR_NOSPACE;
+		goto done;
+	}
+	memcpy(out.buf, fdt, sizeof(struct fdt_header));
+	memcpy(out.buf + out.pos, fdt + fdt_off_mem_rsvmap(fdt), rsv_size);
+	fdt_set_off_mem_rsvmap(out.buf, out.pos);
+	out.pos += rsv_size;
+	fdt_set_off_dt_struct(out.buf, out.pos);
+
+	ret = fdt_batch_copy(batch, &out, order, order_count);
+	if (ret)
+		goto done;
+	fdt_set_size_dt_struct(out.buf, out.pos - fdt_off_dt_struct(out.buf));
+	if (out.pos + out.old_size + out.strings_len > out.size) {
+		ret = -FDT_ERR_NOSPACE;
+		goto done;
+	}
+	fdt_set_off_dt_strings(out.buf, out.pos);
+	memcpy(out.buf + out.pos, out.old_strings, out.old_size);
+	memcpy(out.buf + out.pos + out.old_size, out.strings, out.strings_len);
+	fdt_set_size_dt_strings(out.buf, out.old_size + out.strings_len);
+	fdt_set_totalsize(out.buf, out.pos + out.old_size + out.strings_len);
+
+	/* This checks that the result fits before changing anything */
+	ret = fdt_open_into(out.buf, fdt, fdt_totalsize(fdt));
+
+done:
+	free(out.buf);
+	free(out.strings);
+	free(out.found);
+	free(order);
+	if (!ret) {
+		fdt_batch_uninit(batch);
+	} else {
+		/* Leave the batch as it was, so it can be retried */
+		for (i = 0; i < batch->node_count; i++)
+			batch->nodes[i].done = false;
+		for (i = 0; i < batch->prop_count; i++)
+			batch->props[i].done = false;
+	}
+
+	return ret;
+}
+
+int fdt_batch_apply_resize(struct fdt_batch *batch)
+{
+	int ret;
+
+	ret = fdt_batch_apply(batch);
+	if (ret != -FDT_ERR_NOSPACE)
+		return ret;
+
+	/* The batch is left as it was, so make room and try again */
+	ret = fdt_increase_size(batch->fdt, batch->extra);
+	if (ret)
+		return ret;
+
+	return fdt_batch_apply(batch);
+}
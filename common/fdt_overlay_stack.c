@@ -0,0 +1,829 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Apply a stack of device tree overlays in a single pass
+ *
+ * fdt_overlay_apply() finds each fragment target and symbol by scanning the
+ * base tree, then merges the overlay one property at a time, moving the rest
+ * of the tree each time. Applying many overlays repeats all of this for each
+ * one. Here the base tree is indexed once, by path and by phandle, and every
+ * overlay is merged into a batch of edits (see fdt_batch.h) which is written
+ * out at the end.
+ */
+
+#include <common.h>
+#include <fdt_batch.h>
+#include <fdt_support.h>
+#include <malloc.h>
+
+/* FNV-1a hash of a node path, built up one component at a time */
+#define OVS_HASH_INIT		2166136261U
+#define OVS_HASH_MULT		16777619U
+
+/**
+ * struct ovs_node - a node in the base tree, or one added by an overlay
+ *
+ * @offset: Offset of the node in the base tree, or -1 if added by an overlay
+ * @handle: Batch handle for the node, or -1 if not allocated yet
+ * @parent: Index of the parent node, or -1 for the root node
+ * @phandle: Phandle of the node, or 0 if none
+ * @hash: Hash of the path to the node
+ * @next_hash: Index of the next node in the same path-hash bucket, or -1
+ * @next_phandle: Index of the next node in the same phandle bucket, or -1
+ */
+struct ovs_node {
+	int offset;
+	int handle;
+	int parent;
+	u32 phandle;
+	u32 hash;
+	int next_hash;
+	int next_phandle;
+};
+
+/**
+ * struct ovs_symbol - a symbol (label) which overlays can refer to
+ *
+ * @name: Name of the symbol, in the base tree or in an overlay
+ * @path: Path of the node that the symbol refers to
+ * @alloced: Allocated copy of @path to free, or NULL if it is in the base tree
+ * @next: Index of the next symbol in the same bucket, or -1
+ */
+struct ovs_symbol {
+	const char *name;
+	const char *path;
+	char *alloced;
+	int next;
+};
+
+/**
+ * struct ovs_state - state while applying a stack of overlays
+ *
+ * @batch: Edits to make to the base tree
+ * @nodes: Nodes of the base tree, in the order they appear, followed by the
+ *	nodes added by the overlays
+ * @count: Number of entries used in @nodes
+ * @size: Number of entries allocated in @nodes
+ * @base_count: Number of nodes in the base tree
+ * @path_hash: Index of the first node in each path-hash bucket, or -1
+ * @phandle_hash: Index of the first node in each phandle bucket, or -1
+ * @hash_mask: Number of buckets in each hash table, minus 1
+ * @max_phandle: Largest phandle used so far
+ * @symbols: Index of the /__symbols__ node, or -1 if there is none yet
+ * @syms: Symbols from /__symbols__, including those added by the overlays
+ * @sym_count: Number of entries used in @syms
+ * @sym_size: Number of entries allocated in @syms
+ * @sym_hash: Index of the first symbol in each bucket, or -1
+ * @sym_mask: Number of buckets in @sym_hash, minus 1
+ */
+struct ovs_state {
+	struct fdt_batch batch;
+	struct ovs_node *nodes;
+	int count;
+	int size;
+	int base_count;
+	int *path_hash;
+	int *phandle_hash;
+	u32 hash_mask;
+	u32 max_phandle;
+	int symbols;
+	struct ovs_symbol *syms;
+	int sym_count;
+	int sym_size;
+	int *sym_hash;
+	u32 sym_mask;
+};
+
+static u32 ovs_hash_name(u32 hash, const char *name, int len)
+{
+	hash = (hash ^ '/') * OVS_HASH_MULT;
+	while (len--)
+		hash = (hash ^ (u8)*name++) * OVS_HASH_MULT;
+
+	return hash;
+}
+
+static const char *ovs_name(struct ovs_state *ovs, int idx, int *lenp)
+{
+	struct ovs_node *node = &ovs->nodes[idx];
+	const char *name;
+
+	if (node->offset >= 0)
+		return fdt_get_name(ovs->batch.fdt, node->offset, lenp);
+	name = ovs->batch.nodes[node->handle].name;
+	*lenp = strlen(name);
+
+	return name;
+}
+
+static int ovs_add_node(struct ovs_state *ovs, int offset, int parent,
+			u32 hash)
+{
+	struct ovs_node *node;
+	int *bucket;
+	int idx;
+
+	if (ovs->count == ovs->size) {
+		node = realloc(ovs->nodes, ovs->size * 2 * sizeof(*node));
+		if (!node)
+			return -FDT_ERR_NOSPACE;
+		ovs->nodes = node;
+		ovs->size *= 2;
+	}
+	idx = ovs->count++;
+	node = &ovs->nodes[idx];
+	node->offset = offset;
+	node->handle = -1;
+	node->parent = parent;
+	node->phandle = 0;
+	node->hash = hash;
+	bucket = &ovs->path_hash[hash & ovs->hash_mask];
+	node->next_hash = *bucket;
+	*bucket = idx;
+	node->next_phandle = -1;
+
+	return idx;
+}
+
+static void ovs_set_phandle(struct ovs_state *ovs, int idx, u32 phandle)
+{
+	struct ovs_node *node = &ovs->nodes[idx];
+	int *bucket;
+
+	if (!phandle || phandle == (u32)-1)
+		return;
+	if (phandle > ovs->max_phandle)
+		ovs->max_phandle = phandle;
+	if (node->phandle) {
+		/* It stays in its old bucket; ovs_find_phandle() copes */
+		node->phandle = phandle;
+		return;
+	}
+	node->phandle = phandle;
+	bucket = &ovs->phandle_hash[phandle & ovs->hash_mask];
+	node->next_phandle = *bucket;
+	*bucket = idx;
+}
+
+/* Get the batch handle for a node, allocating one if needed */
+static int ovs_handle(struct ovs_state *ovs, int idx)
+{
+	struct ovs_node *node = &ovs->nodes[idx];
+
+	if (node->handle < 0)
+		node->handle = fdt_batch_node(&ovs->batch, node->offset);
+
+	return node->handle;
+}
+
+/* Find the node at a given offset in the base tree */
+static int ovs_offset_to_node(struct ovs_state *ovs, int offset)
+{
+	int lo = 0, hi = ovs->base_count;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (ovs->nodes[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == ovs->base_count || ovs->nodes[lo].offset != offset)
+		return -FDT_ERR_BADOFFSET;
+
+	return lo;
+}
+
+/* Check a node's path against @path, working up from the last component */
+static bool ovs_path_matches(struct ovs_state *ovs, int idx, const char *path)
+{
+	const char *end = path + strlen(path);
+
+	for (;;) {
+		const char *start, *name;
+		int len;
+
+		while (end > path && end[-1] == '/')
+			end--;
+		if (end == path)
+			return ovs->nodes[idx].parent == -1;
+		if (ovs->nodes[idx].parent == -1)
+			return false;
+		for (start = end; start > path && start[-1] != '/'; start--)
+			;
+		name = ovs_name(ovs, idx, &len);
+		if (!name || len != end - start || memcmp(name, start, len))
+			return false;
+		idx = ovs->nodes[idx].parent;
+		end = start;
+	}
+}
+
+static int ovs_find_path(struct ovs_state *ovs, const char *path)
+{
+	u32 hash = OVS_HASH_INIT;
+	const char *p, *end;
+	int idx, offset;
+
+	if (*path == '/') {
+		for (p = path; *p; p = end) {
+			while (*p == '/')
+				p++;
+			if (!*p)
+				break;
+			end = strchrnul(p, '/');
+			hash = ovs_hash_name(hash, p, end - p);
+		}
+		for (idx = ovs->path_hash[hash & ovs->hash_mask]; idx != -1;
+		     idx = ovs->nodes[idx].next_hash) {
+			if (ovs->nodes[idx].hash == hash &&
+			    ovs_path_matches(ovs, idx, path))
+				return idx;
+		}
+	}
+
+	/*
+	 * Let libfdt deal with aliases and node names given without their
+	 * unit address. These only work for nodes in the base tree.
+	 */
+	offset = fdt_path_offset(ovs->batch.fdt, path);
+	if (offset < 0)
+		return offset;
+
+	return ovs_offset_to_node(ovs, offset);
+}
+
+static int ovs_find_phandle(struct ovs_state *ovs, u32 phandle)
+{
+	int idx;
+
+	for (idx = ovs->phandle_hash[phandle & ovs->hash_mask]; idx != -1;
+	     idx = ovs->nodes[idx].next_phandle) {
+		if (ovs->nodes[idx].phandle == phandle)
+			return idx;
+	}
+	/* The phandle of a node may have been changed by an overlay */
+	for (idx = 0; idx < ovs->count; idx++) {
+		if (ovs->nodes[idx].phandle == phandle)
+			return idx;
+	}
+
+	return -FDT_ERR_NOTFOUND;
+}
+
+/* Find a subnode by its full name, adding it if needed */
+static int ovs_subnode(struct ovs_state *ovs, int parent, const char *name)
+{
+	int len = strlen(name);
+	u32 hash = ovs_hash_name(ovs->nodes[parent].hash, name, len);
+	int idx, handle;
+
+	for (idx = ovs->path_hash[hash & ovs->hash_mask]; idx != -1;
+	     idx = ovs->nodes[idx].next_hash) {
+		const char *node_name;
+		int node_len;
+
+		if (ovs->nodes[idx].hash != hash ||
+		    ovs->nodes[idx].parent != parent)
+			continue;
+		node_name = ovs_name(ovs, idx, &node_len);
+		if (node_name && node_len == len &&
+		    !memcmp(node_name, name, len))
+			return idx;
+	}
+
+	handle = ovs_handle(ovs, parent);
+	if (handle < 0)
+		return handle;
+	handle = fdt_batch_add_subnode(&ovs->batch, handle, name);
+	if (handle < 0)
+		return handle;
+	idx = ovs_add_node(ovs, -1, parent, hash);
+	if (idx < 0)
+		return idx;
+	ovs->nodes[idx].handle = handle;
+
+	return idx;
+}
+
+/* Index the nodes of the base tree by path and by phandle */
+static int ovs_scan(struct ovs_state *ovs)
+{
+	const void *fdt = ovs->batch.fdt;
+	int parents[FDT_MAX_DEPTH];
+	int offset, depth, count;
+	u32 buckets;
+
+	count = 0;
+	for (offset = 0; offset >= 0; offset = fdt_next_node(fdt, offset, NULL))
+		count++;
+	if (offset != -FDT_ERR_NOTFOUND)
+		return offset;
+
+	for (buckets = 16; buckets < count; buckets *= 2)
+		;
+	ovs->hash_mask = buckets - 1;
+	ovs->size = count + 16;
+	ovs->nodes = malloc(ovs->size * sizeof(*ovs->nodes));
+	ovs->path_hash = malloc(buckets * sizeof(int));
+	ovs->phandle_hash = malloc(buckets * sizeof(int));
+	if (!ovs->nodes || !ovs->path_hash || !ovs->phandle_hash)
+		return -FDT_ERR_NOSPACE;
+	memset(ovs->path_hash, '\xff', buckets * sizeof(int));
+	memset(ovs->phandle_hash, '\xff', buckets * sizeof(int));
+
+	depth = 0;
+	for (offset = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(fdt, offset, &depth)) {
+		u32 hash = OVS_HASH_INIT;
+		int parent = -1;
+		int idx;
+
+		if (depth >= FDT_MAX_DEPTH)
+			return -FDT_ERR_BADSTRUCTURE;
+		if (depth) {
+			const char *name;
+			int len;
+
+			parent = parents[depth - 1];
+			name = fdt_get_name(fdt, offset, &len);
+			if (!name)
+				return len;
+			hash = ovs_hash_name(ovs->nodes[parent].hash, name,
+					     len);
+		}
+		idx = ovs_add_node(ovs, offset, parent, hash);
+		if (idx < 0)
+			return idx;
+		parents[depth] = idx;
+		ovs_set_phandle(ovs, idx, fdt_get_phandle(fdt, offset));
+	}
+	ovs->base_count = ovs->count;
+
+	return 0;
+}
+
+static int ovs_find_symbol(struct ovs_state *ovs, const char *name)
+{
+	u32 hash = ovs_hash_name(OVS_HASH_INIT, name, strlen(name));
+	int idx;
+
+	for (idx = ovs->sym_hash[hash & ovs->sym_mask]; idx != -1;
+	     idx = ovs->syms[idx].next) {
+		if (!strcmp(ovs->syms[idx].name, name))
+			return idx;
+	}
+
+	return -FDT_ERR_NOTFOUND;
+}
+
+/* Add or update a symbol; @alloced is freed later */
+static int ovs_add_symbol(struct ovs_state *ovs, const char *name,
+			  const char *path, char *alloced)
+{
+	struct ovs_symbol *sym;
+	int idx;
+	u32 hash;
+
+	idx = ovs_find_symbol(ovs, name);
+	if (idx >= 0) {
+		sym = &ovs->syms[idx];
+		free(sym->alloced);
+		sym->path = path;
+		sym->alloced = alloced;
+		return 0;
+	}
+	if (ovs->sym_count == ovs->sym_size) {
+		sym = realloc(ovs->syms, ovs->sym_size * 2 * sizeof(*sym));
+		if (!sym) {
+			free(alloced);
+			return -FDT_ERR_NOSPACE;
+		}
+		ovs->syms = sym;
+		ovs->sym_size *= 2;
+	}
+	hash = ovs_hash_name(OVS_HASH_INIT, name, strlen(name));
+	idx = ovs->sym_count++;
+	sym = &ovs->syms[idx];
+	sym->name = name;
+	sym->path = path;
+	sym->alloced = alloced;
+	sym->next = ovs->sym_hash[hash & ovs->sym_mask];
+	ovs->sym_hash[hash & ovs->sym_mask] = idx;
+
+	return 0;
+}
+
+/* Index the symbols in the base tree */
+static int ovs_scan_symbols(struct ovs_state *ovs)
+{
+	const void *fdt = ovs->batch.fdt;
+	int offset = -1, prop, count = 0;
+	u32 buckets;
+
+	if (ovs->symbols >= 0) {
+		offset = ovs->nodes[ovs->symbols].offset;
+		fdt_for_each_property_offset(prop, fdt, offset)
+			count++;
+	}
+	for (buckets = 16; buckets < count; buckets *= 2)
+		;
+	ovs->sym_mask = buckets - 1;
+	ovs->sym_size = count + 16;
+	ovs->syms = malloc(ovs->sym_size * sizeof(*ovs->syms));
+	ovs->sym_hash = malloc(buckets * sizeof(int));
+	if (!ovs->syms || !ovs->sym_hash)
+		return -FDT_ERR_NOSPACE;
+	memset(ovs->sym_hash, '\xff', buckets * sizeof(int));
+	if (offset < 0)
+		return 0;
+
+	fdt_for_each_property_offset(prop, fdt, offset) {
+		const char *name, *path;
+		int len, ret;
+
+		path = fdt_getprop_by_offset(fdt, prop, &name, &len);
+		if (!path)
+			return len;
+		/* Skip anything that is not a string, as it is not a path */
+		if (!len || path[len - 1])
+			continue;
+		ret = ovs_add_symbol(ovs, name, path, NULL);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int ovs_init(struct ovs_state *ovs, void *fdt)
+{
+	int ret;
+
+	memset(ovs, '\0', sizeof(*ovs));
+	ret = fdt_batch_init(&ovs->batch, fdt);
+	if (ret)
+		return ret;
+	ret = ovs_scan(ovs);
+	if (ret)
+		return ret;
+	ret = ovs_find_path(ovs, "/__symbols__");
+	if (ret < 0 && ret != -FDT_ERR_NOTFOUND)
+		return ret;
+	ovs->symbols = ret < 0 ? -1 : ret;
+
+	return ovs_scan_symbols(ovs);
+}
+
+static void ovs_uninit(struct ovs_state *ovs)
+{
+	int i;
+
+	for (i = 0; i < ovs->sym_count; i++)
+		free(ovs->syms[i].alloced);
+	free(ovs->syms);
+	free(ovs->sym_hash);
+	fdt_batch_uninit(&ovs->batch);
+	free(ovs->nodes);
+	free(ovs->path_hash);
+	free(ovs->phandle_hash);
+}
+
+/* Get the node that a fragment applies to, like overlay_get_target() */
+static int ovs_get_target(struct ovs_state *ovs, const void *fdto,
+			  int fragment)
+{
+	const fdt32_t *val;
+	const char *path;
+	u32 phandle = 0;
+	int len;
+
+	val = fdt_getprop(fdto, fragment, "target", &len);
+	if (val) {
+		if (len != sizeof(*val) || fdt32_to_cpu(*val) == (u32)-1)
+			return -FDT_ERR_BADPHANDLE;
+		phandle = fdt32_to_cpu(*val);
+	}
+	if (phandle)
+		return ovs_find_phandle(ovs, phandle);
+
+	path = fdt_getprop(fdto, fragment, "target-path", &len);
+	if (!path)
+		return len == -FDT_ERR_NOTFOUND ? -FDT_ERR_BADOVERLAY : len;
+
+	return ovs_find_path(ovs, path);
+}
+
+/* Get the phandle of the node that a symbol refers to */
+static int ovs_symbol_phandle(struct ovs_state *ovs, const char *label,
+			      u32 *phandlep)
+{
+	int idx;
+
+	idx = ovs_find_symbol(ovs, label);
+	if (idx < 0)
+		return idx;
+	idx = ovs_find_path(ovs, ovs->syms[idx].path);
+	if (idx < 0)
+		return idx;
+	if (!ovs->nodes[idx].phandle)
+		return -FDT_ERR_NOTFOUND;
+	*phandlep = ovs->nodes[idx].phandle;
+
+	return 0;
+}
+
+/* Resolve the references in __fixups__, like overlay_fixup_phandles() */
+static int ovs_fixup_phandles(struct ovs_state *ovs, void *fdto)
+{
+	int fixups, property;
+
+	fixups = fdt_subnode_offset(fdto, 0, "__fixups__");
+	if (fixups == -FDT_ERR_NOTFOUND)
+		return 0;
+	if (fixups < 0)
+		return fixups;
+
+	fdt_for_each_property_offset(property, fdto, fixups) {
+		const char *value, *label;
+		fdt32_t phandle_prop;
+		u32 phandle;
+		int len, ret;
+
+		value = fdt_getprop_by_offset(fdto, property, &label, &len);
+		if (len == -FDT_ERR_NOTFOUND)
+			return -FDT_ERR_INTERNAL;
+		if (!value)
+			return len;
+		ret = ovs_symbol_phandle(ovs, label, &phandle);
+		if (ret)
+			return ret;
+		phandle_prop = cpu_to_fdt32(phandle);
+
+		/* Each fixup is "<path>:<property>:<offset>" */
+		while (len > 0) {
+			const char *path = value, *name, *sep, *end;
+			int path_len, name_len, fixup_off;
+			char *endptr;
+			ulong poffset;
+
+			end = memchr(value, '\0', len);
+			if (!end)
+				return -FDT_ERR_BADOVERLAY;
+			len -= end - value + 1;
+			value = end + 1;
+
+			sep = memchr(path, ':', end - path);
+			if (!sep || sep == end - 1)
+				return -FDT_ERR_BADOVERLAY;
+			path_len = sep - path;
+			name = sep + 1;
+			sep = memchr(name, ':', end - name);
+			if (!sep || sep == name)
+				return -FDT_ERR_BADOVERLAY;
+			name_len = sep - name;
+			poffset = simple_strtoul(sep + 1, &endptr, 10);
+			if (*endptr || endptr == sep + 1)
+				return -FDT_ERR_BADOVERLAY;
+
+			fixup_off = fdt_path_offset_namelen(fdto, path,
+							    path_len);
+			if (fixup_off == -FDT_ERR_NOTFOUND)
+				return -FDT_ERR_BADOVERLAY;
+			if (fixup_off < 0)
+				return fixup_off;
+			ret = fdt_setprop_inplace_namelen_partial(fdto,
+					fixup_off, name, name_len, poffset,
+					&phandle_prop, sizeof(phandle_prop));
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+/* Merge an overlay node into a node, like overlay_apply_node() */
+static int ovs_apply_node(struct ovs_state *ovs, int target,
+			  const void *fdto, int node)
+{
+	int property, subnode, handle;
+
+	handle = ovs_handle(ovs, target);
+	if (handle < 0)
+		return handle;
+
+	fdt_for_each_property_offset(property, fdto, node) {
+		const char *name;
+		const void *prop;
+		int prop_len, ret;
+
+		prop = fdt_getprop_by_offset(fdto, property, &name, &prop_len);
+		if (prop_len == -FDT_ERR_NOTFOUND)
+			return -FDT_ERR_INTERNAL;
+		if (prop_len < 0)
+			return prop_len;
+		ret = fdt_batch_setprop(&ovs->batch, handle, name, prop,
+					prop_len);
+		if (ret)
+			return ret;
+		if (prop_len == sizeof(fdt32_t) &&
+		    (!strcmp(name, "phandle") ||
+		     !strcmp(name, "linux,phandle")))
+			ovs_set_phandle(ovs, target,
+					fdt32_to_cpu(*(const fdt32_t *)prop));
+	}
+
+	fdt_for_each_subnode(subnode, fdto, node) {
+		const char *name = fdt_get_name(fdto, subnode, NULL);
+		int idx, ret;
+
+		idx = ovs_subnode(ovs, target, name);
+		if (idx < 0)
+			return idx;
+		ret = ovs_apply_node(ovs, idx, fdto, subnode);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int ovs_merge(struct ovs_state *ovs, const void *fdto)
+{
+	int fragment;
+
+	fdt_for_each_subnode(fragment, fdto, 0) {
+		int overlay, target, ret;
+
+		/* Fragments without an __overlay__ node are not merged */
+		overlay = fdt_subnode_offset(fdto, fragment, "__overlay__");
+		if (overlay == -FDT_ERR_NOTFOUND)
+			continue;
+		if (overlay < 0)
+			return overlay;
+
+		target = ovs_get_target(ovs, fdto, fragment);
+		if (target < 0)
+			return target;
+		ret = ovs_apply_node(ovs, target, fdto, overlay);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Set a symbol to the path of a node, plus a relative path */
+static int ovs_set_symbol(struct ovs_state *ovs, int symbols, const char *name,
+			  int target, const char *rel_path, int rel_path_len)
+{
+	int len, pos, idx, ret;
+	char *buf;
+
+	len = 0;
+	for (idx = target; ovs->nodes[idx].parent != -1;
+	     idx = ovs->nodes[idx].parent) {
+		int name_len;
+
+		if (!ovs_name(ovs, idx, &name_len))
+			return name_len;
+		len += name_len + 1;
+	}
+
+	/* @rel_path_len includes the nul terminator */
+	buf = malloc(len + 1 + rel_path_len);
+	if (!buf)
+		return -FDT_ERR_NOSPACE;
+	pos = len;
+	for (idx = target; ovs->nodes[idx].parent != -1;
+	     idx = ovs->nodes[idx].parent) {
+		const char *node_name;
+		int name_len;
+
+		node_name = ovs_name(ovs, idx, &name_len);
+		pos -= name_len;
+		memcpy(buf + pos, node_name, name_len);
+		buf[--pos] = '/';
+	}
+	buf[len] = '/';
+	memcpy(buf + len + 1, rel_path, rel_path_len);
+	ret = fdt_batch_setprop(&ovs->batch, symbols, name, buf,
+				len + 1 + rel_path_len);
+	if (ret) {
+		free(buf);
+		return ret;
+	}
+
+	/* Later overlays in the stack can refer to it */
+	return ovs_add_symbol(ovs, name, buf, buf);
+}
+
+/* Add the overlay's symbols to the tree, like overlay_symbol_update() */
+static int ovs_symbol_update(struct ovs_state *ovs, const void *fdto)
+{
+	const int overlay_len = sizeof("/__overlay__/") - 1;
+	int ov_sym, prop, handle;
+
+	ov_sym = fdt_subnode_offset(fdto, 0, "__symbols__");
+	if (ov_sym < 0)
+		return 0;
+
+	if (ovs->symbols < 0) {
+		ovs->symbols = ovs_subnode(ovs, 0, "__symbols__");
+		if (ovs->symbols < 0)
+			return ovs->symbols;
+	}
+	handle = ovs_handle(ovs, ovs->symbols);
+	if (handle < 0)
+		return handle;
+
+	fdt_for_each_property_offset(prop, fdto, ov_sym) {
+		const char *path, *name, *s, *e, *rel_path;
+		int path_len, fragment, target, ret;
+
+		path = fdt_getprop_by_offset(fdto, prop, &name, &path_len);
+		if (!path)
+			return path_len;
+		if (path_len < 1 ||
+		    memchr(path, '\0', path_len) != &path[path_len - 1])
+			return -FDT_ERR_BADVALUE;
+		e = path + path_len;
+
+		/* Format: /<fragment-name>/__overlay__/<relative-path> */
+		if (*path != '/')
+			return -FDT_ERR_BADVALUE;
+		s = strchr(path + 1, '/');
+		if (!s)
+			return -FDT_ERR_BADOVERLAY;
+		if (e - s < overlay_len ||
+		    memcmp(s, "/__overlay__/", overlay_len))
+			return -FDT_ERR_BADOVERLAY;
+		rel_path = s + overlay_len;
+
+		fragment = fdt_subnode_offset_namelen(fdto, 0, path + 1,
+						      s - path - 1);
+		if (fragment < 0)
+			return -FDT_ERR_BADOVERLAY;
+		if (fdt_subnode_offset(fdto, fragment, "__overlay__") < 0)
+			return -FDT_ERR_BADOVERLAY;
+		target = ovs_get_target(ovs, fdto, fragment);
+		if (target < 0)
+			return target;
+
+		ret = ovs_set_symbol(ovs, handle, name, target, rel_path,
+				     e - rel_path);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int ovs_apply(struct ovs_state *ovs, void *fdto)
+{
+	int ret;
+
+	ret = fdt_overlay_prepare(fdto, ovs->max_phandle);
+	if (ret)
+		return ret;
+	ret = ovs_fixup_phandles(ovs, fdto);
+	if (ret)
+		return ret;
+	ret = ovs_merge(ovs, fdto);
+	if (ret)
+		return ret;
+
+	return ovs_symbol_update(ovs, fdto);
+}
+
+int fdt_overlay_apply_stack(void *fdt, int bufsize, void *const fdtos[],
+			    int count)
+{
+	struct ovs_state ovs;
+	int i, size, ret;
+
+	ret = ovs_init(&ovs, fdt);
+	for (i = 0; !ret && i < count; i++) {
+		ret = fdt_check_header(fdtos[i]);
+		if (ret)
+			break;
+		ret = ovs_apply(&ovs, fdtos[i]);
+
+		/* The overlay has been changed, so cannot be applied again */
+		fdt_set_magic(fdtos[i], ~0);
+	}
+
+	if (!ret) {
+		/* Grow the tree once, by no more than the edits could need */
+		size = min(bufsize,
+			   (int)fdt_totalsize(fdt) + ovs.batch.extra);
+		if (size > (int)fdt_totalsize(fdt))
+			ret = fdt_open_into(fdt, fdt, size);
+	}
+	if (!ret)
+		ret = fdt_batch_apply(&ovs.batch);
+	ovs_uninit(&ovs);
+
+	return ret;
+}
@@ -13,6 +13,7 @@
 #include <linux/types.h>
 #include <asm/global_data.h>
 #include <linux/libfdt.h>
+#include <fdt_batch.h>
 #include <fdt_support.h>
 #include <exports.h>
 #include <fdtdec.h>
@@ -122,15 +123,29 @@ int fdt_find_or_add_subnode(void *fdt, int parentoffset, const char *name)
 	return offset;
 }
 
+/*
+ * Find or create a subnode, either through a batch (see fdt_batch_start())
+ * or directly
+ */
+static int fdt_batch_maybe_subnode(void *fdt, struct fdt_batch *batch,
+				   int parent, const char *name)
+{
+	if (batch)
+		return fdt_batch_subnode(batch, parent, name);
+
+	return fdt_find_or_add_subnode(fdt, parent, name);
+}
+
 /* rename to CONFIG_OF_STDOUT_PATH ? */
 #if defined(OF_STDOUT_PATH)
-static int fdt_fixup_stdout(void *fdt, int chosenoff)
+static int fdt_fixup_stdout(void *fdt, struct fdt_batch *batch, int chosenoff)
 {
-	return fdt_setprop(fdt, chosenoff, "linux,stdout-path",
-			      OF_STDOUT_PATH, strlen(OF_STDOUT_PATH) + 1);
+	return fdt_batch_maybe_setprop(fdt, batch, chosenoff,
+				       "linux,stdout-path", OF_STDOUT_PATH,
+				       strlen(OF_STDOUT_PATH) + 1);
 }
 #elif defined(CONFIG_OF_STDOUT_VIA_ALIAS) && defined(CONFIG_CONS_INDEX)
-static int fdt_fixup_stdout(void *fdt, int chosenoff)
+static int fdt_fixup_stdout(void *fdt, struct fdt_batch *batch, int chosenoff)
 {
 	int err;
 	int aliasoff;
@@ -156,7 +171,8 @@ static int fdt_fixup_stdout(void *fdt, int chosenoff)
 	/* fdt_setprop may break "path" so we copy it to tmp buffer */
 	memcpy(tmp, path, len);
 
-	err = fdt_setprop(fdt, chosenoff, "linux,stdout-path", tmp, len);
+	err = fdt_batch_maybe_setprop(fdt, batch, chosenoff,
+				      "linux,stdout-path", tmp, len);
 	if (err < 0)
 		printf("WARNING: could not set linux,stdout-path %s.\n",
 		       fdt_strerror(err));
@@ -170,19 +186,25 @@ noalias:
 	return 0;
 }
 #else
-static int fdt_fixup_stdout(void *fdt, int chosenoff)
+static int fdt_fixup_stdout(void *fdt, struct fdt_batch *batch, int chosenoff)
 {
 	return 0;
 }
 #endif
 
-static inline int fdt_setprop_uxx(void *fdt, int nodeoffset, const char *name,
+static inline int fdt_setprop_uxx(void *fdt, struct fdt_batch *batch,
+				  int nodeoffset, const char *name,
 				  uint64_t val, int is_u64)
 {
+	fdt64_t val64 = cpu_to_fdt64(val);
+	fdt32_t val32 = cpu_to_fdt32(val);
+
 	if (is_u64)
-		return fdt_setprop_u64(fdt, nodeoffset, name, val);
+		return fdt_batch_maybe_setprop(fdt, batch, nodeoffset, name,
+					       &val64, sizeof(val64));
 	else
-		return fdt_setprop_u32(fdt, nodeoffset, name, (uint32_t)val);
+		return fdt_batch_maybe_setprop(fdt, batch, nodeoffset, name,
+					       &val32, sizeof(val32));
 }
 
 int fdt_root(void *fdt)
@@ -213,6 +235,7 @@ int fdt_root(void *fdt)
 
 int fdt_initrd(void *fdt, ulong initrd_start, ulong initrd_end)
 {
+	struct fdt_batch batch, *bp;
 	int   nodeoffset;
 	int   err, j, total;
 	int is_u64;
@@ -222,10 +245,15 @@ int fdt_initrd(void *fdt, ulong initrd_start, ulong initrd_end)
 	if (initrd_start == initrd_end)
 		return 0;
 
+	/* Set the properties together rather than moving the tree each time */
+	bp = fdt_batch_start(&batch, fdt);
+
 	/* find or create "/chosen" node. */
-	nodeoffset = fdt_find_or_add_subnode(fdt, 0, "chosen");
+	nodeoffset = fdt_batch_maybe_subnode(fdt, bp,
+					     fdt_batch_maybe_node(bp, 0),
+					     "chosen");
 	if (nodeoffset < 0)
-		return nodeoffset;
+		return fdt_batch_finish(bp, nodeoffset);
 
 	total = fdt_num_mem_rsv(fdt);
 
@@ -242,64 +270,88 @@ int fdt_initrd(void *fdt, ulong initrd_start, ulong initrd_end)
 	}
 
 	err = fdt_add_mem_rsv(fdt, initrd_start, initrd_end - initrd_start);
+	if (err == -FDT_ERR_NOSPACE) {
+		err = fdt_increase_size(fdt, sizeof(struct fdt_reserve_entry));
+		if (!err)
+			err = fdt_add_mem_rsv(fdt, initrd_start,
+					      initrd_end - initrd_start);
+	}
 	if (err < 0) {
 		printf("fdt_initrd: %s\n", fdt_strerror(err));
-		return err;
+		return fdt_batch_finish(bp, err);
 	}
 
 	is_u64 = (fdt_address_cells(fdt, 0) == 2);
 
-	err = fdt_setprop_uxx(fdt, nodeoffset, "linux,initrd-start",
+	err = fdt_setprop_uxx(fdt, bp, nodeoffset, "linux,initrd-start",
 			      (uint64_t)initrd_start, is_u64);
 
 	if (err < 0) {
 		printf("WARNING: could not set linux,initrd-start %s.\n",
 		       fdt_strerror(err));
-		return err;
+		return fdt_batch_finish(bp, err);
 	}
 
-	err = fdt_setprop_uxx(fdt, nodeoffset, "linux,initrd-end",
+	err = fdt_setprop_uxx(fdt, bp, nodeoffset, "linux,initrd-end",
 			      (uint64_t)initrd_end, is_u64);
 
 	if (err < 0) {
 		printf("WARNING: could not set linux,initrd-end %s.\n",
 		       fdt_strerror(err));
 
-		return err;
+		return fdt_batch_finish(bp, err);
 	}
 
-	return 0;
+	err = fdt_batch_finish(bp, 0);
+	if (err < 0)
+		printf("%s: %s\n", __func__, fdt_strerror(err));
+
+	return err;
 }
 
 int fdt_chosen(void *fdt)
 {
+	struct fdt_batch batch, *bp;
 	int   nodeoffset;
 	int   err;
 	char  *str;		/* used to set string properties */
 
 	err = fdt_check_header(fdt);
 	if (err < 0) {
-		printf("fdt_chosen: %s\n", fdt_strerror(err));
+		printf("%s: %s\n", __func__, fdt_strerror(err));
 		return err;
 	}
 
+	/* Set the properties together rather than moving the tree each time */
+	bp = fdt_batch_start(&batch, fdt);
+
 	/* find or create "/chosen" node. */
-	nodeoffset = fdt_find_or_add_subnode(fdt, 0, "chosen");
+	nodeoffset = fdt_batch_maybe_subnode(fdt, bp,
+					     fdt_batch_maybe_node(bp, 0),
+					     "chosen");
 	if (nodeoffset < 0)
-		return nodeoffset;
+		return fdt_batch_finish(bp, nodeoffset);
 
 	str = env_get("bootargs");
 	if (str) {
-		err = fdt_setprop(fdt, nodeoffset, "bootargs", str,
-				  strlen(str) + 1);
+		err = fdt_batch_maybe_setprop(fdt, bp, nodeoffset, "bootargs",
+					      str, strlen(str) + 1);
 		if (err < 0) {
 			printf("WARNING: could not set bootargs %s.\n",
 			       fdt_strerror(err));
-			return err;
+			return fdt_batch_finish(bp, err);
 		}
 	}
 
-	return fdt_fixup_stdout(fdt, nodeoffset);
+	err = fdt_fixup_stdout(fdt, bp, nodeoffset);
+	if (err < 0)
+		return fdt_batch_finish(bp, err);
+
+	err = fdt_batch_finish(bp, 0);
+	if (err < 0)
+		printf("%s: %s\n", __func__, fdt_strerror(err));
+
+	return err;
 }
 
 void do_fixup_by_path(void *fdt, const char *path, const char *prop,
@@ -416,6 +468,7 @@ static int fdt_pack_reg(const void *fdt, void *buf, u64 *address, u64 *size,
 #endif
 int fdt_fixup_memory_banks(void *blob, u64 start[], u64 size[], int banks)
 {
+	struct fdt_batch batch, *bp;
 	int err, nodeoffset;
 	int len, i;
 	u8 tmp[MEMORY_BANKS_MAX * 16]; /* Up to 64-bit address + 64-bit size */
@@ -433,17 +486,22 @@ int fdt_fixup_memory_banks(void *blob, u64 start[], u64 size[], int banks)
 		return err;
 	}
 
+	/* Set the properties together rather than moving the tree each time */
+	bp = fdt_batch_start(&batch, blob);
+
 	/* find or create "/memory" node. */
-	nodeoffset = fdt_find_or_add_subnode(blob, 0, "memory");
+	nodeoffset = fdt_batch_maybe_subnode(blob, bp,
+					     fdt_batch_maybe_node(bp, 0),
+					     "memory");
 	if (nodeoffset < 0)
-			return nodeoffset;
+		return fdt_batch_finish(bp, nodeoffset);
 
-	err = fdt_setprop(blob, nodeoffset, "device_type", "memory",
-			sizeof("memory"));
+	err = fdt_batch_maybe_setprop(blob, bp, nodeoffset, "device_type",
+				      "memory", sizeof("memory"));
 	if (err < 0) {
 		printf("WARNING: could not set %s %s.\n", "device_type",
 				fdt_strerror(err));
-		return err;
+		return fdt_batch_finish(bp, err);
 	}
 
 	for (i = 0; i < banks; i++) {
@@ -453,18 +511,23 @@ int fdt_fixup_memory_banks(void *blob, u64 start[], u64 size[], int banks)
 
 	banks = i;
 
-	if (!banks)
-		return 0;
+	if (banks) {
+		len = fdt_pack_reg(blob, tmp, start, size, banks);
 
-	len = fdt_pack_reg(blob, tmp, start, size, banks);
-
-	err = fdt_setprop(blob, nodeoffset, "reg", tmp, len);
-	if (err < 0) {
-		printf("WARNING: could not set %s %s.\n",
-				"reg", fdt_strerror(err));
-		return err;
+		err = fdt_batch_maybe_setprop(blob, bp, nodeoffset, "reg",
+					      tmp, len);
+		if (err < 0) {
+			printf("WARNING: could not set %s %s.\n",
+			       "reg", fdt_strerror(err));
+			return fdt_batch_finish(bp, err);
+		}
 	}
-	return 0;
+
+	err = fdt_batch_finish(bp, 0);
+	if (err < 0)
+		printf("%s: %s\n", __func__, fdt_strerror(err));
+
+	return err;
 }
 #endif
 
@@ -480,7 +543,8 @@ void fdt_fixup_ethernet(void *fdt)
 	char mac[16];
 	const char *path;
 	unsigned char mac_addr[ARP_HLEN];
-	int offset;
+	struct fdt_batch batch, *bp;
+	int offset, ret;
 #ifdef FDT_SEQ_MACADDR_FROM_ENV
 	int nodeoff;
 	const struct fdt_property *fdt_prop;
@@ -489,6 +553,9 @@ void fdt_fixup_ethernet(void *fdt)
 	if (fdt_path_offset(fdt, "/aliases") < 0)
 		return;
 
+	/* Set the addresses together rather than moving the tree each time */
+	bp = fdt_batch_start(&batch, fdt);
+
 	/* Cycle through all aliases */
 	for (prop = 0; ; prop++) {
 		const char *name;
@@ -543,12 +610,26 @@ void fdt_fixup_ethernet(void *fdt)
 					tmp = (*end) ? end + 1 : end;
 			}
 
-			do_fixup_by_path(fdt, path, "mac-address",
-					 &mac_addr, 6, 0);
-			do_fixup_by_path(fdt, path, "local-mac-address",
-					 &mac_addr, 6, 1);
+			if (bp) {
+				fdt_batch_fixup_by_path(bp, path,
+							"mac-address",
+							&mac_addr, 6, false);
+				fdt_batch_fixup_by_path(bp, path,
+							"local-mac-address",
+							&mac_addr, 6, true);
+			} else {
+				do_fixup_by_path(fdt, path, "mac-address",
+						 &mac_addr, 6, 0);
+				do_fixup_by_path(fdt, path, "local-mac-address",
+						 &mac_addr, 6, 1);
+			}
 		}
 	}
+
+	ret = fdt_batch_finish(bp, 0);
+	if (ret)
+		printf("Unable to update MAC addresses, err=%s\n",
+		       fdt_strerror(ret));
 }
 
 int fdt_record_loadable(void *blob, u32 index, const char *name,
@@ -1735,6 +1816,15 @@ int fdt_fixup_display(void *blob, const char *path, const char *display)
 }
 
 #ifdef CONFIG_OF_LIBFDT_OVERLAY
+static void fdt_overlay_report(const char *func, int err, bool has_symbols)
+{
+	printf("failed on %s(): %s\n", func, fdt_strerror(err));
+	if (!has_symbols) {
+		printf("base fdt does did not have a /__symbols__ node\n");
+		printf("make sure you've compiled with -@\n");
+	}
+}
+
 /**
  * fdt_overlay_apply_verbose - Apply an overlay with verbose error reporting
  *
@@ -1749,18 +1839,44 @@ int fdt_overlay_apply_verbose(void *fdt, void *fdto)
 	int err;
 	bool has_symbols;
 
+	if (CONFIG_IS_ENABLED(OF_OVERLAY_STACK))
+		return fdt_overlay_apply_stack_verbose(fdt, fdt_totalsize(fdt),
+						       &fdto, 1);
+
 	err = fdt_path_offset(fdt, "/__symbols__");
 	has_symbols = err >= 0;
 
 	err = fdt_overlay_apply(fdt, fdto);
-	if (err < 0) {
-		printf("failed on fdt_overlay_apply(): %s\n",
-				fdt_strerror(err));
-		if (!has_symbols) {
-			printf("base fdt does did not have a /__symbols__ node\n");
-			printf("make sure you've compiled with -@\n");
-		}
-	}
+	if (err < 0)
+		fdt_overlay_report("fdt_overlay_apply", err, has_symbols);
+	return err;
+}
+
+#if CONFIG_IS_ENABLED(OF_OVERLAY_STACK)
+/**
+ * fdt_overlay_apply_stack_verbose - Apply overlays with verbose error reporting
+ *
+ * @fdt: ptr to device tree
+ * @bufsize: size of the buffer holding the device tree
+ * @fdtos: list of device tree overlays
+ * @count: number of overlays in @fdtos
+ *
+ * Convenience function to apply a list of overlays and display helpful
+ * messages in the case of an error
+ */
+int fdt_overlay_apply_stack_verbose(void *fdt, int bufsize,
+				    void *const fdtos[], int count)
+{
+	int err;
+	bool has_symbols;
+
+	err = fdt_path_offset(fdt, "/__symbols__");
+	has_symbols = err >= 0;
+
+	err = fdt_overlay_apply_stack(fdt, bufsize, fdtos, count);
+	if (err < 0)
+		fdt_overlay_report("fdt_overlay_apply_stack", err, has_symbols);
 	return err;
 }
 #endif
+#endif
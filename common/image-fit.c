@@ -18,6 +18,7 @@
 #include <errno.h>
 #include <mapmem.h>
 #include <asm/io.h>
+#include <dma.h>
 #include <malloc.h>
 DECLARE_GLOBAL_DATA_PTR;
 #endif /* !USE_HOSTCC*/
@@ -945,6 +946,30 @@ int fit_image_get_data_size(const void *fit, int noffset, int *data_size)
 	return 0;
 }
 
+/**
+ * Get 'uncomp-size' property from a given image node.
+ *
+ * @fit: pointer to the FIT image header
+ * @noffset: component image node offset
+ * @uncomp_size: holds the uncomp-size property
+ *
+ * returns:
+ *     0, on success
+ *     -ENOENT if the property could not be found
+ */
+int fit_image_get_uncomp_size(const void *fit, int noffset, int *uncomp_size)
+{
+	const fdt32_t *val;
+
+	val = fdt_getprop(fit, noffset, FIT_UNCOMP_SIZE_PROP, NULL);
+	if (!val)
+		return -ENOENT;
+
+	*uncomp_size = fdt32_to_cpu(*val);
+
+	return 0;
+}
+
 /**
  * fit_image_get_data_and_size - get data and its size including
  *				 both embedded and external data
@@ -1725,6 +1750,83 @@ static int fit_image_select(const void *fit, int rd_noffset, int verify)
 	return 0;
 }
 
+#if defined(USE_HOSTCC) || defined(CONFIG_FIT_IMAGE_POST_PROCESS)
+#define FIT_VERIFY_ON_COPY	0
+#else
+#define FIT_VERIFY_ON_COPY	CONFIG_IS_ENABLED(DMA_COPY)
+#endif
+
+/**
+ * fit_image_verify_on_copy() - Check whether to verify an image as it loads
+ *
+ * With DMA_COPY, the hash of an image which is copied to its load address is
+ * checked while the copy runs, rather than before it starts. This is only
+ * done if the copy leaves the FIT alone, so that the data which is checked
+ * is the data which is copied.
+ *
+ * @fit:	FIT to check
+ * @noffset:	Offset of image node
+ * @addr:	Address of the FIT
+ * @load_op:	How to load the image
+ * @return true to verify the image in fit_image_copy(), false to verify it
+ *	first
+ */
+static bool fit_image_verify_on_copy(const void *fit, int noffset, ulong addr,
+				     enum fit_load_op load_op)
+{
+	const void *buf;
+	size_t size;
+	ulong load;
+
+	if (!FIT_VERIFY_ON_COPY || load_op == FIT_LOAD_IGNORED)
+		return false;
+	if (fit_image_get_load(fit, noffset, &load) ||
+	    (load_op == FIT_LOAD_OPTIONAL_NON_ZERO && !load))
+		return false;
+	if (fit_image_get_data_and_size(fit, noffset, &buf, &size))
+		return false;
+
+	return load >= addr + fit_get_size(fit) || load + size <= addr;
+}
+
+/**
+ * fit_image_copy() - Copy an image to its load address
+ *
+ * @fit:	FIT containing the image
+ * @noffset:	Offset of image node
+ * @dst:	Load address
+ * @buf:	Image data
+ * @len:	Length of image data
+ * @verify:	true to verify the image while it is copied
+ * @return 0 if OK, -EACCES if the image failed verification
+ */
+static int fit_image_copy(const void *fit, int noffset, void *dst,
+			  const void *buf, ulong len, bool verify)
+{
+#if FIT_VERIFY_ON_COPY
+	struct dma_copy copy;
+	int ok;
+
+	dma_copy_start(&copy, dst, buf, len);
+	if (!verify) {
+		dma_copy_wait(&copy);
+		return 0;
+	}
+	puts("   Verifying Hash Integrity ... ");
+	ok = fit_image_verify(fit, noffset);
+	dma_copy_wait(&copy);
+	if (!ok) {
+		puts("Bad Data Hash\n");
+		return -EACCES;
+	}
+	puts("OK\n");
+#else
+	memmove(dst, buf, len);
+#endif
+
+	return 0;
+}
+
 int fit_get_node_from_config(bootm_headers_t *images, const char *prop_name,
 			ulong addr)
 {
@@ -1804,6 +1906,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	uint8_t os_arch;
 #endif
 	const char *prop_name;
+	bool verify_on_copy;
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -1875,7 +1978,9 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	verify_on_copy = images->verify &&
+		fit_image_verify_on_copy(fit, noffset, addr, load_op);
+	ret = fit_image_select(fit, noffset, images->verify && !verify_on_copy);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
@@ -1995,7 +2100,12 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		       prop_name, data, load);
 
 		dst = map_sysmem(load, len);
-		memmove(dst, buf, len);
+		ret = fit_image_copy(fit, noffset, dst, buf, len,
+				     verify_on_copy);
+		if (ret) {
+			bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
+			return ret;
+		}
 		data = load;
 	}
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_LOAD);
@@ -2050,6 +2160,11 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 	const char *uname;
 	void *base, *ov;
 	int i, err, noffset, ov_noffset;
+#if CONFIG_IS_ENABLED(OF_OVERLAY_STACK)
+	void **ovs = NULL, **new_ovs;
+	ulong ovs_len = 0;
+	int ovs_count = 0;
+#endif
 #endif
 
 	fit_uname = fit_unamep ? *fit_unamep : NULL;
@@ -2147,6 +2262,17 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 				uname, ovload, ovlen);
 		ov = map_sysmem(ovload, ovlen);
 
+#if CONFIG_IS_ENABLED(OF_OVERLAY_STACK)
+		/* Collect the overlays, to apply them all at once below */
+		new_ovs = realloc(ovs, (ovs_count + 1) * sizeof(*ovs));
+		if (!new_ovs) {
+			fdt_noffset = -ENOMEM;
+			goto out;
+		}
+		ovs = new_ovs;
+		ovs[ovs_count++] = ov;
+		ovs_len += ovlen;
+#else
 		base = map_sysmem(load, len + ovlen);
 		err = fdt_open_into(base, base, len + ovlen);
 		if (err < 0) {
@@ -2162,7 +2288,22 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 		}
 		fdt_pack(base);
 		len = fdt_totalsize(base);
+#endif
+	}
+#if CONFIG_IS_ENABLED(OF_OVERLAY_STACK)
+	if (ovs_count) {
+		/* grow the tree in place once, for all the overlays */
+		base = map_sysmem(load, len + ovs_len);
+		err = fdt_overlay_apply_stack_verbose(base, len + ovs_len, ovs,
+						      ovs_count);
+		if (err < 0) {
+			fdt_noffset = err;
+			goto out;
+		}
+		fdt_pack(base);
+		len = fdt_totalsize(base);
 	}
+#endif
 #else
 	printf("config with overlays but CONFIG_OF_LIBFDT_OVERLAY not set\n");
 	fdt_noffset = -EBADF;
@@ -2180,6 +2321,9 @@ out:
 
 	if (fit_uname_config_copy)
 		free(fit_uname_config_copy);
+#if defined(CONFIG_OF_LIBFDT_OVERLAY) && CONFIG_IS_ENABLED(OF_OVERLAY_STACK)
+	free(ovs);
+#endif
 	return fdt_noffset;
 }
 #endif
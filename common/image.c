@@ -16,6 +16,7 @@
 
 #include <rtc.h>
 
+#include <dma.h>
 #include <environment.h>
 #include <image.h>
 #include <mapmem.h>
@@ -178,6 +179,7 @@ static const table_entry_t uimage_comp[] = {
 	{	IH_COMP_LZMA,	"lzma",		"lzma compressed",	},
 	{	IH_COMP_LZO,	"lzo",		"lzo compressed",	},
 	{	IH_COMP_LZ4,	"lz4",		"lz4 compressed",	},
+	{	IH_COMP_ZSTD,	"zstd",		"zstd compressed",	},
 	{	-1,		"",		"",			},
 };
 
@@ -528,6 +530,13 @@ void memmove_wd(void *to, void *from, size_t len, ulong chunksz)
 	if (to == from)
 		return;
 
+	/* Large copies between separate areas may be done by DMA */
+	if (CONFIG_IS_ENABLED(DMA_COPY) &&
+	    (to + len <= from || from + len <= to)) {
+		dma_copy(to, from, len);
+		return;
+	}
+
 #if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
 	if (to > from) {
 		from += len;
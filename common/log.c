@@ -155,6 +155,8 @@ static bool log_passes_filters(struct log_device *ldev, struct log_rec *rec)
 
 	/* If there are no filters, filter on the default log level */
 	if (list_empty(&ldev->filter_head)) {
+		if (ldev->drv->flags & LOGDF_ALL_LEVELS)
+			return true;
 		if (rec->level > gd->default_log_level)
 			return false;
 		return true;
@@ -179,18 +181,37 @@ static bool log_passes_filters(struct log_device *ldev, struct log_rec *rec)
  * log_dispatch() - Send a log record to all log devices for processing
  *
  * The log record is sent to each log device in turn, skipping those which have
- * filters which block the record
+ * filters which block the record. The message is only formatted if a device
+ * which needs it accepts the record.
  *
  * @rec: Log record to dispatch
+ * @buf: Buffer of CONFIG_SYS_CBSIZE bytes to use for the formatted message
+ * @fmt: printf() format string for the message
+ * @args: Arguments for @fmt
  * @return 0 (meaning success)
  */
-static int log_dispatch(struct log_rec *rec)
+static int log_dispatch(struct log_rec *rec, char *buf, const char *fmt,
+			va_list args)
 {
 	struct log_device *ldev;
+	va_list copy;
 
 	list_for_each_entry(ldev, &gd->log_head, sibling_node) {
-		if (log_passes_filters(ldev, rec))
-			ldev->drv->emit(ldev, rec);
+		if (!log_passes_filters(ldev, rec))
+			continue;
+		if (ldev->drv->emit_fmt) {
+			va_copy(copy, args);
+			ldev->drv->emit_fmt(ldev, rec, fmt, copy);
+			va_end(copy);
+			continue;
+		}
+		if (!rec->msg) {
+			va_copy(copy, args);
+			vsnprintf(buf, CONFIG_SYS_CBSIZE, fmt, copy);
+			va_end(copy);
+			rec->msg = buf;
+		}
+		ldev->drv->emit(ldev, rec);
 	}
 
 	return 0;
@@ -203,21 +224,20 @@ int _log(enum log_category_t cat, enum log_level_t level, const char *file,
 	struct log_rec rec;
 	va_list args;
 
+	if (!gd || !(gd->flags & GD_FLG_LOG_READY)) {
+		if (gd)
+			gd->log_drop_count++;
+		return -ENOSYS;
+	}
 	rec.cat = cat;
 	rec.level = level;
 	rec.file = file;
 	rec.line = line;
 	rec.func = func;
+	rec.msg = NULL;
 	va_start(args, fmt);
-	vsnprintf(buf, sizeof(buf), fmt, args);
+	log_dispatch(&rec, buf, fmt, args);
 	va_end(args);
-	rec.msg = buf;
-	if (!gd || !(gd->flags & GD_FLG_LOG_READY)) {
-		if (gd)
-			gd->log_drop_count++;
-		return -ENOSYS;
-	}
-	log_dispatch(&rec);
 
 	return 0;
 }
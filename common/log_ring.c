@@ -0,0 +1,490 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Log driver which records messages in a ring buffer
+ *
+ * Records are stored in binary form, with the format string and the raw
+ * arguments, and are only formatted when they are shown with 'log dump'.
+ * This keeps the cost of logging low enough to leave debug categories
+ * enabled. SPL and TPL store the formatted message instead, since their
+ * records may be shown by a later phase. See struct log_ring_hdr for the
+ * layout of the buffer.
+ *
+ * U-Boot runs on a single CPU without preemption, so the buffer needs no
+ * locking: each record is built on the stack and copied in at the head.
+ */
+
+#include <common.h>
+#include <bloblist.h>
+#include <log.h>
+#include <malloc.h>
+#include <linux/ctype.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Largest record, including its header */
+#define REC_MAX		256
+
+#if defined(CONFIG_TPL_BUILD)
+#define RING_PHASE	LOGRP_TPL
+#elif defined(CONFIG_SPL_BUILD)
+#define RING_PHASE	LOGRP_SPL
+#else
+#define RING_PHASE	LOGRP_PROPER
+#endif
+
+static const char *const phase_name[] = {
+	[LOGRP_PROPER]	= "u-boot",
+	[LOGRP_SPL]	= "spl",
+	[LOGRP_TPL]	= "tpl",
+};
+
+/* Types of argument for a printf() conversion */
+enum arg_type {
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_PTR,
+	ARG_STR,
+	ARG_UNSUPPORTED,
+};
+
+/**
+ * struct fmt_spec - a conversion in a format string
+ *
+ * @start: Pointer to the '%' which starts the conversion
+ * @end: Pointer to the character after the conversion
+ * @width_arg: true if the width is given by an argument ('*')
+ * @prec_arg: true if the precision is given by an argument ('*')
+ * @type: Type of the argument to convert
+ */
+struct fmt_spec {
+	const char *start;
+	const char *end;
+	bool width_arg;
+	bool prec_arg;
+	enum arg_type type;
+};
+
+static struct log_ring_hdr *ring;
+
+static u8 *ring_data(void)
+{
+	return (u8 *)(ring + 1);
+}
+
+static struct log_ring_rec *ring_rec(uint pos)
+{
+	return (struct log_ring_rec *)(ring_data() + pos);
+}
+
+/**
+ * fmt_next() - Find the next conversion in a format string
+ *
+ * @fmtp: Pointer into the format string, updated to point after the
+ *	conversion
+ * @spec: Returns information about the conversion
+ * @return true if a conversion was found, false if there are no more
+ */
+static bool fmt_next(const char **fmtp, struct fmt_spec *spec)
+{
+	const char *p = *fmtp;
+
+	for (;; p += 2) {
+		p = strchr(p, '%');
+		if (!p)
+			return false;
+		if (p[1] != '%')
+			break;
+	}
+
+	spec->start = p++;
+	while (*p && strchr("-+ #0", *p))
+		p++;
+	spec->width_arg = *p == '*';
+	if (spec->width_arg)
+		p++;
+	while (isdigit(*p))
+		p++;
+	spec->prec_arg = false;
+	if (*p == '.') {
+		spec->prec_arg = *++p == '*';
+		if (spec->prec_arg)
+			p++;
+		while (isdigit(*p))
+			p++;
+	}
+
+	spec->type = ARG_INT;
+	switch (*p) {
+	case 'h':
+		if (*++p == 'h')
+			p++;
+		break;
+	case 'l':
+		spec->type = ARG_LONG;
+		if (*++p == 'l') {
+			spec->type = ARG_LLONG;
+			p++;
+		}
+		break;
+	case 'L':
+	case 'q':
+		spec->type = ARG_LLONG;
+		p++;
+		break;
+	case 'z':
+	case 'Z':
+	case 't':
+		spec->type = ARG_LONG;
+		p++;
+		break;
+	}
+
+	switch (*p) {
+	case 'c':
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		break;
+	case 's':
+		spec->type = ARG_STR;
+		break;
+	case 'p':
+		/* Extensions such as %pM dereference the pointer */
+		spec->type = isalnum(p[1]) ? ARG_UNSUPPORTED : ARG_PTR;
+		break;
+	default:
+		spec->type = ARG_UNSUPPORTED;
+		break;
+	}
+	if (*p)
+		p++;
+	spec->end = p;
+	*fmtp = p;
+
+	return true;
+}
+
+/**
+ * ring_encode() - Store the arguments for a format string
+ *
+ * @buf: Buffer to write to
+ * @size: Size of buffer in bytes
+ * @fmt: printf() format string
+ * @args: Arguments for @fmt
+ * @return number of bytes written, -ENOSPC if @buf is too small, or
+ *	-EINVAL if the format string uses a conversion which cannot be stored
+ */
+static int ring_encode(u8 *buf, int size, const char *fmt, va_list args)
+{
+	struct fmt_spec spec;
+	int pos = 0, len;
+	const char *str;
+	u64 val;
+
+	while (fmt_next(&fmt, &spec)) {
+		if (spec.type == ARG_UNSUPPORTED)
+			return -EINVAL;
+		if (pos + 3 * sizeof(u64) > size)
+			return -ENOSPC;
+		if (spec.width_arg) {
+			*(u64 *)(buf + pos) = va_arg(args, int);
+			pos += sizeof(u64);
+		}
+		if (spec.prec_arg) {
+			*(u64 *)(buf + pos) = va_arg(args, int);
+			pos += sizeof(u64);
+		}
+
+		switch (spec.type) {
+		case ARG_INT:
+			val = va_arg(args, int);
+			break;
+		case ARG_LONG:
+			val = va_arg(args, long);
+			break;
+		case ARG_LLONG:
+			val = va_arg(args, long long);
+			break;
+		case ARG_PTR:
+			val = (ulong)va_arg(args, void *);
+			break;
+		case ARG_STR:
+		default:
+			str = va_arg(args, const char *);
+			if (!str)
+				str = "<NULL>";
+			len = strnlen(str, size - pos - 1);
+			memcpy(buf + pos, str, len);
+			buf[pos + len] = '\0';
+			pos += ALIGN(len + 1, sizeof(u64));
+			continue;
+		}
+		*(u64 *)(buf + pos) = val;
+		pos += sizeof(u64);
+	}
+
+	return pos;
+}
+
+/* Copy text from a format string, which may include "%%" */
+static char *copy_literal(char *out, char *end, const char *from,
+			  const char *to)
+{
+	for (; from < to && out < end; from++) {
+		if (*from == '%' && from[1] == '%')
+			from++;
+		*out++ = *from;
+	}
+
+	return out;
+}
+
+/* Read the next u64 argument, or 0 if there is none */
+static u64 next_arg(const u8 **datap, const u8 *end)
+{
+	u64 val = 0;
+
+	if (*datap + sizeof(u64) <= end) {
+		val = *(u64 *)*datap;
+		*datap += sizeof(u64);
+	}
+
+	return val;
+}
+
+/**
+ * ring_decode() - Format the message for a record
+ *
+ * @rec: Record to decode
+ * @buf: Buffer for the message
+ * @size: Size of @buf in bytes
+ */
+static void ring_decode(struct log_ring_rec *rec, char *buf, int size)
+{
+	const u8 *data = (u8 *)rec + LOG_RING_REC_HDR;
+	const u8 *data_end = (u8 *)rec + rec->size;
+	char *out = buf, *end = buf + size - 1;
+	const char *fmt = rec->fmt, *last;
+	struct fmt_spec spec;
+	char conv[32], *cp;
+	const char *str;
+	const char *p;
+	u64 val;
+
+	if (rec->flags & LOGRF_MSG) {
+		strlcpy(buf, (const char *)data,
+			min_t(int, size, data_end - data));
+		return;
+	}
+	if (rec->phase != RING_PHASE) {
+		/* The format string is in another phase's image */
+		strlcpy(buf, "<message not stored>\n", size);
+		return;
+	}
+
+	for (last = fmt; fmt_next(&fmt, &spec); last = spec.end) {
+		out = copy_literal(out, end, last, spec.start);
+
+		/* Put the width and precision into the conversion */
+		cp = conv;
+		for (p = spec.start; p < spec.end && cp < conv + 20; p++) {
+			if (*p == '*')
+				cp += sprintf(cp, "%d",
+					      (int)next_arg(&data, data_end));
+			else
+				*cp++ = *p;
+		}
+		*cp = '\0';
+
+		if (spec.type == ARG_STR) {
+			str = "";
+			if (data < data_end) {
+				str = (const char *)data;
+				data += ALIGN(strnlen(str, data_end - data) + 1,
+					      sizeof(u64));
+			}
+			out += snprintf(out, end - out + 1, conv, str);
+		} else {
+			val = next_arg(&data, data_end);
+			if (spec.type == ARG_LLONG)
+				out += snprintf(out, end - out + 1, conv, val);
+			else if (spec.type == ARG_LONG)
+				out += snprintf(out, end - out + 1, conv,
+						(long)val);
+			else if (spec.type == ARG_PTR)
+				out += snprintf(out, end - out + 1, conv,
+						(void *)(ulong)val);
+			else
+				out += snprintf(out, end - out + 1, conv,
+						(int)val);
+		}
+		if (out > end)
+			out = end;
+	}
+	out = copy_literal(out, end, last, last + strlen(last));
+	*out = '\0';
+}
+
+/* Get the position of the record at @pos, following a wrap marker */
+static uint ring_wrap(uint pos)
+{
+	if (pos + sizeof(u16) > ring->size || !ring_rec(pos)->size)
+		return 0;
+
+	return pos;
+}
+
+/* Drop the oldest record, leaving the tail at the start of the next one */
+static void ring_drop_oldest(void)
+{
+	ring->tail += ring_rec(ring->tail)->size;
+	ring->count--;
+	ring->dropped++;
+	if (ring->count)
+		ring->tail = ring_wrap(ring->tail);
+}
+
+/* Find space for a record of @size bytes, dropping old records as needed */
+static u8 *ring_reserve(uint size)
+{
+	if (!ring->count) {
+		ring->head = 0;
+		ring->tail = 0;
+	}
+	if (ring->head + size > ring->size) {
+		/* Drop the records after the head, then start again */
+		while (ring->count && ring->tail >= ring->head)
+			ring_drop_oldest();
+		if (ring->head + sizeof(u16) <= ring->size)
+			ring_rec(ring->head)->size = 0;
+		ring->head = 0;
+	}
+	while (ring->count && ring->tail >= ring->head &&
+	       ring->tail < ring->head + size)
+		ring_drop_oldest();
+
+	return ring_data() + ring->head;
+}
+
+static int log_ring_setup(void)
+{
+	int size = CONFIG_LOG_RING_SIZE;
+
+	if (IS_ENABLED(CONFIG_LOG_RING_BLOBLIST) && CONFIG_IS_ENABLED(BLOBLIST))
+		ring = bloblist_ensure(BLOBLISTT_LOG_RING, size);
+	if (!ring)
+		ring = calloc(1, size);
+	if (!ring)
+		return -ENOMEM;
+	if (ring->magic != LOG_RING_MAGIC) {
+		memset(ring, '\0', sizeof(*ring));
+		ring->magic = LOG_RING_MAGIC;
+		ring->size = ALIGN_DOWN(size - sizeof(*ring), sizeof(u64));
+	}
+
+	return 0;
+}
+
+static int log_ring_emit_fmt(struct log_device *ldev, struct log_rec *rec,
+			     const char *fmt, va_list args)
+{
+	u64 buf[REC_MAX / sizeof(u64)];
+	struct log_ring_rec *out = (struct log_ring_rec *)buf;
+	u8 *data = (u8 *)buf + LOG_RING_REC_HDR;
+	int max = REC_MAX - LOG_RING_REC_HDR;
+	va_list orig;
+	int ret;
+
+	if (!ring && log_ring_setup())
+		return -ENOMEM;
+
+	out->time_us = timer_get_boot_us();
+	out->level = rec->level;
+	out->flags = 0;
+	out->cat = rec->cat;
+	out->phase = RING_PHASE;
+	out->reserved = 0;
+	out->line = rec->line;
+	out->fmt = fmt;
+	out->file = rec->file;
+	out->func = rec->func;
+
+	va_copy(orig, args);
+	/* SPL and TPL records may be shown later, so cannot point to fmt */
+	ret = -EINVAL;
+	if (RING_PHASE == LOGRP_PROPER)
+		ret = ring_encode(data, max, fmt, args);
+	if (ret < 0) {
+		/* Store the message instead, truncated if need be */
+		if (vsnprintf((char *)data, max, fmt, orig) >= max)
+			data[max - 2] = '\n';
+		ret = strlen((char *)data) + 1;
+		out->flags = LOGRF_MSG;
+		out->fmt = NULL;
+	}
+	va_end(orig);
+	out->size = LOG_RING_REC_HDR + ALIGN(ret, sizeof(u64));
+
+	memcpy(ring_reserve(out->size), buf, out->size);
+	ring->head += out->size;
+	if (!ring->count++)
+		ring->tail = ring_wrap(ring->tail);
+
+	return 0;
+}
+
+int log_ring_dump(void)
+{
+	char msg[CONFIG_SYS_CBSIZE];
+	struct log_ring_rec *rec;
+	const char *file, *func;
+	int fmt = gd->log_fmt;
+	uint pos, i;
+
+	if (!ring || !ring->count)
+		return -ENOENT;
+
+	for (i = 0, pos = ring->tail; i < ring->count; i++) {
+		pos = ring_wrap(pos);
+		rec = ring_rec(pos);
+		pos += rec->size;
+
+		ring_decode(rec, msg, sizeof(msg));
+		file = rec->file;
+		func = rec->func;
+		if (rec->phase != RING_PHASE) {
+			/* These point into another phase's image */
+			file = rec->phase < ARRAY_SIZE(phase_name) ?
+				phase_name[rec->phase] : "?";
+			func = "?";
+		}
+		printf("[%5lu.%06lu] ", (ulong)(rec->time_us / 1000000),
+		       (ulong)(rec->time_us % 1000000));
+		if (fmt & (1 << LOGF_LEVEL))
+			printf("%s.", log_get_level_name(rec->level));
+		if (fmt & (1 << LOGF_CAT))
+			printf("%s,", log_get_cat_name(rec->cat));
+		if (fmt & (1 << LOGF_FILE))
+			printf("%s:", file);
+		if (fmt & (1 << LOGF_LINE))
+			printf("%d-", rec->line);
+		if (fmt & (1 << LOGF_FUNC))
+			printf("%s()", func);
+		if (fmt & (1 << LOGF_MSG))
+			printf("%s%s", fmt != (1 << LOGF_MSG) ? " " : "", msg);
+	}
+	if (ring->dropped)
+		printf("(%u earlier records were dropped)\n", ring->dropped);
+
+	return 0;
+}
+
+LOG_DRIVER(ring) = {
+	.name		= "ring",
+	.flags		= LOGDF_ALL_LEVELS,
+	.emit_fmt	= log_ring_emit_fmt,
+};
@@ -10,6 +10,7 @@
 #include <image.h>
 #include <linux/libfdt.h>
 #include <spl.h>
+#include <u-boot/lz4.h>
 
 #ifndef CONFIG_SYS_BOOTM_LEN
 #define CONFIG_SYS_BOOTM_LEN	(64 << 20)
@@ -150,6 +151,33 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+/*
+ * Get the uncompressed size of LZ4 data, from the FIT or else from the frame
+ * header, which is read to @buf. Returns 0 if neither records it.
+ */
+static ulong spl_fit_lz4_size(struct spl_load_info *info, ulong sector,
+			      void *fit, int node, int offset, int len,
+			      void *buf)
+{
+	struct ulz4f_frame frame;
+	int nr_sectors;
+	int size;
+
+	if (!fit_image_get_uncomp_size(fit, node, &size))
+		return size;
+
+	len = min(len, ULZ4F_MAX_HDR_SIZE);
+	nr_sectors = get_aligned_image_size(info, len, offset);
+	if (info->read(info, sector + get_aligned_image_offset(info, offset),
+		       nr_sectors, buf) != nr_sectors)
+		return 0;
+	if (ulz4f_parse_header(buf + get_aligned_image_overhead(info, offset),
+			       len, &frame) < 0)
+		return 0;
+
+	return frame.content_size;
+}
+
 /**
  * spl_load_fit_image(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -183,16 +211,18 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	uint8_t image_comp = -1, type = -1;
 	const void *data;
 	bool external_data = false;
+	bool decomp = IS_ENABLED(CONFIG_SPL_OS_BOOT) &&
+		(IS_ENABLED(CONFIG_SPL_GZIP) || IS_ENABLED(CONFIG_SPL_ZSTD) ||
+		 IS_ENABLED(CONFIG_SPL_LZ4));
 
-	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) ||
-	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
+	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) || decomp) {
 		if (fit_image_get_type(fit, node, &type))
 			puts("Cannot get image type.\n");
 		else
 			debug("%s ", genimg_get_type_name(type));
 	}
 
-	if (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP)) {
+	if (decomp) {
 		if (fit_image_get_comp(fit, node, &image_comp))
 			puts("Cannot get image compression format.\n");
 		else
@@ -220,6 +250,28 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
 
+		/*
+		 * LZ4 can decompress in place, so read the data to just after
+		 * where the image goes, leaving the margin that this needs. If
+		 * the uncompressed size is not known, read it to the end of
+		 * the space for the image instead.
+		 */
+		if (IS_ENABLED(CONFIG_SPL_LZ4) && image_comp == IH_COMP_LZ4) {
+			size = spl_fit_lz4_size(info, sector, fit, node,
+						offset, len, (void *)load_ptr);
+			if (size) {
+				size += ULZ4F_INPLACE_MARGIN(len);
+				if (size > len + overhead)
+					load_ptr = (load_addr + size - len -
+						    overhead + align_len) &
+						~align_len;
+			} else {
+				load_ptr = (load_addr + CONFIG_SYS_BOOTM_LEN -
+					    nr_sectors * info->bl_len) &
+					~align_len;
+			}
+		}
+
 		if (info->read(info,
 			       sector + get_aligned_image_offset(info, offset),
 			       nr_sectors, (void *)load_ptr) != nr_sectors)
@@ -260,6 +312,26 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 			return -EIO;
 		}
 		length = size;
+	} else if (IS_ENABLED(CONFIG_SPL_ZSTD) && image_comp == IH_COMP_ZSTD) {
+		size_t unc_len = CONFIG_SYS_BOOTM_LEN;
+
+		if (zstd_decompress(src, length, (void *)load_addr, &unc_len)) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+		length = unc_len;
+	} else if (IS_ENABLED(CONFIG_SPL_LZ4) && image_comp == IH_COMP_LZ4) {
+		ulong end = (ulong)src + length - ULZ4F_INPLACE_MARGIN(length);
+		size_t unc_len = CONFIG_SYS_BOOTM_LEN;
+
+		/* in place, the output must stay behind the input */
+		if ((ulong)src >= load_addr && end < load_addr + unc_len)
+			unc_len = end > load_addr ? end - load_addr : 0;
+		if (ulz4fn(src, length, (void *)load_addr, &unc_len)) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+		length = unc_len;
 	} else {
 		memcpy((void *)load_addr, src, length);
 	}
@@ -0,0 +1,624 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Two-Level Segregated Fit (TLSF) memory allocator
+ *
+ * This is an alternative to dlmalloc.c, based on the design described in
+ * "TLSF: a New Dynamic Memory Allocator for Real-Time Systems" by M. Masmano,
+ * I. Ripoll, A. Crespo and J. Real. Free blocks are kept in lists segregated
+ * by size. A first-level index selects a power-of-two size range and a
+ * second-level index divides that range linearly into SL_COUNT lists. Two
+ * levels of bitmaps record which lists are non-empty, so finding a suitable
+ * free block takes a few bit operations, whatever the state of the heap.
+ * Each block records the size of the block and whether the physically
+ * previous block is free, so that free() can merge neighbouring free blocks
+ * straight away. All operations are O(1), except for realloc() which may
+ * need to copy the data.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <asm/io.h>
+#include <linux/bitops.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#ifdef CONFIG_NEEDS_MANUAL_RELOC
+#error "TLSF does not support CONFIG_NEEDS_MANUAL_RELOC"
+#endif
+
+/* Alignment of blocks and of the memory returned by malloc() */
+#define TLSF_ALIGN	(2 * sizeof(size_t))
+#define ALIGN_SHIFT	(sizeof(size_t) == 8 ? 4 : 3)
+
+/* log2 of the number of second-level lists in each first-level range */
+#define SL_LOG2		4
+#define SL_COUNT	(1 << SL_LOG2)
+
+/*
+ * Blocks smaller than SMALL_BLOCK all go in the first first-level range,
+ * with one list for each multiple of TLSF_ALIGN
+ */
+#define FL_SHIFT	(SL_LOG2 + ALIGN_SHIFT)
+#define SMALL_BLOCK	(1UL << FL_SHIFT)
+
+/* Blocks must be smaller than 2 << FL_INDEX_MAX bytes */
+#define FL_INDEX_MAX	30
+#define FL_COUNT	(FL_INDEX_MAX - FL_SHIFT + 2)
+
+/* Flags in the low bits of tlsf_block.size */
+#define BLOCK_FREE	1
+#define BLOCK_PREV_FREE	2
+#define BLOCK_FLAGS	(BLOCK_FREE | BLOCK_PREV_FREE)
+
+/**
+ * struct tlsf_block - header of a block of memory
+ *
+ * The header is followed by the data, which is @size bytes long. The block
+ * after that is the next block in memory. The heap ends with a sentinel
+ * block with a size of 0, which is always in use.
+ *
+ * @prev_phys: Previous block in memory, or NULL for the first block
+ * @size: Size of the data in bytes (a multiple of TLSF_ALIGN), plus flags
+ * @next_free: Next block in the free list (free blocks only)
+ * @prev_free: Previous block in the free list (free blocks only)
+ */
+struct tlsf_block {
+	struct tlsf_block *prev_phys;
+	size_t size;
+	struct tlsf_block *next_free;
+	struct tlsf_block *prev_free;
+};
+
+/* The free-list pointers are only needed while the block is free */
+#define BLOCK_HDR	offsetof(struct tlsf_block, next_free)
+#define BLOCK_MIN	(sizeof(struct tlsf_block) - BLOCK_HDR)
+
+/* Largest request that can be handled */
+#define BLOCK_MAX	(1UL << FL_INDEX_MAX)
+
+/**
+ * struct tlsf_control - state of the allocator
+ *
+ * @fl_bitmap: Bit n is set if sl_bitmap[n] is non-zero
+ * @sl_bitmap: Bit m of sl_bitmap[n] is set if blocks[n][m] is not empty
+ * @blocks: Heads of the free lists
+ * @first: First block in the heap
+ * @arena: Size of the heap in bytes, including block headers
+ * @used: Bytes in blocks which are in use, including their headers
+ * @max_used: Highest value of @used so far
+ */
+struct tlsf_control {
+	u32 fl_bitmap;
+	u32 sl_bitmap[FL_COUNT];
+	struct tlsf_block *blocks[FL_COUNT][SL_COUNT];
+	struct tlsf_block *first;
+	size_t arena;
+	size_t used;
+	size_t max_used;
+};
+
+ulong mem_malloc_start;
+ulong mem_malloc_end;
+ulong mem_malloc_brk;
+
+#if !CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
+static struct tlsf_control tlsf;
+
+static inline size_t block_size(struct tlsf_block *block)
+{
+	return block->size & ~BLOCK_FLAGS;
+}
+
+static inline void *block_to_ptr(struct tlsf_block *block)
+{
+	return (char *)block + BLOCK_HDR;
+}
+
+static inline struct tlsf_block *ptr_to_block(void *ptr)
+{
+	return (struct tlsf_block *)((char *)ptr - BLOCK_HDR);
+}
+
+static inline struct tlsf_block *block_next(struct tlsf_block *block)
+{
+	return (struct tlsf_block *)((char *)block_to_ptr(block) +
+				     block_size(block));
+}
+
+/* Work out the free list which holds blocks of the given size */
+static void mapping_insert(size_t size, int *flp, int *slp)
+{
+	int fl;
+
+	if (size < SMALL_BLOCK) {
+		*flp = 0;
+		*slp = size >> ALIGN_SHIFT;
+	} else {
+		fl = fls(size) - 1;
+		*slp = (size >> (fl - SL_LOG2)) - SL_COUNT;
+		*flp = fl - FL_SHIFT + 1;
+	}
+}
+
+/*
+ * Work out the first free list whose blocks are all at least the given
+ * size, so that any block found there can be used without checking it
+ */
+static void mapping_search(size_t size, int *flp, int *slp)
+{
+	if (size >= SMALL_BLOCK)
+		size += (1UL << (fls(size) - 1 - SL_LOG2)) - 1;
+	mapping_insert(size, flp, slp);
+}
+
+/* Find a free block in the list fl/sl or the next non-empty one above it */
+static struct tlsf_block *search_suitable_block(int *flp, int *slp)
+{
+	int fl = *flp;
+	u32 map;
+
+	map = tlsf.sl_bitmap[fl] & (~0U << *slp);
+	if (!map) {
+		map = tlsf.fl_bitmap & (~0U << (fl + 1));
+		if (!map)
+			return NULL;
+		fl = ffs(map) - 1;
+		*flp = fl;
+		map = tlsf.sl_bitmap[fl];
+	}
+	*slp = ffs(map) - 1;
+
+	return tlsf.blocks[fl][*slp];
+}
+
+static void free_list_insert(struct tlsf_block *block)
+{
+	struct tlsf_block *head;
+	int fl, sl;
+
+	mapping_insert(block_size(block), &fl, &sl);
+	head = tlsf.blocks[fl][sl];
+	block->next_free = head;
+	block->prev_free = NULL;
+	if (head)
+		head->prev_free = block;
+	tlsf.blocks[fl][sl] = block;
+	tlsf.fl_bitmap |= 1U << fl;
+	tlsf.sl_bitmap[fl] |= 1U << sl;
+}
+
+static void free_list_remove(struct tlsf_block *block)
+{
+	struct tlsf_block *next = block->next_free;
+	struct tlsf_block *prev = block->prev_free;
+	int fl, sl;
+
+	if (next)
+		next->prev_free = prev;
+	if (prev) {
+		prev->next_free = next;
+		return;
+	}
+
+	mapping_insert(block_size(block), &fl, &sl);
+	tlsf.blocks[fl][sl] = next;
+	if (!next) {
+		tlsf.sl_bitmap[fl] &= ~(1U << sl);
+		if (!tlsf.sl_bitmap[fl])
+			tlsf.fl_bitmap &= ~(1U << fl);
+	}
+}
+
+/*
+ * Split a block so that it has @size bytes of data, returning the new block
+ * made from the rest. The caller must check there is room for the new block.
+ */
+static struct tlsf_block *block_split(struct tlsf_block *block, size_t size)
+{
+	struct tlsf_block *rest;
+
+	rest = (struct tlsf_block *)((char *)block_to_ptr(block) + size);
+	rest->size = block_size(block) - size - BLOCK_HDR;
+	rest->prev_phys = block;
+	block_next(rest)->prev_phys = rest;
+	block->size = size | (block->size & BLOCK_FLAGS);
+
+	return rest;
+}
+
+/* Add a block to the free lists, merging it with any free neighbours */
+static void block_release(struct tlsf_block *block)
+{
+	struct tlsf_block *next;
+
+	if (block->size & BLOCK_PREV_FREE) {
+		struct tlsf_block *prev = block->prev_phys;
+
+		free_list_remove(prev);
+		prev->size += block_size(block) + BLOCK_HDR;
+		block = prev;
+	}
+
+	next = block_next(block);
+	if (next->size & BLOCK_FREE) {
+		free_list_remove(next);
+		block->size += block_size(next) + BLOCK_HDR;
+		next = block_next(block);
+	}
+
+	next->prev_phys = block;
+	next->size |= BLOCK_PREV_FREE;
+	block->size |= BLOCK_FREE;
+	free_list_insert(block);
+}
+
+static void block_mark_used(struct tlsf_block *block)
+{
+	block->size &= ~BLOCK_FREE;
+	block_next(block)->size &= ~BLOCK_PREV_FREE;
+	tlsf.used += block_size(block) + BLOCK_HDR;
+}
+
+/* Call this once a new or grown block has been trimmed to size */
+static void update_max_used(void)
+{
+	if (tlsf.used > tlsf.max_used)
+		tlsf.max_used = tlsf.used;
+}
+
+/* Shrink a block which is in use, giving any spare space back */
+static void block_trim_used(struct tlsf_block *block, size_t size)
+{
+	struct tlsf_block *rest;
+
+	if (block_size(block) < size + BLOCK_HDR + BLOCK_MIN)
+		return;
+
+	rest = block_split(block, size);
+	tlsf.used -= block_size(rest) + BLOCK_HDR;
+	block_release(rest);
+}
+
+/* Convert a request size into a block size, or 0 if it is too large */
+static size_t adjust_request_size(size_t bytes)
+{
+	if (bytes > BLOCK_MAX)
+		return 0;
+
+	return max(ALIGN(bytes, TLSF_ALIGN), BLOCK_MIN);
+}
+
+/* Find a free block with at least @size bytes of data and mark it in use */
+static struct tlsf_block *block_locate(size_t size)
+{
+	struct tlsf_block *block;
+	int fl, sl;
+
+	mapping_search(size, &fl, &sl);
+	block = search_suitable_block(&fl, &sl);
+	if (!block)
+		return NULL;
+
+	free_list_remove(block);
+	block_mark_used(block);
+	block_trim_used(block, size);
+
+	return block;
+}
+
+static bool ptr_in_heap(void *ptr)
+{
+	return (ulong)ptr >= mem_malloc_start && (ulong)ptr < mem_malloc_end;
+}
+
+Void_t *mALLOc(size_t bytes)
+{
+	struct tlsf_block *block;
+	size_t size;
+
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return malloc_simple(bytes);
+#endif
+
+	size = adjust_request_size(bytes);
+	if (!size)
+		return NULL;
+	block = block_locate(size);
+	if (!block)
+		return NULL;
+	update_max_used();
+
+	return block_to_ptr(block);
+}
+
+void fREe(Void_t *mem)
+{
+	struct tlsf_block *block;
+
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	/* free() is a no-op - all the memory will be freed on relocation */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return;
+#endif
+
+	/* ignore memory allocated before relocation */
+	if (!mem || !ptr_in_heap(mem))
+		return;
+
+	block = ptr_to_block(mem);
+	assert(!(block->size & BLOCK_FREE));
+	tlsf.used -= block_size(block) + BLOCK_HDR;
+	block_release(block);
+}
+
+/*
+ * Move memory from the pre-relocation heap into this one. The size of the
+ * old allocation is not recorded, so copy up to the end of the memory used
+ * in that heap.
+ */
+static void *realloc_simple(void *oldmem, size_t bytes)
+{
+	ulong base = 0, end = 0;
+	void *newmem;
+
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	base = (ulong)map_sysmem(gd->malloc_base, gd->malloc_limit);
+	end = base + gd->malloc_ptr;
+#endif
+	if ((ulong)oldmem < base || (ulong)oldmem >= end)
+		return NULL;
+	newmem = mALLOc(bytes);
+	if (newmem)
+		memcpy(newmem, oldmem,
+		       min_t(size_t, bytes, end - (ulong)oldmem));
+
+	return newmem;
+}
+
+Void_t *rEALLOc(Void_t *oldmem, size_t bytes)
+{
+	struct tlsf_block *block, *next;
+	size_t size, cur;
+	void *newmem;
+
+	if (!oldmem)
+		return mALLOc(bytes);
+
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
+		/* This is harder to support and should not be needed */
+		panic("pre-reloc realloc() is not supported");
+	}
+#endif
+
+	/* memory allocated before relocation is not in the heap */
+	if (!ptr_in_heap(oldmem))
+		return realloc_simple(oldmem, bytes);
+
+	size = adjust_request_size(bytes);
+	if (!size)
+		return NULL;
+
+	block = ptr_to_block(oldmem);
+	cur = block_size(block);
+	if (size > cur) {
+		/* Try to grow into the next block first */
+		next = block_next(block);
+		if (!(next->size & BLOCK_FREE) ||
+		    cur + BLOCK_HDR + block_size(next) < size) {
+			newmem = mALLOc(bytes);
+			if (!newmem)
+				return NULL;
+			memcpy(newmem, oldmem, cur);
+			fREe(oldmem);
+
+			return newmem;
+		}
+		free_list_remove(next);
+		tlsf.used -= cur + BLOCK_HDR;
+		block->size += block_size(next) + BLOCK_HDR;
+		block_next(block)->prev_phys = block;
+		block_mark_used(block);
+	}
+	block_trim_used(block, size);
+	update_max_used();
+
+	return oldmem;
+}
+
+Void_t *mEMALIGn(size_t alignment, size_t bytes)
+{
+	struct tlsf_block *block, *front;
+	size_t size, gap;
+	ulong ptr;
+
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return memalign_simple(alignment, bytes);
+#endif
+
+	if (alignment <= TLSF_ALIGN)
+		return mALLOc(bytes);
+	if (alignment & (alignment - 1))
+		alignment = 1UL << fls(alignment);
+
+	size = adjust_request_size(bytes);
+	if (!size || alignment > BLOCK_MAX - size)
+		return NULL;
+
+	/*
+	 * Allocate enough extra to leave a free block before the aligned
+	 * start, then give that back
+	 */
+	block = block_locate(size + alignment + BLOCK_HDR + BLOCK_MIN);
+	if (!block)
+		return NULL;
+
+	ptr = (ulong)block_to_ptr(block);
+	gap = ALIGN(ptr, alignment) - ptr;
+	if (gap && gap < BLOCK_HDR + BLOCK_MIN)
+		gap += alignment;
+	if (gap) {
+		front = block;
+		block = block_split(front, gap - BLOCK_HDR);
+		tlsf.used -= gap;
+		block_release(front);
+	}
+	block_trim_used(block, size);
+	update_max_used();
+
+	return block_to_ptr(block);
+}
+
+Void_t *vALLOc(size_t bytes)
+{
+	return mEMALIGn(malloc_getpagesize, bytes);
+}
+
+Void_t *pvALLOc(size_t bytes)
+{
+	size_t pagesize = malloc_getpagesize;
+
+	return mEMALIGn(pagesize, ALIGN(bytes, pagesize));
+}
+
+Void_t *cALLOc(size_t n, size_t elem_size)
+{
+	size_t size = n * elem_size;
+	void *mem;
+
+	if (elem_size && size / elem_size != n)
+		return NULL;
+	mem = mALLOc(size);
+	if (mem)
+		memset(mem, '\0', size);
+
+	return mem;
+}
+
+void cfree(Void_t *mem)
+{
+	fREe(mem);
+}
+
+int malloc_trim(size_t pad)
+{
+	/* The whole heap belongs to the allocator, so there is nothing to do */
+	return 0;
+}
+
+size_t malloc_usable_size(Void_t *mem)
+{
+	if (!mem || !ptr_in_heap(mem))
+		return 0;
+
+	return block_size(ptr_to_block(mem));
+}
+
+int mALLOPt(int param_number, int value)
+{
+	/* There is nothing to tune */
+	return 0;
+}
+
+/*
+ * Besides the usual fields, this sets usmblks to the highest number of bytes
+ * in use so far and keepcost to the size of the largest free block, which is
+ * the largest request that can be met.
+ */
+struct mallinfo mALLINFo(void)
+{
+	struct mallinfo info;
+	struct tlsf_block *block;
+	size_t size;
+
+	memset(&info, '\0', sizeof(info));
+	if (!tlsf.first)
+		return info;
+
+	for (block = tlsf.first; (size = block_size(block));
+	     block = block_next(block)) {
+		if (block->size & BLOCK_FREE) {
+			info.ordblks++;
+			info.fordblks += size + BLOCK_HDR;
+			info.keepcost = max_t(int, info.keepcost, size);
+		}
+	}
+	info.arena = tlsf.arena;
+	info.uordblks = tlsf.used;
+	info.usmblks = tlsf.max_used;
+	assert(info.uordblks + info.fordblks == info.arena);
+
+	return info;
+}
+
+void malloc_stats(void)
+{
+	struct mallinfo info = mALLINFo();
+
+	printf("system bytes     = %10u\n", (unsigned int)info.arena);
+	printf("in use bytes     = %10u\n", (unsigned int)info.uordblks);
+	printf("max in use bytes = %10u\n", (unsigned int)info.usmblks);
+	printf("free bytes       = %10u\n", (unsigned int)info.fordblks);
+	printf("free blocks      = %10u\n", (unsigned int)info.ordblks);
+	printf("largest free     = %10u\n", (unsigned int)info.keepcost);
+}
+
+/* Set up the heap as a single free block followed by the sentinel */
+static void tlsf_init(ulong start, ulong end)
+{
+	struct tlsf_block *block, *sentinel;
+	size_t size;
+
+	memset(&tlsf, '\0', sizeof(tlsf));
+	start = ALIGN(start, TLSF_ALIGN);
+	end = ALIGN_DOWN(end, TLSF_ALIGN);
+	if (end < start || end - start < 2 * BLOCK_HDR + BLOCK_MIN)
+		return;
+
+	size = end - start - 2 * BLOCK_HDR;
+	if (size >= 2 * BLOCK_MAX)
+		size = 2 * BLOCK_MAX - TLSF_ALIGN;
+
+	block = (struct tlsf_block *)start;
+	block->prev_phys = NULL;
+	block->size = size;
+	sentinel = block_next(block);
+	sentinel->prev_phys = block;
+	sentinel->size = 0;
+
+	tlsf.first = block;
+	tlsf.arena = size + BLOCK_HDR;
+	block_release(block);
+}
+#else
+static inline void tlsf_init(ulong start, ulong end) {}
+#endif /* !SYS_MALLOC_SIMPLE */
+
+void mem_malloc_init(ulong start, ulong size)
+{
+	mem_malloc_start = start;
+	mem_malloc_end = start + size;
+	/* the allocator owns the whole area from the start */
+	mem_malloc_brk = mem_malloc_end;
+
+	debug("using memory %#lx-%#lx for malloc()\n", mem_malloc_start,
+	      mem_malloc_end);
+#ifdef CONFIG_SYS_MALLOC_CLEAR_ON_INIT
+	memset((void *)mem_malloc_start, 0x0, size);
+#endif
+	tlsf_init(mem_malloc_start, mem_malloc_end);
+}
+
+int initf_malloc(void)
+{
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	assert(gd->malloc_base);	/* Set up by crt0.S */
+	gd->malloc_limit = CONFIG_VAL(SYS_MALLOC_F_LEN);
+	gd->malloc_ptr = 0;
+#endif
+
+	return 0;
+}
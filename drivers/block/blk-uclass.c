@@ -432,6 +432,7 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
 	ulong blks_read;
+	int span;
 
 	if (!ops->read)
 		return -ENOSYS;
@@ -439,7 +440,9 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
+	span = bootstage_span_begin("read", dev->name);
 	blks_read = ops->read(dev, start, blkcnt, buffer);
+	bootstage_span_end(span);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
 			      start, blkcnt, block_dev->blksz, buffer);
@@ -160,6 +160,13 @@ int device_remove(struct udevice *dev, uint flags)
 	if (!dev)
 		return -EINVAL;
 
+	/*
+	 * The driver cannot be removed in the middle of its probe() method,
+	 * so wait for that to finish first
+	 */
+	while (dev->flags & DM_FLAG_PROBE_PENDING)
+		device_probe_async(dev);
+
 	if (!(dev->flags & DM_FLAG_ACTIVATED))
 		return 0;
 
@@ -195,7 +202,7 @@ int device_remove(struct udevice *dev, uint flags)
 	if (flags_remove(flags, drv->flags)) {
 		device_free(dev);
 
-		dev->seq = -1;
+		uclass_set_device_seq(dev, -1);
 		dev->flags &= ~DM_FLAG_ACTIVATED;
 	}
 
@@ -38,6 +38,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	struct udevice *dev;
 	struct uclass *uc;
 	int size, ret = 0;
+	int req_seq;
 
 	if (devp)
 		*devp = NULL;
@@ -146,6 +147,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	ret = uclass_bind_device(dev);
 	if (ret)
 		goto fail_uclass_bind;
+	req_seq = dev->req_seq;
 
 	/* if we fail to bind we remove device from successors and free it */
 	if (drv->bind) {
@@ -164,6 +166,9 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 			goto fail_uclass_post_bind;
 	}
 
+	if (dev->req_seq != req_seq)
+		uclass_req_seq_changed(dev, req_seq);
+
 	if (parent)
 		pr_debug("Bound device %s to %s\n", dev->name, parent->name);
 	if (devp)
@@ -244,10 +249,19 @@ int device_bind_ofnode(struct udevice *parent, const struct driver *drv,
 int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
 			const struct driver_info *info, struct udevice **devp)
 {
-	struct driver *drv;
+	const struct driver *drv = NULL;
+	const char *name = info->name;
 	uint platdata_size = 0;
+	struct udevice *dev;
+	int ret;
 
-	drv = lists_driver_lookup_name(info->name);
+#if CONFIG_IS_ENABLED(OF_PLATDATA_BIND)
+	drv = info->driver;
+	if (info->dev_name)
+		name = info->dev_name;
+#endif
+	if (!drv)
+		drv = lists_driver_lookup_name(info->name);
 	if (!drv)
 		return -ENOENT;
 	if (pre_reloc_only && !(drv->flags & DM_FLAG_PRE_RELOC))
@@ -256,9 +270,26 @@ int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
 	platdata_size = info->platdata_size;
 #endif
-	return device_bind_common(parent, drv, info->name,
-			(void *)info->platdata, 0, ofnode_null(), platdata_size,
-			devp);
+	ret = device_bind_common(parent, drv, name, (void *)info->platdata, 0,
+				 ofnode_null(), platdata_size, &dev);
+	if (devp)
+		*devp = ret ? NULL : dev;
+	if (ret)
+		return ret;
+
+#if CONFIG_IS_ENABLED(OF_PLATDATA_BIND)
+	/* Use the sequence number that dtoc found in the aliases node */
+	if (CONFIG_IS_ENABLED(DM_SEQ_ALIAS) &&
+	    (info->flags & DM_INFO_FLAG_REQ_SEQ) &&
+	    (dev->uclass->uc_drv->flags & DM_UC_FLAG_SEQ_ALIAS)) {
+		int old_req_seq = dev->req_seq;
+
+		dev->req_seq = info->req_seq;
+		uclass_req_seq_changed(dev, old_req_seq);
+	}
+#endif
+
+	return 0;
 }
 
 static void *alloc_priv(int size, uint flags)
@@ -305,7 +336,104 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+/**
+ * device_probe_fail() - Tidy up after a device fails to probe
+ *
+ * @dev: Device which failed to probe
+ * @ret: Error to return
+ * @return @ret
+ */
+static int device_probe_fail(struct udevice *dev, int ret)
+{
+	dev->flags &= ~(DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING);
+
+	uclass_set_device_seq(dev, -1);
+	device_free(dev);
+
+	return ret;
+}
+
+/**
+ * device_probe_finish() - Finish probing a device after its probe() method
+ *
+ * @dev: Device being probed
+ * @ret: Return value from the driver's probe() method
+ * @return 0 if OK, -ve on error
+ */
+static int device_probe_finish(struct udevice *dev, int ret)
+{
+	dev->flags &= ~DM_FLAG_PROBE_PENDING;
+	if (ret)
+		return device_probe_fail(dev, ret);
+
+	ret = uclass_post_probe_device(dev);
+	if (ret) {
+		if (device_remove(dev, DM_REMOVE_NORMAL)) {
+			dm_warn("%s: Device '%s' failed to remove on error path\n",
+				__func__, dev->name);
+		}
+		return device_probe_fail(dev, ret);
+	}
+
+	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
+		pinctrl_select_state(dev, "default");
+
+	return 0;
+}
+
+/* Device which device_probe_list() is currently giving a turn */
+static struct udevice *probe_list_dev;
+
+/*
+ * Set when a device before probe_list_dev in the list is still probing, so
+ * that probe_list_dev must not complete yet
+ */
+static bool probe_list_defer;
+
+/*
+ * Set while an asynchronous driver's probe() method is called from
+ * device_probe_list(): device_probe() then returns -EINPROGRESS for a
+ * device which is not ready yet, instead of waiting for it
+ */
+static bool probe_nowait;
+
+/**
+ * device_probe_call() - Call a device's probe() method
+ *
+ * @dev: Device being probed
+ * @return 0 if the device is now probed, -EINPROGRESS if the driver asked to
+ * be called again later, other -ve on error
+ */
+static int device_probe_call(struct udevice *dev)
+{
+	const struct driver *drv = dev->driver;
+	bool async = drv->flags & DM_FLAG_PROBE_ASYNC;
+	bool nowait = probe_nowait;
+	int ret = 0;
+
+	if (dev->flags & DM_FLAG_PROBE_DEFERRED) {
+		dev->flags &= ~DM_FLAG_PROBE_DEFERRED;
+		return device_probe_finish(dev, 0);
+	}
+
+	if (drv->probe) {
+		probe_nowait = async && dev == probe_list_dev;
+		ret = drv->probe(dev);
+		probe_nowait = nowait;
+		if (ret == -EINPROGRESS && async) {
+			dev->flags |= DM_FLAG_PROBE_PENDING;
+			return ret;
+		}
+	}
+	if (!ret && dev == probe_list_dev && probe_list_defer) {
+		dev->flags |= DM_FLAG_PROBE_PENDING | DM_FLAG_PROBE_DEFERRED;
+		return -EINPROGRESS;
+	}
+
+	return device_probe_finish(dev, ret);
+}
+
+int device_probe_async(struct udevice *dev)
 {
 	struct power_domain pd;
 	const struct driver *drv;
@@ -316,6 +444,8 @@ int device_probe(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
+	if (dev->flags & DM_FLAG_PROBE_PENDING)
+		return device_probe_call(dev);
 	if (dev->flags & DM_FLAG_ACTIVATED)
 		return 0;
 
@@ -367,7 +497,8 @@ int device_probe(struct udevice *dev)
 		 * so that we don't mess up the device.
 		 */
 		if (dev->flags & DM_FLAG_ACTIVATED)
-			return 0;
+			return dev->flags & DM_FLAG_PROBE_PENDING ?
+				-EINPROGRESS : 0;
 	}
 
 	seq = uclass_resolve_seq(dev);
@@ -375,7 +506,7 @@ int device_probe(struct udevice *dev)
 		ret = seq;
 		goto fail;
 	}
-	dev->seq = seq;
+	uclass_set_device_seq(dev, seq);
 
 	dev->flags |= DM_FLAG_ACTIVATED;
 
@@ -414,34 +545,117 @@ int device_probe(struct udevice *dev)
 	if (ret)
 		goto fail;
 
-	if (drv->probe) {
-		ret = drv->probe(dev);
-		if (ret) {
-			dev->flags &= ~DM_FLAG_ACTIVATED;
-			goto fail;
-		}
-	}
+	return device_probe_call(dev);
+fail:
+	return device_probe_fail(dev, ret);
+}
 
-	ret = uclass_post_probe_device(dev);
-	if (ret)
-		goto fail_uclass;
+int device_probe(struct udevice *dev)
+{
+	bool nowait = probe_nowait;
+	int span = -1;
+	int ret;
 
-	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
-		pinctrl_select_state(dev, "default");
+	if (dev && (!(dev->flags & DM_FLAG_ACTIVATED) ||
+		    (dev->flags & DM_FLAG_PROBE_PENDING)))
+		span = bootstage_span_begin("probe", dev->name);
 
-	return 0;
-fail_uclass:
-	if (device_remove(dev, DM_REMOVE_NORMAL)) {
-		dm_warn("%s: Device '%s' failed to remove on error path\n",
-			__func__, dev->name);
+	/*
+	 * Drivers that wait for hardware are called until they are done,
+	 * unless the caller is itself an asynchronous probe() method, which
+	 * can simply try again later
+	 */
+	probe_nowait = false;
+	do {
+		ret = device_probe_async(dev);
+	} while (ret == -EINPROGRESS && !nowait);
+	probe_nowait = nowait;
+	bootstage_span_end(span);
+
+	return ret;
+}
+
+/**
+ * device_find_unready_parent() - Find the top-most parent not yet probed
+ *
+ * @dev: Device to check
+ * @return top-most parent device which is not probed or whose probe is still
+ * pending, or NULL if all parents are ready
+ */
+static struct udevice *device_find_unready_parent(struct udevice *dev)
+{
+	struct udevice *unready = NULL;
+
+	for (dev = dev->parent; dev; dev = dev->parent) {
+		if (!(dev->flags & DM_FLAG_ACTIVATED) ||
+		    (dev->flags & DM_FLAG_PROBE_PENDING))
+			unready = dev;
 	}
-fail:
-	dev->flags &= ~DM_FLAG_ACTIVATED;
 
-	dev->seq = -1;
-	device_free(dev);
+	return unready;
+}
 
-	return ret;
+int device_probe_list(struct udevice *const devs[], int count)
+{
+	struct udevice *outer = probe_list_dev;
+	bool outer_defer = probe_list_defer;
+	int remaining = count;
+	int result = 0;
+	bool *done;
+	int ret, i;
+
+	if (!count)
+		return 0;
+	done = calloc(count, sizeof(*done));
+	if (!done)
+		return -ENOMEM;
+
+	while (remaining) {
+		/* Set once a device earlier in the list is still probing */
+		bool busy = false;
+
+		for (i = 0; i < count; i++) {
+			struct udevice *dev = devs[i];
+			struct udevice *parent, *target;
+
+			if (done[i])
+				continue;
+
+			/*
+			 * A device cannot start probing until its parents are
+			 * probed, so give the parent a turn instead. Devices
+			 * which use another device (e.g. via a phandle) get
+			 * -EINPROGRESS from device_probe() while it is not
+			 * ready, and are called again later.
+			 *
+			 * Devices complete (and so bind their children and
+			 * take their sequence numbers) in the order of the
+			 * list, as they would if probed one after the other.
+			 */
+			parent = device_find_unready_parent(dev);
+			target = parent ? parent : dev;
+			if (busy && (target->flags & DM_FLAG_PROBE_DEFERRED))
+				continue;
+			probe_list_dev = target;
+			probe_list_defer = busy;
+			ret = device_probe_async(target);
+			probe_list_dev = outer;
+			probe_list_defer = outer_defer;
+			if (ret == -EINPROGRESS) {
+				busy = true;
+				continue;
+			}
+			if (!ret && parent)
+				continue;
+			if (ret && !result)
+				result = ret;
+			done[i] = true;
+			remaining--;
+		}
+	}
+	free(done);
+
+	return result;
 }
 
 void *dev_get_platdata(const struct udevice *dev)
@@ -806,10 +1020,19 @@ int device_set_name(struct udevice *dev, const char *name)
 		return -ENOMEM;
 	dev->name = name;
 	device_set_name_alloced(dev);
+	uclass_index_update(dev);
 
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	dev->node = node;
+	uclass_index_update(dev);
+}
+#endif
+
 bool device_is_compatible(struct udevice *dev, const char *compat)
 {
 	return ofnode_device_is_compatible(dev_ofnode(dev), compat);
@@ -15,6 +15,7 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <linux/compiler.h>
 
 struct driver *lists_driver_lookup_name(const char *name)
@@ -48,6 +49,71 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id)
 	return NULL;
 }
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA_BIND)
+/**
+ * bind_drivers_tree() - Bind all devices in the hierarchy worked out by dtoc
+ *
+ * Each driver_info may name its parent. Parents are bound before their
+ * children, in as many passes over the list as the tree is deep. As with
+ * run-time device tree scanning, the children of a device that is not bound
+ * (no driver, or not needed before relocation) are not bound either.
+ *
+ * @parent: Parent for devices which do not name one (root)
+ * @pre_reloc_only: If true, bind only drivers with the DM_FLAG_PRE_RELOC flag
+ * @return 0 if OK, -ve on error
+ */
+static int bind_drivers_tree(struct udevice *parent, bool pre_reloc_only)
+{
+	struct driver_info *info =
+		ll_entry_start(struct driver_info, driver_info);
+	const int n_ents = ll_entry_count(struct driver_info, driver_info);
+	struct udevice **devs;
+	bool *done;
+	bool progress;
+	int result = 0;
+	int ret, i;
+
+	devs = calloc(n_ents, sizeof(*devs) + sizeof(*done));
+	if (!devs)
+		return -ENOMEM;
+	done = (bool *)(devs + n_ents);
+
+	do {
+		progress = false;
+		for (i = 0; i < n_ents; i++) {
+			const struct driver_info *entry = &info[i];
+			struct udevice *pdev = parent;
+
+			if (done[i])
+				continue;
+			if (entry->parent) {
+				int pidx = entry->parent - info;
+
+				if (!done[pidx])
+					continue;
+				pdev = devs[pidx];
+			}
+			done[i] = true;
+			progress = true;
+			if (!pdev)
+				continue;
+
+			ret = device_bind_by_name(pdev, pre_reloc_only, entry,
+						  &devs[i]);
+			if (ret && ret != -EPERM) {
+				dm_warn("No match for driver '%s'\n",
+					entry->name);
+				if (!result || ret != -ENOENT)
+					result = ret;
+			}
+		}
+	} while (progress);
+	free(devs);
+
+	return result;
+}
+#endif
+
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only)
 {
 	struct driver_info *info =
@@ -58,6 +124,9 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only)
 	int result = 0;
 	int ret;
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA_BIND)
+	return bind_drivers_tree(parent, pre_reloc_only);
+#endif
 	for (entry = info; entry != info + n_ents; entry++) {
 		ret = device_bind_by_name(parent, pre_reloc_only, entry, &dev);
 		if (ret && ret != -EPERM) {
@@ -38,6 +38,261 @@ struct uclass *uclass_find(enum uclass_id key)
 	return NULL;
 }
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/*
+ * Don't bother with an index until a uclass has more than this many devices,
+ * since searching the list is just as quick
+ */
+#define UCLASS_INDEX_MIN_DEVS	8
+
+static uint uclass_hash_name(const char *name)
+{
+	uint hash = 5381;
+
+	while (*name)
+		hash = hash * 33 + (uchar)*name++;
+
+	return hash;
+}
+
+static uint uclass_hash_node(ofnode node)
+{
+	ulong val = (ulong)node.of_offset;
+
+	/* With a live tree this is a pointer, so the low bits are all zero */
+	return val ^ (val >> 5) ^ (val >> 13);
+}
+
+static struct hlist_head *uclass_name_bucket(struct uclass *uc,
+					     const char *name)
+{
+	return &uc->idx.name_hash[uclass_hash_name(name) &
+				  (uc->idx.hash_size - 1)];
+}
+
+static struct hlist_head *uclass_node_bucket(struct uclass *uc, ofnode node)
+{
+	return &uc->idx.node_hash[uclass_hash_node(node) &
+				  (uc->idx.hash_size - 1)];
+}
+
+/* Add to the end of a hash chain, so that devices stay in uclass order */
+static void uclass_hash_add(struct hlist_node *n, struct hlist_head *head)
+{
+	struct hlist_node *last = head->first;
+
+	if (!last) {
+		hlist_add_head(n, head);
+		return;
+	}
+	while (last->next)
+		last = last->next;
+	hlist_add_after(last, n);
+}
+
+static void uclass_index_hash_dev(struct uclass *uc, struct udevice *dev)
+{
+	uclass_hash_add(&dev->name_hnode, uclass_name_bucket(uc, dev->name));
+	if (ofnode_valid(dev->node))
+		uclass_hash_add(&dev->node_hnode,
+				uclass_node_bucket(uc, dev->node));
+}
+
+static int uclass_index_grow_seq(struct uclass_index *idx, int seq)
+{
+	struct udevice **seq_devs;
+	int size;
+
+	if (seq < idx->seq_size)
+		return 0;
+	if (seq > DM_MAX_SEQ)
+		return -E2BIG;
+	for (size = max(idx->seq_size, UCLASS_INDEX_MIN_DEVS); size <= seq;
+	     size *= 2)
+		;
+	seq_devs = calloc(size, sizeof(*seq_devs));
+	if (!seq_devs)
+		return -ENOMEM;
+	if (idx->seq_devs)
+		memcpy(seq_devs, idx->seq_devs,
+		       idx->seq_size * sizeof(*seq_devs));
+	free(idx->seq_devs);
+	idx->seq_devs = seq_devs;
+	idx->seq_size = size;
+
+	return 0;
+}
+
+/**
+ * uclass_index_free() - Drop the index of a uclass
+ *
+ * This is also used when the index cannot be updated (e.g. out of memory).
+ * Lookups then fall back to searching the uclass's list of devices.
+ *
+ * @uc: uclass to update
+ */
+static void uclass_index_free(struct uclass *uc)
+{
+	struct uclass_index *idx = &uc->idx;
+	struct udevice *dev;
+
+	if (idx->hash_size) {
+		uclass_foreach_dev(dev, uc) {
+			INIT_HLIST_NODE(&dev->name_hnode);
+			INIT_HLIST_NODE(&dev->node_hnode);
+		}
+	}
+	free(idx->devs);
+	free(idx->seq_devs);
+	free(idx->name_hash);
+	free(idx->node_hash);
+	idx->devs = NULL;
+	idx->seq_devs = NULL;
+	idx->name_hash = NULL;
+	idx->node_hash = NULL;
+	idx->devs_size = 0;
+	idx->seq_size = 0;
+	idx->hash_size = 0;
+}
+
+static int uclass_index_build(struct uclass *uc)
+{
+	struct uclass_index *idx = &uc->idx;
+	struct udevice *dev;
+	int size, i = 0;
+
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	/* Memory is scarce before relocation, and free() does nothing */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return -ENOSPC;
+#endif
+	for (size = UCLASS_INDEX_MIN_DEVS * 2; size < idx->dev_count * 2;
+	     size *= 2)
+		;
+	idx->devs = malloc(size * sizeof(*idx->devs));
+	idx->name_hash = calloc(size, sizeof(*idx->name_hash));
+	idx->node_hash = calloc(size, sizeof(*idx->node_hash));
+	if (!idx->devs || !idx->name_hash || !idx->node_hash)
+		goto err;
+	idx->devs_size = size;
+	idx->hash_size = size;
+
+	uclass_foreach_dev(dev, uc) {
+		idx->devs[i++] = dev;
+		INIT_HLIST_NODE(&dev->name_hnode);
+		INIT_HLIST_NODE(&dev->node_hnode);
+		uclass_index_hash_dev(uc, dev);
+		if (dev->seq != -1) {
+			if (uclass_index_grow_seq(idx, dev->seq))
+				goto err;
+			idx->seq_devs[dev->seq] = dev;
+		}
+	}
+
+	return 0;
+err:
+	uclass_index_free(uc);
+
+	return -ENOMEM;
+}
+
+/* Add a device which has just been added to the end of the uclass's list */
+static void uclass_index_add(struct uclass *uc, struct udevice *dev)
+{
+	struct uclass_index *idx = &uc->idx;
+
+	idx->dev_count++;
+	if (dev->req_seq > idx->max_req_seq) {
+		idx->max_req_seq = dev->req_seq;
+		idx->max_req_seq_stale = false;
+	}
+	if (idx->dev_count > idx->devs_size) {
+		/* Replace the index with a larger one, if it is worth it */
+		uclass_index_free(uc);
+		if (idx->dev_count > UCLASS_INDEX_MIN_DEVS)
+			uclass_index_build(uc);
+		return;
+	}
+	idx->devs[idx->dev_count - 1] = dev;
+	INIT_HLIST_NODE(&dev->name_hnode);
+	INIT_HLIST_NODE(&dev->node_hnode);
+	uclass_index_hash_dev(uc, dev);
+}
+
+/* Remove a device which has just been removed from the uclass's list */
+static void uclass_index_remove(struct uclass *uc, struct udevice *dev)
+{
+	struct uclass_index *idx = &uc->idx;
+	int i;
+
+	if (dev->req_seq != -1 && dev->req_seq >= idx->max_req_seq)
+		idx->max_req_seq_stale = true;
+	if (idx->hash_size) {
+		hlist_del_init(&dev->name_hnode);
+		hlist_del_init(&dev->node_hnode);
+		if (dev->seq != -1 && dev->seq < idx->seq_size &&
+		    idx->seq_devs[dev->seq] == dev)
+			idx->seq_devs[dev->seq] = NULL;
+		for (i = 0; i < idx->dev_count; i++) {
+			if (idx->devs[i] == dev) {
+				memmove(&idx->devs[i], &idx->devs[i + 1],
+					(idx->dev_count - i - 1) *
+					sizeof(*idx->devs));
+				break;
+			}
+		}
+	}
+	idx->dev_count--;
+}
+
+void uclass_index_update(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+
+	if (!uc->idx.hash_size)
+		return;
+	hlist_del_init(&dev->name_hnode);
+	hlist_del_init(&dev->node_hnode);
+	uclass_index_hash_dev(uc, dev);
+}
+
+void uclass_req_seq_changed(struct udevice *dev, int old_req_seq)
+{
+	struct uclass_index *idx = &dev->uclass->idx;
+
+	if (old_req_seq != -1 && old_req_seq >= idx->max_req_seq &&
+	    dev->req_seq < old_req_seq)
+		idx->max_req_seq_stale = true;
+	if (dev->req_seq > idx->max_req_seq) {
+		idx->max_req_seq = dev->req_seq;
+		idx->max_req_seq_stale = false;
+	}
+}
+
+void uclass_set_device_seq(struct udevice *dev, int seq)
+{
+	struct uclass_index *idx = &dev->uclass->idx;
+
+	if (idx->hash_size) {
+		if (dev->seq != -1 && dev->seq < idx->seq_size &&
+		    idx->seq_devs[dev->seq] == dev)
+			idx->seq_devs[dev->seq] = NULL;
+		if (seq != -1) {
+			if (uclass_index_grow_seq(idx, seq))
+				uclass_index_free(dev->uclass);
+			else
+				idx->seq_devs[seq] = dev;
+		}
+	}
+	dev->seq = seq;
+}
+#else
+static inline void uclass_index_free(struct uclass *uc) {}
+static inline void uclass_index_add(struct uclass *uc, struct udevice *dev) {}
+static inline void uclass_index_remove(struct uclass *uc,
+				       struct udevice *dev) {}
+#endif
+
 /**
  * uclass_add() - Create new uclass in list
  * @id: Id number to create
@@ -78,6 +333,9 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	uc->uc_drv = uc_drv;
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	uc->idx.max_req_seq = -1;
+#endif
 	list_add(&uc->sibling_node, &DM_UCLASS_ROOT_NON_CONST);
 
 	if (uc_drv->init) {
@@ -130,6 +388,7 @@ int uclass_destroy(struct uclass *uc)
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
 		free(uc->priv);
+	uclass_index_free(uc);
 	free(uc);
 
 	return 0;
@@ -205,6 +464,14 @@ int uclass_find_device(enum uclass_id id, int index, struct udevice **devp)
 	if (list_empty(&uc->dev_head))
 		return -ENODEV;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	if (uc->idx.hash_size) {
+		if (index < 0 || index >= uc->idx.dev_count)
+			return -ENODEV;
+		*devp = uc->idx.devs[index];
+		return 0;
+	}
+#endif
 	uclass_foreach_dev(dev, uc) {
 		if (!index--) {
 			*devp = dev;
@@ -248,8 +515,9 @@ int uclass_find_next_device(struct udevice **devp)
 int uclass_find_device_by_name(enum uclass_id id, const char *name,
 			       struct udevice **devp)
 {
+	struct udevice *dev, *found = NULL;
 	struct uclass *uc;
-	struct udevice *dev;
+	int len;
 	int ret;
 
 	*devp = NULL;
@@ -259,14 +527,36 @@ int uclass_find_device_by_name(enum uclass_id id, const char *name,
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	if (uc->idx.hash_size) {
+		struct hlist_node *node;
+
+		hlist_for_each_entry(dev, node, uclass_name_bucket(uc, name),
+				     name_hnode) {
+			if (!strcmp(dev->name, name)) {
+				*devp = dev;
+				return 0;
+			}
+		}
+	}
+#endif
+	/* Prefer an exact match, else use the first device with this prefix */
+	len = strlen(name);
 	uclass_foreach_dev(dev, uc) {
-		if (!strncmp(dev->name, name, strlen(name))) {
-			*devp = dev;
-			return 0;
+		if (!strncmp(dev->name, name, len)) {
+			if (!dev->name[len]) {
+				*devp = dev;
+				return 0;
+			}
+			if (!found)
+				found = dev;
 		}
 	}
+	if (!found)
+		return -ENODEV;
+	*devp = found;
 
-	return -ENODEV;
+	return 0;
 }
 
 #if !CONFIG_IS_ENABLED(OF_CONTROL) || CONFIG_IS_ENABLED(OF_PLATDATA)
@@ -281,10 +571,18 @@ int uclass_find_next_free_req_seq(enum uclass_id id)
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	if (!uc->idx.max_req_seq_stale)
+		return uc->idx.max_req_seq + 1;
+#endif
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		if ((dev->req_seq != -1) && (dev->req_seq > max))
 			max = dev->req_seq;
 	}
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	uc->idx.max_req_seq = max;
+	uc->idx.max_req_seq_stale = false;
+#endif
 
 	if (max == -1)
 		return 0;
@@ -308,6 +606,14 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	if (uc->idx.hash_size && !find_req_seq) {
+		if (seq_or_req_seq >= 0 && seq_or_req_seq < uc->idx.seq_size)
+			*devp = uc->idx.seq_devs[seq_or_req_seq];
+		debug("   - %s\n", *devp ? "found" : "not found");
+		return *devp ? 0 : -ENODEV;
+	}
+#endif
 	uclass_foreach_dev(dev, uc) {
 		debug("   - %d %d '%s'\n", dev->req_seq, dev->seq, dev->name);
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
@@ -332,6 +638,9 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	*devp = NULL;
 	if (node < 0)
 		return -ENODEV;
+	if (CONFIG_IS_ENABLED(DM_UCLASS_INDEX) && !of_live_active())
+		return uclass_find_device_by_ofnode(id, offset_to_ofnode(node),
+						    devp);
 	ret = uclass_get(id, &uc);
 	if (ret)
 		return ret;
@@ -361,6 +670,21 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	if (uc->idx.hash_size) {
+		struct hlist_node *hnode;
+
+		hlist_for_each_entry(dev, hnode, uclass_node_bucket(uc, node),
+				     node_hnode) {
+			if (ofnode_equal(dev_ofnode(dev), node)) {
+				*devp = dev;
+				goto done;
+			}
+		}
+		ret = -ENODEV;
+		goto done;
+	}
+#endif
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
@@ -447,11 +771,17 @@ int uclass_get_device_tail(struct udevice *dev, int ret, struct udevice **devp)
 int uclass_get_device(enum uclass_id id, int index, struct udevice **devp)
 {
 	struct udevice *dev;
+	int span = -1;
 	int ret;
 
 	*devp = NULL;
 	ret = uclass_find_device(id, index, &dev);
-	return uclass_get_device_tail(dev, ret, devp);
+	if (!ret && dev)
+		span = bootstage_span_begin("get", dev->name);
+	ret = uclass_get_device_tail(dev, ret, devp);
+	bootstage_span_end(span);
+
+	return ret;
 }
 
 int uclass_get_device_by_name(enum uclass_id id, const char *name,
@@ -624,6 +954,33 @@ int uclass_next_device_check(struct udevice **devp)
 	return device_probe(*devp);
 }
 
+int uclass_probe_all(enum uclass_id id)
+{
+	struct udevice **devs, *dev;
+	struct uclass *uc;
+	int count = 0;
+	int ret;
+
+	ret = uclass_get(id, &uc);
+	if (ret)
+		return ret;
+	list_for_each_entry(dev, &uc->dev_head, uclass_node)
+		count++;
+	if (!count)
+		return 0;
+
+	devs = malloc(count * sizeof(*devs));
+	if (!devs)
+		return -ENOMEM;
+	count = 0;
+	list_for_each_entry(dev, &uc->dev_head, uclass_node)
+		devs[count++] = dev;
+	ret = device_probe_list(devs, count);
+	free(devs);
+
+	return ret;
+}
+
 int uclass_bind_device(struct udevice *dev)
 {
 	struct uclass *uc;
@@ -631,6 +988,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_index_add(uc, dev);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -646,6 +1004,7 @@ int uclass_bind_device(struct udevice *dev)
 err:
 	/* There is no need to undo the parent's post_bind call */
 	list_del(&dev->uclass_node);
+	uclass_index_remove(uc, dev);
 
 	return ret;
 }
@@ -664,6 +1023,7 @@ int uclass_unbind_device(struct udevice *dev)
 	}
 
 	list_del(&dev->uclass_node);
+	uclass_index_remove(uc, dev);
 	return 0;
 }
 #endif
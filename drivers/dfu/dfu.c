@@ -83,8 +83,38 @@ done:
 static unsigned char *dfu_buf;
 static unsigned long dfu_buf_size;
 
+#if CONFIG_IS_ENABLED(DFU_WRITE_ASYNC)
+/* Buffer receiving data while dfu_buf is written, and vice versa */
+static unsigned char *dfu_buf_spare;
+
+/**
+ * struct dfu_pending - A full buffer being written in the background
+ *
+ * @dfu:	Entity being written, NULL if none
+ * @buf:	Next data to write
+ * @left:	Number of bytes left to write
+ * @offset:	Offset of @buf in the medium
+ * @err:	Error from a background write, returned by the next
+ *		dfu_write() or dfu_flush()
+ * @enabled:	true if the caller polls with dfu_write_poll()
+ */
+static struct dfu_pending {
+	struct dfu_entity *dfu;
+	u8 *buf;
+	long left;
+	u64 offset;
+	int err;
+	bool enabled;
+} dfu_pending;
+#endif
+
 unsigned char *dfu_free_buf(void)
 {
+#if CONFIG_IS_ENABLED(DFU_WRITE_ASYNC)
+	dfu_pending.dfu = NULL;
+	free(dfu_buf_spare);
+	dfu_buf_spare = NULL;
+#endif
 	free(dfu_buf);
 	dfu_buf = NULL;
 	return dfu_buf;
@@ -116,6 +146,12 @@ unsigned char *dfu_get_buf(struct dfu_entity *dfu)
 	if (dfu_buf == NULL)
 		printf("%s: Could not memalign 0x%lx bytes\n",
 		       __func__, dfu_buf_size);
+#if CONFIG_IS_ENABLED(DFU_WRITE_ASYNC)
+	/* Without a spare buffer, writes are simply not made in background */
+	else
+		dfu_buf_spare = memalign(CONFIG_SYS_CACHELINE_SIZE,
+					 dfu_buf_size);
+#endif
 
 	return dfu_buf;
 }
@@ -137,19 +173,135 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
+#if CONFIG_IS_ENABLED(DFU_WRITE_ASYNC)
+static inline int dfu_write_error(void)
+{
+	return dfu_pending.err;
+}
+
+static void dfu_write_discard(void)
+{
+	dfu_pending.dfu = NULL;
+	dfu_pending.err = 0;
+}
+
+void dfu_set_write_async(bool enable)
+{
+	dfu_pending.enabled = enable;
+	dfu_write_discard();
+}
+
+static int dfu_write_slice(void)
+{
+	struct dfu_pending *pend = &dfu_pending;
+	struct dfu_entity *dfu = pend->dfu;
+	long w_size;
+	int ret;
+
+	w_size = min(pend->left, (long)roundup(CONFIG_DFU_WRITE_SLICE_SIZE,
+					       dfu->write_align));
+	ret = dfu->write_medium(dfu, pend->offset, pend->buf, &w_size);
+	if (ret) {
+		debug("%s: Write error!\n", __func__);
+		pend->dfu = NULL;
+		return ret;
+	}
+	pend->buf += w_size;
+	pend->offset += w_size;
+	pend->left -= w_size;
+	if (pend->left <= 0) {
+		pend->dfu = NULL;
+		puts("#");
+	}
+
+	return 0;
+}
+
+void dfu_write_poll(void)
+{
+	if (dfu_pending.dfu && !dfu_pending.err)
+		dfu_pending.err = dfu_write_slice();
+}
+
+/* Finish writing the buffer in the background, returning any error */
+static int dfu_write_wait(void)
+{
+	int ret;
+
+	while (dfu_pending.dfu && !dfu_pending.err)
+		dfu_pending.err = dfu_write_slice();
+	ret = dfu_pending.err;
+	dfu_write_discard();
+
+	return ret;
+}
+
+/*
+ * Hand a full buffer over to dfu_write_poll() and continue with the spare
+ * one. This is only done for whole multiples of the alignment, so that the
+ * offset of the next buffer is known.
+ */
+static bool dfu_write_start(struct dfu_entity *dfu, long w_size)
+{
+	struct dfu_pending *pend = &dfu_pending;
+
+	if (!pend->enabled || !dfu_buf_spare || !dfu->write_align ||
+	    w_size % dfu->write_align)
+		return false;
+
+	pend->dfu = dfu;
+	pend->buf = dfu->i_buf_start;
+	pend->left = w_size;
+	pend->offset = dfu->offset;
+
+	if (dfu->i_buf_start == dfu_buf)
+		dfu->i_buf_start = dfu_buf_spare;
+	else
+		dfu->i_buf_start = dfu_buf;
+	dfu->i_buf_end = dfu->i_buf_start + dfu_get_buf_size();
+	dfu->i_buf = dfu->i_buf_start;
+	dfu->offset += w_size;
+
+	return true;
+}
+#else
+static inline int dfu_write_error(void)
+{
+	return 0;
+}
+
+static inline void dfu_write_discard(void)
+{
+}
+
+static inline int dfu_write_wait(void)
+{
+	return 0;
+}
+
+static inline bool dfu_write_start(struct dfu_entity *dfu, long w_size)
+{
+	return false;
+}
+#endif
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
 	int ret;
 
+	/* only one buffer may be written at a time */
+	ret = dfu_write_wait();
+	if (ret)
+		return ret;
+
 	/* flush size? */
 	w_size = dfu->i_buf - dfu->i_buf_start;
 	if (w_size == 0)
 		return 0;
 
-	if (dfu_hash_algo)
-		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
-					   dfu->i_buf_start, w_size, 0);
+	if (dfu_write_start(dfu, w_size))
+		return 0;
 
 	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
 	if (ret)
@@ -178,6 +330,7 @@ void dfu_transaction_cleanup(struct dfu_entity *dfu)
 	dfu->r_left = 0;
 	dfu->b_left = 0;
 	dfu->bad_skip = 0;
+	dfu_write_discard();
 
 	dfu->inited = 0;
 }
@@ -213,6 +366,8 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	int ret = 0;
 
 	ret = dfu_write_buffer_drain(dfu);
+	if (!ret)
+		ret = dfu_write_wait();
 	if (ret)
 		return ret;
 
@@ -263,6 +418,13 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	/* handle rollover */
 	dfu->i_blk_seq_num = (dfu->i_blk_seq_num + 1) & 0xffff;
 
+	/* report a failed write as soon as possible */
+	ret = dfu_write_error();
+	if (ret) {
+		dfu_transaction_cleanup(dfu);
+		return ret;
+	}
+
 	/* flush buffer if overflow */
 	if ((dfu->i_buf + size) > dfu->i_buf_end) {
 		ret = dfu_write_buffer_drain(dfu);
@@ -280,6 +442,11 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 		return -1;
 	}
 
+	/* hash the data now, while it is in the cache */
+	if (dfu_hash_algo)
+		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc, buf, size,
+					   0);
+
 	memcpy(dfu->i_buf, buf, size);
 	dfu->i_buf += size;
 
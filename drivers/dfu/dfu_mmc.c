@@ -378,6 +378,10 @@ int dfu_fill_entity_mmc(struct dfu_entity *dfu, char *devstr, char *s)
 		dfu->data.mmc.part = third_arg;
 	}
 
+	/* raw data may be written a block at a time, files are buffered */
+	if (dfu->layout == DFU_RAW_ADDR)
+		dfu->write_align = dfu->data.mmc.lba_blk_size;
+
 	dfu->dev_type = DFU_DEV_MMC;
 	dfu->get_medium_size = dfu_get_medium_size_mmc;
 	dfu->read_medium = dfu_read_medium_mmc;
@@ -34,13 +34,21 @@ static u64 find_sector(struct dfu_entity *dfu, u64 start, u64 offset)
 static int dfu_write_medium_sf(struct dfu_entity *dfu,
 		u64 offset, void *buf, long *len)
 {
+	u32 sector_size = dfu->data.sf.dev->sector_size;
 	int ret;
 
-	ret = spi_flash_erase(dfu->data.sf.dev,
-			      find_sector(dfu, dfu->data.sf.start, offset),
-			      dfu->data.sf.dev->sector_size);
-	if (ret)
-		return ret;
+	/*
+	 * The buffer holds one sector, but may be written in several pieces.
+	 * Only erase the sector before writing the first.
+	 */
+	if (lldiv(offset, sector_size) * sector_size == offset) {
+		ret = spi_flash_erase(dfu->data.sf.dev,
+				      find_sector(dfu, dfu->data.sf.start,
+						  offset),
+				      sector_size);
+		if (ret)
+			return ret;
+	}
 
 	ret = spi_flash_write(dfu->data.sf.dev, dfu->data.sf.start + offset,
 			      *len, buf);
@@ -126,6 +134,7 @@ int dfu_fill_entity_sf(struct dfu_entity *dfu, char *devstr, char *s)
 
 	dfu->dev_type = DFU_DEV_SF;
 	dfu->max_buf_size = dfu->data.sf.dev->sector_size;
+	dfu->write_align = dfu->data.sf.dev->page_size;
 
 	st = strsep(&s, " ");
 	if (!strcmp(st, "raw")) {
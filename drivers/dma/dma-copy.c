@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Offloading large memory copies to a DMA engine
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <dma.h>
+#include <dma-uclass.h>
+#include <watchdog.h>
+
+/* Size of each piece of a copy done by the CPU, between watchdog resets */
+#define CPU_CHUNK	(64 << 10)
+
+static void dma_copy_cpu(void *dst, const void *src, size_t len)
+{
+	size_t chunk;
+
+	if (dst < src + len && src < dst + len) {
+		memmove(dst, src, len);
+		return;
+	}
+	while (len) {
+		chunk = min_t(size_t, len, CPU_CHUNK);
+		memcpy(dst, src, chunk);
+		dst += chunk;
+		src += chunk;
+		len -= chunk;
+		WATCHDOG_RESET();
+	}
+}
+
+/* Find a DMA device which can copy memory, without any fuss if none */
+static struct udevice *dma_copy_get_device(void)
+{
+	const struct dma_ops *ops;
+	struct udevice *dev;
+
+	if (dma_get_device(DMA_SUPPORTS_MEM_TO_MEM, &dev))
+		return NULL;
+	ops = device_get_ops(dev);
+	if (!ops->transfer_start && !ops->transfer)
+		return NULL;
+
+	return dev;
+}
+
+void dma_copy_start(struct dma_copy *copy, void *dst, const void *src,
+		    size_t len)
+{
+	const ulong mask = ARCH_DMA_MINALIGN - 1;
+	const struct dma_ops *ops;
+	struct udevice *dev;
+	ulong start, end;
+	int ret;
+
+	copy->dev = NULL;
+	start = ALIGN((ulong)dst, ARCH_DMA_MINALIGN);
+	end = ((ulong)dst + len) & ~mask;
+	if (len < CONFIG_DMA_COPY_THRESHOLD || end <= start ||
+	    (dst < src + len && src < dst + len)) {
+		dma_copy_cpu(dst, src, len);
+		return;
+	}
+	dev = dma_copy_get_device();
+	if (!dev) {
+		dma_copy_cpu(dst, src, len);
+		return;
+	}
+
+	/* DMA copies whole cache lines of @dst, the CPU does the rest */
+	copy->dst = (void *)start;
+	copy->src = src + (start - (ulong)dst);
+	copy->len = end - start;
+
+	/*
+	 * Write the source back to RAM so the engine sees it, and drop any
+	 * destination lines so that no writeback races with the engine
+	 */
+	flush_dcache_range((ulong)copy->src & ~mask,
+			   ALIGN((ulong)copy->src + copy->len,
+				 ARCH_DMA_MINALIGN));
+	invalidate_dcache_range(start, end);
+
+	ops = device_get_ops(dev);
+	if (ops->transfer_start)
+		ret = ops->transfer_start(dev, DMA_MEM_TO_MEM, copy->dst,
+					  (void *)copy->src, copy->len);
+	else
+		ret = ops->transfer(dev, DMA_MEM_TO_MEM, copy->dst,
+				    (void *)copy->src, copy->len);
+	if (ret) {
+		debug("%s: DMA copy failed (err=%d)\n", __func__, ret);
+		dma_copy_cpu(dst, src, len);
+		return;
+	}
+	if (ops->transfer_start)
+		copy->dev = dev;
+	else
+		invalidate_dcache_range(start, end);
+
+	memcpy(dst, src, start - (ulong)dst);
+	memcpy((void *)end, src + (end - (ulong)dst), (ulong)dst + len - end);
+}
+
+void dma_copy_wait(struct dma_copy *copy)
+{
+	const struct dma_ops *ops;
+	int ret;
+
+	if (!copy->dev)
+		return;
+
+	ops = device_get_ops(copy->dev);
+	while ((ret = ops->transfer_poll(copy->dev)) == -EBUSY)
+		WATCHDOG_RESET();
+	copy->dev = NULL;
+
+	/* Drop any lines fetched by speculation while the engine wrote */
+	invalidate_dcache_range((ulong)copy->dst,
+				(ulong)copy->dst + copy->len);
+	if (ret) {
+		debug("%s: DMA copy failed (err=%d)\n", __func__, ret);
+		dma_copy_cpu(copy->dst, copy->src, copy->len);
+	}
+}
+
+void dma_copy(void *dst, const void *src, size_t len)
+{
+	struct dma_copy copy;
+
+	dma_copy_start(&copy, dst, src, len);
+	dma_copy_wait(&copy);
+}
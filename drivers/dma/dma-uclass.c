@@ -202,11 +202,8 @@ int dma_get_device(u32 transfer_type, struct udevice **devp)
 			break;
 	}
 
-	if (!dev) {
-		pr_err("No DMA device found that supports %x type\n",
-		      transfer_type);
+	if (!dev)
 		return -EPROTONOSUPPORT;
-	}
 
 	*devp = dev;
 
@@ -220,8 +217,11 @@ int dma_memcpy(void *dst, void *src, size_t len)
 	int ret;
 
 	ret = dma_get_device(DMA_SUPPORTS_MEM_TO_MEM, &dev);
-	if (ret < 0)
+	if (ret < 0) {
+		pr_err("No DMA device found that supports %x type\n",
+		       (u32)DMA_SUPPORTS_MEM_TO_MEM);
 		return ret;
+	}
 
 	ops = device_get_ops(dev);
 	if (!ops->transfer)
@@ -16,6 +16,8 @@
 
 #define SANDBOX_DMA_CH_CNT 3
 #define SANDBOX_DMA_BUF_SIZE 1024
+/* Bytes copied by each poll of a memory-to-memory transfer */
+#define SANDBOX_DMA_COPY_STEP 4096
 
 struct sandbox_dma_chan {
 	struct sandbox_dma_dev *ud;
@@ -34,6 +36,9 @@ struct sandbox_dma_dev {
 	uchar	*buf_rx;
 	size_t	data_len;
 	u32	meta;
+	uchar	*copy_dst;
+	uchar	*copy_src;
+	size_t	copy_left;
 };
 
 static int sandbox_dma_transfer(struct udevice *dev, int direction,
@@ -44,6 +49,37 @@ static int sandbox_dma_transfer(struct udevice *dev, int direction,
 	return 0;
 }
 
+/*
+ * Memory-to-memory transfers run in the background, as with real hardware.
+ * Each poll moves the transfer along a little.
+ */
+static int sandbox_dma_transfer_start(struct udevice *dev, int direction,
+				      void *dst, void *src, size_t len)
+{
+	struct sandbox_dma_dev *ud = dev_get_priv(dev);
+
+	if (ud->copy_left)
+		return -EBUSY;
+	ud->copy_dst = dst;
+	ud->copy_src = src;
+	ud->copy_left = len;
+
+	return 0;
+}
+
+static int sandbox_dma_transfer_poll(struct udevice *dev)
+{
+	struct sandbox_dma_dev *ud = dev_get_priv(dev);
+	size_t step = min_t(size_t, ud->copy_left, SANDBOX_DMA_COPY_STEP);
+
+	memcpy(ud->copy_dst, ud->copy_src, step);
+	ud->copy_dst += step;
+	ud->copy_src += step;
+	ud->copy_left -= step;
+
+	return ud->copy_left ? -EBUSY : 0;
+}
+
 static int sandbox_dma_of_xlate(struct dma *dma,
 				struct ofnode_phandle_args *args)
 {
@@ -227,6 +263,8 @@ static int sandbox_dma_prepare_rcv_buf(struct dma *dma, void *dst, size_t size)
 
 static const struct dma_ops sandbox_dma_ops = {
 	.transfer	= sandbox_dma_transfer,
+	.transfer_start	= sandbox_dma_transfer_start,
+	.transfer_poll	= sandbox_dma_transfer_poll,
 	.of_xlate	= sandbox_dma_of_xlate,
 	.request	= sandbox_dma_request,
 	.free		= sandbox_dma_free,
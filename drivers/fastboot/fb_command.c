@@ -26,6 +26,16 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+/**
+ * stream_part - partition to write the next download to, if not empty
+ */
+static char stream_part[PART_NAME_LEN];
+
+/**
+ * streaming - true if the current download is written to flash as it arrives
+ */
+static bool streaming;
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -37,6 +47,9 @@ static void reboot_bootloader(char *, char *);
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 static void oem_format(char *, char *);
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+static void oem_stream(char *, char *);
+#endif
 
 static const struct {
 	const char *command;
@@ -86,6 +99,12 @@ static const struct {
 		.dispatch = oem_format,
 	},
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	[FASTBOOT_COMMAND_OEM_STREAM] = {
+		.command = "oem stream",
+		.dispatch = oem_stream,
+	},
+#endif
 };
 
 /**
@@ -147,6 +166,40 @@ static void getvar(char *cmd_parameter, char *response)
 	fastboot_getvar(cmd_parameter, response);
 }
 
+/**
+ * stream_download() - Start a download which is written to flash as it arrives
+ *
+ * @cmd_parameter: Pointer to command parameter
+ * @response: Pointer to fastboot response buffer
+ *
+ * The image is written to the partition given by the last "oem stream"
+ * command, so it does not need to fit in the download buffer.
+ */
+static void stream_download(char *cmd_parameter, char *response)
+{
+	int ret;
+
+	printf("Starting download of %d bytes to '%s'\n",
+	       fastboot_bytes_expected, stream_part);
+	ret = fastboot_mmc_stream_start(stream_part, fastboot_bytes_expected,
+					response);
+	*stream_part = '\0';
+	if (ret) {
+		fastboot_bytes_expected = 0;
+		return;
+	}
+	streaming = true;
+	fastboot_response("DATA", response, "%s", cmd_parameter);
+}
+
+/* Abandon any streamed download which did not complete */
+static void stream_abort(void)
+{
+	streaming = false;
+	if (CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM))
+		fastboot_mmc_stream_abort();
+}
+
 /**
  * fastboot_download() - Start a download transfer from the client
  *
@@ -157,6 +210,7 @@ static void download(char *cmd_parameter, char *response)
 {
 	char *tmp;
 
+	stream_abort();
 	if (!cmd_parameter) {
 		fastboot_fail("Expected command parameter", response);
 		return;
@@ -167,6 +221,10 @@ static void download(char *cmd_parameter, char *response)
 		fastboot_fail("Expected nonzero image size", response);
 		return;
 	}
+	if (CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM) && *stream_part) {
+		stream_download(cmd_parameter, response);
+		return;
+	}
 	/*
 	 * Nothing to download yet. Response is of the form:
 	 * [DATA|FAIL]$cmd_parameter
@@ -192,6 +250,17 @@ u32 fastboot_data_remaining(void)
 	return fastboot_bytes_expected - fastboot_bytes_received;
 }
 
+/**
+ * fastboot_data_streaming() - Check if the current download is streamed
+ *
+ * Return: true if the download is written to flash as it arrives, rather
+ * than stored in fastboot_buf_addr
+ */
+bool fastboot_data_streaming(void)
+{
+	return CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM) && streaming;
+}
+
 /**
  * fastboot_data_download() - Copy image data to fastboot_buf_addr.
  *
@@ -199,9 +268,9 @@ u32 fastboot_data_remaining(void)
  * @fastboot_data_len: Length of received fastboot data
  * @response: Pointer to fastboot response buffer
  *
- * Copies image data from fastboot_data to fastboot_buf_addr. Writes to
- * response. fastboot_bytes_received is updated to indicate the number
- * of bytes that have been transferred.
+ * Copies image data from fastboot_data to fastboot_buf_addr, or writes it to
+ * flash for a streamed download. Writes to response. fastboot_bytes_received
+ * is updated to indicate the number of bytes that have been transferred.
  *
  * On completion sets image_size and ${filesize} to the total size of the
  * downloaded image.
@@ -220,9 +289,14 @@ void fastboot_data_download(const void *fastboot_data,
 			      response);
 		return;
 	}
-	/* Download data to fastboot_buf_addr */
-	memcpy(fastboot_buf_addr + fastboot_bytes_received,
-	       fastboot_data, fastboot_data_len);
+	if (fastboot_data_streaming()) {
+		/* Errors are reported when the download completes */
+		fastboot_mmc_stream_write(fastboot_data, fastboot_data_len);
+	} else {
+		/* Download data to fastboot_buf_addr */
+		memcpy(fastboot_buf_addr + fastboot_bytes_received,
+		       fastboot_data, fastboot_data_len);
+	}
 
 	pre_dot_num = fastboot_bytes_received / BYTES_PER_DOT;
 	fastboot_bytes_received += fastboot_data_len;
@@ -242,14 +316,36 @@ void fastboot_data_download(const void *fastboot_data,
  * @response: Pointer to fastboot response buffer
  *
  * Set image_size and ${filesize} to the total size of the downloaded image.
+ * For a streamed download, finish writing the image and respond with the
+ * result.
  */
 void fastboot_data_complete(char *response)
 {
-	/* Download complete. Respond with "OKAY" */
-	fastboot_okay(NULL, response);
 	printf("\ndownloading of %d bytes finished\n", fastboot_bytes_received);
-	image_size = fastboot_bytes_received;
-	env_set_hex("filesize", image_size);
+	if (fastboot_data_streaming()) {
+		/* Nothing was stored in the buffer, so leave ${filesize} */
+		streaming = false;
+		fastboot_mmc_stream_finish(response);
+	} else {
+		/* Download complete. Respond with "OKAY" */
+		fastboot_okay(NULL, response);
+		image_size = fastboot_bytes_received;
+		env_set_hex("filesize", image_size);
+	}
+	fastboot_bytes_expected = 0;
+	fastboot_bytes_received = 0;
+}
+
+/**
+ * fastboot_data_abort() - Abandon the current download
+ *
+ * Forget the current download and any "oem stream" command, freeing anything
+ * held by a streamed download.
+ */
+void fastboot_data_abort(void)
+{
+	stream_abort();
+	*stream_part = '\0';
 	fastboot_bytes_expected = 0;
 	fastboot_bytes_received = 0;
 }
@@ -333,3 +429,21 @@ static void oem_format(char *cmd_parameter, char *response)
 	}
 }
 #endif
+
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/**
+ * oem_stream() - Write the next download to a partition as it arrives
+ *
+ * @cmd_parameter: Pointer to partition name
+ * @response: Pointer to fastboot response buffer
+ */
+static void oem_stream(char *cmd_parameter, char *response)
+{
+	if (!cmd_parameter || !*cmd_parameter) {
+		fastboot_fail("Expected partition name", response);
+		return;
+	}
+	strlcpy(stream_part, cmd_parameter, sizeof(stream_part));
+	fastboot_okay(NULL, response);
+}
+#endif
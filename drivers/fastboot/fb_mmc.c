@@ -96,6 +96,69 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	/*
+	 * The range is aligned to erase groups, so erase it in one go rather
+	 * than in FASTBOOT_MAX_BLK_WRITE pieces, which may split groups
+	 */
+	if (fastboot_progress_callback)
+		fastboot_progress_callback("erasing");
+
+	return blk_derase(sparse->dev_desc, blk, blkcnt);
+}
+
+/**
+ * fb_mmc_erase_is_zero() - Check if erased blocks read as zero
+ *
+ * Erasing is much faster than writing zeroes, but the erased value depends on
+ * the device. SD cards do not report it reliably, so only eMMC is used.
+ *
+ * @mmc: MMC device
+ * @return true if erased blocks read as zero
+ */
+static bool fb_mmc_erase_is_zero(struct mmc *mmc)
+{
+	return mmc && !IS_SD(mmc) && mmc->ext_csd &&
+	       !mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT];
+}
+
+/**
+ * fb_mmc_sparse_setup() - Set up storage for writing a sparse image
+ *
+ * @sparse: Storage to set up
+ * @sparse_priv: Private data for the storage
+ * @dev_desc: Block device to write
+ * @info: Partition to write
+ */
+static void fb_mmc_sparse_setup(struct sparse_storage *sparse,
+				struct fb_mmc_sparse *sparse_priv,
+				struct blk_desc *dev_desc,
+				disk_partition_t *info)
+{
+	struct mmc *mmc = find_mmc_device(CONFIG_FASTBOOT_FLASH_MMC_DEV);
+
+	sparse_priv->dev_desc = dev_desc;
+
+	sparse->blksz = info->blksz;
+	sparse->start = info->start;
+	sparse->size = info->size;
+	sparse->write = fb_mmc_sparse_write;
+	sparse->reserve = fb_mmc_sparse_reserve;
+	if (fb_mmc_erase_is_zero(mmc)) {
+		sparse->erase = fb_mmc_sparse_erase;
+		sparse->erase_grp = mmc->erase_grp_size;
+	} else {
+		sparse->erase = NULL;
+		sparse->erase_grp = 0;
+	}
+	sparse->mssg = fastboot_fail;
+	sparse->priv = sparse_priv;
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		u32 download_bytes, char *response)
@@ -405,19 +468,11 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		struct sparse_storage sparse;
 		int err;
 
-		sparse_priv.dev_desc = dev_desc;
-
-		sparse.blksz = info.blksz;
-		sparse.start = info.start;
-		sparse.size = info.size;
-		sparse.write = fb_mmc_sparse_write;
-		sparse.reserve = fb_mmc_sparse_reserve;
-		sparse.mssg = fastboot_fail;
+		fb_mmc_sparse_setup(&sparse, &sparse_priv, dev_desc, &info);
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
 
-		sparse.priv = &sparse_priv;
 		err = write_sparse_image(&sparse, cmd, download_buffer,
 					 response);
 		if (!err)
@@ -428,6 +483,249 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	}
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/**
+ * struct fb_mmc_stream - State for writing an image while it is downloaded
+ *
+ * @dev_desc: Block device being written
+ * @info: Partition being written
+ * @sparse_priv: Private data for @sparse
+ * @sparse: Storage for writing a sparse image
+ * @strm: Sparse image state, if @is_sparse
+ * @download_bytes: Size of image
+ * @started: true once the type of image is known
+ * @is_sparse: true if the image is a sparse image
+ * @blk: Next block to write, for a raw image
+ * @buf: Buffer holding the start of the image, then raw data to write
+ * @buf_size: Size of @buf, a whole number of blocks
+ * @pending: Number of bytes in @buf
+ * @err: Error which stopped the write, or 0
+ * @response: Failure response, sent when the download completes
+ */
+struct fb_mmc_stream {
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+	struct fb_mmc_sparse sparse_priv;
+	struct sparse_storage sparse;
+	struct sparse_stream strm;
+	u32 download_bytes;
+	bool started;
+	bool is_sparse;
+	lbaint_t blk;
+	u8 *buf;
+	u32 buf_size;
+	u32 pending;
+	int err;
+	char response[FASTBOOT_RESPONSE_LEN];
+};
+
+static struct fb_mmc_stream fb_stream;
+
+static int fb_mmc_stream_write_blks(struct fb_mmc_stream *fs,
+				    const void *buffer, lbaint_t blkcnt)
+{
+	lbaint_t blks;
+
+	blks = fb_mmc_blk_write(fs->dev_desc, fs->blk, blkcnt, buffer);
+	if (blks != blkcnt) {
+		pr_err("failed writing to device %d\n", fs->dev_desc->devnum);
+		fastboot_fail("failed writing to device", fs->response);
+		return -EIO;
+	}
+	fs->blk += blkcnt;
+
+	return 0;
+}
+
+static int fb_mmc_stream_raw(struct fb_mmc_stream *fs, const u8 *data,
+			     u32 len)
+{
+	u32 blksz = fs->info.blksz;
+	u32 n_blks = fs->buf_size / blksz;
+	u32 n;
+	int ret;
+
+	while (len) {
+		/* Write whole buffers directly, unless there is data waiting */
+		if (!fs->pending && len >= fs->buf_size) {
+			n = len - len % blksz;
+			ret = fb_mmc_stream_write_blks(fs, data, n / blksz);
+		} else {
+			n = min(len, fs->buf_size - fs->pending);
+			memcpy(fs->buf + fs->pending, data, n);
+			fs->pending += n;
+			ret = 0;
+			if (fs->pending == fs->buf_size) {
+				fs->pending = 0;
+				ret = fb_mmc_stream_write_blks(fs, fs->buf,
+							       n_blks);
+			}
+		}
+		if (ret)
+			return ret;
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* Decide the type of image from the data in the buffer and start writing */
+static int fb_mmc_stream_begin(struct fb_mmc_stream *fs)
+{
+	const char *part_name = (const char *)fs->info.name;
+	lbaint_t blkcnt;
+	int ret;
+
+	fs->started = true;
+	if (fs->pending >= sizeof(sparse_header_t) &&
+	    is_sparse_image(fs->buf)) {
+		printf("Flashing sparse image at offset " LBAFU "\n",
+		       fs->sparse.start);
+		ret = sparse_stream_init(&fs->strm, &fs->sparse, part_name,
+					 fs->response);
+		if (ret)
+			return ret;
+		fs->is_sparse = true;
+		ret = sparse_stream_write(&fs->strm, fs->buf, fs->pending);
+		fs->pending = 0;
+
+		return ret;
+	}
+
+	blkcnt = lldiv(fs->download_bytes + fs->info.blksz - 1,
+		       fs->info.blksz);
+	if (blkcnt > fs->info.size) {
+		pr_err("too large for partition: '%s'\n", part_name);
+		fastboot_fail("too large for partition", fs->response);
+		return -ENOSPC;
+	}
+	puts("Flashing Raw Image\n");
+
+	return 0;
+}
+
+void fastboot_mmc_stream_abort(void)
+{
+	struct fb_mmc_stream *fs = &fb_stream;
+
+	if (fs->is_sparse)
+		sparse_stream_finish(&fs->strm);
+	free(fs->buf);
+	memset(fs, '\0', sizeof(*fs));
+}
+
+int fastboot_mmc_stream_start(const char *cmd, u32 download_bytes,
+			      char *response)
+{
+	struct fb_mmc_stream *fs = &fb_stream;
+
+	fastboot_mmc_stream_abort();
+	fs->dev_desc = blk_get_dev("mmc", CONFIG_FASTBOOT_FLASH_MMC_DEV);
+	if (!fs->dev_desc || fs->dev_desc->type == DEV_TYPE_UNKNOWN) {
+		pr_err("invalid mmc device\n");
+		fastboot_fail("invalid mmc device", response);
+		return -ENODEV;
+	}
+	if (part_get_info_by_name_or_alias(fs->dev_desc, cmd, &fs->info) < 0) {
+		pr_err("cannot find partition: '%s'\n", cmd);
+		fastboot_fail("cannot find partition", response);
+		return -ENOENT;
+	}
+
+	fs->buf_size = CONFIG_FASTBOOT_STREAM_BUF_SIZE / fs->info.blksz *
+		fs->info.blksz;
+	if (!fs->buf_size)
+		fs->buf_size = fs->info.blksz;
+	fs->buf = memalign(ARCH_DMA_MINALIGN, fs->buf_size);
+	if (!fs->buf) {
+		fastboot_fail("out of memory", response);
+		return -ENOMEM;
+	}
+	fs->download_bytes = download_bytes;
+	fs->blk = fs->info.start;
+	fb_mmc_sparse_setup(&fs->sparse, &fs->sparse_priv, fs->dev_desc,
+			    &fs->info);
+
+	return 0;
+}
+
+int fastboot_mmc_stream_write(const void *data, u32 len)
+{
+	struct fb_mmc_stream *fs = &fb_stream;
+	u32 n;
+	int ret;
+
+	if (fs->err)
+		return fs->err;
+
+	/* Collect enough of the image to see if it is a sparse image */
+	if (!fs->started) {
+		n = min(len, (u32)sizeof(sparse_header_t) - fs->pending);
+		memcpy(fs->buf + fs->pending, data, n);
+		fs->pending += n;
+		data += n;
+		len -= n;
+		if (fs->pending < sizeof(sparse_header_t))
+			return 0;
+		ret = fb_mmc_stream_begin(fs);
+		if (ret)
+			goto err;
+	}
+
+	if (fs->is_sparse)
+		ret = sparse_stream_write(&fs->strm, data, len);
+	else
+		ret = fb_mmc_stream_raw(fs, data, len);
+	if (ret)
+		goto err;
+
+	return 0;
+err:
+	fs->err = ret;
+
+	return ret;
+}
+
+void fastboot_mmc_stream_finish(char *response)
+{
+	struct fb_mmc_stream *fs = &fb_stream;
+	u32 blksz = fs->info.blksz;
+	int ret = fs->err;
+
+	if (!ret && !fs->started)
+		ret = fb_mmc_stream_begin(fs);
+
+	if (fs->is_sparse) {
+		int err = sparse_stream_finish(&fs->strm);
+
+		if (!ret)
+			ret = err;
+		fs->is_sparse = false;
+	} else if (!ret) {
+		/* Write the last partial block, padded with zeroes */
+		if (fs->pending % blksz) {
+			memset(fs->buf + fs->pending, '\0',
+			       blksz - fs->pending % blksz);
+			fs->pending += blksz - fs->pending % blksz;
+		}
+		if (fs->pending)
+			ret = fb_mmc_stream_write_blks(fs, fs->buf,
+						       fs->pending / blksz);
+		if (!ret)
+			printf("........ wrote %u bytes to '%s'\n",
+			       fs->download_bytes, fs->info.name);
+	}
+	free(fs->buf);
+	fs->buf = NULL;
+
+	if (ret)
+		strlcpy(response, fs->response, FASTBOOT_RESPONSE_LEN);
+	else
+		fastboot_okay(NULL, response);
+}
+#endif
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
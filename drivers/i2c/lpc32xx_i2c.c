@@ -14,6 +14,7 @@
 #include <asm/arch/i2c.h>
 #include <dm.h>
 #include <mapmem.h>
+#include <dm/uclass-internal.h>
 
 /*
  * Provide default speed and slave if target did not
@@ -281,7 +282,8 @@ U_BOOT_I2C_ADAP_COMPLETE(lpc32xx_2, lpc32xx_i2c_init, NULL,
 static int lpc32xx_i2c_probe(struct udevice *bus)
 {
 	struct lpc32xx_i2c_dev *dev = dev_get_platdata(bus);
-	bus->seq = dev->index;
+
+	uclass_set_device_seq(bus, dev->index);
 
 	__i2c_init(dev->base, dev->speed, 0, dev->index);
 	return 0;
@@ -10,6 +10,7 @@
 #include <memalign.h>
 #include <pci.h>
 #include <dm/device-internal.h>
+#include <linux/log2.h>
 #include "nvme.h"
 
 #define NVME_Q_DEPTH		2
@@ -47,22 +48,22 @@ struct nvme_queue {
 	unsigned long cmdid_data[];
 };
 
-static int nvme_wait_ready(struct nvme_dev *dev, bool enabled)
+/*
+ * Check whether the controller has become ready (or not ready) since it was
+ * last enabled (or disabled), returning -EINPROGRESS while it may still do so
+ */
+static int nvme_check_ready(struct nvme_dev *dev, bool enabled)
 {
 	u32 bit = enabled ? NVME_CSTS_RDY : 0;
-	int timeout;
-	ulong start;
 
-	/* Timeout field in the CAP register is in 500 millisecond units */
-	timeout = NVME_CAP_TIMEOUT(dev->cap) * 500;
+	if ((readl(&dev->bar->csts) & NVME_CSTS_RDY) == bit)
+		return 0;
 
-	start = get_timer(0);
-	while (get_timer(start) < timeout) {
-		if ((readl(&dev->bar->csts) & NVME_CSTS_RDY) == bit)
-			return 0;
-	}
+	/* Timeout field in the CAP register is in 500 millisecond units */
+	if (get_timer(dev->ready_start) >= NVME_CAP_TIMEOUT(dev->cap) * 500)
+		return -ETIME;
 
-	return -ETIME;
+	return -EINPROGRESS;
 }
 
 static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
@@ -275,22 +276,20 @@ static int nvme_delete_cq(struct nvme_dev *dev, u16 cqid)
 	return nvme_delete_queue(dev, nvme_admin_delete_cq, cqid);
 }
 
-static int nvme_enable_ctrl(struct nvme_dev *dev)
+static void nvme_enable_ctrl(struct nvme_dev *dev)
 {
 	dev->ctrl_config &= ~NVME_CC_SHN_MASK;
 	dev->ctrl_config |= NVME_CC_ENABLE;
 	writel(cpu_to_le32(dev->ctrl_config), &dev->bar->cc);
-
-	return nvme_wait_ready(dev, true);
+	dev->ready_start = get_timer(0);
 }
 
-static int nvme_disable_ctrl(struct nvme_dev *dev)
+static void nvme_disable_ctrl(struct nvme_dev *dev)
 {
 	dev->ctrl_config &= ~NVME_CC_SHN_MASK;
 	dev->ctrl_config &= ~NVME_CC_ENABLE;
 	writel(cpu_to_le32(dev->ctrl_config), &dev->bar->cc);
-
-	return nvme_wait_ready(dev, false);
+	dev->ready_start = get_timer(0);
 }
 
 static void nvme_free_queue(struct nvme_queue *nvmeq)
@@ -326,12 +325,13 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 	dev->online_queues++;
 }
 
-static int nvme_configure_admin_queue(struct nvme_dev *dev)
+/*
+ * Start configuring the admin queue: the controller is disabled and
+ * nvme_configure_admin_queue() must be called once it is no longer ready
+ */
+static int nvme_start_admin_queue(struct nvme_dev *dev)
 {
-	int result;
-	u32 aqa;
 	u64 cap = dev->cap;
-	struct nvme_queue *nvmeq;
 	/* most architectures use 4KB as the page size */
 	unsigned page_shift = 12;
 	unsigned dev_page_min = NVME_CAP_MPSMIN(cap) + 12;
@@ -348,10 +348,22 @@ static int nvme_configure_admin_queue(struct nvme_dev *dev)
 		      1 << dev_page_max, 1 << page_shift);
 		page_shift = dev_page_max;
 	}
+	dev->page_size = 1 << page_shift;
 
-	result = nvme_disable_ctrl(dev);
-	if (result < 0)
-		return result;
+	nvme_disable_ctrl(dev);
+
+	return 0;
+}
+
+/*
+ * Set up the admin queue and enable the controller, which is ready to be
+ * used once nvme_check_ready() says so
+ */
+static int nvme_configure_admin_queue(struct nvme_dev *dev)
+{
+	unsigned int page_shift = ilog2(dev->page_size);
+	struct nvme_queue *nvmeq;
+	u32 aqa;
 
 	nvmeq = dev->queues[NVME_ADMIN_Q];
 	if (!nvmeq) {
@@ -364,8 +376,6 @@ static int nvme_configure_admin_queue(struct nvme_dev *dev)
 	aqa |= aqa << 16;
 	aqa |= aqa << 16;
 
-	dev->page_size = 1 << page_shift;
-
 	dev->ctrl_config = NVME_CC_CSS_NVM;
 	dev->ctrl_config |= (page_shift - 12) << NVME_CC_MPS_SHIFT;
 	dev->ctrl_config |= NVME_CC_ARB_RR | NVME_CC_SHN_NONE;
@@ -375,20 +385,9 @@ static int nvme_configure_admin_queue(struct nvme_dev *dev)
 	nvme_writeq((ulong)nvmeq->sq_cmds, &dev->bar->asq);
 	nvme_writeq((ulong)nvmeq->cqes, &dev->bar->acq);
 
-	result = nvme_enable_ctrl(dev);
-	if (result)
-		goto free_nvmeq;
-
-	nvmeq->cq_vector = 0;
+	nvme_enable_ctrl(dev);
 
-	nvme_init_queue(dev->queues[NVME_ADMIN_Q], 0);
-
-	return result;
-
- free_nvmeq:
-	nvme_free_queues(dev, 0);
-
-	return result;
+	return 0;
 }
 
 static int nvme_alloc_cq(struct nvme_dev *dev, u16 qid,
@@ -615,21 +614,8 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 
 int nvme_scan_namespace(void)
 {
-	struct uclass *uc;
-	struct udevice *dev;
-	int ret;
-
-	ret = uclass_get(UCLASS_NVME, &uc);
-	if (ret)
-		return ret;
-
-	uclass_foreach_dev(dev, uc) {
-		ret = device_probe(dev);
-		if (ret)
-			return ret;
-	}
-
-	return 0;
+	/* Wait for all the controllers to become ready at the same time */
+	return uclass_probe_all(UCLASS_NVME);
 }
 
 static int nvme_blk_probe(struct udevice *udev)
@@ -764,7 +750,8 @@ static int nvme_bind(struct udevice *udev)
 	return device_set_name(udev, name);
 }
 
-static int nvme_probe(struct udevice *udev)
+/* Set up the controller and start resetting it */
+static int nvme_probe_start(struct udevice *udev)
 {
 	int ret;
 	struct nvme_dev *ndev = dev_get_priv(udev);
@@ -801,16 +788,10 @@ static int nvme_probe(struct udevice *udev)
 	ndev->db_stride = 1 << NVME_CAP_STRIDE(ndev->cap);
 	ndev->dbs = ((void __iomem *)ndev->bar) + 4096;
 
-	ret = nvme_configure_admin_queue(ndev);
-	if (ret)
-		goto free_queue;
-
-	ret = nvme_setup_io_queues(ndev);
+	ret = nvme_start_admin_queue(ndev);
 	if (ret)
 		goto free_queue;
 
-	nvme_get_info_from_identify(ndev);
-
 	return 0;
 
 free_queue:
@@ -819,12 +800,65 @@ free_nvme:
 	return ret;
 }
 
+/*
+ * The controller can take several seconds to reset and become ready, so
+ * the probe is asynchronous: it returns -EINPROGRESS while waiting, to be
+ * called again later. This allows controllers to reset at the same time.
+ */
+static int nvme_probe(struct udevice *udev)
+{
+	struct nvme_dev *ndev = dev_get_priv(udev);
+	int ret;
+
+	switch (ndev->probe_state) {
+	case NVME_PROBE_START:
+		ret = nvme_probe_start(udev);
+		if (ret)
+			return ret;
+		ndev->probe_state = NVME_PROBE_DISABLE;
+		/* fall through */
+	case NVME_PROBE_DISABLE:
+		ret = nvme_check_ready(ndev, false);
+		if (ret)
+			break;
+		ret = nvme_configure_admin_queue(ndev);
+		if (ret)
+			break;
+		ndev->probe_state = NVME_PROBE_ENABLE;
+		/* fall through */
+	case NVME_PROBE_ENABLE:
+		ret = nvme_check_ready(ndev, true);
+		if (ret == -EINPROGRESS)
+			return ret;
+		if (ret) {
+			nvme_free_queues(ndev, 0);
+			break;
+		}
+		ndev->queues[NVME_ADMIN_Q]->cq_vector = 0;
+		nvme_init_queue(ndev->queues[NVME_ADMIN_Q], 0);
+
+		ret = nvme_setup_io_queues(ndev);
+		if (ret)
+			break;
+
+		nvme_get_info_from_identify(ndev);
+
+		return 0;
+	}
+	if (ret == -EINPROGRESS)
+		return ret;
+	free((void *)ndev->queues);
+
+	return ret;
+}
+
 U_BOOT_DRIVER(nvme) = {
 	.name	= "nvme",
 	.id	= UCLASS_NVME,
 	.bind	= nvme_bind,
 	.probe	= nvme_probe,
 	.priv_auto_alloc_size = sizeof(struct nvme_dev),
+	.flags	= DM_FLAG_PROBE_ASYNC,
 };
 
 struct pci_device_id nvme_supported[] = {
@@ -603,6 +603,13 @@ enum {
 };
 
 /* Represents an NVM Express device. Each nvme_dev is a PCI function. */
+/* Steps of probing a controller, see nvme_probe() */
+enum nvme_probe_state {
+	NVME_PROBE_START,
+	NVME_PROBE_DISABLE,
+	NVME_PROBE_ENABLE,
+};
+
 struct nvme_dev {
 	struct list_head node;
 	struct nvme_queue **queues;
@@ -627,6 +634,8 @@ struct nvme_dev {
 	u64 *prp_pool;
 	u32 prp_entry_num;
 	u32 nn;
+	enum nvme_probe_state probe_state;
+	ulong ready_start;
 };
 
 /*
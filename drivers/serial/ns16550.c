@@ -322,6 +322,30 @@ static int ns16550_serial_putc(struct udevice *dev, const char ch)
 	return 0;
 }
 
+/* Characters which the TX FIFO can take once it is empty */
+#define NS16550_TX_FIFO_SIZE	16
+
+static int ns16550_serial_puts(struct udevice *dev, const char *s, size_t len)
+{
+	struct NS16550 *const com_port = dev_get_priv(dev);
+	size_t i, room = 1;
+
+	if (!(serial_in(&com_port->lsr) & UART_LSR_THRE))
+		return -EAGAIN;
+
+	/* With the FIFO enabled, THRE means that the whole FIFO is empty */
+	if (ns16550_getfcr(com_port) & UART_FCR_FIFO_EN)
+		room = NS16550_TX_FIFO_SIZE;
+	len = min(len, room);
+	for (i = 0; i < len; i++) {
+		serial_out(s[i], &com_port->thr);
+		if (s[i] == '\n')
+			WATCHDOG_RESET();
+	}
+
+	return len;
+}
+
 static int ns16550_serial_pending(struct udevice *dev, bool input)
 {
 	struct NS16550 *const com_port = dev_get_priv(dev);
@@ -511,6 +535,7 @@ int ns16550_serial_ofdata_to_platdata(struct udevice *dev)
 
 const struct dm_serial_ops ns16550_serial_ops = {
 	.putc = ns16550_serial_putc,
+	.puts = ns16550_serial_puts,
 	.pending = ns16550_serial_pending,
 	.getc = ns16550_serial_getc,
 	.setbrg = ns16550_serial_setbrg,
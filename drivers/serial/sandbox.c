@@ -105,6 +105,29 @@ static int sandbox_serial_putc(struct udevice *dev, const char ch)
 	return 0;
 }
 
+static int sandbox_serial_puts(struct udevice *dev, const char *s, size_t len)
+{
+	struct sandbox_serial_priv *priv = dev_get_priv(dev);
+	struct sandbox_serial_platdata *plat = dev->platdata;
+	const char *nl;
+
+	/* Stop after a newline so that the colour is set for the next line */
+	if (plat->colour != -1) {
+		nl = memchr(s, '\n', len);
+		if (nl)
+			len = nl + 1 - s;
+		if (priv->start_of_line) {
+			priv->start_of_line = false;
+			output_ansi_colour(plat->colour);
+		}
+		if (nl)
+			priv->start_of_line = true;
+	}
+	os_write(1, s, len);
+
+	return len;
+}
+
 static unsigned int increment_buffer_index(unsigned int index)
 {
 	return (index + 1) % ARRAY_SIZE(serial_buf);
@@ -237,6 +260,7 @@ static int sandbox_serial_ofdata_to_platdata(struct udevice *dev)
 
 static const struct dm_serial_ops sandbox_serial_ops = {
 	.putc = sandbox_serial_putc,
+	.puts = sandbox_serial_puts,
 	.pending = sandbox_serial_pending,
 	.getc = sandbox_serial_getc,
 	.getconfig = sandbox_serial_getconfig,
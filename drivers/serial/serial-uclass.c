@@ -170,23 +170,136 @@ void serial_initialize(void)
 	serial_init();
 }
 
-static void _serial_putc(struct udevice *dev, char ch)
+static void __serial_putc(struct udevice *dev, char ch)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 	int err;
 
-	if (ch == '\n')
-		_serial_putc(dev, '\r');
-
 	do {
 		err = ops->putc(dev, ch);
 	} while (err == -EAGAIN);
 }
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/* Output is kept in the buffer, not sent, while the console is silent */
+static bool serial_tx_held(void)
+{
+	return IS_ENABLED(CONFIG_SERIAL_TX_BUFFER_SILENT) &&
+		(gd->flags & GD_FLG_SILENT);
+}
+
+/* Send the TX buffer, stopping when the UART is full unless @wait is true */
+static void serial_tx_drain(struct udevice *dev, bool wait)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int len, ret;
+
+	/* Output written by the driver while sending goes out directly */
+	if (!upriv->tx_buf || upriv->tx_busy || serial_tx_held())
+		return;
+
+	upriv->tx_busy = true;
+	while (upriv->tx_rd != upriv->tx_wr) {
+		if (upriv->tx_wr > upriv->tx_rd)
+			len = upriv->tx_wr - upriv->tx_rd;
+		else
+			len = CONFIG_SERIAL_TX_BUFFER_SIZE - upriv->tx_rd;
+
+		if (ops->puts) {
+			ret = ops->puts(dev, upriv->tx_buf + upriv->tx_rd, len);
+		} else {
+			ret = ops->putc(dev, upriv->tx_buf[upriv->tx_rd]);
+			if (!ret)
+				ret = 1;
+		}
+		if (ret == -EAGAIN) {
+			if (!wait)
+				break;
+			WATCHDOG_RESET();
+			continue;
+		}
+		/* As with putc(), characters which cannot be sent are lost */
+		if (ret < 0 || ret > len)
+			ret = len;
+
+		upriv->tx_rd += ret;
+		upriv->tx_rd %= CONFIG_SERIAL_TX_BUFFER_SIZE;
+	}
+	upriv->tx_busy = false;
+}
+
+/* Add a character to the TX buffer, returning false to send it directly */
+static bool serial_tx_put(struct udevice *dev, char ch)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	int next;
+
+	/* If it cannot be buffered, it is lost while silent */
+	if (!upriv->tx_buf || upriv->tx_busy)
+		return serial_tx_held();
+
+	next = (upriv->tx_wr + 1) % CONFIG_SERIAL_TX_BUFFER_SIZE;
+	if (next == upriv->tx_rd) {
+		if (serial_tx_held()) {
+			/* Make room by losing the oldest character */
+			upriv->tx_rd++;
+			upriv->tx_rd %= CONFIG_SERIAL_TX_BUFFER_SIZE;
+		} else {
+			serial_tx_drain(dev, true);
+		}
+	}
+	upriv->tx_buf[upriv->tx_wr] = ch;
+	upriv->tx_wr = next;
+
+	return true;
+}
+
+void serial_tx_poll(void)
+{
+	if (gd->cur_serial_dev)
+		serial_tx_drain(gd->cur_serial_dev, false);
+}
+
+void serial_flush(void)
+{
+	if (gd->cur_serial_dev)
+		serial_tx_drain(gd->cur_serial_dev, true);
+}
+
+#else /* CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) */
+
+static void serial_tx_drain(struct udevice *dev, bool wait)
+{
+}
+
+static bool serial_tx_put(struct udevice *dev, char ch)
+{
+	return false;
+}
+#endif /* CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) */
+
+/* Queue a character, or send it if there is no TX buffer */
+static void serial_emit(struct udevice *dev, char ch)
+{
+	if (ch == '\n')
+		serial_emit(dev, '\r');
+
+	if (!serial_tx_put(dev, ch))
+		__serial_putc(dev, ch);
+}
+
+static void _serial_putc(struct udevice *dev, char ch)
+{
+	serial_emit(dev, ch);
+	serial_tx_drain(dev, false);
+}
+
 static void _serial_puts(struct udevice *dev, const char *str)
 {
 	while (*str)
-		_serial_putc(dev, *str++);
+		serial_emit(dev, *str++);
+	serial_tx_drain(dev, false);
 }
 
 static int __serial_getc(struct udevice *dev)
@@ -196,8 +309,10 @@ static int __serial_getc(struct udevice *dev)
 
 	do {
 		err = ops->getc(dev);
-		if (err == -EAGAIN)
+		if (err == -EAGAIN) {
 			WATCHDOG_RESET();
+			serial_tx_drain(dev, false);
+		}
 	} while (err == -EAGAIN);
 
 	return err >= 0 ? err : 0;
@@ -207,6 +322,8 @@ static int __serial_tstc(struct udevice *dev)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	/* The main loop polls for input, so send any output meanwhile */
+	serial_tx_drain(dev, false);
 	if (ops->pending)
 		return ops->pending(dev, true);
 
@@ -439,6 +556,8 @@ static int serial_post_probe(struct udevice *dev)
 		ops->getc += gd->reloc_off;
 	if (ops->putc)
 		ops->putc += gd->reloc_off;
+	if (ops->puts)
+		ops->puts += gd->reloc_off;
 	if (ops->pending)
 		ops->pending += gd->reloc_off;
 	if (ops->clear)
@@ -478,6 +597,10 @@ static int serial_post_probe(struct udevice *dev)
 	/* Allocate the RX buffer */
 	upriv->buf = malloc(CONFIG_SERIAL_RX_BUFFER_SIZE);
 #endif
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	/* Allocate the TX buffer */
+	upriv->tx_buf = malloc(CONFIG_SERIAL_TX_BUFFER_SIZE);
+#endif
 
 	stdio_register_dev(&sdev, &upriv->sdev);
 #endif
@@ -486,12 +609,17 @@ static int serial_post_probe(struct udevice *dev)
 
 static int serial_pre_remove(struct udevice *dev)
 {
-#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
-	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct serial_dev_priv *upriv __maybe_unused = dev_get_uclass_priv(dev);
 
+#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	if (stdio_deregister_dev(upriv->sdev, true))
 		return -EPERM;
 #endif
+	serial_tx_drain(dev, true);
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	free(upriv->tx_buf);
+	upriv->tx_buf = NULL;
+#endif
 
 	return 0;
 }
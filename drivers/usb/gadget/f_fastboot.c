@@ -41,6 +41,14 @@ struct f_fastboot {
 	/* IN/OUT EP's and corresponding requests */
 	struct usb_ep *in_ep, *out_ep;
 	struct usb_request *in_req, *out_req;
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	/* Ring of OUT requests for streamed downloads */
+	struct usb_request *stream_req[CONFIG_FASTBOOT_STREAM_BUFS];
+	/* Number of bytes of the download queued in each stream request */
+	unsigned int stream_len[CONFIG_FASTBOOT_STREAM_BUFS];
+	/* Number of bytes of the download covered by queued stream requests */
+	unsigned int stream_queued;
+#endif
 };
 
 static inline struct f_fastboot *func_to_fastboot(struct usb_function *f)
@@ -196,6 +204,65 @@ static void fastboot_unbind(struct usb_configuration *c, struct usb_function *f)
 	memset(fastboot_func, 0, sizeof(*fastboot_func));
 }
 
+static struct usb_request *fastboot_alloc_req(struct usb_ep *ep,
+					      unsigned int size)
+{
+	struct usb_request *req;
+
+	req = usb_ep_alloc_request(ep, 0);
+	if (!req)
+		return NULL;
+
+	req->length = size;
+	req->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, size);
+	if (!req->buf) {
+		usb_ep_free_request(ep, req);
+		return NULL;
+	}
+
+	memset(req->buf, 0, req->length);
+	return req;
+}
+
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/*
+ * Allocate the ring of requests for a streamed download, returning the number
+ * allocated. Without these, streamed downloads use out_req as other
+ * downloads do, so this does not fail if memory is short.
+ */
+static int fastboot_stream_alloc(struct f_fastboot *f_fb)
+{
+	struct usb_request *req;
+	int i;
+
+	for (i = 0; i < CONFIG_FASTBOOT_STREAM_BUFS; i++) {
+		req = fastboot_alloc_req(f_fb->out_ep,
+					 CONFIG_FASTBOOT_STREAM_BUF_SIZE);
+		if (!req)
+			break;
+		req->context = &f_fb->stream_len[i];
+		f_fb->stream_req[i] = req;
+	}
+
+	return i;
+}
+
+static void fastboot_stream_free(struct f_fastboot *f_fb)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_FASTBOOT_STREAM_BUFS; i++) {
+		if (f_fb->stream_req[i]) {
+			free(f_fb->stream_req[i]->buf);
+			usb_ep_free_request(f_fb->out_ep, f_fb->stream_req[i]);
+			f_fb->stream_req[i] = NULL;
+		}
+	}
+}
+#else
+static inline void fastboot_stream_free(struct f_fastboot *f_fb) {}
+#endif
+
 static void fastboot_disable(struct usb_function *f)
 {
 	struct f_fastboot *f_fb = func_to_fastboot(f);
@@ -213,25 +280,13 @@ static void fastboot_disable(struct usb_function *f)
 		usb_ep_free_request(f_fb->in_ep, f_fb->in_req);
 		f_fb->in_req = NULL;
 	}
+	fastboot_stream_free(f_fb);
+	fastboot_data_abort();
 }
 
 static struct usb_request *fastboot_start_ep(struct usb_ep *ep)
 {
-	struct usb_request *req;
-
-	req = usb_ep_alloc_request(ep, 0);
-	if (!req)
-		return NULL;
-
-	req->length = EP_BUFFER_SIZE;
-	req->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, EP_BUFFER_SIZE);
-	if (!req->buf) {
-		usb_ep_free_request(ep, req);
-		return NULL;
-	}
-
-	memset(req->buf, 0, req->length);
-	return req;
+	return fastboot_alloc_req(ep, EP_BUFFER_SIZE);
 }
 
 static int fastboot_set_alt(struct usb_function *f,
@@ -260,6 +315,7 @@ static int fastboot_set_alt(struct usb_function *f,
 		goto err;
 	}
 	f_fb->out_req->complete = rx_handler_command;
+	fastboot_data_abort();
 
 	d = fb_ep_desc(gadget, &fs_ep_in, &hs_ep_in);
 	ret = usb_ep_enable(f_fb->in_ep, d);
@@ -416,6 +472,104 @@ static void do_bootm_on_complete(struct usb_ep *ep, struct usb_request *req)
 	do_exit_on_complete(ep, req);
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+static void rx_handler_stream(struct usb_ep *ep, struct usb_request *req);
+
+/* Queue a stream request for the next part of the download, if any */
+static void fastboot_stream_queue(struct usb_ep *ep, struct usb_request *req)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+	unsigned int left = fastboot_data_remaining() - f_fb->stream_queued;
+	unsigned int *queued = req->context;
+	unsigned int maxpacket = ep->maxpacket;
+	unsigned int len;
+
+	if (!left)
+		return;
+	len = min(left, (unsigned int)CONFIG_FASTBOOT_STREAM_BUF_SIZE);
+	f_fb->stream_queued += len;
+	*queued = len;
+
+	/* Request whole packets, as rx_bytes_expected() does */
+	req->length = roundup(len, maxpacket);
+	req->actual = 0;
+	req->complete = rx_handler_stream;
+	usb_ep_queue(ep, req, 0);
+}
+
+/*
+ * Each stream request is written to flash when it completes, while the
+ * controller receives the rest of the download into the other requests
+ */
+static void rx_handler_stream(struct usb_ep *ep, struct usb_request *req)
+{
+	char response[FASTBOOT_RESPONSE_LEN] = {0};
+	unsigned int transfer_size = fastboot_data_remaining();
+	struct f_fastboot *f_fb = fastboot_func;
+	struct usb_request *out_req = f_fb->out_req;
+	unsigned int *queued = req->context;
+	int i;
+
+	if (req->status != 0) {
+		printf("Bad status: %d\n", req->status);
+		return;
+	}
+
+	/* After a short packet, the rest of this part is queued again */
+	f_fb->stream_queued -= *queued;
+	if (req->actual < transfer_size)
+		transfer_size = req->actual;
+
+	fastboot_data_download(req->buf, transfer_size, response);
+	if (response[0]) {
+		/* Stop receiving the download */
+		for (i = 0; i < CONFIG_FASTBOOT_STREAM_BUFS; i++) {
+			if (f_fb->stream_req[i] && f_fb->stream_req[i] != req)
+				usb_ep_dequeue(ep, f_fb->stream_req[i]);
+		}
+		fastboot_data_abort();
+		fastboot_tx_write_str(response);
+	} else if (!fastboot_data_remaining()) {
+		fastboot_data_complete(response);
+		fastboot_tx_write_str(response);
+	} else {
+		fastboot_stream_queue(ep, req);
+		return;
+	}
+
+	/* Go back to receiving commands */
+	fastboot_stream_free(f_fb);
+	out_req->length = EP_BUFFER_SIZE;
+	out_req->actual = 0;
+	usb_ep_queue(ep, out_req, 0);
+}
+
+/* Start receiving a streamed download into the ring of requests */
+static bool fastboot_stream_start(struct usb_ep *ep)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+	int count, i;
+
+	if (!fastboot_data_streaming())
+		return false;
+	fastboot_stream_free(f_fb);
+	count = fastboot_stream_alloc(f_fb);
+	if (!count)
+		return false;
+
+	f_fb->stream_queued = 0;
+	for (i = 0; i < count; i++)
+		fastboot_stream_queue(ep, f_fb->stream_req[i]);
+
+	return true;
+}
+#else
+static inline bool fastboot_stream_start(struct usb_ep *ep)
+{
+	return false;
+}
+#endif
+
 static void rx_handler_command(struct usb_ep *ep, struct usb_request *req)
 {
 	char *cmdbuf = req->buf;
@@ -434,6 +588,12 @@ static void rx_handler_command(struct usb_ep *ep, struct usb_request *req)
 	}
 
 	if (!strncmp("DATA", response, 4)) {
+		/* out_req is queued again when the download is complete */
+		if (fastboot_stream_start(ep)) {
+			fastboot_tx_write_str(response);
+			*cmdbuf = '\0';
+			return;
+		}
 		req->complete = rx_handler_dl_image;
 		req->length = rx_bytes_expected(ep);
 	}
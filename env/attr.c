@@ -11,6 +11,10 @@
 #else
 #include <common.h>
 #include <slre.h>
+#include <linux/ctype.h>
+#include <linux/xxhash.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 #endif
 
 #include <env_attr.h>
@@ -307,3 +311,240 @@ int env_attr_lookup(const char *attr_list, const char *name, char *attributes)
 	return -ENOENT;
 }
 #endif
+
+#ifndef USE_HOSTCC
+/**
+ * struct env_attr_regex - a regular expression in an attribute list index
+ *
+ * @slre: Compiled expression
+ * @attributes: Attributes for matching variables
+ * @seq: Position of the entry in the list
+ */
+struct env_attr_regex {
+#if defined(CONFIG_REGEX)
+	struct slre slre;
+#endif
+	const char *attributes;
+	int seq;
+};
+
+struct env_attr_build {
+	struct env_attr_index *idx;
+	char *pos;
+	int count;
+};
+
+static unsigned int env_attr_hash(const char *name)
+{
+	return xxh32(name, strlen(name), 0);
+}
+
+static int count_callback(const char *name, const char *attributes,
+			  void *priv)
+{
+	int *count = priv;
+
+	(*count)++;
+
+	return 0;
+}
+
+/*
+ * Copy a name into the index buffer. With CONFIG_REGEX, return -EINVAL if it
+ * is a regular expression rather than a plain name. Escaped characters such
+ * as "\." are taken literally, so ".callbacks" and ".flags" still count as
+ * plain names.
+ */
+static int copy_name(const char *name, char *out)
+{
+	for (; *name; name++) {
+#if defined(CONFIG_REGEX)
+		if (*name == '\\' && ispunct(name[1]))
+			name++;
+		else if (strchr("^$.[]|()?*+\\", *name))
+			return -EINVAL;
+#endif
+		*out++ = *name;
+	}
+	*out = '\0';
+
+	return 0;
+}
+
+static int index_callback(const char *name, const char *attributes,
+			  void *priv)
+{
+	struct env_attr_build *build = priv;
+	struct env_attr_index *idx = build->idx;
+	struct env_attr_entry *entry;
+	unsigned int slot;
+	char *copy = build->pos;
+	int seq = build->count++;
+
+	if (!attributes)
+		attributes = "";
+
+	if (copy_name(name, copy)) {
+#if defined(CONFIG_REGEX)
+		struct env_attr_regex *re = &idx->regex[idx->regex_count];
+		char regex[strlen(name) + 3];
+
+		/* Require the whole string to be described by the regex */
+		sprintf(regex, "^%s$", name);
+		if (!slre_compile(&re->slre, regex)) {
+			printf("Error compiling regex: %s\n", re->slre.err_str);
+			return -EINVAL;
+		}
+		re->attributes = strcpy(copy, attributes);
+		re->seq = seq;
+		idx->regex_count++;
+		build->pos += strlen(attributes) + 1;
+#endif
+		return 0;
+	}
+	build->pos += strlen(copy) + 1;
+
+	/* A later entry for the same name replaces an earlier one */
+	slot = env_attr_hash(copy) & idx->exact_mask;
+	for (entry = &idx->exact[slot]; entry->name;
+	     slot = (slot + 1) & idx->exact_mask, entry = &idx->exact[slot]) {
+		if (!strcmp(entry->name, copy))
+			break;
+	}
+	entry->name = copy;
+	entry->attributes = strcpy(build->pos, attributes);
+	entry->seq = seq;
+	build->pos += strlen(attributes) + 1;
+
+	return 0;
+}
+
+void env_attr_index_free(struct env_attr_index *idx)
+{
+	free(idx->buf);
+	free(idx->exact);
+	free(idx->regex);
+	memset(idx, '\0', sizeof(*idx));
+}
+
+int env_attr_index_build(struct env_attr_index *idx, const char *attr_list)
+{
+	struct env_attr_build build;
+	unsigned int size;
+	int count = 0;
+	int ret;
+
+	env_attr_index_free(idx);
+	idx->list = attr_list;
+	if (!attr_list) {
+		idx->valid = true;
+		return 0;
+	}
+
+	ret = env_attr_walk(attr_list, count_callback, &count);
+	if (ret)
+		return ret;
+
+	/* Keep the hash table no more than half full */
+	for (size = 8; size < count * 2; size <<= 1)
+		;
+	idx->exact = calloc(size, sizeof(*idx->exact));
+	idx->exact_mask = size - 1;
+	/* Each entry needs at most two more bytes than it takes in the list */
+	idx->buf = malloc(strlen(attr_list) + count * 2 + 1);
+	if (IS_ENABLED(CONFIG_REGEX) && count)
+		idx->regex = malloc(count * sizeof(*idx->regex));
+	if (!idx->exact || !idx->buf ||
+	    (IS_ENABLED(CONFIG_REGEX) && count && !idx->regex)) {
+		env_attr_index_free(idx);
+		return -ENOMEM;
+	}
+
+	build.idx = idx;
+	build.pos = idx->buf;
+	build.count = 0;
+	ret = env_attr_walk(attr_list, index_callback, &build);
+	if (ret) {
+		env_attr_index_free(idx);
+		return ret;
+	}
+	idx->list = attr_list;
+	idx->valid = true;
+
+	return 0;
+}
+
+int env_attr_index_lookup(const struct env_attr_index *idx, const char *name,
+			  char *attributes)
+{
+	const struct env_attr_entry *found = NULL;
+#if defined(CONFIG_REGEX)
+	int i;
+#endif
+
+	if (!attributes)
+		/* bad parameter */
+		return -EINVAL;
+	if (!idx->list)
+		/* list not found */
+		return -EINVAL;
+
+	if (idx->exact) {
+		unsigned int slot = env_attr_hash(name) & idx->exact_mask;
+		const struct env_attr_entry *entry;
+
+		for (entry = &idx->exact[slot]; entry->name;
+		     slot = (slot + 1) & idx->exact_mask,
+		     entry = &idx->exact[slot]) {
+			if (!strcmp(entry->name, name)) {
+				found = entry;
+				break;
+			}
+		}
+	}
+
+#if defined(CONFIG_REGEX)
+	/* The last matching entry wins, so only try those after found */
+	for (i = idx->regex_count - 1;
+	     i >= 0 && (!found || idx->regex[i].seq > found->seq); i--) {
+		const struct env_attr_regex *re = &idx->regex[i];
+		struct cap caps[re->slre.num_caps + 2];
+
+		if (slre_match(&re->slre, name, strlen(name), caps)) {
+			strcpy(attributes, re->attributes);
+			return 0;
+		}
+	}
+#endif
+
+	if (!found)
+		return -ENOENT; /* not found in list */
+	strcpy(attributes, found->attributes);
+
+	return 0;
+}
+
+int env_attr_lookup_indexed(struct env_attr_index *idx, const char *attr_list,
+			    const char *name, char *attributes)
+{
+	if (!idx->valid || idx->list != attr_list) {
+		if (env_attr_index_build(idx, attr_list))
+			return env_attr_lookup(attr_list, name, attributes);
+	}
+
+	return env_attr_index_lookup(idx, name, attributes);
+}
+
+int env_attr_lookup_var(struct env_attr_index *idx, const char *var,
+			const char *name, char *attributes)
+{
+	const char *attr_list;
+
+	if (idx->valid && !(gd->flags & GD_FLG_ENV_READY))
+		attr_list = idx->list;
+	else
+		attr_list = env_get(var);
+
+	return env_attr_lookup_indexed(idx, attr_list, name, attributes);
+}
+#endif
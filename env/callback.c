@@ -34,8 +34,9 @@ static struct env_clbk_tbl *find_env_callback(const char *name)
 	return NULL;
 }
 
-static int first_call = 1;
-static const char *callback_list;
+/* Indexes for the ".callbacks" variable and the static list */
+static struct env_attr_index callback_index;
+static struct env_attr_index callback_index_static;
 
 /*
  * Look for a possible callback for a newly added variable
@@ -47,21 +48,17 @@ void env_callback_init(ENTRY *var_entry)
 	const char *var_name = var_entry->key;
 	char callback_name[256] = "";
 	struct env_clbk_tbl *clbkp;
-	int ret = 1;
-
-	if (first_call) {
-		callback_list = env_get(ENV_CALLBACK_VAR);
-		first_call = 0;
-	}
+	int ret;
 
 	/* look in the ".callbacks" var for a reference to this variable */
-	if (callback_list != NULL)
-		ret = env_attr_lookup(callback_list, var_name, callback_name);
+	ret = env_attr_lookup_var(&callback_index, ENV_CALLBACK_VAR, var_name,
+				  callback_name);
 
 	/* only if not found there, look in the static list */
 	if (ret)
-		ret = env_attr_lookup(ENV_CALLBACK_LIST_STATIC, var_name,
-			callback_name);
+		ret = env_attr_lookup_indexed(&callback_index_static,
+					      ENV_CALLBACK_LIST_STATIC,
+					      var_name, callback_name);
 
 	/* if an association was found, set the callback pointer */
 	if (!ret && strlen(callback_name)) {
@@ -122,6 +119,9 @@ static int set_callback(const char *name, const char *value, void *priv)
 static int on_callbacks(const char *name, const char *value, enum env_op op,
 	int flags)
 {
+	/* the list has changed, so its index must be rebuilt */
+	env_attr_index_invalidate(&callback_index);
+
 	/* remove all callbacks */
 	hwalk_r(&env_htab, clear_callback);
 
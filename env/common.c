@@ -110,6 +110,7 @@ int set_default_vars(int nvars, char * const vars[], int flags)
 int env_import(const char *buf, int check)
 {
 	env_t *ep = (env_t *)buf;
+	int ret;
 
 	if (check) {
 		uint32_t crc;
@@ -122,8 +123,11 @@ int env_import(const char *buf, int check)
 		}
 	}
 
-	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', 0, 0,
-			0, NULL)) {
+	bootstage_start(BOOTSTAGE_ID_ACCUM_ENV_IMPORT, "env_import");
+	ret = himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', 0, 0,
+			0, NULL);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_ENV_IMPORT);
+	if (ret) {
 		gd->flags |= GD_FLG_ENV_READY;
 		return 0;
 	}
@@ -410,8 +410,9 @@ static int env_parse_flags_to_bin(const char *flags)
 	return binflags;
 }
 
-static int first_call = 1;
-static const char *flags_list;
+/* Indexes for the ".flags" variable and the static list */
+static struct env_attr_index flags_index;
+static struct env_attr_index flags_index_static;
 
 /*
  * Look for possible flags for a newly added variable
@@ -422,14 +423,14 @@ void env_flags_init(ENTRY *var_entry)
 {
 	const char *var_name = var_entry->key;
 	char flags[ENV_FLAGS_ATTR_MAX_LEN + 1] = "";
-	int ret = 1;
+	int ret;
 
-	if (first_call) {
-		flags_list = env_get(ENV_FLAGS_VAR);
-		first_call = 0;
-	}
 	/* look in the ".flags" and static for a reference to this variable */
-	ret = env_flags_lookup(flags_list, var_name, flags);
+	ret = env_attr_lookup_var(&flags_index, ENV_FLAGS_VAR, var_name, flags);
+	if (ret)
+		ret = env_attr_lookup_indexed(&flags_index_static,
+					      ENV_FLAGS_LIST_STATIC, var_name,
+					      flags);
 
 	/* if any flags were found, set the binary form to the entry */
 	if (!ret && strlen(flags))
@@ -475,6 +476,9 @@ static int set_flags(const char *name, const char *value, void *priv)
 static int on_flags(const char *name, const char *value, enum env_op op,
 	int flags)
 {
+	/* the list has changed, so its index must be rebuilt */
+	env_attr_index_invalidate(&flags_index);
+
 	/* remove all flags */
 	hwalk_r(&env_htab, clear_flags);
 
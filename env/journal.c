@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Journal of environment changes
+ *
+ * See include/env_journal.h for a description of the journal format.
+ */
+
+#include <common.h>
+#include <env_journal.h>
+#include <errno.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <search.h>
+#include <u-boot/crc.h>
+
+#if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_SAVEENV)
+#define JOURNAL_SAVE
+#endif
+
+#define REC_HDR_SIZE	sizeof(struct env_journal_rec)
+
+static u32 journal_hdr_crc(const struct env_journal_hdr *hdr)
+{
+	return crc32(0, (const u8 *)hdr, offsetof(struct env_journal_hdr, crc));
+}
+
+static u32 journal_rec_crc(struct env_journal *jnl,
+			   const struct env_journal_rec *rec)
+{
+	return crc32(jnl->seed, (const u8 *)&rec->len,
+		     REC_HDR_SIZE - sizeof(rec->crc) + le16_to_cpu(rec->len));
+}
+
+static ulong journal_rec_size(uint len)
+{
+	return ALIGN(REC_HDR_SIZE + len, 4);
+}
+
+static int journal_alloc(struct env_journal *jnl)
+{
+	if (!jnl->buf) {
+		jnl->buf = memalign(ARCH_DMA_MINALIGN, jnl->size);
+		if (!jnl->buf)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/*
+ * Find the end of the valid records. On media which needs erasing, check
+ * that only erased space follows, since otherwise new records cannot be
+ * written there.
+ */
+static void journal_scan(struct env_journal *jnl)
+{
+	ulong pos = sizeof(struct env_journal_hdr);
+	ulong i;
+
+	while (pos + REC_HDR_SIZE <= jnl->size) {
+		struct env_journal_rec *rec = (void *)(jnl->buf + pos);
+		const char *data = (const char *)(rec + 1);
+		uint len = le16_to_cpu(rec->len);
+
+		if (!len || pos + journal_rec_size(len) > jnl->size)
+			break;
+		if (rec->type != ENV_JOURNAL_SET &&
+		    rec->type != ENV_JOURNAL_DELETE)
+			break;
+		if (rec->reserved || data[len - 1])
+			break;
+		if (le32_to_cpu(rec->crc) != journal_rec_crc(jnl, rec))
+			break;
+		pos += journal_rec_size(len);
+	}
+	jnl->end = pos;
+
+	if (jnl->erase) {
+		for (i = pos; i < jnl->size; i++) {
+			if (jnl->buf[i] != 0xff) {
+				debug("Env journal damaged at %lx\n", i);
+				jnl->full = true;
+				break;
+			}
+		}
+	}
+}
+
+static void journal_replay(struct env_journal *jnl, struct hsearch_data *htab)
+{
+	ulong pos = sizeof(struct env_journal_hdr);
+
+	while (pos < jnl->end) {
+		struct env_journal_rec *rec = (void *)(jnl->buf + pos);
+		char *data = (char *)(rec + 1);
+		ENTRY e, *ep;
+		char *value;
+
+		if (rec->type == ENV_JOURNAL_SET) {
+			value = strchr(data, '=');
+			if (value) {
+				/* the buffer mirrors the media */
+				*value = '\0';
+				e.key = data;
+				e.data = value + 1;
+				if (!hsearch_r(e, ENTER, &ep, htab, H_FORCE))
+					printf("Cannot replay \"%s\"\n", data);
+				*value = '=';
+			}
+		} else {
+			hdelete_r(data, htab, H_FORCE);
+		}
+		pos += journal_rec_size(le16_to_cpu(rec->len));
+	}
+}
+
+#ifdef JOURNAL_SAVE
+/* Record the environment as it is now, to compare against when saving */
+static int journal_save_state(struct env_journal *jnl,
+			      struct hsearch_data *htab)
+{
+	char *res = NULL;
+	ssize_t len;
+
+	len = hexport_r(htab, '\0', 0, &res, 0, 0, NULL);
+	if (len < 0)
+		return -ENOMEM;
+	free(jnl->saved);
+	jnl->saved = res;
+	jnl->saved_len = len;
+
+	return 0;
+}
+#else
+static int journal_save_state(struct env_journal *jnl,
+			      struct hsearch_data *htab)
+{
+	return 0;
+}
+#endif
+
+int env_journal_load(struct env_journal *jnl, struct hsearch_data *htab,
+		     u32 base_crc)
+{
+	struct env_journal_hdr *hdr;
+	int ret;
+
+	jnl->attached = false;
+	jnl->full = false;
+	jnl->gen = 0;
+	ret = journal_alloc(jnl);
+	if (ret)
+		return ret;
+	ret = jnl->read(jnl, 0, jnl->size, jnl->buf);
+	if (ret)
+		return ret;
+
+	hdr = (struct env_journal_hdr *)jnl->buf;
+	if (le32_to_cpu(hdr->magic) != ENV_JOURNAL_MAGIC ||
+	    le32_to_cpu(hdr->crc) != journal_hdr_crc(hdr))
+		return 0;
+	jnl->gen = le32_to_cpu(hdr->gen);
+
+	/* A journal left over from before the last full save is stale */
+	if (le32_to_cpu(hdr->base_crc) != base_crc)
+		return 0;
+
+	jnl->seed = le32_to_cpu(hdr->crc);
+	journal_scan(jnl);
+	journal_replay(jnl, htab);
+
+	ret = journal_save_state(jnl, htab);
+	if (ret)
+		return ret;
+	jnl->attached = true;
+
+	return 0;
+}
+
+#ifdef JOURNAL_SAVE
+/* Compare the names of two "name=value" strings */
+static int journal_cmp_names(const char *a, const char *b)
+{
+	for (; *a != '=' && *a == *b; a++, b++)
+		;
+
+	return (*a == '=' ? 0 : (u8)*a) - (*b == '=' ? 0 : (u8)*b);
+}
+
+/* Add a record at *posp, holding len bytes of data plus a NUL */
+static int journal_add(struct env_journal *jnl, ulong *posp,
+		       enum env_journal_type type, const char *data, uint len)
+{
+	struct env_journal_rec *rec;
+	char *out;
+	ulong size = journal_rec_size(len + 1);
+
+	if (len + 1 > U16_MAX || *posp + size > jnl->size)
+		return -ENOSPC;
+
+	rec = (void *)(jnl->buf + *posp);
+	out = (char *)(rec + 1);
+	rec->len = cpu_to_le16(len + 1);
+	rec->type = type;
+	rec->reserved = 0;
+	memcpy(out, data, len);
+	memset(out + len, '\0', size - REC_HDR_SIZE - len);
+	rec->crc = cpu_to_le32(journal_rec_crc(jnl, rec));
+	*posp += size;
+
+	return 0;
+}
+
+int env_journal_append(struct env_journal *jnl, struct hsearch_data *htab)
+{
+	const char *old, *new;
+	ulong pos, start, end;
+	char *res = NULL;
+	int count = 0;
+	ssize_t len;
+	int ret = 0;
+
+	if (!jnl->buf || !jnl->attached || jnl->full)
+		return -ENOSPC;
+
+	len = hexport_r(htab, '\0', 0, &res, 0, 0, NULL);
+	if (len < 0)
+		return -ENOMEM;
+
+	/*
+	 * Both lists are sorted by name, so walk them together to find the
+	 * variables which have been added, changed or deleted.
+	 */
+	pos = jnl->end;
+	old = jnl->saved;
+	new = res;
+	while (!ret && (*old || *new)) {
+		int cmp;
+
+		if (!*old)
+			cmp = 1;
+		else if (!*new)
+			cmp = -1;
+		else
+			cmp = journal_cmp_names(old, new);
+
+		if (cmp < 0) {
+			ret = journal_add(jnl, &pos, ENV_JOURNAL_DELETE, old,
+					  strchrnul(old, '=') - old);
+			count++;
+		} else if (cmp > 0 || strcmp(old, new)) {
+			ret = journal_add(jnl, &pos, ENV_JOURNAL_SET, new,
+					  strlen(new));
+			count++;
+		}
+		if (cmp <= 0)
+			old += strlen(old) + 1;
+		if (cmp >= 0)
+			new += strlen(new) + 1;
+	}
+	if (ret)
+		goto err;
+
+	if (count) {
+		printf("Writing %d change%s to journal...", count,
+		       count == 1 ? "" : "s");
+		start = ALIGN_DOWN(jnl->end, jnl->write_size);
+		end = ALIGN(pos, jnl->write_size);
+		ret = jnl->write(jnl, start, end - start, jnl->buf + start);
+		if (ret) {
+			puts("failed\n");
+			/* the journal may be damaged now */
+			jnl->full = true;
+			goto err;
+		}
+		puts("done\n");
+		jnl->end = pos;
+	}
+
+	free(jnl->saved);
+	jnl->saved = res;
+	jnl->saved_len = len;
+
+	return 0;
+
+err:
+	/* put back the erased space that the new records were built in */
+	if (jnl->erase)
+		memset(jnl->buf + jnl->end, 0xff, pos - jnl->end);
+	free(res);
+
+	return ret == -ENOSPC ? ret : -EIO;
+}
+
+int env_journal_reset(struct env_journal *jnl, struct hsearch_data *htab,
+		      u32 base_crc)
+{
+	struct env_journal_hdr *hdr;
+	int ret;
+
+	jnl->attached = false;
+	ret = journal_alloc(jnl);
+	if (ret)
+		return ret;
+
+	if (jnl->erase) {
+		ret = jnl->erase(jnl);
+		if (ret)
+			return ret;
+		memset(jnl->buf, 0xff, jnl->size);
+	} else {
+		/* a zero length ends the records */
+		memset(jnl->buf, '\0', jnl->size);
+	}
+
+	hdr = (struct env_journal_hdr *)jnl->buf;
+	hdr->magic = cpu_to_le32(ENV_JOURNAL_MAGIC);
+	hdr->gen = cpu_to_le32(++jnl->gen);
+	hdr->base_crc = cpu_to_le32(base_crc);
+	hdr->crc = cpu_to_le32(journal_hdr_crc(hdr));
+	jnl->seed = le32_to_cpu(hdr->crc);
+	jnl->end = sizeof(*hdr);
+	jnl->full = false;
+
+	ret = jnl->write(jnl, 0, ALIGN(sizeof(*hdr), jnl->write_size),
+			 jnl->buf);
+	if (ret)
+		return ret;
+
+	ret = journal_save_state(jnl, htab);
+	if (ret)
+		return ret;
+	jnl->attached = true;
+
+	return 0;
+}
+#endif /* JOURNAL_SAVE */
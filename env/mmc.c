@@ -9,6 +9,7 @@
 
 #include <command.h>
 #include <environment.h>
+#include <env_journal.h>
 #include <fdtdec.h>
 #include <linux/stddef.h>
 #include <malloc.h>
@@ -181,6 +182,53 @@ static void fini_mmc_for_env(struct mmc *mmc)
 #endif
 }
 
+#ifdef CONFIG_ENV_JOURNAL
+static int env_mmc_journal_read(struct env_journal *jnl, ulong offset,
+				ulong size, void *buf)
+{
+	struct mmc *mmc = jnl->priv;
+	struct blk_desc *desc = mmc_get_blk_desc(mmc);
+	lbaint_t blk_start, blk_cnt;
+
+	blk_start = (CONFIG_ENV_JOURNAL_OFFSET + offset) / mmc->read_bl_len;
+	blk_cnt = size / mmc->read_bl_len;
+
+	return blk_dread(desc, blk_start, blk_cnt, buf) == blk_cnt ? 0 : -EIO;
+}
+
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+static int env_mmc_journal_write(struct env_journal *jnl, ulong offset,
+				 ulong size, const void *buf)
+{
+	struct mmc *mmc = jnl->priv;
+	struct blk_desc *desc = mmc_get_blk_desc(mmc);
+	lbaint_t blk_start, blk_cnt;
+
+	blk_start = (CONFIG_ENV_JOURNAL_OFFSET + offset) / mmc->write_bl_len;
+	blk_cnt = size / mmc->write_bl_len;
+
+	return blk_dwrite(desc, blk_start, blk_cnt, buf) == blk_cnt ? 0 : -EIO;
+}
+#endif
+
+/* Blocks can be rewritten in place, so there is no erase function */
+static struct env_journal env_mmc_journal = {
+	.read		= env_mmc_journal_read,
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+	.write		= env_mmc_journal_write,
+#endif
+	.size		= CONFIG_ENV_JOURNAL_SIZE,
+};
+
+static struct env_journal *env_mmc_journal_get(struct mmc *mmc)
+{
+	env_mmc_journal.priv = mmc;
+	env_mmc_journal.write_size = mmc->write_bl_len;
+
+	return &env_mmc_journal;
+}
+#endif
+
 #if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
 static inline int write_env(struct mmc *mmc, unsigned long size,
 			    unsigned long offset, const void *buffer)
@@ -211,6 +259,13 @@ static int env_mmc_save(void)
 		return 1;
 	}
 
+#ifdef CONFIG_ENV_JOURNAL
+	if (!env_journal_append(env_mmc_journal_get(mmc), &env_htab)) {
+		ret = 0;
+		goto fini;
+	}
+#endif
+
 	ret = env_export(env_new);
 	if (ret)
 		goto fini;
@@ -238,6 +293,12 @@ static int env_mmc_save(void)
 	gd->env_valid = gd->env_valid == ENV_REDUND ? ENV_VALID : ENV_REDUND;
 #endif
 
+#ifdef CONFIG_ENV_JOURNAL
+	if (env_journal_reset(env_mmc_journal_get(mmc), &env_htab,
+			      env_new->crc))
+		puts("Cannot start a new journal\n");
+#endif
+
 fini:
 	fini_mmc_for_env(mmc);
 	return ret;
@@ -293,6 +354,12 @@ static int env_mmc_load(void)
 
 	ret = env_import_redund((char *)tmp_env1, read1_fail, (char *)tmp_env2,
 				read2_fail);
+#ifdef CONFIG_ENV_JOURNAL
+	if (!ret)
+		env_journal_load(env_mmc_journal_get(mmc), &env_htab,
+				 gd->env_valid == ENV_REDUND ? tmp_env2->crc :
+				 tmp_env1->crc);
+#endif
 
 fini:
 	fini_mmc_for_env(mmc);
@@ -334,6 +401,11 @@ static int env_mmc_load(void)
 	}
 
 	ret = env_import(buf, 1);
+#ifdef CONFIG_ENV_JOURNAL
+	if (!ret)
+		env_journal_load(env_mmc_journal_get(mmc), &env_htab,
+				 ((env_t *)buf)->crc);
+#endif
 
 fini:
 	fini_mmc_for_env(mmc);
@@ -11,6 +11,7 @@
 #include <common.h>
 #include <dm.h>
 #include <environment.h>
+#include <env_journal.h>
 #include <malloc.h>
 #include <spi.h>
 #include <spi_flash.h>
@@ -68,6 +69,40 @@ static int setup_flash_device(void)
 	return 0;
 }
 
+#ifdef CONFIG_ENV_JOURNAL
+static int env_sf_journal_read(struct env_journal *jnl, ulong offset,
+			       ulong size, void *buf)
+{
+	return spi_flash_read(env_flash, CONFIG_ENV_JOURNAL_OFFSET + offset,
+			      size, buf);
+}
+
+#ifdef CMD_SAVEENV
+static int env_sf_journal_write(struct env_journal *jnl, ulong offset,
+				ulong size, const void *buf)
+{
+	return spi_flash_write(env_flash, CONFIG_ENV_JOURNAL_OFFSET + offset,
+			       size, buf);
+}
+
+static int env_sf_journal_erase(struct env_journal *jnl)
+{
+	return spi_flash_erase(env_flash, CONFIG_ENV_JOURNAL_OFFSET,
+			       CONFIG_ENV_JOURNAL_SIZE);
+}
+#endif
+
+static struct env_journal env_sf_journal = {
+	.read		= env_sf_journal_read,
+#ifdef CMD_SAVEENV
+	.write		= env_sf_journal_write,
+	.erase		= env_sf_journal_erase,
+#endif
+	.size		= CONFIG_ENV_JOURNAL_SIZE,
+	.write_size	= 1,
+};
+#endif
+
 #if defined(CONFIG_ENV_OFFSET_REDUND)
 #ifdef CMD_SAVEENV
 static int env_sf_save(void)
@@ -81,6 +116,11 @@ static int env_sf_save(void)
 	if (ret)
 		return ret;
 
+#ifdef CONFIG_ENV_JOURNAL
+	if (!env_journal_append(&env_sf_journal, &env_htab))
+		return 0;
+#endif
+
 	ret = env_export(&env_new);
 	if (ret)
 		return -EIO;
@@ -142,6 +182,11 @@ static int env_sf_save(void)
 
 	printf("Valid environment: %d\n", (int)gd->env_valid);
 
+#ifdef CONFIG_ENV_JOURNAL
+	if (env_journal_reset(&env_sf_journal, &env_htab, env_new.crc))
+		puts("Cannot start a new journal\n");
+#endif
+
  done:
 	if (saved_buffer)
 		free(saved_buffer);
@@ -177,6 +222,12 @@ static int env_sf_load(void)
 
 	ret = env_import_redund((char *)tmp_env1, read1_fail, (char *)tmp_env2,
 				read2_fail);
+#ifdef CONFIG_ENV_JOURNAL
+	if (!ret)
+		env_journal_load(&env_sf_journal, &env_htab,
+				 gd->env_valid == ENV_REDUND ? tmp_env2->crc :
+				 tmp_env1->crc);
+#endif
 
 	spi_flash_free(env_flash);
 	env_flash = NULL;
@@ -199,6 +250,11 @@ static int env_sf_save(void)
 	if (ret)
 		return ret;
 
+#ifdef CONFIG_ENV_JOURNAL
+	if (!env_journal_append(&env_sf_journal, &env_htab))
+		return 0;
+#endif
+
 	/* Is the sector larger than the env (i.e. embedded) */
 	if (CONFIG_ENV_SECT_SIZE > CONFIG_ENV_SIZE) {
 		saved_size = CONFIG_ENV_SECT_SIZE - CONFIG_ENV_SIZE;
@@ -241,6 +297,11 @@ static int env_sf_save(void)
 	ret = 0;
 	puts("done\n");
 
+#ifdef CONFIG_ENV_JOURNAL
+	if (env_journal_reset(&env_sf_journal, &env_htab, env_new.crc))
+		puts("Cannot start a new journal\n");
+#endif
+
  done:
 	if (saved_buffer)
 		free(saved_buffer);
@@ -274,6 +335,11 @@ static int env_sf_load(void)
 	ret = env_import(buf, 1);
 	if (!ret)
 		gd->env_valid = ENV_VALID;
+#ifdef CONFIG_ENV_JOURNAL
+	if (!ret)
+		env_journal_load(&env_sf_journal, &env_htab,
+				 ((env_t *)buf)->crc);
+#endif
 
 err_read:
 	spi_flash_free(env_flash);
@@ -200,6 +200,7 @@ enum bootstage_id {
 	BOOTSTATE_ID_ACCUM_DM_SPL,
 	BOOTSTATE_ID_ACCUM_DM_F,
 	BOOTSTATE_ID_ACCUM_DM_R,
+	BOOTSTAGE_ID_ACCUM_ENV_IMPORT,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -228,6 +229,9 @@ void show_boot_progress(int val);
 #if !defined(USE_HOSTCC)
 #if CONFIG_IS_ENABLED(BOOTSTAGE)
 #define ENABLE_BOOTSTAGE
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+#define ENABLE_BOOTSTAGE_SPANS
+#endif
 #endif
 #endif
 
@@ -426,6 +430,66 @@ static inline int bootstage_init(bool first)
 
 #endif /* ENABLE_BOOTSTAGE */
 
+/* Formats for bootstage_export() */
+enum bootstage_export_fmt {
+	BOOTSTAGE_EXPORT_CHROME,	/* Chrome trace-event JSON */
+	BOOTSTAGE_EXPORT_FOLDED,	/* Folded stacks, for flame graphs */
+};
+
+#ifdef ENABLE_BOOTSTAGE_SPANS
+/**
+ * bootstage_span_begin() - Mark the start of a span of time
+ *
+ * Spans nest: a span begun before the previous one has ended is recorded
+ * as being inside it. This is used to record device probing, block reads
+ * and the like, so that the time can be broken down afterwards.
+ *
+ * @kind: What sort of span this is, e.g. "probe" (not copied)
+ * @name: What the span is about, e.g. a device name (copied)
+ * @return span number to pass to bootstage_span_end(), or -ve if the span
+ *	is not being recorded
+ */
+int bootstage_span_begin(const char *kind, const char *name);
+
+/**
+ * bootstage_span_end() - Mark the end of a span of time
+ *
+ * Any spans begun inside this one which are still open are ended too. A span
+ * which has already ended, including one ended along with an outer span, is
+ * left alone.
+ *
+ * @span: Span number returned by bootstage_span_begin(); -ve values are
+ *	ignored
+ */
+void bootstage_span_end(int span);
+
+/**
+ * bootstage_export() - Write out the recorded spans and marks
+ *
+ * @fmt: Format to use
+ * @buf: Buffer for the text, which is nul-terminated if there is space
+ * @size: Size of buffer in bytes (may be 0)
+ * @return length of the text, not including the terminator, even if it did
+ *	not all fit in the buffer, or -ve on error
+ */
+int bootstage_export(enum bootstage_export_fmt fmt, char *buf, int size);
+#else
+static inline int bootstage_span_begin(const char *kind, const char *name)
+{
+	return -ENOSYS;
+}
+
+static inline void bootstage_span_end(int span)
+{
+}
+
+static inline int bootstage_export(enum bootstage_export_fmt fmt, char *buf,
+				   int size)
+{
+	return -ENOSYS;
+}
+#endif
+
 /* Helper macro for adding a bootstage to a line of code */
 #define BOOTSTAGE_MARKER()	\
 		bootstage_mark_code(__FILE__, __func__, __LINE__)
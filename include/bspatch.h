@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Applying binary patches made by bsdiff
+ */
+
+#ifndef __BSPATCH_H
+#define __BSPATCH_H
+
+#include <part.h>
+
+/* Patch header: magic, control size, diff size, new size */
+#define BSPATCH_MAGIC		"BSDIFF40"
+#define BSPATCH_HDR_SIZE	32
+
+/**
+ * struct bspatch_io - Access to the old and new images
+ *
+ * @read_old:	Read @len bytes of the old image, starting at @offset. The
+ *		range is always inside the old image.
+ * @write_new:	Write the next @len bytes of the new image
+ * @priv:	Private data for the caller
+ */
+struct bspatch_io {
+	int (*read_old)(struct bspatch_io *io, u64 offset, void *buf,
+			ulong len);
+	int (*write_new)(struct bspatch_io *io, const void *buf, ulong len);
+	void *priv;
+};
+
+/**
+ * bspatch_new_size() - Check a patch header and get the new image size
+ *
+ * @patch:	Patch data
+ * @len:	Size of patch data
+ * @sizep:	Returns the size of the new image
+ * @return 0 if OK, -EINVAL if the header is not valid
+ */
+int bspatch_new_size(const void *patch, ulong len, u64 *sizep);
+
+/**
+ * bspatch() - Apply a patch
+ *
+ * The new image is produced in order, from the start, through @io. The old
+ * image is read in pieces as needed, mostly in order.
+ *
+ * @patch:	Patch data
+ * @len:	Size of patch data
+ * @old_size:	Size of the old image the patch was made against
+ * @io:	Access to the old and new images
+ * @return 0 if OK, -EINVAL if the patch is corrupt, -ENOMEM if out of
+ *	memory, or an error from @io
+ */
+int bspatch(const void *patch, ulong len, u64 old_size, struct bspatch_io *io);
+
+/**
+ * bspatch_blk() - Apply a patch from one block device area to another
+ *
+ * This reads the old image from one area and writes the new image to
+ * another, e.g. the two slots of an A/B system. The areas must not overlap.
+ * If the new image does not fill its last block, the block is padded with
+ * zeroes.
+ *
+ * @patch:	Patch data
+ * @len:	Size of patch data
+ * @old_dev:	Device holding the old image
+ * @old_part:	Area of @old_dev holding the old image
+ * @old_size:	Size of the old image in bytes, or 0 for the whole area
+ * @new_dev:	Device to write the new image to
+ * @new_part:	Area of @new_dev to write the new image to
+ * @algo:	Name of hash algorithm to check the new image with, or NULL
+ * @digest:	Expected hash of the new image, if @algo is not NULL
+ * @return 0 if OK, -EBADMSG if the hash does not match, -ENOSPC if an image
+ *	does not fit its area, -EIO on a device error, -EINTR if stopped with
+ *	Ctrl-C, other -ve on error as for bspatch()
+ */
+int bspatch_blk(const void *patch, ulong len, struct blk_desc *old_dev,
+		const disk_partition_t *old_part, u64 old_size,
+		struct blk_desc *new_dev, const disk_partition_t *new_part,
+		const char *algo, const u8 *digest);
+
+#endif
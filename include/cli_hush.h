@@ -16,6 +16,20 @@ extern int u_boot_hush_start(void);
 extern int parse_string_outer(const char *, int);
 extern int parse_file_outer(void);
 
+/**
+ * hush_cache_drop() - Forget the parsed form of a script
+ *
+ * This is called when an environment variable is about to change, so
+ * that the cached form of the script it held is not kept around.
+ *
+ * @s: Script text
+ */
+#if CONFIG_IS_ENABLED(HUSH_CACHE)
+void hush_cache_drop(const char *s);
+#else
+static inline void hush_cache_drop(const char *s) {}
+#endif
+
 int set_local_var(const char *s, int flg_export);
 void unset_local_var(const char *name);
 char *get_local_var(const char *s);
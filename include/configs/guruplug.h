@@ -14,11 +14,6 @@
  */
 #define CONFIG_SHEEVA_88SV131	1	/* CPU Core subversion */
 
-/*
- * Standard filesystems
- */
-#define CONFIG_BZIP2
-
 /*
  * mv-plug-common.h should be defined after CMD configs since it used them
  * to enable certain macros
@@ -15,11 +15,6 @@
 #define CONFIG_KW88F6281		/* SOC Name */
 #define CONFIG_SKIP_LOWLEVEL_INIT	/* disable board lowlevel_init */
 
-/*
- * Compression configuration
- */
-#define CONFIG_BZIP2
-
 /*
  * Commands configuration
  */
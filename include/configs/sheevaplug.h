@@ -18,11 +18,6 @@
  * Commands configuration
  */
 
-/*
- * Standard filesystems
- */
-#define CONFIG_BZIP2
-
 /*
  * mv-plug-common.h should be defined after CMD configs since it used them
  * to enable certain macros
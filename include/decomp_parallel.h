@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Parallel decompression of images made of independent streams
+ */
+
+#ifndef __DECOMP_PARALLEL_H
+#define __DECOMP_PARALLEL_H
+
+/**
+ * decomp_parallel() - Decompress independent streams on several CPUs
+ *
+ * This handles gzip files with several members, as produced by
+ * concatenating gzip files, zstd files with several frames which each
+ * record their uncompressed size, as produced by pzstd or by concatenating
+ * zstd files, and LZ4 frames with several independent blocks. The members,
+ * frames or blocks are shared out into chunks, which are decompressed
+ * concurrently into their final place using arch_run_parallel().
+ *
+ * If the data holds a single stream, or cannot be split up safely, this
+ * returns -ENOENT or -EBUSY before writing anything. Other errors are found
+ * while decompressing, by which time @dst may be partly written. In either
+ * case @src is left alone, so the caller can decompress it in the normal
+ * way.
+ *
+ * The chunks do not reset the watchdog, since that is not safe to do on
+ * several CPUs at once. It is reset before and after the chunks run.
+ *
+ * @comp:	Compression type (IH_COMP_GZIP, IH_COMP_ZSTD or IH_COMP_LZ4)
+ * @dst:	Buffer for the uncompressed data
+ * @dst_size:	Size of @dst
+ * @src:	Compressed data
+ * @src_size:	Size of compressed data
+ * @out_lenp:	Returns the number of bytes uncompressed
+ * @return 0 if OK, -ENOENT if the data cannot be split, -EBUSY if @src
+ *	overlaps @dst, -ENOSPC if @dst is too small, -EINVAL if the data is
+ *	corrupt, other -ve on error
+ */
+int decomp_parallel(int comp, void *dst, ulong dst_size, const void *src,
+		    ulong src_size, ulong *out_lenp);
+
+/**
+ * arch_run_parallel() - Run a function on several CPUs
+ *
+ * This calls @func once for each element of @args and returns when all
+ * calls have finished. Calls may run concurrently, so @func must not use
+ * anything which is not safe to call on several CPUs at once, including
+ * malloc(), printf() and driver model.
+ *
+ * The default implementation calls @func for each element in turn,
+ * resetting the watchdog between calls. Architectures which can run code on
+ * secondary CPUs override this and select CONFIG_ARCH_RUN_PARALLEL. At
+ * present only sandbox does so.
+ *
+ * @func:	Function to call
+ * @args:	Argument for each call
+ * @count:	Number of calls to make
+ */
+void arch_run_parallel(int (*func)(void *arg), void *const args[], int count);
+
+#endif
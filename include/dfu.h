@@ -100,6 +100,8 @@ struct dfu_entity {
 	enum dfu_device_type    dev_type;
 	enum dfu_layout         layout;
 	unsigned long           max_buf_size;
+	/* alignment of writes which do not end the buffer, 0 if unsupported */
+	unsigned long           write_align;
 
 	union {
 		struct mmc_internal_data mmc;
@@ -186,6 +188,37 @@ static inline void dfu_set_defer_flush(struct dfu_entity *dfu)
 	dfu_defer_flush = dfu;
 }
 
+#if CONFIG_IS_ENABLED(DFU_WRITE_ASYNC)
+/**
+ * dfu_set_write_async() - Enable writing to the medium in the background
+ *
+ * While enabled, a full buffer passed to dfu_write() is written by later
+ * calls to dfu_write_poll(), while the next data is received. This is only
+ * safe if the caller's data is not in the buffer returned by dfu_get_buf().
+ * Disabling discards any write in progress.
+ *
+ * @enable:	true to enable, false to disable
+ */
+void dfu_set_write_async(bool enable);
+
+/**
+ * dfu_write_poll() - Write the next slice of a full buffer
+ *
+ * This should be called repeatedly while receiving data. It does nothing if
+ * no buffer is being written. An error is returned by the next call to
+ * dfu_write() or dfu_flush().
+ */
+void dfu_write_poll(void);
+#else
+static inline void dfu_set_write_async(bool enable)
+{
+}
+
+static inline void dfu_write_poll(void)
+{
+}
+#endif
+
 /**
  * dfu_write_from_mem_addr - write data from memory to DFU managed medium
  *
@@ -94,6 +94,49 @@ int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
  */
 int device_probe(struct udevice *dev);
 
+/**
+ * device_probe_async() - Start or continue probing a device
+ *
+ * This is like device_probe() but does not wait for drivers which have the
+ * DM_FLAG_PROBE_ASYNC flag. The probe() method of such a driver may return
+ * -EINPROGRESS when it needs to wait for the hardware (e.g. a PHY link or
+ * card power-up), in which case it is called again on the next call to this
+ * function. The driver keeps track of its progress in its private data,
+ * which remains allocated in the meantime.
+ *
+ * While the probe is pending the device is marked with
+ * DM_FLAG_PROBE_PENDING and device_active() is false. Calling device_probe()
+ * on it waits until it is finished, so other devices which use it are not
+ * affected, and device_remove() also waits for it before removing it.
+ *
+ * @dev: Pointer to device to probe
+ * @return 0 if OK, -EINPROGRESS if the probe is not finished yet, other -ve
+ * on error
+ */
+int device_probe_async(struct udevice *dev);
+
+/**
+ * device_probe_list() - Probe a list of devices, overlapping their waits
+ *
+ * This probes all the devices in the list, calling device_probe_async() on
+ * each in turn until all are finished. Devices are not started until their
+ * parents are probed, but otherwise waits in one driver's probe() method
+ * overlap with the work of the others. Devices still complete (their
+ * uclass's post_probe() method is called) in the order of the list.
+ *
+ * When an asynchronous driver's probe() method is called from here and it
+ * uses another device (e.g. via a phandle) which is not ready yet, the
+ * device_probe() of that device returns -EINPROGRESS rather than waiting.
+ * The driver should return that from its probe() method, to be called again
+ * once the other device has had its turn.
+ *
+ * @devs: List of devices to probe
+ * @count: Number of devices in the list
+ * @return 0 if OK, else the first error encountered (all devices are still
+ * attempted)
+ */
+int device_probe_list(struct udevice *const devs[], int count);
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
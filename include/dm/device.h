@@ -61,6 +61,21 @@ struct driver_info;
  */
 #define DM_FLAG_OS_PREPARE		(1 << 10)
 
+/*
+ * Driver's probe() method may return -EINPROGRESS while it waits for the
+ * hardware, to be called again later. See device_probe_async()
+ */
+#define DM_FLAG_PROBE_ASYNC		(1 << 11)
+
+/* Device is being probed: its driver's probe() method is not finished */
+#define DM_FLAG_PROBE_PENDING		(1 << 12)
+
+/*
+ * Device's probe() method is finished but device_probe_list() has not yet
+ * completed its probe, so that devices complete in the order of the list
+ */
+#define DM_FLAG_PROBE_DEFERRED		(1 << 13)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
@@ -123,6 +138,8 @@ enum {
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @name_hnode: Used by uclass to index its devices by name
+ * @node_hnode: Used by uclass to index its devices by device tree node
  */
 struct udevice {
 	const struct driver *driver;
@@ -146,6 +163,10 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct hlist_node name_hnode;
+	struct hlist_node node_hnode;
+#endif
 };
 
 /* Maximum sequence number supported */
@@ -154,17 +175,40 @@ struct udevice {
 /* Returns the operations for a device */
 #define device_get_ops(dev)	(dev->driver->ops)
 
-/* Returns non-zero if the device is active (probed and not removed) */
-#define device_active(dev)	((dev)->flags & DM_FLAG_ACTIVATED)
+/*
+ * Returns non-zero if the device is active (probed and not removed). A device
+ * whose probe is still pending is not active.
+ */
+#define device_active(dev)	(((dev)->flags & (DM_FLAG_ACTIVATED | \
+					  DM_FLAG_PROBE_PENDING)) == \
+				 DM_FLAG_ACTIVATED)
 
 static inline int dev_of_offset(const struct udevice *dev)
 {
 	return ofnode_to_offset(dev->node);
 }
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/**
+ * dev_set_ofnode() - Change the device tree node of a device
+ *
+ * This updates the uclass's index of devices, so must be used instead of
+ * setting dev->node directly once the device is bound.
+ *
+ * @dev:	Device to update
+ * @node:	New device tree node
+ */
+void dev_set_ofnode(struct udevice *dev, ofnode node);
+#else
+static inline void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	dev->node = node;
+}
+#endif
+
 static inline void dev_set_of_offset(struct udevice *dev, int of_offset)
 {
-	dev->node = offset_to_ofnode(of_offset);
+	dev_set_ofnode(dev, offset_to_ofnode(of_offset));
 }
 
 static inline bool dev_has_of_node(struct udevice *dev)
@@ -262,6 +306,14 @@ struct driver {
 #define DM_GET_DRIVER(__name)						\
 	ll_entry_get(struct driver, __name, driver)
 
+/* Declare a driver defined in another file, for use with DM_REF_DRIVER() */
+#define DM_DECL_DRIVER(__name)						\
+	ll_entry_decl(struct driver, __name, driver)
+
+/* Get a pointer to a given driver, usable in static initialisers */
+#define DM_REF_DRIVER(__name)						\
+	ll_entry_ref(struct driver, __name, driver)
+
 /**
  * dev_get_platdata() - Get the platform data for a device
  *
@@ -22,6 +22,13 @@
  * @name:	Driver name
  * @platdata:	Driver-specific platform data
  * @platdata_size: Size of platform data structure
+ * @driver:	Driver to bind, or NULL to look it up by @name. This and the
+ *		following fields are normally filled in by dtoc, which works
+ *		out the device hierarchy when U-Boot is built
+ * @dev_name:	Device name (the device tree node name), or NULL to use @name
+ * @parent:	Parent device's driver_info, or NULL to bind to the root device
+ * @flags:	Flags for this device (DM_INFO_FLAG_...)
+ * @req_seq:	Requested sequence number, if DM_INFO_FLAG_REQ_SEQ is set
  */
 struct driver_info {
 	const char *name;
@@ -29,8 +36,18 @@ struct driver_info {
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
 	uint platdata_size;
 #endif
+#if CONFIG_IS_ENABLED(OF_PLATDATA_BIND)
+	const struct driver *driver;
+	const char *dev_name;
+	const struct driver_info *parent;
+	uint flags;
+	int req_seq;
+#endif
 };
 
+/* The req_seq member of struct driver_info is valid */
+#define DM_INFO_FLAG_REQ_SEQ	(1 << 0)
+
 /**
  * NOTE: Avoid using these except in extreme circumstances, where device tree
  * is not feasible (e.g. serial driver in SPL where <8KB of SRAM is
@@ -43,4 +60,8 @@ struct driver_info {
 #define U_BOOT_DEVICES(__name)						\
 	ll_entry_declare_list(struct driver_info, __name, driver_info)
 
+/* Get a pointer to a given device, usable in static initialisers */
+#define DM_REF_DEVICE(__name)						\
+	ll_entry_ref(struct driver_info, __name, driver_info)
+
 #endif
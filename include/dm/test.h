@@ -72,6 +72,22 @@ struct dm_test_priv {
 	int uclass_postp;
 };
 
+/**
+ * struct dm_test_async_priv - private data for the asynchronous test devices
+ *
+ * @calls: Number of calls to the probe() method so far
+ * @first_call: Value of dm_testdrv_async_seq at the first call to probe()
+ * @last_call: Value of dm_testdrv_async_seq at the last call to probe()
+ * @post_probes: Number of post-probe calls made in the test uclass, at the
+ *	last call to probe()
+ */
+struct dm_test_async_priv {
+	int calls;
+	int first_call;
+	int last_call;
+	int post_probes;
+};
+
 /**
  * struct dm_test_perdev_class_priv - private per-device data for test uclass
  */
@@ -124,6 +140,12 @@ struct dm_test_perdev_uc_pdata {
  */
 extern int dm_testdrv_op_count[DM_TEST_OP_COUNT];
 
+/* Incremented on each call to an asynchronous test driver's probe() method */
+extern int dm_testdrv_async_seq;
+
+/* Device used by the probe() method of the test_async_user_drv driver */
+extern struct udevice *dm_testdrv_async_supplier;
+
 extern struct unit_test_state global_dm_test_state;
 
 /*
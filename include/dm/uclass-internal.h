@@ -9,6 +9,7 @@
 #ifndef _DM_UCLASS_INTERNAL_H
 #define _DM_UCLASS_INTERNAL_H
 
+#include <dm/device.h>
 #include <dm/ofnode.h>
 
 /**
@@ -88,7 +89,8 @@ int uclass_find_next_device(struct udevice **devp);
 /**
  * uclass_find_device_by_name() - Find uclass device based on ID and name
  *
- * This searches for a device with the exactly given name.
+ * This searches for a device with the exactly given name. If there is none,
+ * the first device whose name starts with @name is returned.
  *
  * The device is NOT probed, it is merely returned.
  *
@@ -196,6 +198,48 @@ int uclass_unbind_device(struct udevice *dev);
 static inline int uclass_unbind_device(struct udevice *dev) { return 0; }
 #endif
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/**
+ * uclass_index_update() - Update the uclass index after a device is changed
+ *
+ * This must be called when the name or device tree node of a device is
+ * changed after it is bound, so that it can still be found.
+ *
+ * @dev:	Pointer to the device
+ */
+void uclass_index_update(struct udevice *dev);
+
+/**
+ * uclass_req_seq_changed() - Note that the req_seq of a device has changed
+ *
+ * This must be called when the req_seq of a device is changed after it is
+ * bound, so that uclass_find_next_free_req_seq() stays correct.
+ *
+ * @dev:	Pointer to the device, with the new req_seq
+ * @old_req_seq: Previous value of req_seq
+ */
+void uclass_req_seq_changed(struct udevice *dev, int old_req_seq);
+
+/**
+ * uclass_set_device_seq() - Set the sequence number of a device
+ *
+ * This updates dev->seq and the uclass index.
+ *
+ * @dev:	Pointer to the device
+ * @seq:	New sequence number, or -1 if none
+ */
+void uclass_set_device_seq(struct udevice *dev, int seq);
+#else
+static inline void uclass_index_update(struct udevice *dev) {}
+static inline void uclass_req_seq_changed(struct udevice *dev,
+					  int old_req_seq) {}
+
+static inline void uclass_set_device_seq(struct udevice *dev, int seq)
+{
+	dev->seq = seq;
+}
+#endif
+
 /**
  * uclass_pre_probe_device() - Deal with a device that is about to be probed
  *
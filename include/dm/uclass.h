@@ -14,6 +14,40 @@
 #include <linker_lists.h>
 #include <linux/list.h>
 
+/**
+ * struct uclass_index - an index of the devices in a uclass
+ *
+ * This is used to find devices without searching the whole uclass. It is
+ * only created once the uclass has more than a few devices, until then
+ * @hash_size is 0 and only @dev_count and the req_seq fields are used.
+ *
+ * @dev_count: Number of devices in the uclass
+ * @max_req_seq: Largest req_seq of any device in the uclass (-1 if none)
+ * @max_req_seq_stale: true if @max_req_seq must be recalculated, since the
+ *	device which had it was unbound or changed its req_seq
+ * @devs: Devices in the uclass, in the same order as the uclass's list
+ * @devs_size: Number of entries allocated in @devs
+ * @seq_devs: Device with each sequence number, or NULL if none
+ * @seq_size: Number of entries allocated in @seq_devs
+ * @name_hash: Hash table of devices by name, linked by udevice.name_hnode
+ * @node_hash: Hash table of devices by device tree node, linked by
+ *	udevice.node_hnode
+ * @hash_size: Number of buckets in each hash table (a power of two), or 0 if
+ *	there is no index
+ */
+struct uclass_index {
+	int dev_count;
+	int max_req_seq;
+	bool max_req_seq_stale;
+	struct udevice **devs;
+	int devs_size;
+	struct udevice **seq_devs;
+	int seq_size;
+	struct hlist_head *name_hash;
+	struct hlist_head *node_hash;
+	int hash_size;
+};
+
 /**
  * struct uclass - a U-Boot drive class, collecting together similar drivers
  *
@@ -30,12 +64,16 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @idx: Index of the devices in this uclass (if CONFIG_DM_UCLASS_INDEX)
  */
 struct uclass {
 	void *priv;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct uclass_index idx;
+#endif
 };
 
 struct driver;
@@ -350,6 +388,18 @@ int uclass_first_device_check(enum uclass_id id, struct udevice **devp);
  */
 int uclass_next_device_check(struct udevice **devp);
 
+/**
+ * uclass_probe_all() - Probe all the devices in a uclass
+ *
+ * The devices are probed with device_probe_list(), so drivers which wait for
+ * the hardware during probe (see DM_FLAG_PROBE_ASYNC) do so in parallel.
+ *
+ * @id: Uclass ID to probe
+ * @return 0 if OK, else the first error encountered (all devices are still
+ * attempted)
+ */
+int uclass_probe_all(enum uclass_id id);
+
 /**
  * uclass_resolve_seq() - Resolve a device's sequence number
  *
@@ -123,6 +123,31 @@ struct dma_ops {
 	 */
 	int (*transfer)(struct udevice *dev, int direction, void *dst,
 			void *src, size_t len);
+	/**
+	 * transfer_start() - Start a DMA transfer, without waiting for it.
+	 *   Only one transfer may be in progress at a time. This is
+	 *   optional; dma_copy_start() uses transfer() if it is missing.
+	 *
+	 * @dev: The DMA device
+	 * @direction: direction of data transfer (should be one from
+	 *   enum dma_direction)
+	 * @dst: The destination pointer.
+	 * @src: The source pointer.
+	 * @len: Length of the data to be copied (number of bytes).
+	 * @return zero on success, -EBUSY if a transfer is in progress, or
+	 *   other -ve error code.
+	 */
+	int (*transfer_start)(struct udevice *dev, int direction, void *dst,
+			      void *src, size_t len);
+	/**
+	 * transfer_poll() - Check the transfer started by transfer_start().
+	 *   Required if transfer_start() is provided.
+	 *
+	 * @dev: The DMA device
+	 * @return zero if done, -EBUSY if still in progress, or other -ve
+	 *   error code if the transfer failed or timed out.
+	 */
+	int (*transfer_poll)(struct udevice *dev);
 };
 
 #endif /* _DMA_UCLASS_H */
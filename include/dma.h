@@ -10,6 +10,7 @@
 #define _DMA_H_
 
 #include <linux/errno.h>
+#include <linux/string.h>
 #include <linux/types.h>
 
 /*
@@ -300,7 +301,8 @@ int dma_send(struct dma *dma, void *src, size_t len, void *metadata);
  *		    DMA_SUPPORTS_*
  * @devp - udevice pointer to return the found device
  * @return - will return on success and devp will hold the
- *	     pointer to the device
+ *	     pointer to the device, or -EPROTONOSUPPORT without a
+ *	     message if there is no such device
  */
 int dma_get_device(u32 transfer_type, struct udevice **devp);
 
@@ -316,4 +318,80 @@ int dma_get_device(u32 transfer_type, struct udevice **devp);
  */
 int dma_memcpy(void *dst, void *src, size_t len);
 
+/**
+ * struct dma_copy - A memory copy which may be done by a DMA engine
+ *
+ * @dev:	DMA device doing the copy, or NULL if the CPU has done it
+ * @dst:	Destination of the part being copied by DMA
+ * @src:	Source of the part being copied by DMA
+ * @len:	Length of the part being copied by DMA
+ */
+struct dma_copy {
+	struct udevice *dev;
+	void *dst;
+	const void *src;
+	size_t len;
+};
+
+#if CONFIG_IS_ENABLED(DMA_COPY)
+/**
+ * dma_copy_start() - Start copying memory, using DMA if worthwhile
+ *
+ * Copies of at least CONFIG_DMA_COPY_THRESHOLD bytes between separate areas
+ * are started on the first DMA device which supports memory-to-memory
+ * transfers. The CPU copies any partial cache lines at the ends of @dst
+ * itself, so that the rest can be invalidated safely. Other copies, or any
+ * which the device refuses, are done by the CPU before this returns.
+ *
+ * The CPU is free to do other work, such as checking a hash of @src, until
+ * dma_copy_wait() is called. Neither area may be written in the meantime,
+ * nor @dst read.
+ *
+ * @copy:	Returns the state of the copy
+ * @dst:	Destination
+ * @src:	Source
+ * @len:	Number of bytes to copy
+ */
+void dma_copy_start(struct dma_copy *copy, void *dst, const void *src,
+		    size_t len);
+
+/**
+ * dma_copy_wait() - Wait for a copy to finish
+ *
+ * If the DMA transfer fails, the copy is done again by the CPU, so this
+ * always succeeds.
+ *
+ * @copy:	Copy started by dma_copy_start()
+ */
+void dma_copy_wait(struct dma_copy *copy);
+
+/**
+ * dma_copy() - Copy memory, using DMA if worthwhile
+ *
+ * This is like memmove(), except that large copies between separate areas
+ * may be done by DMA. See dma_copy_start().
+ *
+ * @dst:	Destination
+ * @src:	Source
+ * @len:	Number of bytes to copy
+ */
+void dma_copy(void *dst, const void *src, size_t len);
+#else
+static inline void dma_copy_start(struct dma_copy *copy, void *dst,
+				  const void *src, size_t len)
+{
+	copy->dev = NULL;
+	memmove(dst, src, len);
+}
+
+static inline void dma_copy_wait(struct dma_copy *copy)
+{
+}
+
+static inline void dma_copy(void *dst, const void *src, size_t len)
+{
+	memmove(dst, src, len);
+}
+#endif
+
 #endif	/* _DMA_H_ */
@@ -6,7 +6,7 @@
 #ifndef __DT_STRUCTS
 #define __DT_STRUCTS
 
-/* These structures may only be used in SPL */
+/* These structures may only be used with of-platdata */
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
 struct phandle_0_arg {
 	const void *node;
@@ -22,7 +22,11 @@ struct phandle_2_arg {
 	const void *node;
 	int arg[2];
 };
+#ifdef CONFIG_SPL_BUILD
 #include <generated/dt-structs-gen.h>
+#else
+#include <generated/dt-structs-uboot-gen.h>
+#endif
 #endif
 
 #endif
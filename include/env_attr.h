@@ -35,4 +35,126 @@ int env_attr_walk(const char *attr_list,
  */
 int env_attr_lookup(const char *attr_list, const char *name, char *attributes);
 
+#ifndef USE_HOSTCC
+/**
+ * struct env_attr_entry - a name in an attribute list index
+ *
+ * @name: Variable name, or NULL if this slot is free
+ * @attributes: Attributes for the variable
+ * @seq: Position of the entry in the list; later entries take precedence
+ */
+struct env_attr_entry {
+	const char *name;
+	const char *attributes;
+	int seq;
+};
+
+struct env_attr_regex;
+
+/**
+ * struct env_attr_index - an attribute list compiled for fast lookup
+ *
+ * Looking up a name with env_attr_lookup() parses the whole list and (with
+ * CONFIG_REGEX) compiles each entry as a regular expression. An index does
+ * that once: plain names go into a hash table and only the entries which
+ * really are regular expressions have to be matched in turn.
+ *
+ * @list: List the index was built from. This is only compared against, so
+ *	it need not remain valid.
+ * @valid: true if the index has been built from @list
+ * @buf: Copies of the names and attributes
+ * @exact: Hash table of plain names, with @exact_mask + 1 slots
+ * @exact_mask: Mask to apply to the hash value to get a slot number
+ * @regex: Regular expressions, in list order
+ * @regex_count: Number of entries in @regex
+ */
+struct env_attr_index {
+	const char *list;
+	bool valid;
+	char *buf;
+	struct env_attr_entry *exact;
+	unsigned int exact_mask;
+	struct env_attr_regex *regex;
+	int regex_count;
+};
+
+/**
+ * env_attr_index_build() - Build an index for an attribute list
+ *
+ * Any previous contents of the index are freed.
+ *
+ * @idx: Index to build
+ * @attr_list: Attribute list, in the form given for env_attr_walk(), or
+ *	NULL if there is no list
+ * @return 0 if OK, -ENOMEM if out of memory, -EINVAL if a regular expression
+ *	in the list is not valid
+ */
+int env_attr_index_build(struct env_attr_index *idx, const char *attr_list);
+
+/**
+ * env_attr_index_free() - Free the contents of an index
+ *
+ * @idx: Index to free
+ */
+void env_attr_index_free(struct env_attr_index *idx);
+
+/**
+ * env_attr_index_lookup() - Look up a name in an index
+ *
+ * This gives the same result as env_attr_lookup() on the list that the
+ * index was built from.
+ *
+ * @idx: Index to search
+ * @name: Variable name to look for
+ * @attributes: Returns the attributes for @name
+ * @return 0 if found, -ENOENT if not found, -EINVAL if @attributes is NULL
+ *	or the index was built from a NULL list
+ */
+int env_attr_index_lookup(const struct env_attr_index *idx, const char *name,
+			  char *attributes);
+
+/**
+ * env_attr_index_invalidate() - Mark an index as needing to be rebuilt
+ *
+ * @idx: Index whose list has changed
+ */
+static inline void env_attr_index_invalidate(struct env_attr_index *idx)
+{
+	idx->valid = false;
+}
+
+/**
+ * env_attr_lookup_indexed() - Look up a name in a list, using an index
+ *
+ * The index is rebuilt first if it is not valid or was built from a
+ * different list. If it cannot be built, this falls back to
+ * env_attr_lookup().
+ *
+ * @idx: Index for @attr_list
+ * @attr_list: Attribute list to search, or NULL if none
+ * @name: Variable name to look for
+ * @attributes: Returns the attributes for @name
+ * @return as for env_attr_lookup()
+ */
+int env_attr_lookup_indexed(struct env_attr_index *idx, const char *attr_list,
+			    const char *name, char *attributes);
+
+/**
+ * env_attr_lookup_var() - Look up a name in the list held by an env variable
+ *
+ * This is used for the ".callbacks" and ".flags" lists. Before the
+ * environment has been imported, env_get() has to search the stored
+ * environment on every call, so the list is only read once and then the
+ * index is reused until it is invalidated.
+ *
+ * @idx: Index for the list held in @var
+ * @var: Name of the variable holding the list
+ * @name: Variable name to look for
+ * @attributes: Returns the attributes for @name
+ * @return as for env_attr_lookup()
+ */
+int env_attr_lookup_var(struct env_attr_index *idx, const char *var,
+			const char *name, char *attributes);
+#endif
+
 #endif /* __ENV_ATTR_H__ */
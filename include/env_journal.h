@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Journal of environment changes
+ */
+
+#ifndef __ENV_JOURNAL_H
+#define __ENV_JOURNAL_H
+
+#include <search.h>
+
+/**
+ * DOC: Environment journal
+ *
+ * Normally saveenv erases the environment area and writes out the whole
+ * environment again. With a journal, saveenv instead appends a record for
+ * each variable which was set or deleted since the last save to a
+ * separate journal area. When the environment is loaded the records are
+ * replayed on top of it.
+ *
+ * Once the journal is full, the next saveenv writes out the whole
+ * environment as before (to the redundant copy, if there is one) and then
+ * starts a new, empty journal. The journal header holds the CRC of the
+ * environment it applies to, so a journal left over from before a full
+ * save is ignored.
+ *
+ * The journal starts with a struct env_journal_hdr, followed by records
+ * made up of a struct env_journal_rec and the data, padded to a multiple of
+ * four bytes. The log ends at the first record which is not valid. On
+ * media which must be erased before writing (SPI flash), only erased space
+ * may follow; anything else means a write was interrupted, so the journal
+ * is not appended to again until it has been reset.
+ */
+
+#define ENV_JOURNAL_MAGIC	0x4c4a5645	/* "EVJL" */
+
+/* Record types */
+enum env_journal_type {
+	ENV_JOURNAL_SET		= 1,	/* data is "name=value" */
+	ENV_JOURNAL_DELETE	= 2,	/* data is "name" */
+};
+
+/**
+ * struct env_journal_hdr - header at the start of the journal
+ *
+ * @magic: ENV_JOURNAL_MAGIC
+ * @gen: Generation, increased each time the journal is reset
+ * @base_crc: CRC of the environment (env_t.crc) that the records apply to
+ * @crc: CRC32 of the fields above
+ */
+struct env_journal_hdr {
+	__le32 magic;
+	__le32 gen;
+	__le32 base_crc;
+	__le32 crc;
+};
+
+/**
+ * struct env_journal_rec - header of a record in the journal
+ *
+ * @crc: CRC32 of the rest of the record header and the data. The CRC of the
+ *	journal header is used as the seed, so that records left behind by an
+ *	earlier generation are not valid.
+ * @len: Length of the data, including its terminating NUL
+ * @type: Record type (enum env_journal_type)
+ * @reserved: Must be 0
+ */
+struct env_journal_rec {
+	__le32 crc;
+	__le16 len;
+	u8 type;
+	u8 reserved;
+};
+
+/**
+ * struct env_journal - a journal on a storage device
+ *
+ * The caller fills in the first part; the rest is private.
+ *
+ * @read: Read from the journal area
+ * @write: Write to the journal area. @offset and @size are multiples of
+ *	@write_size.
+ * @erase: Erase the whole journal area, or NULL if it does not need to be
+ *	erased before writing
+ * @priv: Private data for the functions above
+ * @size: Size of the journal area in bytes
+ * @write_size: Smallest unit that can be written, in bytes
+ *
+ * @buf: Copy of the journal area
+ * @end: Offset of the end of the valid records in @buf
+ * @seed: CRC seed for records, from the journal header
+ * @gen: Generation of the journal
+ * @attached: true if the records apply to the environment in use
+ * @full: true if no more records may be appended
+ * @saved: Environment as it was last saved, in the form produced by
+ *	hexport_r() with a '\0' separator
+ * @saved_len: Length of @saved in bytes
+ */
+struct env_journal {
+	int (*read)(struct env_journal *jnl, ulong offset, ulong size,
+		    void *buf);
+	int (*write)(struct env_journal *jnl, ulong offset, ulong size,
+		     const void *buf);
+	int (*erase)(struct env_journal *jnl);
+	void *priv;
+	ulong size;
+	ulong write_size;
+
+	u8 *buf;
+	ulong end;
+	u32 seed;
+	u32 gen;
+	bool attached;
+	bool full;
+	char *saved;
+	size_t saved_len;
+};
+
+/**
+ * env_journal_load() - Read the journal and replay it
+ *
+ * This is called after importing the environment from storage. If the
+ * journal applies to that environment, its records are replayed into
+ * @htab.
+ *
+ * @jnl: Journal to read
+ * @htab: Hash table holding the environment
+ * @base_crc: CRC of the environment that was imported (env_t.crc)
+ * @return 0 if OK (whether or not the journal applied), -ve on error
+ */
+int env_journal_load(struct env_journal *jnl, struct hsearch_data *htab,
+		     u32 base_crc);
+
+/**
+ * env_journal_append() - Save changes to the environment in the journal
+ *
+ * This appends a record for each variable which has been set or deleted
+ * since the environment was last loaded or saved.
+ *
+ * @jnl: Journal to update
+ * @htab: Hash table holding the environment
+ * @return 0 if OK, -ENOSPC if the whole environment must be saved instead
+ *	(because the journal is full or does not apply), other -ve on error
+ */
+int env_journal_append(struct env_journal *jnl, struct hsearch_data *htab);
+
+/**
+ * env_journal_reset() - Start a new journal after saving the environment
+ *
+ * @jnl: Journal to reset
+ * @htab: Hash table holding the environment
+ * @base_crc: CRC of the environment that was saved (env_t.crc)
+ * @return 0 if OK, -ve on error
+ */
+int env_journal_reset(struct env_journal *jnl, struct hsearch_data *htab,
+		      u32 base_crc);
+
+#endif
@@ -36,6 +36,9 @@ enum {
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 	FASTBOOT_COMMAND_OEM_FORMAT,
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	FASTBOOT_COMMAND_OEM_STREAM,
+#endif
 
 	FASTBOOT_COMMAND_COUNT
 };
@@ -128,6 +131,14 @@ int fastboot_handle_command(char *cmd_string, char *response);
  */
 u32 fastboot_data_remaining(void);
 
+/**
+ * fastboot_data_streaming() - Check if the current download is streamed
+ *
+ * Return: true if the download is written to flash as it arrives, rather
+ * than stored in the download buffer
+ */
+bool fastboot_data_streaming(void);
+
 /**
  * fastboot_data_download() - Copy image data to fastboot_buf_addr.
  *
@@ -151,4 +162,12 @@ void fastboot_data_download(const void *fastboot_data,
  */
 void fastboot_data_complete(char *response);
 
+/**
+ * fastboot_data_abort() - Abandon the current download
+ *
+ * This is called when the connection is reset, so that a download which did
+ * not complete, or an "oem stream" command, does not affect the next session.
+ */
+void fastboot_data_abort(void);
+
 #endif /* _FASTBOOT_H_ */
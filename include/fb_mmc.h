@@ -34,4 +34,45 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
  * @response: Pointer to fastboot response buffer
  */
 void fastboot_mmc_erase(const char *cmd, char *response);
+
+/**
+ * fastboot_mmc_stream_start() - Start writing an image while downloading it
+ *
+ * The image may be a raw or sparse image. Call fastboot_mmc_stream_write()
+ * with the data as it arrives, then fastboot_mmc_stream_finish().
+ *
+ * @cmd: Named partition to write image to
+ * @download_bytes: Size of image
+ * @response: Pointer to fastboot response buffer, for errors
+ * Return: 0 if OK, -ve on error
+ */
+int fastboot_mmc_stream_start(const char *cmd, u32 download_bytes,
+			      char *response);
+
+/**
+ * fastboot_mmc_stream_write() - Write the next part of a streamed image
+ *
+ * After an error the rest of the image is ignored. The error is reported by
+ * fastboot_mmc_stream_finish().
+ *
+ * @data: Next part of the image
+ * @len: Size of part
+ * Return: 0 if OK, -ve on error
+ */
+int fastboot_mmc_stream_write(const void *data, u32 len);
+
+/**
+ * fastboot_mmc_stream_finish() - Finish writing a streamed image
+ *
+ * @response: Pointer to fastboot response buffer
+ */
+void fastboot_mmc_stream_finish(char *response);
+
+/**
+ * fastboot_mmc_stream_abort() - Abandon a streamed image
+ *
+ * This frees anything left over from a streamed image which did not
+ * complete. It does nothing if there is none.
+ */
+void fastboot_mmc_stream_abort(void);
 #endif
@@ -0,0 +1,366 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Batched edits to a flat device tree
+ */
+
+#ifndef __FDT_BATCH_H
+#define __FDT_BATCH_H
+
+#include <linux/libfdt.h>
+
+/**
+ * DOC: Batched device tree fixups
+ *
+ * Each call to fdt_setprop() or fdt_add_subnode() moves the rest of the tree
+ * up to make room, so making many fixups to a large tree is slow. A batch
+ * collects the edits instead, then fdt_batch_apply() writes out a new copy
+ * of the tree with all of them in a single pass.
+ *
+ * Nodes are referred to by a handle, obtained from fdt_batch_node(),
+ * fdt_batch_path() or fdt_batch_subnode(). Until the batch is applied the
+ * tree itself is not changed, so node offsets remain valid and the tree can
+ * still be read in the normal way (without the pending edits).
+ *
+ * Example::
+ *
+ *	struct fdt_batch batch;
+ *	int node, ret;
+ *
+ *	ret = fdt_batch_init(&batch, blob);
+ *	if (ret)
+ *		return ret;
+ *	node = fdt_batch_path(&batch, "/chosen");
+ *	if (node >= 0)
+ *		fdt_batch_setprop_string(&batch, node, "bootargs", cmdline);
+ *	...
+ *	ret = fdt_batch_apply(&batch);
+ *	fdt_batch_uninit(&batch);
+ */
+
+/**
+ * struct fdt_batch_prop - a pending change to a property
+ *
+ * @name: Property name (allocated)
+ * @val: New value (allocated), or NULL if @del
+ * @len: Length of @val in bytes
+ * @next: Index of the next change to the same node, or -1 if none
+ * @del: true to delete the property
+ * @done: true once written out (used by fdt_batch_apply())
+ */
+struct fdt_batch_prop {
+	char *name;
+	void *val;
+	int len;
+	int next;
+	bool del;
+	bool done;
+};
+
+/**
+ * struct fdt_batch_node - a node which is changed or created by a batch
+ *
+ * @offset: Offset of the node in the tree, or -1 if it is a new node
+ * @name: Name of a new node (allocated), or NULL for an existing node
+ * @first_prop: Index of the first property change, or -1 if none
+ * @last_prop: Index of the last property change, or -1 if none
+ * @first_child: Handle of the first new subnode, or -1 if none
+ * @next_sibling: Handle of the next new subnode of the same parent (new
+ *	nodes only), or -1 if none
+ * @del: true to delete the node and all its subnodes
+ * @done: true once its new properties and subnodes are written out (used
+ *	by fdt_batch_apply())
+ */
+struct fdt_batch_node {
+	int offset;
+	char *name;
+	int first_prop;
+	int last_prop;
+	int first_child;
+	int next_sibling;
+	bool del;
+	bool done;
+};
+
+/**
+ * struct fdt_batch - a set of edits to make to a device tree
+ *
+ * @fdt: Device tree to edit
+ * @nodes: Nodes which are changed or created, indexed by handle
+ * @node_count: Number of entries used in @nodes
+ * @node_size: Number of entries allocated in @nodes
+ * @props: Property changes
+ * @prop_count: Number of entries used in @props
+ * @prop_size: Number of entries allocated in @props
+ * @extra: Most extra space that the edits could need in the tree
+ */
+struct fdt_batch {
+	void *fdt;
+	struct fdt_batch_node *nodes;
+	int node_count;
+	int node_size;
+	struct fdt_batch_prop *props;
+	int prop_count;
+	int prop_size;
+	int extra;
+};
+
+/**
+ * fdt_batch_init() - Start a batch of edits to a device tree
+ *
+ * @batch: Batch to set up
+ * @fdt: Device tree to edit
+ * @return 0 if OK, -FDT_ERR_... if the tree is not valid
+ */
+int fdt_batch_init(struct fdt_batch *batch, void *fdt);
+
+/**
+ * fdt_batch_uninit() - Free a batch and discard any edits not yet applied
+ *
+ * @batch: Batch to free
+ */
+void fdt_batch_uninit(struct fdt_batch *batch);
+
+/**
+ * fdt_batch_node() - Get the handle for an existing node
+ *
+ * @batch: Batch to update
+ * @nodeoffset: Offset of the node in the tree
+ * @return handle (>= 0) if OK, -FDT_ERR_NOSPACE if out of memory
+ */
+int fdt_batch_node(struct fdt_batch *batch, int nodeoffset);
+
+/**
+ * fdt_batch_path() - Get the handle for an existing node, given its path
+ *
+ * @batch: Batch to update
+ * @path: Path (or alias) of the node
+ * @return handle (>= 0) if OK, -FDT_ERR_NOTFOUND if there is no such node,
+ *	other -FDT_ERR_... on error
+ */
+int fdt_batch_path(struct fdt_batch *batch, const char *path);
+
+/**
+ * fdt_batch_find_subnode() - Get the handle for an existing subnode
+ *
+ * This finds subnodes in the tree and those added by the batch.
+ *
+ * @batch: Batch to update
+ * @parent: Handle of parent node
+ * @name: Name of subnode
+ * @return handle (>= 0) if OK, -FDT_ERR_NOTFOUND if there is no such subnode,
+ *	other -FDT_ERR_... on error
+ */
+int fdt_batch_find_subnode(struct fdt_batch *batch, int parent,
+			   const char *name);
+
+/**
+ * fdt_batch_add_subnode() - Add a new subnode
+ *
+ * The caller must make sure that the subnode does not already exist. It is
+ * placed before any existing subnodes of the parent, as fdt_add_subnode()
+ * does, so subnodes added to the same parent end up in reverse order.
+ *
+ * @batch: Batch to update
+ * @parent: Handle of parent node
+ * @name: Name of subnode
+ * @return handle (>= 0) if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_add_subnode(struct fdt_batch *batch, int parent,
+			  const char *name);
+
+/**
+ * fdt_batch_subnode() - Get the handle for a subnode, adding it if needed
+ *
+ * This is the batch version of fdt_find_or_add_subnode(). A new subnode is
+ * added with fdt_batch_add_subnode().
+ *
+ * @batch: Batch to update
+ * @parent: Handle of parent node
+ * @name: Name of subnode
+ * @return handle (>= 0) if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_subnode(struct fdt_batch *batch, int parent, const char *name);
+
+/**
+ * fdt_batch_setprop() - Set the value of a property, adding it if needed
+ *
+ * The value is copied, so need not remain valid after this call. If the
+ * property is set more than once in the same batch, the last value wins.
+ *
+ * @batch: Batch to update
+ * @node: Handle of node containing the property
+ * @name: Name of property
+ * @val: Value to write
+ * @len: Length of @val in bytes
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_setprop(struct fdt_batch *batch, int node, const char *name,
+		      const void *val, int len);
+
+static inline int fdt_batch_setprop_u32(struct fdt_batch *batch, int node,
+					const char *name, u32 val)
+{
+	fdt32_t tmp = cpu_to_fdt32(val);
+
+	return fdt_batch_setprop(batch, node, name, &tmp, sizeof(tmp));
+}
+
+static inline int fdt_batch_setprop_u64(struct fdt_batch *batch, int node,
+					const char *name, u64 val)
+{
+	fdt64_t tmp = cpu_to_fdt64(val);
+
+	return fdt_batch_setprop(batch, node, name, &tmp, sizeof(tmp));
+}
+
+static inline int fdt_batch_setprop_string(struct fdt_batch *batch, int node,
+					   const char *name, const char *str)
+{
+	return fdt_batch_setprop(batch, node, name, str, strlen(str) + 1);
+}
+
+/**
+ * fdt_batch_fixup_by_path() - Set a property in a node given by its path
+ *
+ * This is the batch version of do_fixup_by_path().
+ *
+ * @batch: Batch to update
+ * @path: Path (or alias) of the node
+ * @name: Name of property
+ * @val: Value to write
+ * @len: Length of @val in bytes
+ * @create: true to add the property if it does not exist in the tree, false
+ *	to leave the node alone in that case
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_fixup_by_path(struct fdt_batch *batch, const char *path,
+			    const char *name, const void *val, int len,
+			    bool create);
+
+/**
+ * fdt_batch_delprop() - Delete a property
+ *
+ * Nothing happens if the property does not exist.
+ *
+ * @batch: Batch to update
+ * @node: Handle of node containing the property
+ * @name: Name of property
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_delprop(struct fdt_batch *batch, int node, const char *name);
+
+/**
+ * fdt_batch_delnode() - Delete a node and all its subnodes
+ *
+ * @batch: Batch to update
+ * @node: Handle of node to delete
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_delnode(struct fdt_batch *batch, int node);
+
+/**
+ * fdt_batch_apply() - Apply the edits in a batch to the device tree
+ *
+ * This writes a new copy of the tree containing the edits, then copies it
+ * back over the original. The tree keeps its total size, so it must have
+ * enough free space for the edits (see fdt_increase_size() and
+ * @batch->extra).
+ *
+ * The batch is emptied, since its handles refer to the old tree. It can be
+ * used again for a new set of edits.
+ *
+ * @batch: Batch to apply
+ * @return 0 if OK, -FDT_ERR_NOSPACE if the tree does not have enough free
+ *	space (in which case it is unchanged), other -FDT_ERR_... on error
+ */
+int fdt_batch_apply(struct fdt_batch *batch);
+
+/**
+ * fdt_batch_apply_resize() - Apply a batch, increasing the tree size if needed
+ *
+ * This is like fdt_batch_apply() but if the tree does not have enough free
+ * space, its total size is increased with fdt_increase_size() and the batch
+ * is applied again. As with fdt_increase_size(), the caller must make sure
+ * that the buffer holding the tree is large enough.
+ *
+ * @batch: Batch to apply
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_apply_resize(struct fdt_batch *batch);
+
+/**
+ * fdt_batch_start() - Start a batch of fixups, if batches are enabled
+ *
+ * This allows a fixup function to use a batch when CONFIG_OF_FIXUP_BATCH
+ * is enabled and otherwise edit the tree directly, with the help of
+ * fdt_batch_maybe_node() and fdt_batch_maybe_setprop().
+ *
+ * @batch: Batch to set up
+ * @fdt: Device tree to edit
+ * @return @batch, or NULL to edit the tree directly
+ */
+static inline struct fdt_batch *fdt_batch_start(struct fdt_batch *batch,
+						void *fdt)
+{
+	if (!CONFIG_IS_ENABLED(OF_FIXUP_BATCH) || fdt_batch_init(batch, fdt))
+		return NULL;
+
+	return batch;
+}
+
+/**
+ * fdt_batch_finish() - Finish a batch of fixups started by fdt_batch_start()
+ *
+ * If there was no error, the batch is applied with fdt_batch_apply_resize().
+ * The batch is then freed.
+ *
+ * @batch: Batch to finish, or NULL if the tree was edited directly
+ * @err: Result of the fixups so far: 0 if OK, else -ve error
+ * @return 0 if OK, -ve on error
+ */
+static inline int fdt_batch_finish(struct fdt_batch *batch, int err)
+{
+	if (!batch)
+		return err;
+	if (!err)
+		err = fdt_batch_apply_resize(batch);
+	fdt_batch_uninit(batch);
+
+	return err;
+}
+
+/**
+ * fdt_batch_maybe_node() - Get the handle for a node, if using a batch
+ *
+ * @batch: Batch to update, or NULL if the tree is edited directly
+ * @nodeoffset: Offset of the node in the tree
+ * @return handle of the node if @batch is not NULL, else @nodeoffset
+ */
+static inline int fdt_batch_maybe_node(struct fdt_batch *batch,
+				       int nodeoffset)
+{
+	return batch ? fdt_batch_node(batch, nodeoffset) : nodeoffset;
+}
+
+/**
+ * fdt_batch_maybe_setprop() - Set a property through a batch or directly
+ *
+ * @fdt: Device tree to edit
+ * @batch: Batch to update, or NULL to edit @fdt directly
+ * @node: Handle of the node if @batch is not NULL, else its offset
+ * @name: Name of property
+ * @val: Value to write
+ * @len: Length of @val in bytes
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+static inline int fdt_batch_maybe_setprop(void *fdt, struct fdt_batch *batch,
+					  int node, const char *name,
+					  const void *val, int len)
+{
+	if (batch)
+		return fdt_batch_setprop(batch, node, name, val, len);
+
+	return fdt_setprop(fdt, node, name, val, len);
+}
+
+#endif
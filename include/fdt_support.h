@@ -288,6 +288,33 @@ int fdt_setup_simplefb_node(void *fdt, int node, u64 base_address, u32 width,
 
 int fdt_overlay_apply_verbose(void *fdt, void *fdto);
 
+/**
+ * fdt_overlay_apply_stack() - Apply a list of overlays to a device tree
+ *
+ * This has the same effect as calling fdt_overlay_apply() for each overlay in
+ * turn, so later overlays can refer to symbols added by earlier ones. But the
+ * base tree is only indexed once and is written out once, after all the
+ * overlays have been merged, so this is much faster for a long list.
+ *
+ * The tree is grown once, within @bufsize, to make room for the overlays. On
+ * error the tree's contents are unchanged, although it may have been grown.
+ *
+ * As with fdt_overlay_apply(), the overlays are changed and their magic is
+ * erased, so they cannot be used again.
+ *
+ * @fdt: Device tree to update
+ * @bufsize: Size of the buffer holding @fdt
+ * @fdtos: List of overlays to apply, in order
+ * @count: Number of overlays in @fdtos
+ * @return 0 if OK, -FDT_ERR_NOSPACE if @bufsize is too small or out of
+ *	memory, other -FDT_ERR_... on error
+ */
+int fdt_overlay_apply_stack(void *fdt, int bufsize, void *const fdtos[],
+			    int count);
+
+int fdt_overlay_apply_stack_verbose(void *fdt, int bufsize,
+				    void *const fdtos[], int count);
+
 /**
  * fdt_get_cells_len() - Get the length of a type of cell in top-level nodes
  *
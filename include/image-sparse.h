@@ -23,9 +23,65 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: erase blocks so that they read as zero. This is used
+	 * instead of writing zeroes for fill chunks, in whole multiples of
+	 * erase_grp blocks. Set to NULL if the device cannot do this.
+	 */
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+	lbaint_t	erase_grp;
+
 	void		(*mssg)(const char *str, char *response);
 };
 
+/**
+ * struct sparse_stream - State for writing a sparse image in pieces
+ *
+ * Data is written to the device through a buffer, so that small chunks are
+ * combined into large writes. This is private to image-sparse.c
+ *
+ * @info:	Storage to write to
+ * @part_name:	Name of partition, for messages
+ * @response:	Response buffer passed to info->mssg()
+ * @state:	Next thing expected in the input (enum sparse_state)
+ * @err:	Error which stopped the stream, or 0
+ * @hdr:	Sparse image header
+ * @chunk_hdr:	Header of current chunk
+ * @fill_val:	Fill value of current chunk
+ * @collect:	Number of bytes collected of a header or fill value
+ * @skip:	Number of input bytes to skip
+ * @data_left:	Number of bytes of RAW data left in the current chunk
+ * @chunk:	Number of chunks processed so far
+ * @blk:	Next block to write on the device
+ * @total_blocks: Number of sparse blocks processed so far
+ * @bytes_written: Number of bytes written to the device
+ * @buf:	Write buffer
+ * @buf_size:	Size of write buffer in bytes
+ * @pending:	Number of bytes in the write buffer
+ */
+struct sparse_stream {
+	struct sparse_storage *info;
+	const char *part_name;
+	char *response;
+	int state;
+	int err;
+	sparse_header_t hdr;
+	chunk_header_t chunk_hdr;
+	u32 fill_val;
+	uint collect;
+	u32 skip;
+	u32 data_left;
+	uint chunk;
+	lbaint_t blk;
+	u32 total_blocks;
+	u64 bytes_written;
+	u8 *buf;
+	size_t buf_size;
+	size_t pending;
+};
+
 static inline int is_sparse_image(void *buf)
 {
 	sparse_header_t *s_header = (sparse_header_t *)buf;
@@ -37,5 +93,48 @@ static inline int is_sparse_image(void *buf)
 	return 0;
 }
 
+/**
+ * sparse_stream_init() - Start writing a sparse image in pieces
+ *
+ * This allows an image to be written as it is received, without holding all
+ * of it in memory. Call sparse_stream_write() for each piece, then
+ * sparse_stream_finish(). On error, info->mssg() is called with a message
+ * for @response.
+ *
+ * @strm:	Stream state to set up
+ * @info:	Storage to write to
+ * @part_name:	Name of partition, for messages
+ * @response:	Response buffer passed to info->mssg()
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int sparse_stream_init(struct sparse_stream *strm, struct sparse_storage *info,
+		       const char *part_name, char *response);
+
+/**
+ * sparse_stream_write() - Write the next piece of a sparse image
+ *
+ * Pieces can be any size and need not be aligned to chunks. Data after the
+ * last chunk is ignored.
+ *
+ * @strm:	Stream state
+ * @data:	Next piece of the image
+ * @len:	Size of piece
+ * @return 0 if OK, -EINVAL if the image is invalid, -ENOSPC if it does not
+ *	fit in the partition, -EIO on a write error
+ */
+int sparse_stream_write(struct sparse_stream *strm, const void *data,
+			size_t len);
+
+/**
+ * sparse_stream_finish() - Finish writing a sparse image in pieces
+ *
+ * This writes any buffered data and frees the memory used by the stream. It
+ * must be called even if sparse_stream_write() fails.
+ *
+ * @strm:	Stream state
+ * @return 0 if the whole image was written, -ve on error
+ */
+int sparse_stream_finish(struct sparse_stream *strm);
+
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
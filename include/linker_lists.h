@@ -210,6 +210,38 @@
 		_ll_result;						\
 	})
 
+/**
+ * ll_entry_decl() - Declare a linker-generated array entry defined elsewhere
+ * @_type:	Data type of the entry
+ * @_name:	Name of the entry
+ * @_list:	Name of the list in which this entry is placed
+ *
+ * This declares an entry so that it can be referenced with ll_entry_ref(),
+ * for example from a static initialiser in another file. Attributes such as
+ * __weak may follow, if the entry is allowed to be absent from the image.
+ *
+ * Example:
+ *
+ * ::
+ *
+ *   ll_entry_decl(struct my_sub_cmd, my_sub_cmd, cmd_sub);
+ */
+#define ll_entry_decl(_type, _name, _list)				\
+	extern _type _u_boot_list_2_##_list##_2_##_name
+
+/**
+ * ll_entry_ref() - Get a reference to a linker-generated array entry
+ * @_type:	Data type of the entry
+ * @_name:	Name of the entry
+ * @_list:	Name of the list in which this entry is placed
+ *
+ * This is like ll_entry_get() but is a constant expression, so it can be used
+ * in static initialisers. The entry must already be declared, either with
+ * ll_entry_declare() or ll_entry_decl().
+ */
+#define ll_entry_ref(_type, _name, _list)				\
+	((_type *)&_u_boot_list_2_##_list##_2_##_name)
+
 /**
  * ll_start() - Point to first entry of first linker-generated array
  * @_type:	Data type of the entry
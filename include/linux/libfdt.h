@@ -305,6 +305,21 @@ int fdt_next_region(const void *fdt,
  */
 int fdt_add_alias_regions(const void *fdt, struct fdt_region *region, int count,
 			  int max_regions, struct fdt_region_state *info);
+
+/**
+ * fdt_overlay_prepare() - Renumber the phandles in an overlay
+ *
+ * This does the first steps of fdt_overlay_apply(): it adds @delta to the
+ * phandle of each node in the overlay and updates the local references to
+ * them (as listed in /__local_fixups__) to match. It is used by code which
+ * merges the overlay itself, such as fdt_overlay_apply_stack().
+ *
+ * @fdto:	Device tree overlay to update
+ * @delta:	Amount to add to each phandle, normally the largest phandle in
+ *		the base tree
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_overlay_prepare(void *fdto, uint32_t delta);
 #endif /* SWIG */
 
 extern struct fdt_header *working_fdt;  /* Pointer to the working fdt */
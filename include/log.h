@@ -9,6 +9,7 @@
 #ifndef __LOG_H
 #define __LOG_H
 
+#include <stdarg.h>
 #include <dm/uclass-id.h>
 #include <linux/list.h>
 
@@ -244,13 +245,20 @@ struct log_rec {
 
 struct log_device;
 
+enum log_driver_flags {
+	/* Accept records at all levels if the device has no filters */
+	LOGDF_ALL_LEVELS	= 1 << 0,
+};
+
 /**
  * struct log_driver - a driver which accepts and processes log records
  *
  * @name: Name of driver
+ * @flags: Flags for this driver (LOGDF_...)
  */
 struct log_driver {
 	const char *name;
+	int flags;
 	/**
 	 * emit() - emit a log record
 	 *
@@ -258,6 +266,15 @@ struct log_driver {
 	 * for processing. The filter is checked before calling this function.
 	 */
 	int (*emit)(struct log_device *ldev, struct log_rec *rec);
+	/**
+	 * emit_fmt() - emit a log record without a formatted message
+	 *
+	 * If provided, this is called instead of emit(). The message is given
+	 * by @fmt and @args, so that the driver can store it and format it
+	 * later, avoiding the cost of formatting it now. @rec->msg may be NULL.
+	 */
+	int (*emit_fmt)(struct log_device *ldev, struct log_rec *rec,
+			const char *fmt, va_list args);
 };
 
 /**
@@ -363,6 +380,99 @@ enum log_fmt {
 	LOGF_ALL = 0x3f,
 };
 
+#define LOG_RING_MAGIC	0x474e524c	/* "LRNG" */
+
+/**
+ * struct log_ring_hdr - header of the log ring buffer
+ *
+ * This is followed by the records, each a struct log_ring_rec followed by the
+ * arguments for its format string. The records run from @tail to @head,
+ * wrapping back to the start of the record area when they reach the end of
+ * it or a record with a size of 0.
+ *
+ * @magic: LOG_RING_MAGIC
+ * @size: Size of the record area in bytes
+ * @head: Offset in the record area where the next record will be written
+ * @tail: Offset in the record area of the oldest record
+ * @count: Number of records in the buffer
+ * @dropped: Number of records which were overwritten to make space
+ */
+struct log_ring_hdr {
+	u32 magic;
+	u32 size;
+	u32 head;
+	u32 tail;
+	u32 count;
+	u32 dropped;
+	u32 reserved[2];
+};
+
+enum log_ring_rec_flags {
+	/* The message was formatted when it was logged, and is stored as-is */
+	LOGRF_MSG	= 1 << 0,
+};
+
+/* U-Boot phase which logged a record, see struct log_ring_rec */
+enum log_ring_phase {
+	LOGRP_PROPER	= 0,
+	LOGRP_SPL,
+	LOGRP_TPL,
+};
+
+/**
+ * struct log_ring_rec - a record in the log ring buffer
+ *
+ * The message is not formatted when it is logged. Instead the arguments are
+ * stored after the record header (at an offset of LOG_RING_REC_HDR), each
+ * as a u64 except for strings, which are copied in with their terminator and
+ * padded to a multiple of 8 bytes. The format string, file and function are
+ * stored as pointers, so need the U-Boot image to decode.
+ *
+ * SPL and TPL store the formatted message (LOGRF_MSG) since their records may
+ * be shown by a later phase, where these pointers are not valid. The file and
+ * function are only shown for records logged by the current phase.
+ *
+ * @size: Size of the record including its header and arguments, a multiple
+ *	of 8 bytes. A size of 0 marks the end of the records before they
+ *	wrap back to the start of the buffer.
+ * @level: Level of the record (enum log_level_t)
+ * @flags: Flags for the record (LOGRF_...)
+ * @line: Line number where the record was generated
+ * @time_us: Time the record was logged, from timer_get_boot_us()
+ * @fmt: printf() format string for the message (NULL if LOGRF_MSG is set)
+ * @file: Name of file where the record was generated
+ * @func: Function where the record was generated
+ * @cat: Category of the record (enum log_category_t)
+ * @phase: Phase which logged the record (enum log_ring_phase)
+ * @reserved: Reserved, set to 0
+ */
+struct log_ring_rec {
+	u16 size;
+	u8 level;
+	u8 flags;
+	u32 line;
+	u64 time_us;
+	const char *fmt;
+	const char *file;
+	const char *func;
+	u16 cat;
+	u8 phase;
+	u8 reserved;
+};
+
+#define LOG_RING_REC_HDR	ALIGN(sizeof(struct log_ring_rec), 8)
+
+/**
+ * log_ring_dump() - Show the records in the log ring buffer
+ *
+ * The records are formatted and written to the console, oldest first, using
+ * the fields selected by the log format (gd->log_fmt).
+ *
+ * @return 0 if OK, -ENOENT if there is no ring buffer yet or it has no
+ *	records
+ */
+int log_ring_dump(void);
+
 /* Handle the 'log test' command */
 int do_log_test(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[]);
 
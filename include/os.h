@@ -375,4 +375,38 @@ int os_read_file(const char *name, void **bufp, int *sizep);
  */
 void *os_find_text_base(void);
 
+/**
+ * os_profile_start() - Start calling a function periodically to take samples
+ *
+ * This uses SIGPROF, so @sample is called in a signal handler with the
+ * registers of the code which was interrupted. Time is measured in CPU
+ * time used, so time spent sleeping is not sampled.
+ *
+ * @period_us:	Time between calls in microseconds
+ * @sample:	Function to call with the program counter, stack pointer and
+ *		frame pointer
+ * @return 0 if OK, -ENOSYS if not supported on this host, other -ve on error
+ */
+int os_profile_start(unsigned int period_us,
+		     void (*sample)(unsigned long pc, unsigned long sp,
+				    unsigned long fp));
+
+/**
+ * os_profile_stop() - Stop calling the function set up by os_profile_start()
+ */
+void os_profile_stop(void);
+
+/**
+ * os_run_parallel() - Run a function on several host threads
+ *
+ * This calls @func once for each element of @args, using up to one thread
+ * per host CPU, and returns when all calls have finished. @func must not
+ * call anything which is not thread-safe, including malloc() and printf().
+ *
+ * @func:	Function to call
+ * @args:	Argument for each call
+ * @count:	Number of calls to make
+ */
+void os_run_parallel(int (*func)(void *arg), void *const args[], int count);
+
 #endif
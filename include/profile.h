@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Statistical profiler
+ */
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+/**
+ * profile_sample() - Record where the CPU is at present
+ *
+ * This is called from the timer interrupt (or signal handler on sandbox)
+ * with the registers of the code that was interrupted. It records the
+ * program counter and the return addresses found by following the chain of
+ * frame records from @fp.
+ *
+ * @pc:		Program counter
+ * @sp:		Stack pointer
+ * @fp:		Frame pointer
+ */
+void profile_sample(ulong pc, ulong sp, ulong fp);
+
+/**
+ * profile_start() - Start taking samples
+ *
+ * This throws away any samples already taken.
+ *
+ * @period_us:	Time between samples in microseconds
+ * @return 0 if OK, -ENOSYS if the architecture cannot take samples, other
+ *	-ve on error
+ */
+int profile_start(uint period_us);
+
+/* Stop taking samples */
+void profile_stop(void);
+
+/* Print statistics about the samples taken */
+void profile_print_stats(void);
+
+/**
+ * profile_list_samples() - Write the samples into a buffer
+ *
+ * This writes a struct trace_output_hdr followed by the samples, each a
+ * struct trace_sample followed by its function offsets, as read by
+ * proftool. The 'needed' parameter returns the number of bytes needed,
+ * which may be more than @buff_size if the buffer is too small.
+ *
+ * @buff:	Buffer in which to place data
+ * @buff_size:	Size of buffer
+ * @needed:	Returns number of bytes used / needed
+ * @return 0 if ok, -ENOSPC if the buffer is too small
+ */
+int profile_list_samples(void *buff, int buff_size, uint *needed);
+
+/**
+ * arch_profile_start() - Start a periodic interrupt which takes samples
+ *
+ * The interrupt handler should call profile_sample(). The default
+ * implementation returns -ENOSYS.
+ *
+ * @period_us:	Time between samples in microseconds
+ * @return 0 if OK, -ve on error
+ */
+int arch_profile_start(uint period_us);
+
+/* arch_profile_stop() - Stop the interrupt started by arch_profile_start() */
+void arch_profile_stop(void);
+
+#endif
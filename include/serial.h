@@ -189,6 +189,22 @@ struct dm_serial_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*putc)(struct udevice *dev, const char ch);
+	/**
+	 * puts() - Write a number of characters
+	 *
+	 * Write as many characters as the UART can take without waiting,
+	 * e.g. enough to fill its TX FIFO. This is used to send the TX
+	 * buffer (see CONFIG_SERIAL_TX_BUFFER).
+	 *
+	 * This method is optional. If not provided, putc() is used.
+	 *
+	 * @dev: Device pointer
+	 * @s: Characters to write
+	 * @len: Number of characters to write
+	 * @return number of characters written (at least 1), -EAGAIN if
+	 * the UART has no room, other -ve on error
+	 */
+	int (*puts)(struct udevice *dev, const char *s, size_t len);
 	/**
 	 * pending() - Check if input/output characters are waiting
 	 *
@@ -268,6 +284,11 @@ struct dm_serial_ops {
  * @buf:	Pointer to the RX buffer
  * @rd_ptr:	Read pointer in the RX buffer
  * @wr_ptr:	Write pointer in the RX buffer
+ *
+ * @tx_buf:	Pointer to the TX buffer
+ * @tx_rd:	Read pointer in the TX buffer
+ * @tx_wr:	Write pointer in the TX buffer
+ * @tx_busy:	true while the TX buffer is being sent
  */
 struct serial_dev_priv {
 	struct stdio_dev *sdev;
@@ -275,6 +296,11 @@ struct serial_dev_priv {
 	char *buf;
 	int rd_ptr;
 	int wr_ptr;
+
+	char *tx_buf;
+	int tx_rd;
+	int tx_wr;
+	bool tx_busy;
 };
 
 /* Access the serial operations for a device */
@@ -313,6 +339,25 @@ int serial_setconfig(struct udevice *dev, uint config);
  */
 int serial_getinfo(struct udevice *dev, struct serial_device_info *info);
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/**
+ * serial_tx_poll() - Send buffered output which the UART can take now
+ *
+ * This does not wait, so can be called from polling loops.
+ */
+void serial_tx_poll(void);
+
+/**
+ * serial_flush() - Wait until all buffered output has been sent
+ *
+ * Output held while the console is silent stays in the buffer.
+ */
+void serial_flush(void);
+#else
+static inline void serial_tx_poll(void) {}
+static inline void serial_flush(void) {}
+#endif
+
 void atmel_serial_initialize(void);
 void mcf_serial_initialize(void);
 void mpc85xx_serial_initialize(void);
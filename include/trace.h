@@ -28,6 +28,7 @@ enum {
 enum trace_chunk_type {
 	TRACE_CHUNK_FUNCS,
 	TRACE_CHUNK_CALLS,
+	TRACE_CHUNK_SAMPLES,
 };
 
 /* A trace record for a function, as written to the profile output file */
@@ -36,6 +37,15 @@ struct trace_output_func {
 	uint32_t call_count;		/* Number of times called */
 };
 
+/*
+ * A sample taken by the profiler, as written to the profile output file.
+ * This is followed by 'depth' function offsets (uint32_t), the first being
+ * where the CPU was and the rest the return addresses of its callers.
+ */
+struct trace_sample {
+	uint32_t depth;
+};
+
 /* A header at the start of the trace output buffer */
 struct trace_output_hdr {
 	enum trace_chunk_type type;	/* Record type */
@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * LZ4 frame decoding
+ */
+
+#ifndef _UBOOT_LZ4_H
+#define _UBOOT_LZ4_H
+
+#include <linux/types.h>
+
+/* Largest frame header we support: no dictionary ID */
+#define ULZ4F_MAX_HDR_SIZE	15
+
+/*
+ * Extra space needed to decompress a frame in place. If @srcn bytes of
+ * compressed data are placed at the end of a buffer of the uncompressed size
+ * plus this margin, they can be decompressed to the start of the buffer.
+ * This is the standard LZ4 margin plus room for block headers and checksums.
+ */
+#define ULZ4F_INPLACE_MARGIN(srcn)	(((srcn) >> 8) + ((srcn) >> 13) + 40)
+
+/**
+ * struct ulz4f_frame - Information from an LZ4 frame header
+ *
+ * @hdr_len:		Size of the frame header in bytes
+ * @max_block:		Largest uncompressed size of a block
+ * @content_size:	Uncompressed size of the frame, or 0 if not recorded
+ * @block_checksum:	true if each block is followed by a checksum
+ * @content_checksum:	true if the frame ends with a checksum
+ */
+struct ulz4f_frame {
+	uint hdr_len;
+	uint max_block;
+	u64 content_size;
+	bool block_checksum;
+	bool content_checksum;
+};
+
+/**
+ * struct ulz4f_stream - State for decompressing a frame in pieces
+ *
+ * @frame:	Information about the frame, once the header is read
+ * @dst:	Output buffer
+ * @dst_size:	Size of output buffer
+ * @out:	Number of bytes written to @dst so far
+ * @hdr:	Frame header, while collecting it
+ * @hdr_len:	Number of header bytes collected
+ * @buf:	Buffer holding a block which is split between input pieces
+ * @buf_size:	Size of @buf
+ * @buf_len:	Number of bytes in @buf
+ * @skip:	Number of input bytes to skip (checksum after the end mark)
+ * @done:	true once the end of the frame is reached
+ */
+struct ulz4f_stream {
+	struct ulz4f_frame frame;
+	u8 *dst;
+	size_t dst_size;
+	size_t out;
+	u8 hdr[ULZ4F_MAX_HDR_SIZE];
+	size_t hdr_len;
+	u8 *buf;
+	size_t buf_size;
+	size_t buf_len;
+	uint skip;
+	bool done;
+};
+
+/**
+ * ulz4fn() - Decompress an LZ4 frame
+ *
+ * The data may be decompressed in place, see ULZ4F_INPLACE_MARGIN()
+ *
+ * @src:	Compressed data
+ * @srcn:	Size of compressed data
+ * @dst:	Output buffer
+ * @dstn:	On entry, size of output buffer; on exit, number of bytes
+ *		written, even on error
+ * @return 0 if OK, -ENOBUFS if the output buffer is too small, -EPROTO on
+ *	corrupt data, -EPROTONOSUPPORT for an unsupported format, -EINVAL if
+ *	the input is truncated or invalid
+ */
+int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+/**
+ * ulz4f_parse_header() - Read the header of an LZ4 frame
+ *
+ * @src:	Start of the frame
+ * @srcn:	Number of bytes available at @src
+ * @frame:	Returns information about the frame
+ * @return size of header, -EPROTONOSUPPORT for an unsupported format,
+ *	-EINVAL if the header is invalid or more than @srcn bytes long
+ */
+int ulz4f_parse_header(const void *src, size_t srcn, struct ulz4f_frame *frame);
+
+/**
+ * ulz4f_block_size() - Get the size of a block of an LZ4 frame
+ *
+ * @frame:	Frame information, from ulz4f_parse_header()
+ * @src:	Start of the block header
+ * @srcn:	Number of bytes available at @src
+ * @in_lenp:	Returns the number of input bytes used by the block
+ * @out_lenp:	Returns the uncompressed size of the block if it is stored
+ *		uncompressed, else the largest possible size
+ * @return 0 for a block, 1 for the end mark, -EINVAL if the block is
+ *	truncated
+ */
+int ulz4f_block_size(const struct ulz4f_frame *frame, const void *src,
+		     size_t srcn, size_t *in_lenp, size_t *out_lenp);
+
+/**
+ * ulz4f_decode_block() - Decompress one block of an LZ4 frame
+ *
+ * @frame:	Frame information, from ulz4f_parse_header()
+ * @src:	Start of the block header
+ * @srcn:	Number of bytes available at @src
+ * @dst:	Output buffer
+ * @dstn:	Size of output buffer
+ * @in_lenp:	Returns the number of input bytes used
+ * @out_lenp:	Returns the number of bytes written, even on error
+ * @return 0 if a block was decompressed, 1 if this is the end mark, -ve on
+ *	error as for ulz4fn()
+ */
+int ulz4f_decode_block(const struct ulz4f_frame *frame, const void *src,
+		       size_t srcn, void *dst, size_t dstn, size_t *in_lenp,
+		       size_t *out_lenp);
+
+/**
+ * ulz4f_stream_init() - Start decompressing an LZ4 frame in pieces
+ *
+ * This allows data to be decompressed as it is read, without holding all of
+ * it in memory. Call ulz4f_stream_decompress() for each piece, then
+ * ulz4f_stream_end().
+ *
+ * @strm:	Stream state to set up
+ * @dst:	Output buffer
+ * @dst_size:	Size of output buffer
+ */
+void ulz4f_stream_init(struct ulz4f_stream *strm, void *dst, size_t dst_size);
+
+/**
+ * ulz4f_stream_decompress() - Decompress the next piece of an LZ4 frame
+ *
+ * Blocks which are complete in @src are decompressed directly from it. Only a
+ * block which continues into the next piece is copied to a buffer, which is
+ * allocated the first time it is needed.
+ *
+ * @strm:	Stream state
+ * @src:	Next piece of compressed data
+ * @srcn:	Size of piece
+ * @return 0 if more data is needed, 1 if the frame is complete (any data
+ *	after it is ignored), -ENOMEM if out of memory, other -ve on error as
+ *	for ulz4fn()
+ */
+int ulz4f_stream_decompress(struct ulz4f_stream *strm, const void *src,
+			    size_t srcn);
+
+/**
+ * ulz4f_stream_end() - Finish decompressing an LZ4 frame in pieces
+ *
+ * This frees the memory used by the stream
+ *
+ * @strm:	Stream state
+ * @return number of bytes written to the output buffer
+ */
+size_t ulz4f_stream_end(struct ulz4f_stream *strm);
+
+#endif
@@ -724,6 +724,9 @@ ZEXTERN int ZEXPORT inflateInit2_ OF((z_streamp strm, int  windowBits,
 extern void *gzalloc(void *, unsigned, unsigned);
 extern void gzfree(void *, void *, unsigned);
 
+/* Set while inflate() runs on several CPUs, so it leaves the watchdog be */
+extern int zlib_no_watchdog;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,385 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Apply a binary patch made by bsdiff
+ *
+ * A patch is a header followed by three bzip2 streams: control triples,
+ * bytes to add to the old image and bytes to insert. Each triple copies a
+ * run of the old image with the diff bytes added, inserts a run of extra
+ * bytes, then moves the position in the old image. The new image is thus
+ * made in order, so it can be written out as it is made, while the old
+ * image is only read in pieces.
+ */
+
+#include <common.h>
+#include <bspatch.h>
+#include <bzlib.h>
+#include <console.h>
+#include <div64.h>
+#include <hash.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <watchdog.h>
+#include <asm/unaligned.h>
+
+enum {
+	/* Amount of data handled in each step */
+	BSPATCH_CHUNK		= 0x10000,
+
+	/* Size of the buffers for reading and writing block devices */
+	BSPATCH_BLK_BUF_SIZE	= 1 << 20,
+};
+
+/* Read a signed 64-bit value: little-endian magnitude, top bit is sign */
+static s64 bspatch_offtin(const u8 *buf)
+{
+	s64 val = get_unaligned_le64(buf) & ~(1ULL << 63);
+
+	return buf[7] & 0x80 ? -val : val;
+}
+
+int bspatch_new_size(const void *patch, ulong len, u64 *sizep)
+{
+	const u8 *hdr = patch;
+	s64 ctrl_len, diff_len, new_size;
+
+	if (len < BSPATCH_HDR_SIZE || memcmp(hdr, BSPATCH_MAGIC, 8))
+		return -EINVAL;
+	ctrl_len = bspatch_offtin(hdr + 8);
+	diff_len = bspatch_offtin(hdr + 16);
+	new_size = bspatch_offtin(hdr + 24);
+	if (ctrl_len < 0 || diff_len < 0 || new_size < 0 ||
+	    ctrl_len > len - BSPATCH_HDR_SIZE ||
+	    diff_len > len - BSPATCH_HDR_SIZE - ctrl_len)
+		return -EINVAL;
+	*sizep = new_size;
+
+	return 0;
+}
+
+static int bspatch_stream_init(bz_stream *strm, const u8 *data, ulong len)
+{
+	memset(strm, '\0', sizeof(*strm));
+	if (BZ2_bzDecompressInit(strm, 0, 0) != BZ_OK)
+		return -ENOMEM;
+	strm->next_in = (char *)data;
+	strm->avail_in = len;
+
+	return 0;
+}
+
+/* Read exactly @len bytes from a stream */
+static int bspatch_stream_read(bz_stream *strm, void *buf, uint len)
+{
+	int ret;
+
+	strm->next_out = buf;
+	strm->avail_out = len;
+	while (strm->avail_out) {
+		ret = BZ2_bzDecompress(strm);
+		if (ret == BZ_STREAM_END && strm->avail_out)
+			return -EINVAL;
+		if (ret != BZ_OK && ret != BZ_STREAM_END)
+			return ret == BZ_MEM_ERROR ? -ENOMEM : -EINVAL;
+		/* no progress is possible without more input */
+		if (ret == BZ_OK && !strm->avail_in && strm->avail_out)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Add the old image at @old_pos to the @len bytes at @buf */
+static int bspatch_add_old(struct bspatch_io *io, u8 *buf, ulong len,
+			   s64 old_pos, u64 old_size, u8 *old_buf)
+{
+	ulong start = 0, end = len;
+	ulong i;
+	int ret;
+
+	/* Bytes outside the old image are taken as zero */
+	if (old_pos >= (s64)old_size || old_pos + (s64)len <= 0)
+		return 0;
+	if (old_pos < 0)
+		start = -old_pos;
+	if (old_pos + len > old_size)
+		end = old_size - old_pos;
+
+	ret = io->read_old(io, old_pos + start, old_buf + start, end - start);
+	if (ret)
+		return ret;
+	for (i = start; i < end; i++)
+		buf[i] += old_buf[i];
+
+	return 0;
+}
+
+int bspatch(const void *patch, ulong len, u64 old_size, struct bspatch_io *io)
+{
+	const u8 *hdr = patch;
+	bz_stream ctrl, diff, extra;
+	u64 new_size, new_pos = 0;
+	ulong ctrl_len, diff_len;
+	u8 *buf, *old_buf;
+	s64 old_pos = 0;
+	int ret;
+
+	ret = bspatch_new_size(patch, len, &new_size);
+	if (ret)
+		return ret;
+	ctrl_len = bspatch_offtin(hdr + 8);
+	diff_len = bspatch_offtin(hdr + 16);
+
+	buf = malloc(BSPATCH_CHUNK);
+	old_buf = malloc(BSPATCH_CHUNK);
+	if (!buf || !old_buf) {
+		ret = -ENOMEM;
+		goto err_buf;
+	}
+	ret = bspatch_stream_init(&ctrl, hdr + BSPATCH_HDR_SIZE, ctrl_len);
+	if (ret)
+		goto err_buf;
+	ret = bspatch_stream_init(&diff, hdr + BSPATCH_HDR_SIZE + ctrl_len,
+				  diff_len);
+	if (ret)
+		goto err_diff;
+	ret = bspatch_stream_init(&extra,
+				  hdr + BSPATCH_HDR_SIZE + ctrl_len + diff_len,
+				  len - BSPATCH_HDR_SIZE - ctrl_len - diff_len);
+	if (ret)
+		goto err_extra;
+
+	while (new_pos < new_size) {
+		u8 triple[24];
+		s64 add_len, extra_len;
+
+		ret = bspatch_stream_read(&ctrl, triple, sizeof(triple));
+		if (ret)
+			goto err;
+		add_len = bspatch_offtin(triple);
+		extra_len = bspatch_offtin(triple + 8);
+		if (add_len < 0 || extra_len < 0 ||
+		    add_len > new_size - new_pos ||
+		    extra_len > new_size - new_pos - add_len) {
+			ret = -EINVAL;
+			goto err;
+		}
+
+		while (add_len) {
+			uint n = min_t(s64, add_len, BSPATCH_CHUNK);
+
+			ret = bspatch_stream_read(&diff, buf, n);
+			if (!ret)
+				ret = bspatch_add_old(io, buf, n, old_pos,
+						      old_size, old_buf);
+			if (!ret)
+				ret = io->write_new(io, buf, n);
+			if (ret)
+				goto err;
+			old_pos += n;
+			new_pos += n;
+			add_len -= n;
+		}
+
+		while (extra_len) {
+			uint n = min_t(s64, extra_len, BSPATCH_CHUNK);
+
+			ret = bspatch_stream_read(&extra, buf, n);
+			if (!ret)
+				ret = io->write_new(io, buf, n);
+			if (ret)
+				goto err;
+			new_pos += n;
+			extra_len -= n;
+		}
+
+		old_pos += bspatch_offtin(triple + 16);
+		WATCHDOG_RESET();
+	}
+
+err:
+	BZ2_bzDecompressEnd(&extra);
+err_extra:
+	BZ2_bzDecompressEnd(&diff);
+err_diff:
+	BZ2_bzDecompressEnd(&ctrl);
+err_buf:
+	free(old_buf);
+	free(buf);
+
+	return ret;
+}
+
+/**
+ * struct bspatch_blk_priv - State for patching between block devices
+ *
+ * @old_dev:	Device holding the old image
+ * @old_start:	First block of the old image
+ * @old_blks:	Number of blocks holding the old image
+ * @rbuf:	Buffer holding part of the old image
+ * @rbuf_blk:	First block held in @rbuf, relative to @old_start
+ * @rbuf_blks:	Number of blocks held in @rbuf
+ * @new_dev:	Device to write the new image to
+ * @new_blk:	Next block to write
+ * @wbuf:	Buffer collecting the new image
+ * @wbuf_len:	Number of bytes in @wbuf
+ * @algo:	Hash algorithm for the new image, or NULL
+ * @hash_ctx:	Hash context
+ */
+struct bspatch_blk_priv {
+	struct blk_desc *old_dev;
+	lbaint_t old_start;
+	lbaint_t old_blks;
+	u8 *rbuf;
+	lbaint_t rbuf_blk;
+	lbaint_t rbuf_blks;
+	struct blk_desc *new_dev;
+	lbaint_t new_blk;
+	u8 *wbuf;
+	ulong wbuf_len;
+	struct hash_algo *algo;
+	void *hash_ctx;
+};
+
+static int bspatch_blk_read(struct bspatch_io *io, u64 offset, void *buf,
+			    ulong len)
+{
+	struct bspatch_blk_priv *priv = io->priv;
+	ulong blksz = priv->old_dev->blksz;
+	lbaint_t blk = lldiv(offset, blksz);
+	ulong pos = offset - (u64)blk * blksz;
+
+	while (len) {
+		ulong n;
+
+		if (blk < priv->rbuf_blk ||
+		    blk >= priv->rbuf_blk + priv->rbuf_blks) {
+			lbaint_t count;
+
+			count = min_t(lbaint_t, BSPATCH_BLK_BUF_SIZE / blksz,
+				      priv->old_blks - blk);
+			if (blk_dread(priv->old_dev, priv->old_start + blk,
+				      count, priv->rbuf) != count)
+				return -EIO;
+			priv->rbuf_blk = blk;
+			priv->rbuf_blks = count;
+		}
+		pos += (blk - priv->rbuf_blk) * blksz;
+		n = min_t(ulong, len, priv->rbuf_blks * blksz - pos);
+		memcpy(buf, priv->rbuf + pos, n);
+		buf += n;
+		len -= n;
+		blk = priv->rbuf_blk + priv->rbuf_blks;
+		pos = 0;
+	}
+
+	return 0;
+}
+
+/* Write out the collected data, padding the last block with zeroes */
+static int bspatch_blk_flush(struct bspatch_blk_priv *priv)
+{
+	ulong blksz = priv->new_dev->blksz;
+	lbaint_t count = DIV_ROUND_UP(priv->wbuf_len, blksz);
+
+	memset(priv->wbuf + priv->wbuf_len, '\0',
+	       count * blksz - priv->wbuf_len);
+	if (blk_dwrite(priv->new_dev, priv->new_blk, count, priv->wbuf) !=
+	    count)
+		return -EIO;
+	priv->new_blk += count;
+	priv->wbuf_len = 0;
+
+	return 0;
+}
+
+static int bspatch_blk_write(struct bspatch_io *io, const void *buf,
+			     ulong len)
+{
+	struct bspatch_blk_priv *priv = io->priv;
+	int ret;
+
+	if (priv->algo)
+		priv->algo->hash_update(priv->algo, priv->hash_ctx, buf, len,
+					0);
+	while (len) {
+		ulong n = min(len, BSPATCH_BLK_BUF_SIZE - priv->wbuf_len);
+
+		memcpy(priv->wbuf + priv->wbuf_len, buf, n);
+		priv->wbuf_len += n;
+		buf += n;
+		len -= n;
+		if (priv->wbuf_len == BSPATCH_BLK_BUF_SIZE) {
+			ret = bspatch_blk_flush(priv);
+			if (ret)
+				return ret;
+			if (ctrlc())
+				return -EINTR;
+		}
+	}
+
+	return 0;
+}
+
+int bspatch_blk(const void *patch, ulong len, struct blk_desc *old_dev,
+		const disk_partition_t *old_part, u64 old_size,
+		struct blk_desc *new_dev, const disk_partition_t *new_part,
+		const char *algo, const u8 *digest)
+{
+	struct bspatch_blk_priv priv;
+	struct bspatch_io io;
+	u8 hash[HASH_MAX_DIGEST_SIZE];
+	u64 new_size;
+	int ret;
+
+	ret = bspatch_new_size(patch, len, &new_size);
+	if (ret)
+		return ret;
+	if (!old_size)
+		old_size = (u64)old_part->size * old_dev->blksz;
+	if (old_size > (u64)old_part->size * old_dev->blksz ||
+	    new_size > (u64)new_part->size * new_dev->blksz)
+		return -ENOSPC;
+	if (old_dev == new_dev &&
+	    old_part->start < new_part->start + new_part->size &&
+	    new_part->start < old_part->start + old_part->size)
+		return -EINVAL;
+
+	memset(&priv, '\0', sizeof(priv));
+	priv.old_dev = old_dev;
+	priv.old_start = old_part->start;
+	priv.old_blks = lldiv(old_size + old_dev->blksz - 1, old_dev->blksz);
+	priv.new_dev = new_dev;
+	priv.new_blk = new_part->start;
+	if (algo) {
+		ret = hash_lookup_algo(algo, &priv.algo);
+		if (ret)
+			return -EINVAL;
+		ret = priv.algo->hash_init(priv.algo, &priv.hash_ctx);
+		if (ret)
+			return -ENOMEM;
+	}
+	io.read_old = bspatch_blk_read;
+	io.write_new = bspatch_blk_write;
+	io.priv = &priv;
+
+	priv.rbuf = malloc_cache_aligned(BSPATCH_BLK_BUF_SIZE);
+	priv.wbuf = malloc_cache_aligned(BSPATCH_BLK_BUF_SIZE);
+	if (!priv.rbuf || !priv.wbuf)
+		ret = -ENOMEM;
+	else
+		ret = bspatch(patch, len, old_size, &io);
+	if (!ret && priv.wbuf_len)
+		ret = bspatch_blk_flush(&priv);
+	free(priv.wbuf);
+	free(priv.rbuf);
+
+	if (priv.algo) {
+		if (priv.algo->hash_finish(priv.algo, priv.hash_ctx, hash,
+					   sizeof(hash)))
+			ret = ret ? ret : -EINVAL;
+		else if (!ret && memcmp(hash, digest, priv.algo->digest_size))
+			ret = -EBADMSG;
+	}
+
+	return ret;
+}
@@ -0,0 +1,458 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Parallel decompression of images made of independent streams
+ *
+ * Each gzip member and each zstd frame can be decompressed without looking
+ * at the others. If we can find where each one starts in the compressed
+ * data and how large it is when uncompressed, they can be decompressed at
+ * the same time, each straight into its final place.
+ *
+ * zstd frames record their compressed layout in their block headers and
+ * usually their uncompressed size in the frame header. gzip members have
+ * neither, so we look for gzip headers in the data and take the size from
+ * the trailer just before each one. A header can appear in compressed data
+ * by chance, so each chunk checks that its members end exactly where the
+ * next one starts and have the size recorded in their trailers.
+ *
+ * LZ4 frames with independent blocks are split into blocks. Each block
+ * except the last is normally full, so chunks assume this and check it.
+ */
+
+#include <common.h>
+#include <decomp_parallel.h>
+#include <image.h>
+#include <malloc.h>
+#include <watchdog.h>
+#include <asm/unaligned.h>
+#include <linux/sizes.h>
+#include <linux/zstd.h>
+#include <u-boot/lz4.h>
+#include <u-boot/zlib.h>
+
+/* Space for the zlib state used by each chunk, allocated up front */
+#define GZIP_WORK_SIZE		SZ_64K
+#define GZIP_HDR_SIZE		10
+#define GZIP_TRAILER_SIZE	8
+
+#define GZIP_FLAG_HCRC		BIT(1)
+#define GZIP_FLAG_EXTRA		BIT(2)
+#define GZIP_FLAG_NAME		BIT(3)
+#define GZIP_FLAG_COMMENT	BIT(4)
+#define GZIP_FLAG_RESERVED	0xe0
+
+/**
+ * struct decomp_chunk - A part of the data to decompress on one CPU
+ *
+ * @comp:	Compression type (IH_COMP_...)
+ * @src:	Compressed data, holding one or more members, frames or blocks
+ * @src_len:	Size of compressed data
+ * @dst:	Place for the uncompressed data
+ * @dst_len:	Expected size of the uncompressed data. If @open_end, this is
+ *		the space available and is updated to the actual size
+ * @open_end:	true if this holds the last LZ4 block, whose size is unknown
+ * @frame:	LZ4 frame information (LZ4 only)
+ * @work:	Working memory for the decompressor
+ * @work_size:	Size of working memory
+ * @work_used:	Amount of working memory allocated so far (gzip only)
+ * @dctx:	Decompression context (zstd only)
+ * @ret:	Returns 0 if OK, or -ve error code
+ */
+struct decomp_chunk {
+	int comp;
+	const u8 *src;
+	ulong src_len;
+	u8 *dst;
+	ulong dst_len;
+	bool open_end;
+	const struct ulz4f_frame *frame;
+	void *work;
+	ulong work_size;
+	ulong work_used;
+	ZSTD_DCtx *dctx;
+	int ret;
+};
+
+__weak void arch_run_parallel(int (*func)(void *arg), void *const args[],
+			      int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		func(args[i]);
+		WATCHDOG_RESET();
+	}
+}
+
+/* Get the size of the gzip header at @src, or -EINVAL if there is none */
+static int gzip_header_len(const u8 *src, ulong len)
+{
+	const u8 *end = src + len;
+	const u8 *p;
+	int flags;
+
+	if (len < GZIP_HDR_SIZE || src[0] != 0x1f || src[1] != 0x8b ||
+	    src[2] != Z_DEFLATED)
+		return -EINVAL;
+	flags = src[3];
+	if (flags & GZIP_FLAG_RESERVED)
+		return -EINVAL;
+	/* extra flags are 0, 2 (best) or 4 (fastest); OS is 0-13 or 255 */
+	if ((src[8] & ~6) || (src[9] > 13 && src[9] != 255))
+		return -EINVAL;
+
+	p = src + GZIP_HDR_SIZE;
+	if (flags & GZIP_FLAG_EXTRA) {
+		if (end - p < 2)
+			return -EINVAL;
+		p += 2 + get_unaligned_le16(p);
+	}
+	if (flags & GZIP_FLAG_NAME) {
+		while (p < end && *p)
+			p++;
+		p++;
+	}
+	if (flags & GZIP_FLAG_COMMENT) {
+		while (p < end && *p)
+			p++;
+		p++;
+	}
+	if (flags & GZIP_FLAG_HCRC)
+		p += 2;
+	if (p >= end)
+		return -EINVAL;
+
+	return p - src;
+}
+
+static voidpf chunk_zalloc(voidpf opaque, uInt items, uInt size)
+{
+	struct decomp_chunk *chunk = opaque;
+	ulong bytes = ALIGN((ulong)items * size, 16);
+	void *ptr;
+
+	if (chunk->work_used + bytes > chunk->work_size)
+		return NULL;
+	ptr = chunk->work + chunk->work_used;
+	chunk->work_used += bytes;
+
+	return ptr;
+}
+
+static void chunk_zfree(voidpf opaque, voidpf ptr, uInt nb)
+{
+}
+
+static int decomp_gzip_chunk(struct decomp_chunk *chunk)
+{
+	const u8 *src = chunk->src, *end = src + chunk->src_len;
+	u8 *dst = chunk->dst;
+	z_stream s;
+	int ret = 0;
+	int hdr;
+
+	memset(&s, '\0', sizeof(s));
+	s.zalloc = chunk_zalloc;
+	s.zfree = chunk_zfree;
+	s.opaque = chunk;
+	if (inflateInit2(&s, -MAX_WBITS) != Z_OK)
+		return -ENOMEM;
+
+	while (!ret && src < end) {
+		hdr = gzip_header_len(src, end - src);
+		if (hdr < 0) {
+			ret = hdr;
+			break;
+		}
+		s.next_in = (u8 *)src + hdr;
+		s.avail_in = end - src - hdr;
+		s.next_out = dst;
+		s.avail_out = chunk->dst + chunk->dst_len - dst;
+		if (inflate(&s, Z_FINISH) != Z_STREAM_END) {
+			ret = -EINVAL;
+			break;
+		}
+
+		/* the member must be followed by its trailer, then the next */
+		src = s.next_in + GZIP_TRAILER_SIZE;
+		if (src > end ||
+		    get_unaligned_le32(src - 4) != (u32)(s.next_out - dst))
+			ret = -EINVAL;
+		dst = s.next_out;
+		inflateReset(&s);
+	}
+	inflateEnd(&s);
+	if (!ret && dst != chunk->dst + chunk->dst_len)
+		ret = -EINVAL;
+
+	return ret;
+}
+
+static int decomp_zstd_chunk(struct decomp_chunk *chunk)
+{
+	size_t ret;
+
+	ret = ZSTD_decompressDCtx(chunk->dctx, chunk->dst, chunk->dst_len,
+				  chunk->src, chunk->src_len);
+	if (ZSTD_isError(ret) || ret != chunk->dst_len)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int decomp_lz4_chunk(struct decomp_chunk *chunk)
+{
+	const u8 *src = chunk->src, *end = src + chunk->src_len;
+	u8 *dst = chunk->dst, *dst_end = dst + chunk->dst_len;
+	size_t in_len, out_len;
+	int ret;
+
+	do {
+		ret = ulz4f_decode_block(chunk->frame, src, end - src, dst,
+					 dst_end - dst, &in_len, &out_len);
+		src += in_len;
+		dst += out_len;
+	} while (!ret && src < end);
+	if (ret < 0)
+		return ret;
+
+	/* the last chunk ends with the end mark */
+	if (chunk->open_end) {
+		if (ret != 1)
+			return -EINVAL;
+		chunk->dst_len = dst - chunk->dst;
+		return 0;
+	}
+	if (ret || dst != dst_end)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int decomp_chunk(void *arg)
+{
+	struct decomp_chunk *chunk = arg;
+
+	if (IS_ENABLED(CONFIG_GZIP) && chunk->comp == IH_COMP_GZIP)
+		chunk->ret = decomp_gzip_chunk(chunk);
+	else if (IS_ENABLED(CONFIG_ZSTD) && chunk->comp == IH_COMP_ZSTD)
+		chunk->ret = decomp_zstd_chunk(chunk);
+	else if (IS_ENABLED(CONFIG_LZ4) && chunk->comp == IH_COMP_LZ4)
+		chunk->ret = decomp_lz4_chunk(chunk);
+	else
+		chunk->ret = -ENOENT;
+
+	return chunk->ret;
+}
+
+/*
+ * Find the next member or frame after @pos, returning its offset and the
+ * uncompressed size of the data from @pos up to there, which must not be
+ * more than @max_size. Returns @src_size at the end of the data, or -ve on
+ * error
+ */
+static long next_gzip_member(const u8 *src, ulong src_size, ulong pos,
+			     ulong max_size, ulong *sizep)
+{
+	ulong next;
+
+	/* skip anything which looks like a header but has an unlikely size */
+	for (next = pos + GZIP_HDR_SIZE + GZIP_TRAILER_SIZE;
+	     next + GZIP_HDR_SIZE < src_size; next++) {
+		if (src[next] == 0x1f && src[next + 1] == 0x8b &&
+		    gzip_header_len(src + next, src_size - next) > 0 &&
+		    get_unaligned_le32(src + next - 4) <= max_size)
+			break;
+	}
+	if (next + GZIP_HDR_SIZE >= src_size)
+		next = src_size;
+	*sizep = get_unaligned_le32(src + next - 4);
+	if (*sizep > max_size)
+		return -ENOSPC;
+
+	return next;
+}
+
+static long next_zstd_frame(const u8 *src, ulong src_size, ulong pos,
+			    ulong max_size, ulong *sizep)
+{
+	unsigned long long size;
+	size_t len;
+
+	len = ZSTD_findFrameCompressedSize(src + pos, src_size - pos);
+	if (ZSTD_isError(len))
+		return -EINVAL;
+	size = ZSTD_getFrameContentSize(src + pos, len);
+	if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR)
+		return -ENOENT;
+	if (size > max_size)
+		return -ENOSPC;
+	*sizep = size;
+
+	return pos + len;
+}
+
+/*
+ * The last block is followed by the end mark. Its size is not known unless it
+ * is stored uncompressed, so give it all the remaining space
+ */
+static long next_lz4_block(const struct ulz4f_frame *frame, const u8 *src,
+			   ulong src_size, ulong pos, ulong max_size,
+			   ulong *sizep)
+{
+	size_t in_len, out_len, next_len, next_out;
+	int ret;
+
+	ret = ulz4f_block_size(frame, src + pos, src_size - pos, &in_len,
+			       &out_len);
+	if (ret)
+		return -EINVAL;
+	pos += in_len;
+	ret = ulz4f_block_size(frame, src + pos, src_size - pos, &next_len,
+			       &next_out);
+	if (ret < 0)
+		return ret;
+	if (ret == 1) {
+		*sizep = min((ulong)out_len, max_size);
+		return src_size;
+	}
+	if (out_len > max_size)
+		return -ENOSPC;
+	*sizep = out_len;
+
+	return pos;
+}
+
+/*
+ * Share the members, frames or blocks out into chunks of similar compressed
+ * size. Returns the number of chunks, or -ve on error
+ */
+static int decomp_split(int comp, const struct ulz4f_frame *frame,
+			struct decomp_chunk *chunks, u8 *dst, ulong dst_size,
+			const u8 *src, ulong src_size)
+{
+	ulong target = DIV_ROUND_UP(src_size, CONFIG_DECOMP_PARALLEL_CHUNKS);
+	ulong pos, start, out = 0, out_start = 0, size;
+	int count = 0, streams = 0;
+	long next;
+
+	start = frame ? frame->hdr_len : 0;
+	for (pos = start; pos < src_size; pos = next) {
+		if (IS_ENABLED(CONFIG_GZIP) && comp == IH_COMP_GZIP)
+			next = next_gzip_member(src, src_size, pos,
+						dst_size - out, &size);
+		else if (IS_ENABLED(CONFIG_ZSTD) && comp == IH_COMP_ZSTD)
+			next = next_zstd_frame(src, src_size, pos,
+					       dst_size - out, &size);
+		else if (IS_ENABLED(CONFIG_LZ4) && comp == IH_COMP_LZ4)
+			next = next_lz4_block(frame, src, src_size, pos,
+					      dst_size - out, &size);
+		else
+			return -ENOENT;
+		if (next < 0)
+			return next;
+		streams++;
+		out += size;
+		if (next - start >= target || next == src_size) {
+			struct decomp_chunk *chunk = &chunks[count++];
+
+			chunk->comp = comp;
+			chunk->src = src + start;
+			chunk->src_len = next - start;
+			chunk->dst = dst + out_start;
+			chunk->dst_len = out - out_start;
+			chunk->open_end = comp == IH_COMP_LZ4 &&
+				next == src_size;
+			chunk->frame = frame;
+			start = next;
+			out_start = out;
+		}
+	}
+	if (streams < 2)
+		return -ENOENT;
+
+	/* chunks must not overwrite compressed data which others still need */
+	if (dst < src + src_size && src < dst + out)
+		return -EBUSY;
+
+	return count;
+}
+
+int decomp_parallel(int comp, void *dst, ulong dst_size, const void *src,
+		    ulong src_size, ulong *out_lenp)
+{
+	struct decomp_chunk chunks[CONFIG_DECOMP_PARALLEL_CHUNKS];
+	void *args[CONFIG_DECOMP_PARALLEL_CHUNKS];
+	struct ulz4f_frame frame, *lz4 = NULL;
+	ulong work_size = 0;
+	int count, i;
+	int ret = 0;
+
+	if (comp == IH_COMP_GZIP && IS_ENABLED(CONFIG_GZIP)) {
+		work_size = GZIP_WORK_SIZE;
+	} else if (comp == IH_COMP_ZSTD && IS_ENABLED(CONFIG_ZSTD)) {
+		work_size = ZSTD_DCtxWorkspaceBound();
+	} else if (comp == IH_COMP_LZ4 && IS_ENABLED(CONFIG_LZ4)) {
+		ret = ulz4f_parse_header(src, src_size, &frame);
+		if (ret < 0)
+			return ret;
+		lz4 = &frame;
+	} else {
+		return -ENOENT;
+	}
+
+	memset(chunks, '\0', sizeof(chunks));
+	count = decomp_split(comp, lz4, chunks, dst, dst_size, src, src_size);
+	if (count < 0)
+		return count;
+
+	/* allocate everything here, since malloc() is not thread-safe */
+	ret = 0;
+	for (i = 0; i < count; i++) {
+		struct decomp_chunk *chunk = &chunks[i];
+
+		args[i] = chunk;
+		if (!work_size)
+			continue;
+		chunk->work = malloc(work_size);
+		if (!chunk->work) {
+			ret = -ENOMEM;
+			break;
+		}
+		chunk->work_size = work_size;
+		chunk->work_used = 0;
+		if (IS_ENABLED(CONFIG_ZSTD) && comp == IH_COMP_ZSTD) {
+			chunk->dctx = ZSTD_initDCtx(chunk->work, work_size);
+			if (!chunk->dctx) {
+				ret = -ENOMEM;
+				break;
+			}
+		}
+	}
+
+	if (!ret) {
+		debug("Decompressing %d chunks in parallel\n", count);
+
+		/* only this CPU may reset the watchdog, so chunks leave it */
+		WATCHDOG_RESET();
+		if (IS_ENABLED(CONFIG_ZLIB))
+			zlib_no_watchdog = 1;
+		arch_run_parallel(decomp_chunk, args, count);
+		if (IS_ENABLED(CONFIG_ZLIB))
+			zlib_no_watchdog = 0;
+		WATCHDOG_RESET();
+		for (i = 0; i < count; i++) {
+			if (chunks[i].ret) {
+				ret = chunks[i].ret;
+				break;
+			}
+		}
+	}
+	for (i = 0; i < count; i++)
+		free(chunks[i].work);
+	if (ret)
+		return ret;
+	*out_lenp = chunks[count - 1].dst + chunks[count - 1].dst_len -
+		(u8 *)dst;
+
+	return 0;
+}
@@ -10,6 +10,7 @@
 #include <dm/of_extra.h>
 #include <errno.h>
 #include <fdtdec.h>
+#include <fdt_batch.h>
 #include <fdt_support.h>
 #include <mapmem.h>
 #include <linux/libfdt.h>
@@ -1290,32 +1291,39 @@ int fdtdec_set_ethernet_mac_address(void *fdt, const u8 *mac, size_t size)
 	return 0;
 }
 
-static int fdtdec_init_reserved_memory(void *blob)
+/*
+ * Create the /reserved-memory node, through @batch if not NULL, returning its
+ * handle (with a batch) or offset
+ */
+static int fdtdec_init_reserved_memory(void *blob, struct fdt_batch *batch,
+				       int na, int ns)
 {
-	int na, ns, node, err;
+	int node, err;
 	fdt32_t value;
 
-	/* inherit #address-cells and #size-cells from the root node */
-	na = fdt_address_cells(blob, 0);
-	ns = fdt_size_cells(blob, 0);
-
-	node = fdt_add_subnode(blob, 0, "reserved-memory");
+	if (batch)
+		node = fdt_batch_add_subnode(batch, fdt_batch_node(batch, 0),
+					     "reserved-memory");
+	else
+		node = fdt_add_subnode(blob, 0, "reserved-memory");
 	if (node < 0)
 		return node;
 
-	err = fdt_setprop(blob, node, "ranges", NULL, 0);
+	err = fdt_batch_maybe_setprop(blob, batch, node, "ranges", NULL, 0);
 	if (err < 0)
 		return err;
 
 	value = cpu_to_fdt32(ns);
 
-	err = fdt_setprop(blob, node, "#size-cells", &value, sizeof(value));
+	err = fdt_batch_maybe_setprop(blob, batch, node, "#size-cells", &value,
+				      sizeof(value));
 	if (err < 0)
 		return err;
 
 	value = cpu_to_fdt32(na);
 
-	err = fdt_setprop(blob, node, "#address-cells", &value, sizeof(value));
+	err = fdt_batch_maybe_setprop(blob, batch, node, "#address-cells",
+				      &value, sizeof(value));
 	if (err < 0)
 		return err;
 
@@ -1329,40 +1337,44 @@ int fdtdec_add_reserved_memory(void *blob, const char *basename,
 	fdt32_t cells[4] = {}, *ptr = cells;
 	uint32_t upper, lower, phandle;
 	int parent, node, na, ns, err;
+	struct fdt_batch batch, *bp;
 	fdt_size_t size;
+	fdt32_t value;
 	char name[64];
 
-	/* create an empty /reserved-memory node if one doesn't exist */
+	/*
+	 * An empty /reserved-memory node is created below if one doesn't
+	 * exist, inheriting #address-cells and #size-cells from the root node
+	 */
 	parent = fdt_path_offset(blob, "/reserved-memory");
-	if (parent < 0) {
-		parent = fdtdec_init_reserved_memory(blob);
-		if (parent < 0)
-			return parent;
-	}
 
 	/* only 1 or 2 #address-cells and #size-cells are supported */
-	na = fdt_address_cells(blob, parent);
+	na = fdt_address_cells(blob, parent < 0 ? 0 : parent);
 	if (na < 1 || na > 2)
 		return -FDT_ERR_BADNCELLS;
 
-	ns = fdt_size_cells(blob, parent);
+	ns = fdt_size_cells(blob, parent < 0 ? 0 : parent);
 	if (ns < 1 || ns > 2)
 		return -FDT_ERR_BADNCELLS;
 
 	/* find a matching node and return the phandle to that */
-	fdt_for_each_subnode(node, blob, parent) {
-		const char *name = fdt_get_name(blob, node, NULL);
-		phys_addr_t addr, size;
-
-		addr = fdtdec_get_addr_size(blob, node, "reg", &size);
-		if (addr == FDT_ADDR_T_NONE) {
-			debug("failed to read address/size for %s\n", name);
-			continue;
-		}
+	if (parent >= 0) {
+		fdt_for_each_subnode(node, blob, parent) {
+			const char *name = fdt_get_name(blob, node, NULL);
+			phys_addr_t addr, size;
+
+			addr = fdtdec_get_addr_size(blob, node, "reg", &size);
+			if (addr == FDT_ADDR_T_NONE) {
+				debug("failed to read address/size for %s\n",
+				      name);
+				continue;
+			}
 
-		if (addr == carveout->start && (addr + size) == carveout->end) {
-			*phandlep = fdt_get_phandle(blob, node);
-			return 0;
+			if (addr == carveout->start &&
+			    (addr + size) == carveout->end) {
+				*phandlep = fdt_get_phandle(blob, node);
+				return 0;
+			}
 		}
 	}
 
@@ -1386,17 +1398,36 @@ int fdtdec_add_reserved_memory(void *blob, const char *basename,
 		snprintf(name, sizeof(name), "%s@%x", basename, lower);
 	}
 
-	node = fdt_add_subnode(blob, parent, name);
-	if (node < 0)
-		return node;
-
 	err = fdt_generate_phandle(blob, &phandle);
 	if (err < 0)
 		return err;
 
-	err = fdtdec_set_phandle(blob, node, phandle);
+	/* Add the nodes and properties together, moving the tree just once */
+	bp = fdt_batch_start(&batch, blob);
+	if (parent < 0)
+		parent = fdtdec_init_reserved_memory(blob, bp, na, ns);
+	else
+		parent = fdt_batch_maybe_node(bp, parent);
+	if (parent < 0)
+		return fdt_batch_finish(bp, parent);
+
+	if (bp) {
+		node = fdt_batch_find_subnode(bp, parent, name);
+		if (node >= 0)
+			node = -FDT_ERR_EXISTS;
+		else if (node == -FDT_ERR_NOTFOUND)
+			node = fdt_batch_add_subnode(bp, parent, name);
+	} else {
+		node = fdt_add_subnode(blob, parent, name);
+	}
+	if (node < 0)
+		return fdt_batch_finish(bp, node);
+
+	value = cpu_to_fdt32(phandle);
+	err = fdt_batch_maybe_setprop(blob, bp, node, "phandle", &value,
+				      sizeof(value));
 	if (err < 0)
-		return err;
+		return fdt_batch_finish(bp, err);
 
 	/* store one or two address cells */
 	if (na > 1)
@@ -1414,7 +1445,9 @@ int fdtdec_add_reserved_memory(void *blob, const char *basename,
 
 	*ptr++ = cpu_to_fdt32(lower);
 
-	err = fdt_setprop(blob, node, "reg", cells, (na + ns) * sizeof(*cells));
+	err = fdt_batch_maybe_setprop(blob, bp, node, "reg", cells,
+				      (na + ns) * sizeof(*cells));
+	err = fdt_batch_finish(bp, err < 0 ? err : 0);
 	if (err < 0)
 		return err;
 
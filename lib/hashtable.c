@@ -40,17 +40,22 @@
 #define	CONFIG_ENV_MAX_ENTRIES 512
 #endif
 
-#define USED_FREE 0
-#define USED_DELETED -1
+/* Smallest table size; must be a power of two */
+#define HTAB_MIN_SIZE	16
+
+/* Grow the table once more than HTAB_LOAD / 8 of the slots are in use */
+#define HTAB_LOAD	6
 
 #include <env_callback.h>
 #include <env_flags.h>
 #include <search.h>
 #include <slre.h>
+#include <linux/xxhash.h>
 
 /*
- * [Aho,Sethi,Ullman] Compilers: Principles, Techniques and Tools, 1986
  * [Knuth]	      The Art of Computer Programming, part 3 (6.4)
+ * [Celis]	      Robin Hood Hashing, PhD thesis, University of Waterloo,
+ *		      1986
  */
 
 /*
@@ -59,48 +64,152 @@
  * which describes the current status.
  */
 
+/*
+ * A slot in the table holds the hash value of its key and a pointer to the
+ * entry, or NULL if the slot is free. Entries are allocated separately
+ * (together with a copy of their key) so that the pointers returned by
+ * hsearch_r() remain valid when other entries are added or removed, or the
+ * table grows.
+ */
 typedef struct _ENTRY {
-	int used;
-	ENTRY entry;
+	unsigned int hval;
+	ENTRY *entry;
 } _ENTRY;
 
 
-static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
-	int idx);
+static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep);
 
 /*
- * hcreate()
+ * The table uses open addressing with linear probing and Robin Hood
+ * insertion [Celis]: an entry being inserted takes over any slot whose
+ * occupant is closer to its own home slot (the one selected by its hash
+ * value) and the occupant moves on instead. This keeps probe sequences
+ * short even in a well-filled table, and lets a search give up as soon as
+ * it reaches an entry closer to home than the key would be. Deleted entries
+ * leave no tombstones behind; the entries after them are shifted back.
+ *
+ * The table size is a power of two and keys are hashed with xxh32().
+ */
+static unsigned int hhash(const char *key)
+{
+	return xxh32(key, strlen(key), 0);
+}
+
+/* Distance of the entry in slot idx from its home slot */
+static inline unsigned int hdist(struct hsearch_data *htab, unsigned int idx)
+{
+	return (idx - htab->table[idx].hval) & (htab->size - 1);
+}
+
+/*
+ * Find the slot holding key, or return -1 if there is none.
  */
+static int hfind(struct hsearch_data *htab, const char *key,
+		 unsigned int hval)
+{
+	unsigned int mask = htab->size - 1;
+	unsigned int idx = hval & mask;
+	unsigned int dist;
+
+	for (dist = 0; ; ++dist, idx = (idx + 1) & mask) {
+		_ENTRY *slot = &htab->table[idx];
+
+		if (!slot->entry || hdist(htab, idx) < dist)
+			return -1;
+		if (slot->hval == hval && !strcmp(key, slot->entry->key))
+			return idx;
+	}
+}
 
 /*
- * For the used double hash method the table size has to be a prime. To
- * correct the user given table size we need a prime test.  This trivial
- * algorithm is adequate because
- * a)  the code is (most probably) called a few times per program run and
- * b)  the number is small because the table must fit in the core
- * */
-static int isprime(unsigned int number)
+ * Put an entry into the table, which must have at least one free slot.
+ */
+static void hinsert(struct hsearch_data *htab, unsigned int hval, ENTRY *ep)
 {
-	/* no even number will be passed */
-	unsigned int div = 3;
+	unsigned int mask = htab->size - 1;
+	unsigned int idx = hval & mask;
+	unsigned int dist = 0;
+	_ENTRY cur = { .hval = hval, .entry = ep };
+
+	for (;; ++dist, idx = (idx + 1) & mask) {
+		_ENTRY *slot = &htab->table[idx];
+		unsigned int slot_dist;
+		_ENTRY tmp;
+
+		if (!slot->entry) {
+			*slot = cur;
+			return;
+		}
+
+		slot_dist = hdist(htab, idx);
+		if (slot_dist < dist) {
+			tmp = *slot;
+			*slot = cur;
+			cur = tmp;
+			dist = slot_dist;
+		}
+	}
+}
 
-	while (div * div < number && number % div != 0)
-		div += 2;
+/*
+ * Empty slot idx, moving back the entries which follow it.
+ */
+static void hremove(struct hsearch_data *htab, unsigned int idx)
+{
+	unsigned int mask = htab->size - 1;
+	unsigned int next = (idx + 1) & mask;
 
-	return number % div != 0;
+	while (htab->table[next].entry && hdist(htab, next)) {
+		htab->table[idx] = htab->table[next];
+		idx = next;
+		next = (next + 1) & mask;
+	}
+	htab->table[idx].hval = 0;
+	htab->table[idx].entry = NULL;
 }
 
+/*
+ * Double the size of the table. Only the slots are reallocated; the
+ * entries stay where they are.
+ */
+static int hgrow(struct hsearch_data *htab)
+{
+	_ENTRY *old = htab->table;
+	unsigned int old_size = htab->size;
+	unsigned int i;
+
+	htab->table = calloc(old_size * 2, sizeof(_ENTRY));
+	if (!htab->table) {
+		htab->table = old;
+		return -ENOMEM;
+	}
+	htab->size = old_size * 2;
+	debug("hgrow: table %p, size %d\n", htab, htab->size);
+
+	for (i = 0; i < old_size; ++i) {
+		if (old[i].entry)
+			hinsert(htab, old[i].hval, old[i].entry);
+	}
+	free(old);
+
+	return 0;
+}
+
+/*
+ * hcreate()
+ */
+
 /*
  * Before using the hash table we must allocate memory for it.
- * Test for an existing table are done. We allocate one element
- * more as the found prime number says. This is done for more effective
- * indexing as explained in the comment for the hsearch function.
- * The contents of the table is zeroed, especially the field used
- * becomes zero.
+ * Test for an existing table are done. The table is made large enough
+ * to hold nel entries without having to grow, but more can be added
+ * later. The contents of the table is zeroed, so all slots are free.
  */
 
 int hcreate_r(size_t nel, struct hsearch_data *htab)
 {
+	unsigned int size;
+
 	/* Test for correct arguments.  */
 	if (htab == NULL) {
 		__set_errno(EINVAL);
@@ -111,16 +220,14 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 	if (htab->table != NULL)
 		return 0;
 
-	/* Change nel to the first prime number not smaller as nel. */
-	nel |= 1;		/* make odd */
-	while (!isprime(nel))
-		nel += 2;
+	for (size = HTAB_MIN_SIZE; size * HTAB_LOAD / 8 < nel; size <<= 1)
+		;
 
-	htab->size = nel;
+	htab->size = size;
 	htab->filled = 0;
 
 	/* allocate memory and zero out */
-	htab->table = (_ENTRY *) calloc(htab->size + 1, sizeof(_ENTRY));
+	htab->table = (_ENTRY *) calloc(htab->size, sizeof(_ENTRY));
 	if (htab->table == NULL)
 		return 0;
 
@@ -149,12 +256,12 @@ void hdestroy_r(struct hsearch_data *htab)
 	}
 
 	/* free used memory */
-	for (i = 1; i <= htab->size; ++i) {
-		if (htab->table[i].used > 0) {
-			ENTRY *ep = &htab->table[i].entry;
+	for (i = 0; i < htab->size; ++i) {
+		ENTRY *ep = htab->table[i].entry;
 
-			free((void *)ep->key);
+		if (ep) {
 			free(ep->data);
+			free(ep);
 		}
 	}
 	free(htab->table);
@@ -168,19 +275,8 @@ void hdestroy_r(struct hsearch_data *htab)
  */
 
 /*
- * This is the search function. It uses double hashing with open addressing.
- * The argument item.key has to be a pointer to an zero terminated, most
- * probably strings of chars. The function for generating a number of the
- * strings is simple but fast. It can be replaced by a more complex function
- * like ajw (see [Aho,Sethi,Ullman]) if the needs are shown.
- *
- * We use an trick to speed up the lookup. The table is created by hcreate
- * with one more element available. This enables us to use the index zero
- * special. This index will never be used because we store the first hash
- * index in the field used where zero means not used. Every other value
- * means used. The used field can be used as a first fast comparison for
- * equality of the stored and the parameter value. This helps to prevent
- * unnecessary expensive calls of strcmp.
+ * This is the search function. The argument item.key has to be a pointer
+ * to an zero terminated, most probably strings of chars.
  *
  * This implementation differs from the standard library version of
  * this function in a number of ways:
@@ -194,10 +290,12 @@ void hdestroy_r(struct hsearch_data *htab)
  * - The standard implementation does not provide a way to update an
  *   existing entry.  This version will create a new entry or update an
  *   existing one when both "action == ENTER" and "item.data != NULL".
- * - Instead of returning 1 on success, we return the index into the
- *   internal hash table, which is also guaranteed to be positive.
- *   This allows us direct access to the found hash table slot for
- *   example for functions like hdelete().
+ * - The standard implementation cannot add more entries than were given
+ *   to hcreate(). This version grows the table as needed.
+ * - When an existing entry is found, we return its index into the
+ *   internal hash table plus one, which is also guaranteed to be
+ *   positive, instead of 1. The index is only valid until the table is
+ *   next changed.
  */
 
 int hmatch_r(const char *match, int last_idx, ENTRY ** retval,
@@ -206,12 +304,12 @@ int hmatch_r(const char *match, int last_idx, ENTRY ** retval,
 	unsigned int idx;
 	size_t key_len = strlen(match);
 
-	for (idx = last_idx + 1; idx < htab->size; ++idx) {
-		if (htab->table[idx].used <= 0)
-			continue;
-		if (!strncmp(match, htab->table[idx].entry.key, key_len)) {
-			*retval = &htab->table[idx].entry;
-			return idx;
+	for (idx = last_idx; idx < htab->size; ++idx) {
+		ENTRY *ep = htab->table[idx].entry;
+
+		if (ep && !strncmp(match, ep->key, key_len)) {
+			*retval = ep;
+			return idx + 1;
 		}
 	}
 
@@ -220,22 +318,23 @@ int hmatch_r(const char *match, int last_idx, ENTRY ** retval,
 	return 0;
 }
 
-/*
- * Compare an existing entry with the desired key, and overwrite if the action
- * is ENTER.  This is simply a helper function for hsearch_r().
- */
-static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
-	ENTRY **retval, struct hsearch_data *htab, int flag,
-	unsigned int hval, unsigned int idx)
+int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
+	      struct hsearch_data *htab, int flag)
 {
-	if (htab->table[idx].used == hval
-	    && strcmp(item.key, htab->table[idx].entry.key) == 0) {
+	unsigned int hval = hhash(item.key);
+	size_t len;
+	ENTRY *ep;
+	int idx;
+
+	idx = hfind(htab, item.key, hval);
+	if (idx >= 0) {
+		ep = htab->table[idx].entry;
+
 		/* Overwrite existing value? */
 		if ((action == ENTER) && (item.data != NULL)) {
 			/* check for permission */
 			if (htab->change_ok != NULL && htab->change_ok(
-			    &htab->table[idx].entry, item.data,
-			    env_op_overwrite, flag)) {
+			    ep, item.data, env_op_overwrite, flag)) {
 				debug("change_ok() rejected setting variable "
 					"%s, skipping it!\n", item.key);
 				__set_errno(EPERM);
@@ -244,8 +343,7 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 			}
 
 			/* If there is a callback, call it */
-			if (htab->table[idx].entry.callback &&
-			    htab->table[idx].entry.callback(item.key,
+			if (ep->callback && ep->callback(item.key,
 			    item.data, env_op_overwrite, flag)) {
 				debug("callback() rejected setting variable "
 					"%s, skipping it!\n", item.key);
@@ -254,170 +352,91 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 				return 0;
 			}
 
-			free(htab->table[idx].entry.data);
-			htab->table[idx].entry.data = strdup(item.data);
-			if (!htab->table[idx].entry.data) {
+			free(ep->data);
+			ep->data = strdup(item.data);
+			if (!ep->data) {
 				__set_errno(ENOMEM);
 				*retval = NULL;
 				return 0;
 			}
 		}
 		/* return found entry */
-		*retval = &htab->table[idx].entry;
-		return idx;
+		*retval = ep;
+		return idx + 1;
 	}
-	/* keep searching */
-	return -1;
-}
 
-int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
-	      struct hsearch_data *htab, int flag)
-{
-	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
-	unsigned int idx;
-	unsigned int first_deleted = 0;
-	int ret;
-
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
+	if (action != ENTER) {
+		__set_errno(ESRCH);
+		*retval = NULL;
+		return 0;
 	}
 
 	/*
-	 * First hash function:
-	 * simply take the modul but prevent zero.
+	 * Make room for the new entry. If the table cannot grow, carry on
+	 * as long as there is still a free slot left after this one.
 	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
-
-	/* The first index tried. */
-	idx = hval;
-
-	if (htab->table[idx].used) {
-		/*
-		 * Further action might be required according to the
-		 * action value.
-		 */
-		unsigned hval2;
-
-		if (htab->table[idx].used == USED_DELETED
-		    && !first_deleted)
-			first_deleted = idx;
-
-		ret = _compare_and_overwrite_entry(item, action, retval, htab,
-			flag, hval, idx);
-		if (ret != -1)
-			return ret;
-
-		/*
-		 * Second hash function:
-		 * as suggested in [Knuth]
-		 */
-		hval2 = 1 + hval % (htab->size - 2);
-
-		do {
-			/*
-			 * Because SIZE is prime this guarantees to
-			 * step through all available indices.
-			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
-
-			/*
-			 * If we visited all entries leave the loop
-			 * unsuccessfully.
-			 */
-			if (idx == hval)
-				break;
-
-			if (htab->table[idx].used == USED_DELETED
-			    && !first_deleted)
-				first_deleted = idx;
-
-			/* If entry is found use it. */
-			ret = _compare_and_overwrite_entry(item, action, retval,
-				htab, flag, hval, idx);
-			if (ret != -1)
-				return ret;
-		}
-		while (htab->table[idx].used != USED_FREE);
+	if ((htab->filled + 1) * 8 > htab->size * HTAB_LOAD &&
+	    hgrow(htab) && htab->filled + 2 > htab->size) {
+		__set_errno(ENOMEM);
+		*retval = NULL;
+		return 0;
 	}
 
-	/* An empty bucket has been found. */
-	if (action == ENTER) {
-		/*
-		 * If table is full and another entry should be
-		 * entered return with error.
-		 */
-		if (htab->filled == htab->size) {
-			__set_errno(ENOMEM);
-			*retval = NULL;
-			return 0;
-		}
+	/*
+	 * Create new entry;
+	 * create copies of item.key and item.data
+	 */
+	len = strlen(item.key) + 1;
+	ep = malloc(sizeof(*ep) + len);
+	if (!ep) {
+		__set_errno(ENOMEM);
+		*retval = NULL;
+		return 0;
+	}
+	ep->key = memcpy(ep + 1, item.key, len);
+	ep->data = strdup(item.data);
+	if (!ep->data) {
+		free(ep);
+		__set_errno(ENOMEM);
+		*retval = NULL;
+		return 0;
+	}
+	ep->callback = NULL;
+	ep->flags = 0;
 
-		/*
-		 * Create new entry;
-		 * create copies of item.key and item.data
-		 */
-		if (first_deleted)
-			idx = first_deleted;
-
-		htab->table[idx].used = hval;
-		htab->table[idx].entry.key = strdup(item.key);
-		htab->table[idx].entry.data = strdup(item.data);
-		if (!htab->table[idx].entry.key ||
-		    !htab->table[idx].entry.data) {
-			__set_errno(ENOMEM);
-			*retval = NULL;
-			return 0;
-		}
+	hinsert(htab, hval, ep);
+	++htab->filled;
 
-		++htab->filled;
-
-		/* This is a new entry, so look up a possible callback */
-		env_callback_init(&htab->table[idx].entry);
-		/* Also look for flags */
-		env_flags_init(&htab->table[idx].entry);
-
-		/* check for permission */
-		if (htab->change_ok != NULL && htab->change_ok(
-		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
-			debug("change_ok() rejected setting variable "
-				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
-			__set_errno(EPERM);
-			*retval = NULL;
-			return 0;
-		}
+	/* This is a new entry, so look up a possible callback */
+	env_callback_init(ep);
+	/* Also look for flags */
+	env_flags_init(ep);
 
-		/* If there is a callback, call it */
-		if (htab->table[idx].entry.callback &&
-		    htab->table[idx].entry.callback(item.key, item.data,
-		    env_op_create, flag)) {
-			debug("callback() rejected setting variable "
-				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
-			__set_errno(EINVAL);
-			*retval = NULL;
-			return 0;
-		}
+	/* check for permission */
+	if (htab->change_ok != NULL && htab->change_ok(
+	    ep, item.data, env_op_create, flag)) {
+		debug("change_ok() rejected setting variable "
+			"%s, skipping it!\n", item.key);
+		_hdelete(item.key, htab, ep);
+		__set_errno(EPERM);
+		*retval = NULL;
+		return 0;
+	}
 
-		/* return new entry */
-		*retval = &htab->table[idx].entry;
-		return 1;
+	/* If there is a callback, call it */
+	if (ep->callback &&
+	    ep->callback(item.key, item.data, env_op_create, flag)) {
+		debug("callback() rejected setting variable "
+			"%s, skipping it!\n", item.key);
+		_hdelete(item.key, htab, ep);
+		__set_errno(EINVAL);
+		*retval = NULL;
+		return 0;
 	}
 
-	__set_errno(ESRCH);
-	*retval = NULL;
-	return 0;
+	/* return new entry */
+	*retval = ep;
+	return 1;
 }
 
 
@@ -431,16 +450,23 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
  * do that.
  */
 
-static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
-	int idx)
+static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep)
 {
+	int idx;
+
+	/*
+	 * Look the entry up again, since a callback may have changed the
+	 * table and moved it to another slot.
+	 */
+	idx = hfind(htab, ep->key, hhash(ep->key));
+	if (idx < 0)
+		return;
+
 	/* free used ENTRY */
 	debug("hdelete: DELETING key \"%s\"\n", key);
-	free((void *)ep->key);
+	hremove(htab, idx);
 	free(ep->data);
-	ep->callback = NULL;
-	ep->flags = 0;
-	htab->table[idx].used = USED_DELETED;
+	free(ep);
 
 	--htab->filled;
 }
@@ -470,15 +496,14 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* If there is a callback, call it */
-	if (htab->table[idx].entry.callback &&
-	    htab->table[idx].entry.callback(key, NULL, env_op_delete, flag)) {
+	if (ep->callback && ep->callback(key, NULL, env_op_delete, flag)) {
 		debug("callback() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EINVAL);
 		return 0;
 	}
 
-	_hdelete(key, htab, ep, idx);
+	_hdelete(key, htab, ep);
 
 	return 1;
 }
@@ -596,7 +621,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		 char **resp, size_t size,
 		 int argc, char * const argv[])
 {
-	ENTRY *list[htab->size];
+	ENTRY *list[htab->filled];
 	char *res, *p;
 	size_t totlen;
 	int i, n;
@@ -614,10 +639,10 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	 * search used entries,
 	 * save addresses and compute total length
 	 */
-	for (i = 1, n = 0, totlen = 0; i <= htab->size; ++i) {
+	for (i = 0, n = 0, totlen = 0; i < htab->size; ++i) {
+		ENTRY *ep = htab->table[i].entry;
 
-		if (htab->table[i].used > 0) {
-			ENTRY *ep = &htab->table[i].entry;
+		if (ep) {
 			int found = match_entry(ep, flag, argc, argv);
 
 			if ((argc > 0) && (found == 0))
@@ -833,7 +858,8 @@ int himport_r(struct hsearch_data *htab,
 	 * environment size), so we clip it to a reasonable value.
 	 * On the other hand we need to add some more entries for free
 	 * space when importing very small buffers. Both boundaries can
-	 * be overwritten in the board config file if needed.
+	 * be overwritten in the board config file if needed. This only
+	 * sets the initial size: the table grows if more entries are added.
 	 */
 
 	if (!htab->table) {
@@ -981,9 +1007,9 @@ int hwalk_r(struct hsearch_data *htab, int (*callback)(ENTRY *))
 	int i;
 	int retval;
 
-	for (i = 1; i <= htab->size; ++i) {
-		if (htab->table[i].used > 0) {
-			retval = callback(&htab->table[i].entry);
+	for (i = 0; i < htab->size; ++i) {
+		if (htab->table[i].entry) {
+			retval = callback(htab->table[i].entry);
 			if (retval)
 				return retval;
 		}
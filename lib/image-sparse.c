@@ -44,218 +44,444 @@
 
 #include <linux/math64.h>
 
+/* What the stream expects next */
+enum sparse_state {
+	SPARSE_FILE_HDR,
+	SPARSE_CHUNK_HDR,
+	SPARSE_FILL_VAL,
+	SPARSE_RAW,
+	SPARSE_DONE,
+};
+
 static void default_log(const char *ignored, char *response) {}
 
-int write_sparse_image(struct sparse_storage *info,
-		       const char *part_name, void *data, char *response)
+static int sparse_fail(struct sparse_stream *s, const char *msg, int ret)
+{
+	s->info->mssg(msg, s->response);
+	s->err = ret;
+
+	return ret;
+}
+
+/* Get the number of device blocks in the current chunk */
+static lbaint_t sparse_chunk_blks(struct sparse_stream *s)
+{
+	return (lbaint_t)le32_to_cpu(s->chunk_hdr.chunk_sz) *
+		(le32_to_cpu(s->hdr.blk_sz) / s->info->blksz);
+}
+
+static int sparse_write_blocks(struct sparse_stream *s, const void *data,
+			       lbaint_t blkcnt)
 {
-	lbaint_t blk;
-	lbaint_t blkcnt;
+	struct sparse_storage *info = s->info;
 	lbaint_t blks;
-	uint32_t bytes_written = 0;
-	unsigned int chunk;
-	unsigned int offset;
-	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
-	uint32_t fill_val;
-	sparse_header_t *sparse_header;
-	chunk_header_t *chunk_header;
-	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
-
-	/* Read and skip over sparse image header */
-	sparse_header = (sparse_header_t *)data;
-
-	data += sparse_header->file_hdr_sz;
-	if (sparse_header->file_hdr_sz > sizeof(sparse_header_t)) {
-		/*
-		 * Skip the remaining bytes in a header that is longer than
-		 * we expected.
-		 */
-		data += (sparse_header->file_hdr_sz - sizeof(sparse_header_t));
+
+	blks = info->write(info, s->blk, blkcnt, data);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (blks < blkcnt) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n", __func__,
+		       "Write failed, block #", s->blk, blks);
+		return sparse_fail(s, "flash write failure", -EIO);
 	}
+	s->blk += blks;
+	s->bytes_written += blkcnt * info->blksz;
 
-	if (!info->mssg)
-		info->mssg = default_log;
+	return 0;
+}
+
+static int sparse_flush(struct sparse_stream *s)
+{
+	int ret;
+
+	if (!s->pending)
+		return 0;
+	ret = sparse_write_blocks(s, s->buf, s->pending / s->info->blksz);
+	s->pending = 0;
+
+	return ret;
+}
+
+/* Check that @blkcnt more blocks fit after those already buffered */
+static int sparse_check_space(struct sparse_stream *s, lbaint_t blkcnt)
+{
+	struct sparse_storage *info = s->info;
+
+	if (s->blk + s->pending / info->blksz + blkcnt >
+	    info->start + info->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		return sparse_fail(s, "Request would exceed partition size!",
+				   -ENOSPC);
+	}
+
+	return 0;
+}
+
+static int sparse_raw(struct sparse_stream *s, const u8 *data, size_t len)
+{
+	lbaint_t blksz = s->info->blksz;
+	size_t n;
+	int ret;
+
+	while (len) {
+		/* Write large runs directly, unless there is data waiting */
+		if (!s->pending && len >= s->buf_size) {
+			n = len - len % blksz;
+			ret = sparse_write_blocks(s, data, n / blksz);
+		} else {
+			n = min(len, s->buf_size - s->pending);
+			memcpy(s->buf + s->pending, data, n);
+			s->pending += n;
+			ret = s->pending == s->buf_size ? sparse_flush(s) : 0;
+		}
+		if (ret)
+			return ret;
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static void sparse_fill_buf(void *buf, u32 val, size_t len)
+{
+	u32 *ptr = buf;
+	size_t i;
+
+	for (i = 0; i < len / sizeof(val); i++)
+		ptr[i] = val;
+}
+
+static int sparse_fill_blocks(struct sparse_stream *s, lbaint_t blkcnt)
+{
+	lbaint_t blksz = s->info->blksz;
+	lbaint_t buf_blks = s->buf_size / blksz;
+	lbaint_t n;
+	int ret;
+
+	while (blkcnt) {
+		/* Fill the whole buffer once and write it repeatedly */
+		if (!s->pending && blkcnt >= buf_blks) {
+			sparse_fill_buf(s->buf, s->fill_val, s->buf_size);
+			do {
+				ret = sparse_write_blocks(s, s->buf, buf_blks);
+				if (ret)
+					return ret;
+				blkcnt -= buf_blks;
+			} while (blkcnt >= buf_blks);
+			continue;
+		}
+		n = min_t(lbaint_t, blkcnt, (s->buf_size - s->pending) / blksz);
+		sparse_fill_buf(s->buf + s->pending, s->fill_val, n * blksz);
+		s->pending += n * blksz;
+		blkcnt -= n;
+		if (s->pending == s->buf_size) {
+			ret = sparse_flush(s);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Fill @blkcnt blocks with the fill value. Zeroes are erased rather than
+ * written where the storage allows it, which is much faster. Only whole erase
+ * groups are erased; the blocks either side are written.
+ */
+static int sparse_fill(struct sparse_stream *s, lbaint_t blkcnt)
+{
+	struct sparse_storage *info = s->info;
+	lbaint_t head, count, blks;
+	u32 rem;
+	int ret;
+
+	if (s->fill_val || !info->erase || !info->erase_grp)
+		return sparse_fill_blocks(s, blkcnt);
+
+	div_u64_rem(s->blk + s->pending / info->blksz, info->erase_grp, &rem);
+	head = rem ? info->erase_grp - rem : 0;
+	if (blkcnt < head + info->erase_grp)
+		return sparse_fill_blocks(s, blkcnt);
+	div_u64_rem(blkcnt - head, info->erase_grp, &rem);
+	count = blkcnt - head - rem;
+
+	ret = sparse_fill_blocks(s, head);
+	if (!ret)
+		ret = sparse_flush(s);
+	if (ret)
+		return ret;
+
+	blks = info->erase(info, s->blk, count);
+	if (blks < count) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n", __func__,
+		       "Erase failed, block #", s->blk, blks);
+		return sparse_fail(s, "flash erase failure", -EIO);
+	}
+	s->blk += blks;
+	s->bytes_written += count * info->blksz;
+
+	return sparse_fill_blocks(s, rem);
+}
+
+static void sparse_next_chunk(struct sparse_stream *s)
+{
+	s->total_blocks += le32_to_cpu(s->chunk_hdr.chunk_sz);
+	s->chunk++;
+	if (s->chunk == le32_to_cpu(s->hdr.total_chunks))
+		s->state = SPARSE_DONE;
+	else
+		s->state = SPARSE_CHUNK_HDR;
+}
+
+static int sparse_start(struct sparse_stream *s)
+{
+	sparse_header_t *hdr = &s->hdr;
+	u32 offset;
 
 	debug("=== Sparse Image Header ===\n");
-	debug("magic: 0x%x\n", sparse_header->magic);
-	debug("major_version: 0x%x\n", sparse_header->major_version);
-	debug("minor_version: 0x%x\n", sparse_header->minor_version);
-	debug("file_hdr_sz: %d\n", sparse_header->file_hdr_sz);
-	debug("chunk_hdr_sz: %d\n", sparse_header->chunk_hdr_sz);
-	debug("blk_sz: %d\n", sparse_header->blk_sz);
-	debug("total_blks: %d\n", sparse_header->total_blks);
-	debug("total_chunks: %d\n", sparse_header->total_chunks);
+	debug("magic: 0x%x\n", le32_to_cpu(hdr->magic));
+	debug("major_version: 0x%x\n", le16_to_cpu(hdr->major_version));
+	debug("minor_version: 0x%x\n", le16_to_cpu(hdr->minor_version));
+	debug("file_hdr_sz: %d\n", le16_to_cpu(hdr->file_hdr_sz));
+	debug("chunk_hdr_sz: %d\n", le16_to_cpu(hdr->chunk_hdr_sz));
+	debug("blk_sz: %d\n", le32_to_cpu(hdr->blk_sz));
+	debug("total_blks: %d\n", le32_to_cpu(hdr->total_blks));
+	debug("total_chunks: %d\n", le32_to_cpu(hdr->total_chunks));
+
+	if (!is_sparse_image(hdr))
+		return sparse_fail(s, "not a sparse image", -EINVAL);
+	if (le16_to_cpu(hdr->file_hdr_sz) < sizeof(sparse_header_t) ||
+	    le16_to_cpu(hdr->chunk_hdr_sz) < sizeof(chunk_header_t))
+		return sparse_fail(s, "sparse image header size issue",
+				   -EINVAL);
 
 	/*
 	 * Verify that the sparse block size is a multiple of our
 	 * storage backend block size
 	 */
-	div_u64_rem(sparse_header->blk_sz, info->blksz, &offset);
+	div_u64_rem(le32_to_cpu(hdr->blk_sz), s->info->blksz, &offset);
 	if (offset) {
 		printf("%s: Sparse image block size issue [%u]\n",
-		       __func__, sparse_header->blk_sz);
-		info->mssg("sparse image block size issue", response);
-		return -1;
+		       __func__, le32_to_cpu(hdr->blk_sz));
+		return sparse_fail(s, "sparse image block size issue",
+				   -EINVAL);
 	}
 
 	puts("Flashing Sparse Image\n");
 
-	/* Start processing chunks */
-	blk = info->start;
-	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
-		/* Read and skip over chunk header */
-		chunk_header = (chunk_header_t *)data;
-		data += sizeof(chunk_header_t);
-
-		if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
-			debug("=== Chunk Header ===\n");
-			debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
-			debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
-			debug("total_size: 0x%x\n", chunk_header->total_sz);
-		}
+	/* Skip the remaining bytes in a header that is longer than expected */
+	s->skip = le16_to_cpu(hdr->file_hdr_sz) - sizeof(sparse_header_t);
+	s->state = hdr->total_chunks ? SPARSE_CHUNK_HDR : SPARSE_DONE;
 
-		if (sparse_header->chunk_hdr_sz > sizeof(chunk_header_t)) {
-			/*
-			 * Skip the remaining bytes in a header that is longer
-			 * than we expected.
-			 */
-			data += (sparse_header->chunk_hdr_sz -
-				 sizeof(chunk_header_t));
-		}
+	return 0;
+}
 
-		chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
-		blkcnt = chunk_data_sz / info->blksz;
-		switch (chunk_header->chunk_type) {
-		case CHUNK_TYPE_RAW:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
-				info->mssg("Bogus chunk size for chunk type Raw",
-					   response);
-				return -1;
-			}
+static int sparse_chunk(struct sparse_stream *s)
+{
+	chunk_header_t *chunk_header = &s->chunk_hdr;
+	u32 chunk_hdr_sz = le16_to_cpu(s->hdr.chunk_hdr_sz);
+	u32 total_sz = le32_to_cpu(chunk_header->total_sz);
+	u64 chunk_data_sz;
+	int ret;
 
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
+	if (le16_to_cpu(chunk_header->chunk_type) != CHUNK_TYPE_RAW) {
+		debug("=== Chunk Header ===\n");
+		debug("chunk_type: 0x%x\n",
+		      le16_to_cpu(chunk_header->chunk_type));
+		debug("chunk_data_sz: 0x%x\n",
+		      le32_to_cpu(chunk_header->chunk_sz));
+		debug("total_size: 0x%x\n", total_sz);
+	}
 
-			blks = info->write(info, blk, blkcnt, data);
-			/* blks might be > blkcnt (eg. NAND bad-blocks) */
-			if (blks < blkcnt) {
-				printf("%s: %s" LBAFU " [" LBAFU "]\n",
-				       __func__, "Write failed, block #",
-				       blk, blks);
-				info->mssg("flash write failure", response);
-				return -1;
-			}
-			blk += blks;
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
-			break;
-
-		case CHUNK_TYPE_FILL:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
-				info->mssg("Bogus chunk size for chunk type FILL", response);
-				return -1;
-			}
+	/* Skip the remaining bytes in a header that is longer than expected */
+	s->skip = chunk_hdr_sz - sizeof(chunk_header_t);
 
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
-			}
+	chunk_data_sz = (u64)le32_to_cpu(s->hdr.blk_sz) *
+		le32_to_cpu(chunk_header->chunk_sz);
+	switch (le16_to_cpu(chunk_header->chunk_type)) {
+	case CHUNK_TYPE_RAW:
+		if (total_sz != chunk_hdr_sz + chunk_data_sz)
+			return sparse_fail(s, "Bogus chunk size for chunk type Raw",
+					   -EINVAL);
+		ret = sparse_check_space(s, sparse_chunk_blks(s));
+		if (ret)
+			return ret;
+		s->data_left = chunk_data_sz;
+		if (s->data_left)
+			s->state = SPARSE_RAW;
+		else
+			sparse_next_chunk(s);
+		break;
 
-			fill_val = *(uint32_t *)data;
-			data = (char *)data + sizeof(uint32_t);
-
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
+	case CHUNK_TYPE_FILL:
+		if (total_sz != chunk_hdr_sz + sizeof(u32))
+			return sparse_fail(s, "Bogus chunk size for chunk type FILL",
+					   -EINVAL);
+		ret = sparse_check_space(s, sparse_chunk_blks(s));
+		if (ret)
+			return ret;
+		s->state = SPARSE_FILL_VAL;
+		break;
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
-			break;
-
-		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
-			total_blocks += chunk_header->chunk_sz;
-			break;
-
-		case CHUNK_TYPE_CRC32:
-			if (chunk_header->total_sz !=
-			    sparse_header->chunk_hdr_sz) {
-				info->mssg("Bogus chunk size for chunk type Dont Care",
-					   response);
-				return -1;
+	case CHUNK_TYPE_DONT_CARE:
+		ret = sparse_flush(s);
+		if (ret)
+			return ret;
+		s->blk += s->info->reserve(s->info, s->blk,
+					   sparse_chunk_blks(s));
+		sparse_next_chunk(s);
+		break;
+
+	case CHUNK_TYPE_CRC32:
+		/* The checksum is optional; it is not checked */
+		if (total_sz != chunk_hdr_sz &&
+		    total_sz != chunk_hdr_sz + sizeof(u32))
+			return sparse_fail(s, "Bogus chunk size for chunk type CRC32",
+					   -EINVAL);
+		s->skip += total_sz - chunk_hdr_sz;
+		sparse_next_chunk(s);
+		break;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       le16_to_cpu(chunk_header->chunk_type));
+		return sparse_fail(s, "Unknown chunk type", -EINVAL);
+	}
+
+	return 0;
+}
+
+/*
+ * Collect @want bytes of a header at @dst, setting *@usedp to the number of
+ * bytes used from @data. Returns true when all the bytes are present.
+ */
+static bool sparse_collect(struct sparse_stream *s, void *dst, uint want,
+			   const u8 *data, size_t len, size_t *usedp)
+{
+	size_t n = min_t(size_t, want - s->collect, len);
+
+	memcpy(dst + s->collect, data, n);
+	s->collect += n;
+	*usedp = n;
+	if (s->collect < want)
+		return false;
+	s->collect = 0;
+
+	return true;
+}
+
+int sparse_stream_init(struct sparse_stream *strm, struct sparse_storage *info,
+		       const char *part_name, char *response)
+{
+	struct sparse_stream *s = strm;
+
+	if (!info->mssg)
+		info->mssg = default_log;
+
+	memset(s, '\0', sizeof(*s));
+	s->info = info;
+	s->part_name = part_name;
+	s->response = response;
+	s->state = SPARSE_FILE_HDR;
+	s->blk = info->start;
+
+	/* The buffer must hold a whole number of blocks */
+	s->buf_size = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz *
+		info->blksz;
+	if (!s->buf_size)
+		s->buf_size = info->blksz;
+	s->buf = memalign(ARCH_DMA_MINALIGN,
+			  ROUNDUP(s->buf_size, ARCH_DMA_MINALIGN));
+	if (!s->buf) {
+		info->mssg("Malloc failed for sparse write buffer", response);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+int sparse_stream_write(struct sparse_stream *strm, const void *data,
+			size_t len)
+{
+	struct sparse_stream *s = strm;
+	const u8 *ptr = data;
+	size_t n;
+	int ret = 0;
+
+	while (len && !s->err && s->state != SPARSE_DONE) {
+		if (s->skip) {
+			n = min_t(size_t, len, s->skip);
+			s->skip -= n;
+		} else if (s->state == SPARSE_FILE_HDR) {
+			if (sparse_collect(s, &s->hdr, sizeof(s->hdr), ptr,
+					   len, &n))
+				ret = sparse_start(s);
+		} else if (s->state == SPARSE_CHUNK_HDR) {
+			if (sparse_collect(s, &s->chunk_hdr,
+					   sizeof(s->chunk_hdr), ptr, len, &n))
+				ret = sparse_chunk(s);
+		} else if (s->state == SPARSE_FILL_VAL) {
+			if (sparse_collect(s, &s->fill_val,
+					   sizeof(s->fill_val), ptr, len, &n)) {
+				ret = sparse_fill(s, sparse_chunk_blks(s));
+				if (!ret)
+					sparse_next_chunk(s);
 			}
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
-			break;
-
-		default:
-			printf("%s: Unknown chunk type: %x\n", __func__,
-			       chunk_header->chunk_type);
-			info->mssg("Unknown chunk type", response);
-			return -1;
+		} else {
+			n = min_t(size_t, len, s->data_left);
+			ret = sparse_raw(s, ptr, n);
+			s->data_left -= n;
+			if (!ret && !s->data_left)
+				sparse_next_chunk(s);
 		}
+		ptr += n;
+		len -= n;
 	}
 
+	return s->err;
+}
+
+int sparse_stream_finish(struct sparse_stream *strm)
+{
+	struct sparse_stream *s = strm;
+	int ret = s->err;
+
+	if (!ret && s->state != SPARSE_DONE)
+		ret = sparse_fail(s, "sparse image is truncated", -EINVAL);
+	if (!ret)
+		ret = sparse_flush(s);
+	free(s->buf);
+	s->buf = NULL;
+	if (ret)
+		return ret;
+
 	debug("Wrote %d blocks, expected to write %d blocks\n",
-	      total_blocks, sparse_header->total_blks);
-	printf("........ wrote %u bytes to '%s'\n", bytes_written, part_name);
+	      s->total_blocks, le32_to_cpu(s->hdr.total_blks));
+	printf("........ wrote %llu bytes to '%s'\n", s->bytes_written,
+	       s->part_name);
 
-	if (total_blocks != sparse_header->total_blks) {
-		info->mssg("sparse image write failure", response);
-		return -1;
-	}
+	if (s->total_blocks != le32_to_cpu(s->hdr.total_blks))
+		return sparse_fail(s, "sparse image write failure", -EIO);
 
 	return 0;
 }
+
+int write_sparse_image(struct sparse_storage *info,
+		       const char *part_name, void *data, char *response)
+{
+	struct sparse_stream strm;
+	int ret;
+
+	ret = sparse_stream_init(&strm, info, part_name, response);
+	if (ret)
+		return ret;
+
+	/*
+	 * The size of the image is not known, but nothing beyond the last
+	 * chunk is read, so offer the rest of the address space
+	 */
+	sparse_stream_write(&strm, data, ~(ulong)0 - (ulong)data);
+
+	return sparse_stream_finish(&strm);
+}
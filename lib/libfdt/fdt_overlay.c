@@ -1,2 +1,17 @@
 #include <linux/libfdt_env.h>
 #include "../../scripts/dtc/libfdt/fdt_overlay.c"
+
+/* U-Boot local hacks */
+
+int fdt_overlay_prepare(void *fdto, uint32_t delta)
+{
+	int ret;
+
+	FDT_CHECK_HEADER(fdto);
+
+	ret = overlay_adjust_local_phandles(fdto, delta);
+	if (ret)
+		return ret;
+
+	return overlay_update_local_references(fdto, delta);
+}
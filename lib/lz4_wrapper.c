@@ -6,6 +6,9 @@
 #include <common.h>
 #include <compiler.h>
 #include <image.h>
+#include <malloc.h>
+#include <u-boot/lz4.h>
+#include <asm/unaligned.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
 
@@ -61,77 +64,277 @@ struct lz4_block_header {
 	/* + u32 block_checksum iff has_block_checksum is set */
 } __packed;
 
+/* Get the number of input bytes used by the block at @src */
+static size_t lz4_block_len(const struct ulz4f_frame *frame, const void *src)
+{
+	struct lz4_block_header b;
+
+	b.raw = get_unaligned_le32(src);
+	if (!b.size)
+		return sizeof(b);
+
+	return sizeof(b) + b.size + (frame->block_checksum ? sizeof(u32) : 0);
+}
+
+int ulz4f_parse_header(const void *src, size_t srcn, struct ulz4f_frame *frame)
+{
+	const struct lz4_frame_header *h = src;
+	uint len = sizeof(*h) + sizeof(u8);
+
+	if (srcn < len)
+		return -EINVAL;	/* input overrun */
+
+	/* We assume there's always only a single, standard frame. */
+	if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
+		return -EPROTONOSUPPORT;	/* unknown format */
+	if (h->reserved0 || h->reserved1 || h->reserved2)
+		return -EINVAL;	/* reserved must be zero */
+	if (!h->independent_blocks)
+		return -EPROTONOSUPPORT; /* we can't support this yet */
+	if (h->max_block_size < 4)
+		return -EINVAL;	/* 64KB is the smallest */
+
+	frame->max_block = 1 << (8 + 2 * h->max_block_size);
+	frame->block_checksum = h->has_block_checksum;
+	frame->content_checksum = h->has_content_checksum;
+	frame->content_size = 0;
+	if (h->has_content_size) {
+		len += sizeof(u64);
+		if (srcn < len)
+			return -EINVAL;
+		frame->content_size = get_unaligned_le64(src + sizeof(*h));
+	}
+	frame->hdr_len = len;
+
+	return len;
+}
+
+int ulz4f_block_size(const struct ulz4f_frame *frame, const void *src,
+		     size_t srcn, size_t *in_lenp, size_t *out_lenp)
+{
+	struct lz4_block_header b;
+
+	*in_lenp = 0;
+	if (srcn < sizeof(b))
+		return -EINVAL;		/* input overrun */
+	b.raw = get_unaligned_le32(src);
+	*in_lenp = lz4_block_len(frame, src);
+	if (*in_lenp > srcn)
+		return -EINVAL;		/* input overrun */
+	*out_lenp = b.not_compressed ? b.size : frame->max_block;
+
+	return b.size ? 0 : 1;
+}
+
+int ulz4f_decode_block(const struct ulz4f_frame *frame, const void *src,
+		       size_t srcn, void *dst, size_t dstn, size_t *in_lenp,
+		       size_t *out_lenp)
+{
+	struct lz4_block_header b;
+	const void *in = src;
+	size_t max_len;
+	int ret;
+
+	*out_lenp = 0;
+	ret = ulz4f_block_size(frame, src, srcn, in_lenp, &max_len);
+	if (ret)
+		return ret;
+	b.raw = get_unaligned_le32(in);
+	in += sizeof(b);
+
+	if (b.not_compressed) {
+		size_t size = min((size_t)b.size, dstn);
+
+		/* the output may overlap the input, if in place */
+		memmove(dst, in, size);
+		*out_lenp = size;
+		if (size < b.size)
+			return -ENOBUFS;	/* output overrun */
+	} else {
+		/* constant folding essential, do not touch params! */
+		ret = LZ4_decompress_generic(in, dst, b.size,
+					     dstn, endOnInputSize,
+					     full, 0, noDict, dst, NULL, 0);
+		if (ret < 0)
+			return -EPROTO;		/* decompression error */
+		*out_lenp = ret;
+	}
+
+	return 0;
+}
+
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 {
-	const void *end = dst + *dstn;
+	struct ulz4f_frame frame;
+	size_t in_len, out_len;
 	const void *in = src;
-	void *out = dst;
-	int has_block_checksum;
+	size_t out = 0;
 	int ret;
-	*dstn = 0;
-
-	{ /* With in-place decompression the header may become invalid later. */
-		const struct lz4_frame_header *h = in;
-
-		if (srcn < sizeof(*h) + sizeof(u64) + sizeof(u8))
-			return -EINVAL;	/* input overrun */
-
-		/* We assume there's always only a single, standard frame. */
-		if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
-			return -EPROTONOSUPPORT;	/* unknown format */
-		if (h->reserved0 || h->reserved1 || h->reserved2)
-			return -EINVAL;	/* reserved must be zero */
-		if (!h->independent_blocks)
-			return -EPROTONOSUPPORT; /* we can't support this yet */
-		has_block_checksum = h->has_block_checksum;
-
-		in += sizeof(*h);
-		if (h->has_content_size)
-			in += sizeof(u64);
-		in += sizeof(u8);
+
+	/* With in-place decompression the header may become invalid later. */
+	if (srcn < ULZ4F_MAX_HDR_SIZE) {
+		*dstn = 0;
+		return -EINVAL;		/* input overrun */
+	}
+	ret = ulz4f_parse_header(src, srcn, &frame);
+	if (ret < 0) {
+		*dstn = 0;
+		return ret;
 	}
+	in += ret;
 
-	while (1) {
-		struct lz4_block_header b;
+	do {
+		ret = ulz4f_decode_block(&frame, in, src + srcn - in, dst + out,
+					 *dstn - out, &in_len, &out_len);
+		in += in_len;
+		out += out_len;
+	} while (!ret);
 
-		b.raw = le32_to_cpu(*(u32 *)in);
-		in += sizeof(struct lz4_block_header);
+	*dstn = out;
+	return ret == 1 ? 0 : ret;
+}
 
-		if (in - src + b.size > srcn) {
-			ret = -EINVAL;		/* input overrun */
-			break;
-		}
+void ulz4f_stream_init(struct ulz4f_stream *strm, void *dst, size_t dst_size)
+{
+	memset(strm, '\0', sizeof(*strm));
+	strm->dst = dst;
+	strm->dst_size = dst_size;
+}
 
-		if (!b.size) {
-			ret = 0;	/* decompression successful */
-			break;
-		}
+/* Decompress a block, returning 1 at the end of the frame */
+static int lz4_stream_block(struct ulz4f_stream *strm, const void *src,
+			    size_t srcn)
+{
+	size_t in_len, out_len;
+	int ret;
 
-		if (b.not_compressed) {
-			size_t size = min((ptrdiff_t)b.size, end - out);
-			memcpy(out, in, size);
-			out += size;
-			if (size < b.size) {
-				ret = -ENOBUFS;	/* output overrun */
-				break;
-			}
+	ret = ulz4f_decode_block(&strm->frame, src, srcn, strm->dst + strm->out,
+				 strm->dst_size - strm->out, &in_len, &out_len);
+	strm->out += out_len;
+	if (ret == 1) {
+		strm->done = true;
+		if (strm->frame.content_checksum)
+			strm->skip = sizeof(u32);
+	}
+
+	return ret;
+}
+
+/* Copy up to @want bytes into a buffer, returning the number copied */
+static size_t lz4_gather(u8 *buf, size_t *lenp, size_t want,
+			 const void *src, size_t srcn)
+{
+	size_t size = min(want - *lenp, srcn);
+
+	memcpy(buf + *lenp, src, size);
+	*lenp += size;
+
+	return size;
+}
+
+/* Collect the frame header, returning the number of bytes used */
+static int lz4_stream_header(struct ulz4f_stream *strm, const void *src,
+			     size_t srcn)
+{
+	const struct lz4_frame_header *h = (void *)strm->hdr;
+	size_t min_len = sizeof(*h) + sizeof(u8);
+	size_t used;
+	int ret;
+
+	used = lz4_gather(strm->hdr, &strm->hdr_len, min_len, src, srcn);
+	if (strm->hdr_len < min_len)
+		return used;
+	if (h->has_content_size) {
+		used += lz4_gather(strm->hdr, &strm->hdr_len,
+				   min_len + sizeof(u64), src + used,
+				   srcn - used);
+		if (strm->hdr_len < min_len + sizeof(u64))
+			return used;
+	}
+	ret = ulz4f_parse_header(strm->hdr, strm->hdr_len, &strm->frame);
+	if (ret < 0)
+		return ret;
+
+	return used;
+}
+
+/* Copy a block to the buffer until it is complete, returning bytes used */
+static int lz4_stream_buffer(struct ulz4f_stream *strm, const void *src,
+			     size_t srcn)
+{
+	size_t used = 0, len;
+	int ret;
+
+	if (!strm->buf) {
+		strm->buf_size = sizeof(u32) + strm->frame.max_block +
+			sizeof(u32);
+		strm->buf = malloc(strm->buf_size);
+		if (!strm->buf)
+			return -ENOMEM;
+	}
+	if (strm->buf_len < sizeof(u32)) {
+		used = lz4_gather(strm->buf, &strm->buf_len, sizeof(u32), src,
+				  srcn);
+		if (strm->buf_len < sizeof(u32))
+			return used;
+	}
+	len = lz4_block_len(&strm->frame, strm->buf);
+	if (len > strm->buf_size)
+		return -EINVAL;		/* block too large */
+	used += lz4_gather(strm->buf, &strm->buf_len, len, src + used,
+			   srcn - used);
+	if (strm->buf_len == len) {
+		strm->buf_len = 0;
+		ret = lz4_stream_block(strm, strm->buf, len);
+		if (ret < 0)
+			return ret;
+	}
+
+	return used;
+}
+
+int ulz4f_stream_decompress(struct ulz4f_stream *strm, const void *src,
+			    size_t srcn)
+{
+	size_t len;
+	int ret;
+
+	while (!strm->done || strm->skip) {
+		if (!srcn)
+			return 0;
+
+		/* see if the whole of the next block is here */
+		len = 0;
+		if (!strm->done && strm->frame.hdr_len && !strm->buf_len &&
+		    srcn >= sizeof(u32))
+			len = lz4_block_len(&strm->frame, src);
+
+		if (strm->done) {
+			ret = min((size_t)strm->skip, srcn);
+			strm->skip -= ret;
+		} else if (!strm->frame.hdr_len) {
+			ret = lz4_stream_header(strm, src, srcn);
+		} else if (len && len <= srcn) {
+			/* use the block where it is, without copying it */
+			ret = lz4_stream_block(strm, src, len);
+			if (ret >= 0)
+				ret = len;
 		} else {
-			/* constant folding essential, do not touch params! */
-			ret = LZ4_decompress_generic(in, out, b.size,
-					end - out, endOnInputSize,
-					full, 0, noDict, out, NULL, 0);
-			if (ret < 0) {
-				ret = -EPROTO;	/* decompression error */
-				break;
-			}
-			out += ret;
+			ret = lz4_stream_buffer(strm, src, srcn);
 		}
-
-		in += b.size;
-		if (has_block_checksum)
-			in += sizeof(u32);
+		if (ret < 0)
+			return ret;
+		src += ret;
+		srcn -= ret;
 	}
 
-	*dstn = out - dst;
-	return ret;
+	return 1;
+}
+
+size_t ulz4f_stream_end(struct ulz4f_stream *strm)
+{
+	free(strm->buf);
+	strm->buf = NULL;
+
+	return strm->out;
 }
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Statistical profiler
+ *
+ * A periodic interrupt records where the CPU is and, by following the
+ * frame pointers, how it got there. Functions appear in the samples in
+ * proportion to the time spent in them. Unlike function tracing (see
+ * trace.c) no instrumentation is needed, so the timings are not distorted.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <profile.h>
+#include <trace.h>
+#include <asm/sections.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+enum {
+	/* Largest stack frame we expect, to detect a broken frame chain */
+	MAX_FRAME_SIZE	= 0x10000,
+};
+
+/*
+ * The frame record which a function prologue pushes when frame pointers are
+ * in use. The frame pointer points to this record on arm64 and x86.
+ */
+struct stack_frame {
+	struct stack_frame *next;
+	ulong ret;
+};
+
+/**
+ * struct profile_info - Profiler state
+ *
+ * @buf:	Buffer holding the samples, each a struct trace_sample followed
+ *		by its function offsets
+ * @size:	Size of buffer in 32-bit words
+ * @used:	Number of words used
+ * @count:	Number of samples recorded
+ * @dropped:	Number of samples dropped because the buffer was full
+ * @running:	true if sampling is in progress
+ */
+struct profile_info {
+	u32 *buf;
+	ulong size;
+	ulong used;
+	ulong count;
+	ulong dropped;
+	bool running;
+};
+
+static struct profile_info prof;
+
+/* Get the offset of an address from the start of the code, as in trace.c */
+static u32 profile_offset(ulong addr)
+{
+#ifdef CONFIG_SANDBOX
+	return addr - (ulong)&_init;
+#else
+	if (gd->flags & GD_FLG_RELOC)
+		return addr - gd->relocaddr;
+	else
+		return addr - CONFIG_SYS_TEXT_BASE;
+#endif
+}
+
+void profile_sample(ulong pc, ulong sp, ulong fp)
+{
+	const struct stack_frame *frame = (void *)fp;
+	ulong limit = sp;
+	uint depth = 0;
+	u32 *rec;
+
+	if (!prof.running)
+		return;
+	if (prof.used + 1 + CONFIG_PROFILER_DEPTH > prof.size) {
+		prof.dropped++;
+		return;
+	}
+
+	rec = prof.buf + prof.used;
+	rec[1 + depth++] = profile_offset(pc);
+
+	/*
+	 * Each frame must be a little further up the stack than the last, so
+	 * that the walk stops where the chain is broken, e.g. in code built
+	 * without frame pointers.
+	 */
+	while (depth < CONFIG_PROFILER_DEPTH) {
+		ulong addr = (ulong)frame;
+
+		if (addr < limit || addr - limit > MAX_FRAME_SIZE ||
+		    (addr & (sizeof(ulong) - 1)) || !frame->ret)
+			break;
+		rec[1 + depth++] = profile_offset(frame->ret);
+		limit = addr + sizeof(*frame);
+		frame = frame->next;
+	}
+	rec[0] = depth;
+	prof.used += 1 + depth;
+	prof.count++;
+}
+
+__weak int arch_profile_start(uint period_us)
+{
+	return -ENOSYS;
+}
+
+__weak void arch_profile_stop(void)
+{
+}
+
+int profile_start(uint period_us)
+{
+	int ret;
+
+	if (prof.running)
+		return -EALREADY;
+	if (!prof.buf) {
+		prof.buf = malloc(CONFIG_PROFILER_BUF_SIZE);
+		if (!prof.buf)
+			return -ENOMEM;
+		prof.size = CONFIG_PROFILER_BUF_SIZE / sizeof(u32);
+	}
+	prof.used = 0;
+	prof.count = 0;
+	prof.dropped = 0;
+	barrier();
+
+	prof.running = true;
+	ret = arch_profile_start(period_us);
+	if (ret)
+		prof.running = false;
+
+	return ret;
+}
+
+void profile_stop(void)
+{
+	if (!prof.running)
+		return;
+	arch_profile_stop();
+	prof.running = false;
+}
+
+void profile_print_stats(void)
+{
+	printf("Profiler %s\n", prof.running ? "running" : "stopped");
+	printf("%15lu samples", prof.count);
+	if (prof.dropped)
+		printf(" (%lu dropped due to overflow)", prof.dropped);
+	printf("\n%15lu bytes used of %#x\n", prof.used * sizeof(u32),
+	       CONFIG_PROFILER_BUF_SIZE);
+}
+
+int profile_list_samples(void *buff, int buff_size, uint *needed)
+{
+	struct trace_output_hdr *output_hdr = buff;
+	bool running = prof.running;
+	ulong size;
+	int ret = 0;
+
+	/* Don't take samples while copying them */
+	prof.running = false;
+	barrier();
+	size = prof.used * sizeof(u32);
+	*needed = sizeof(*output_hdr) + size;
+	if (*needed > buff_size) {
+		ret = -ENOSPC;
+	} else {
+		output_hdr->type = TRACE_CHUNK_SAMPLES;
+		output_hdr->rec_count = prof.count;
+		if (size)
+			memcpy(output_hdr + 1, prof.buf, size);
+	}
+	barrier();
+	prof.running = running;
+
+	return ret;
+}
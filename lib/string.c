@@ -565,6 +565,7 @@ void * memcpy(void *dest, const void *src, size_t count)
  */
 void * memmove(void * dest,const void *src,size_t count)
 {
+	unsigned long *dl, *sl;
 	char *tmp, *s;
 
 	if (dest <= src) {
@@ -572,9 +573,27 @@ void * memmove(void * dest,const void *src,size_t count)
 	} else {
 		tmp = (char *) dest + count;
 		s = (char *) src + count;
+		/*
+		 * if both ends can be aligned, copy the odd bytes at the end
+		 * and then a word at a time
+		 */
+		if ((((ulong)dest ^ (ulong)src) & (sizeof(*dl) - 1)) == 0) {
+			while (count && ((ulong)tmp & (sizeof(*dl) - 1))) {
+				*--tmp = *--s;
+				count--;
+			}
+			dl = (unsigned long *)tmp;
+			sl = (unsigned long *)s;
+			while (count >= sizeof(*dl)) {
+				*--dl = *--sl;
+				count -= sizeof(*dl);
+			}
+			tmp = (char *)dl;
+			s = (char *)sl;
+		}
 		while (count--)
 			*--tmp = *--s;
-		}
+	}
 
 	return dest;
 }
@@ -589,10 +608,21 @@ void * memmove(void * dest,const void *src,size_t count)
  */
 int memcmp(const void * cs,const void * ct,size_t count)
 {
+	const unsigned long *l1 = cs, *l2 = ct;
 	const unsigned char *su1, *su2;
 	int res = 0;
 
-	for( su1 = cs, su2 = ct; 0 < count; ++su1, ++su2, count--)
+	/* while all data is aligned, skip over equal words */
+	if ((((ulong)cs | (ulong)ct) & (sizeof(*l1) - 1)) == 0) {
+		while (count >= sizeof(*l1) && *l1 == *l2) {
+			l1++;
+			l2++;
+			count -= sizeof(*l1);
+		}
+	}
+	/* compare the rest one byte at a time */
+	for (su1 = (const unsigned char *)l1, su2 = (const unsigned char *)l2;
+	     count > 0; ++su1, ++su2, count--)
 		if ((res = *su1 - *su2) != 0)
 			break;
 	return res;
@@ -7,6 +7,7 @@
 #include <common.h>
 #include <dm.h>
 #include <errno.h>
+#include <serial.h>
 #include <timer.h>
 #include <watchdog.h>
 #include <div64.h>
@@ -165,6 +166,7 @@ void udelay(unsigned long usec)
 
 	do {
 		WATCHDOG_RESET();
+		serial_tx_poll();
 		kv = usec > CONFIG_WD_PERIOD ? CONFIG_WD_PERIOD : usec;
 		__udelay (kv);
 		usec -= kv;
@@ -9,3 +9,8 @@
  */
 
 void inflate_fast OF((z_streamp strm, unsigned start));
+
+/* U-Boot: inflate_fast() with a word-sized bit buffer and copies */
+#define INFLATE_WIDE_IN_MARGIN  16
+#define INFLATE_WIDE_OUT_MARGIN (258 + sizeof(unsigned long))
+void inflate_fast_wide OF((z_streamp strm, unsigned start));
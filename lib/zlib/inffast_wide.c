@@ -0,0 +1,334 @@
+/* inffast_wide.c -- fast decoding with a word-sized bit buffer
+ * Copyright (C) 1995-2004 Mark Adler
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* U-Boot: we already included these
+#include "zutil.h"
+#include "inftrees.h"
+#include "inflate.h"
+#include "inffast.h"
+*/
+
+#if CONFIG_IS_ENABLED(ZLIB_INFLATE_WIDE)
+
+/*
+   This is inflate_fast() reworked for modern CPUs. It decodes the same
+   tables, built by inflate_table(), but:
+
+    - The bit buffer is refilled a whole word at a time, without branches,
+      so that on a 64-bit CPU one refill provides the 48 bits needed for a
+      length/distance pair. Up to three literals are decoded per refill.
+
+    - Matches are copied a word at a time, allowing the copy to run up to a
+      word past the end of the match. Matches which overlap by less than a
+      word are copied bytewise, except for runs of one byte, which are
+      filled a word at a time.
+
+   Words are loaded and stored with __builtin_memcpy(), so the compiler uses
+   unaligned accesses only where the CPU allows them.
+
+   Since words are read beyond the current input position and written
+   beyond the current output position, this needs more margin than
+   inflate_fast(): INFLATE_WIDE_IN_MARGIN bytes of input and
+   INFLATE_WIDE_OUT_MARGIN bytes of output. inflate() falls back to
+   inflate_fast() near the end of the buffers.
+
+   Entry assumptions:
+
+        state->mode == LEN
+        strm->avail_in >= INFLATE_WIDE_IN_MARGIN
+        strm->avail_out >= INFLATE_WIDE_OUT_MARGIN
+        start >= strm->avail_out
+
+   On return, state->mode is one of LEN, TYPE or BAD, as for inflate_fast().
+ */
+
+typedef unsigned long bitbuf_t;
+#define BITBUF_BITS (8 * sizeof(bitbuf_t))
+
+/* Number of literals which can be decoded after one refill */
+#define LITS_PER_REFILL ((BITBUF_BITS - 8) / 15)
+
+local inline bitbuf_t load_word(const unsigned char FAR *p)
+{
+    bitbuf_t word;
+
+    __builtin_memcpy(&word, p, sizeof(word));
+    if (sizeof(word) == 8)
+        return le64_to_cpu(word);
+    return le32_to_cpu(word);
+}
+
+local inline void copy_word(unsigned char FAR *dst,
+                            const unsigned char FAR *src)
+{
+    __builtin_memcpy(dst, src, sizeof(bitbuf_t));
+}
+
+/*
+   Fill the bit buffer with whole bytes, leaving bits >= BITBUF_BITS - 8.
+   This may load bytes which do not fit; they are loaded again next time.
+ */
+#define REFILL() \
+    do { \
+        hold |= load_word(in) << bits; \
+        in += (BITBUF_BITS - 1 - bits) >> 3; \
+        bits |= BITBUF_BITS - 8; \
+    } while (0)
+
+#define DROP(n) \
+    do { \
+        hold >>= (n); \
+        bits -= (unsigned)(n); \
+    } while (0)
+
+#define LITERAL() \
+    do { \
+        Tracevv((stderr, here.val >= 0x20 && here.val < 0x7f ? \
+                "inflate:         literal '%c'\n" : \
+                "inflate:         literal 0x%02x\n", here.val)); \
+        DROP(here.bits); \
+        *out++ = (unsigned char)(here.val); \
+    } while (0)
+
+void inflate_fast_wide(z_streamp strm, unsigned start)
+/* start: inflate()'s starting value for strm->avail_out */
+{
+    struct inflate_state FAR *state;
+    unsigned char FAR *in;      /* local strm->next_in */
+    unsigned char FAR *last;    /* while in < last, enough input available */
+    unsigned char FAR *out;     /* local strm->next_out */
+    unsigned char FAR *beg;     /* inflate()'s initial strm->next_out */
+    unsigned char FAR *end;     /* while out < end, enough space available */
+#ifdef INFLATE_STRICT
+    unsigned dmax;              /* maximum distance from zlib header */
+#endif
+    unsigned wsize;             /* window size or zero if not using window */
+    unsigned whave;             /* valid bytes in the window */
+    unsigned write;             /* window write index */
+    unsigned char FAR *window;  /* allocated sliding window, if wsize != 0 */
+    bitbuf_t hold;              /* local strm->hold */
+    unsigned bits;              /* local strm->bits */
+    code const FAR *lcode;      /* local strm->lencode */
+    code const FAR *dcode;      /* local strm->distcode */
+    unsigned lmask;             /* mask for first level of length codes */
+    unsigned dmask;             /* mask for first level of distance codes */
+    code here;                  /* retrieved table entry */
+    unsigned op;                /* code bits, operation, extra bits, or */
+                                /*  window position, window bytes to copy */
+    unsigned len;               /* match length, unused bytes */
+    unsigned dist;              /* match distance */
+    unsigned char FAR *from;    /* where to copy match from */
+    unsigned char FAR *stop;    /* end of match in output */
+
+    /* copy state to local variables */
+    state = (struct inflate_state FAR *)strm->state;
+    in = strm->next_in;
+    last = in + (strm->avail_in - INFLATE_WIDE_IN_MARGIN);
+    if (last < in) {
+        /* as in inflate_fast(), limit avail_in to the address space */
+        strm->avail_in = 0xffffffff - (uintptr_t)in;
+        last = in + (strm->avail_in - INFLATE_WIDE_IN_MARGIN);
+    }
+    out = strm->next_out;
+    beg = out - (start - strm->avail_out);
+    end = out + (strm->avail_out - INFLATE_WIDE_OUT_MARGIN);
+#ifdef INFLATE_STRICT
+    dmax = state->dmax;
+#endif
+    wsize = state->wsize;
+    whave = state->whave;
+    write = state->write;
+    window = state->window;
+    hold = state->hold;
+    bits = state->bits;
+    lcode = state->lencode;
+    dcode = state->distcode;
+    lmask = (1U << state->lenbits) - 1;
+    dmask = (1U << state->distbits) - 1;
+
+    /* decode literals and length/distances until end-of-block or not enough
+       input data or output space */
+    do {
+        REFILL();
+        here = lcode[hold & lmask];
+        if (here.op == 0) {
+            LITERAL();
+            if (LITS_PER_REFILL < 2)
+                continue;
+            here = lcode[hold & lmask];
+            if (here.op != 0)
+                continue;
+            LITERAL();
+            if (LITS_PER_REFILL < 3)
+                continue;
+            here = lcode[hold & lmask];
+            if (here.op == 0)
+                LITERAL();
+            continue;
+        }
+      dolen:
+        DROP(here.bits);
+        op = (unsigned)(here.op);
+        if (op == 0) {                          /* literal */
+            *out++ = (unsigned char)(here.val);
+        }
+        else if (op & 16) {                     /* length base */
+            len = (unsigned)(here.val);
+            op &= 15;                           /* number of extra bits */
+            len += (unsigned)hold & ((1U << op) - 1);
+            DROP(op);
+            Tracevv((stderr, "inflate:         length %u\n", len));
+            if (BITBUF_BITS < 64)
+                REFILL();
+            here = dcode[hold & dmask];
+          dodist:
+            DROP(here.bits);
+            op = (unsigned)(here.op);
+            if (op & 16) {                      /* distance base */
+                dist = (unsigned)(here.val);
+                op &= 15;                       /* number of extra bits */
+                if (BITBUF_BITS < 64 && bits < op)
+                    REFILL();
+                dist += (unsigned)hold & ((1U << op) - 1);
+#ifdef INFLATE_STRICT
+                if (dist > dmax) {
+                    strm->msg = (char *)"invalid distance too far back";
+                    state->mode = BAD;
+                    break;
+                }
+#endif
+                DROP(op);
+                Tracevv((stderr, "inflate:         distance %u\n", dist));
+                op = (unsigned)(out - beg);     /* max distance in output */
+                if (dist > op) {                /* see if copy from window */
+                    op = dist - op;             /* distance back in window */
+                    if (op > whave) {
+                        strm->msg = (char *)"invalid distance too far back";
+                        state->mode = BAD;
+                        break;
+                    }
+                    from = window;
+                    if (write == 0) {           /* very common case */
+                        from += wsize - op;
+                        if (op < len) {         /* some from window */
+                            len -= op;
+                            do {
+                                *out++ = *from++;
+                            } while (--op);
+                            from = out - dist;  /* rest from output */
+                        }
+                    }
+                    else if (write < op) {      /* wrap around window */
+                        from += wsize + write - op;
+                        op -= write;
+                        if (op < len) {         /* some from end of window */
+                            len -= op;
+                            do {
+                                *out++ = *from++;
+                            } while (--op);
+                            from = window;
+                            if (write < len) {  /* some from start of window */
+                                op = write;
+                                len -= op;
+                                do {
+                                    *out++ = *from++;
+                                } while (--op);
+                                from = out - dist;      /* rest from output */
+                            }
+                        }
+                    }
+                    else {                      /* contiguous in window */
+                        from += write - op;
+                        if (op < len) {         /* some from window */
+                            len -= op;
+                            do {
+                                *out++ = *from++;
+                            } while (--op);
+                            from = out - dist;  /* rest from output */
+                        }
+                    }
+                    while (len > 2) {
+                        *out++ = *from++;
+                        *out++ = *from++;
+                        *out++ = *from++;
+                        len -= 3;
+                    }
+                    if (len) {
+                        *out++ = *from++;
+                        if (len > 1)
+                            *out++ = *from++;
+                    }
+                }
+                else {                          /* copy direct from output */
+                    from = out - dist;
+                    stop = out + len;
+                    if (dist >= sizeof(bitbuf_t)) {
+                        /* a word at a time, possibly overrunning the end */
+                        do {
+                            copy_word(out, from);
+                            out += sizeof(bitbuf_t);
+                            from += sizeof(bitbuf_t);
+                        } while (out < stop);
+                    }
+                    else if (dist == 1) {       /* run of one byte */
+                        bitbuf_t pattern = *from * (~(bitbuf_t)0 / 0xff);
+
+                        do {
+                            __builtin_memcpy(out, &pattern, sizeof(pattern));
+                            out += sizeof(bitbuf_t);
+                        } while (out < stop);
+                    }
+                    else {                      /* minimum length is three */
+                        do {
+                            *out++ = *from++;
+                            *out++ = *from++;
+                            *out++ = *from++;
+                        } while (out < stop);
+                    }
+                    out = stop;
+                }
+            }
+            else if ((op & 64) == 0) {          /* 2nd level distance code */
+                here = dcode[here.val + (hold & ((1U << op) - 1))];
+                goto dodist;
+            }
+            else {
+                strm->msg = (char *)"invalid distance code";
+                state->mode = BAD;
+                break;
+            }
+        }
+        else if ((op & 64) == 0) {              /* 2nd level length code */
+            here = lcode[here.val + (hold & ((1U << op) - 1))];
+            goto dolen;
+        }
+        else if (op & 32) {                     /* end-of-block */
+            Tracevv((stderr, "inflate:         end of block\n"));
+            state->mode = TYPE;
+            break;
+        }
+        else {
+            strm->msg = (char *)"invalid literal/length code";
+            state->mode = BAD;
+            break;
+        }
+    } while (in < last && out < end);
+
+    /* return unused bytes */
+    len = bits >> 3;
+    in -= len;
+    bits -= len << 3;
+    hold &= ((bitbuf_t)1 << bits) - 1;
+
+    /* update state and return */
+    strm->next_in = in;
+    strm->next_out = out;
+    strm->avail_in = (unsigned)(last + INFLATE_WIDE_IN_MARGIN - in);
+    strm->avail_out = (unsigned)(end + INFLATE_WIDE_OUT_MARGIN - out);
+    state->hold = hold;
+    state->bits = bits;
+}
+
+#endif /* ZLIB_INFLATE_WIDE */
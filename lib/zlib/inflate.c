@@ -724,7 +724,12 @@ int ZEXPORT inflate(z_streamp strm, int flush)
 	    WATCHDOG_RESET();
             if (have >= 6 && left >= 258) {
                 RESTORE();
-                inflate_fast(strm, out);
+                if (CONFIG_IS_ENABLED(ZLIB_INFLATE_WIDE) &&
+                    have >= INFLATE_WIDE_IN_MARGIN &&
+                    left >= INFLATE_WIDE_OUT_MARGIN)
+                    inflate_fast_wide(strm, out);
+                else
+                    inflate_fast(strm, out);
                 LOAD();
                 break;
             }
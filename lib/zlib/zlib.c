@@ -26,7 +26,10 @@
 #include "inffast.h"
 #include "inffixed.h"
 #include "inffast.c"
+#include "inffast_wide.c"
 #include "inftrees.c"
 #include "inflate.c"
 #include "zutil.c"
 #include "adler32.c"
+
+int zlib_no_watchdog;
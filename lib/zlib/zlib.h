@@ -17,4 +17,13 @@
 #undef STDC
 #undef NO_ERRNO_H
 
+static inline void zlib_watchdog_reset(void)
+{
+	if (!zlib_no_watchdog)
+		WATCHDOG_RESET();
+}
+
+#undef WATCHDOG_RESET
+#define WATCHDOG_RESET zlib_watchdog_reset
+
 #endif
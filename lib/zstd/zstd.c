@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Decompress a buffer holding one or more Zstandard frames
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/zstd.h>
+
+/**
+ * zstd_decompress() - Decompress Zstandard data
+ *
+ * @src:	Compressed data, holding one or more frames
+ * @srcn:	Size of compressed data
+ * @dst:	Buffer for the uncompressed data
+ * @dstn:	On entry, the size of @dst; on exit, the number of bytes
+ *		uncompressed
+ * @return 0 if OK, -ENOSPC if @dst is too small, -EINVAL if the data is
+ *	corrupt, -ENOMEM if out of memory
+ */
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	ZSTD_DCtx *dctx;
+	void *workspace;
+	size_t wsize;
+	size_t ret;
+	int err = 0;
+
+	/*
+	 * Decompressing the whole buffer in one go means that the output
+	 * buffer serves as the window, so only the context is allocated
+	 * here, however large a window the compressor chose.
+	 */
+	wsize = ZSTD_DCtxWorkspaceBound();
+	workspace = malloc(wsize);
+	if (!workspace)
+		return -ENOMEM;
+
+	dctx = ZSTD_initDCtx(workspace, wsize);
+	if (!dctx) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	ret = ZSTD_decompressDCtx(dctx, dst, *dstn, src, srcn);
+	if (ZSTD_isError(ret)) {
+		debug("%s: error %d\n", __func__, ZSTD_getErrorCode(ret));
+		err = ZSTD_getErrorCode(ret) == ZSTD_error_dstSize_tooSmall ?
+			-ENOSPC : -EINVAL;
+		goto out;
+	}
+	*dstn = ret;
+out:
+	free(workspace);
+
+	return err;
+}
@@ -11,6 +11,64 @@ static const char test_cmd[] = "setenv list 1\n setenv list ${list}2; "
 		"setenv list ${list}3\0"
 		"setenv list ${list}4";
 
+/* names looked up by the benchmark, as a boot script might use them */
+static const char *const bench_cmds[] = {
+	"setenv", "test", "run", "echo", "load", "env", "md.b", "x",
+};
+
+#define BENCH_LOOPS	10000
+
+/* Check that find_cmd() agrees with a linear search of the table */
+static void check_find_cmd(void)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	cmd_tbl_t *cmdtp;
+	char name[40];
+	int len;
+
+	for (cmdtp = start; cmdtp != start + count; cmdtp++) {
+		/* every abbreviation, with and without a size suffix */
+		for (len = 1; len <= strlen(cmdtp->name) &&
+		     len < sizeof(name) - 2; len++) {
+			strlcpy(name, cmdtp->name, len + 1);
+			assert(find_cmd(name) == find_cmd_tbl(name, start,
+							      count));
+			strcat(name, ".b");
+			assert(find_cmd(name) == find_cmd_tbl(name, start,
+							      count));
+		}
+	}
+	assert(!find_cmd("no-such-command"));
+	assert(!find_cmd(""));
+}
+
+static void bench_find_cmd(void)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	ulong linear, sorted;
+	int i, j;
+
+	linear = timer_get_us();
+	for (i = 0; i < BENCH_LOOPS; i++) {
+		for (j = 0; j < ARRAY_SIZE(bench_cmds); j++)
+			find_cmd_tbl(bench_cmds[j], start, count);
+	}
+	linear = timer_get_us() - linear;
+
+	sorted = timer_get_us();
+	for (i = 0; i < BENCH_LOOPS; i++) {
+		for (j = 0; j < ARRAY_SIZE(bench_cmds); j++)
+			find_cmd(bench_cmds[j]);
+	}
+	sorted = timer_get_us() - sorted;
+
+	printf("%s: %d lookups in %d commands: linear %lu us, sorted %lu us\n",
+	       __func__, BENCH_LOOPS * (int)ARRAY_SIZE(bench_cmds), count,
+	       linear, sorted);
+}
+
 static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	printf("%s: Testing commands\n", __func__);
@@ -49,6 +107,18 @@ static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	assert(!strcmp("1", env_get("black")));
 	assert(env_get("adder") != NULL);
 	assert(!strcmp("2", env_get("adder")));
+
+	/* a script run several times gives the same result each time */
+	run_command("setenv list", 0);
+	run_command("setenv loop 'for i in 1 2; do setenv list ${list}${i}; "
+		    "done; a=${list} setenv list ${a}x'", 0);
+	run_command("run loop; run loop", 0);
+	assert(!strcmp("12x12x", env_get("list")));
+
+	/* a changed script is parsed again */
+	run_command("setenv loop 'setenv list done'", 0);
+	run_command("run loop", 0);
+	assert(!strcmp("done", env_get("list")));
 #endif
 
 	assert(run_command("", 0) == 0);
@@ -56,6 +126,9 @@ static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	assert(run_command("'", 0) == 1);
 
+	check_find_cmd();
+	bench_find_cmd();
+
 	printf("%s: Everything went swimmingly\n", __func__);
 	return 0;
 }
@@ -6,10 +6,13 @@
 #include <common.h>
 #include <bootm.h>
 #include <command.h>
+#include <decomp_parallel.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 
+#include <u-boot/lz4.h>
 #include <u-boot/zlib.h>
 #include <bzlib.h>
 
@@ -117,6 +120,66 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/* zstd -19 -c /tmp/plain.txt > /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
+/*
+ * The text above repeated to make 4MB, for the speed test:
+ * for i in $(seq 11984); do cat /tmp/plain.txt; done | head -c 4194304 |
+ *	zstd -19 > /tmp/speed.zst
+ */
+static const char zstd_speed_compressed[] =
+	"\x28\xb5\x2f\xfd\xa4\x00\x00\x40\x00\xd4\x05\x00\x52\x4e\x26\x17"
+	"\x80\x6d\x0e\x00\x10\x12\x93\xa0\xe5\x3f\xd1\x9e\x20\xf2\xc4\x30"
+	"\xe6\x6f\x74\x95\x0d\xd7\x03\xc0\xa0\x5f\x50\xf5\x0c\x50\x9c\x8f"
+	"\xa0\xb4\x9e\x73\x8d\xff\xa0\xfa\x61\xb7\xd6\x87\x6f\x1a\xb4\x42"
+	"\x52\x41\x80\x20\x21\x24\xb8\x69\x59\x6d\x42\x5e\xc5\x2f\x2f\xe1"
+	"\xe1\x08\xae\xc6\xab\x2f\x15\x5f\xad\x5b\xfa\xcc\x4b\x4b\xa0\xa5"
+	"\xaf\xed\x6a\x85\x38\xcc\x3f\xbc\x41\x4b\x96\xe3\xa0\xb5\xf0\xbe"
+	"\xcf\x29\xf5\xdf\x21\x17\x56\x0a\x60\x78\x4b\x66\x4d\xbf\x39\x6b"
+	"\xaa\xf5\x3a\x87\x85\x33\x9f\xc9\x65\xa9\x21\xf3\x1f\xfa\xef\xca"
+	"\x00\x86\x8d\xbe\x56\x9c\x37\x0f\x7f\x1d\xa8\xfa\xd7\x30\x87\x58"
+	"\x5a\x6a\x49\x65\x34\x43\x17\x01\x09\x00\x9f\xfe\x61\x9b\x1d\x6c"
+	"\x22\x60\x6c\x94\x45\x51\xaf\x66\x84\xa2\xc0\x08\x23\xe1\x3a\x42"
+	"\x65\x41\xf4\x42\x55\x19\x54\x00\x00\x00\x01\x00\xfd\xff\x57\xff"
+	"\xb9\x06\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00"
+	"\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd"
+	"\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44"
+	"\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00"
+	"\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02"
+	"\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01"
+	"\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00"
+	"\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00"
+	"\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39"
+	"\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00"
+	"\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff"
+	"\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00"
+	"\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd"
+	"\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44"
+	"\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00"
+	"\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02"
+	"\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01"
+	"\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00"
+	"\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00"
+	"\x01\x00\xfd\xff\x39\x00\x02\x44\x00\x00\x00\x01\x00\xfd\xff\x39"
+	"\x00\x02\x45\x00\x00\x00\x01\x00\xfd\xff\x39\x00\x02\xb3\xc3\xa2"
+	"\x16";
+static const unsigned long zstd_speed_compressed_size = 545;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -292,6 +355,40 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(struct unit_test_state *uts,
+				 void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	size_t output_size = out_max;
+	int ret;
+
+	ret = zstd_decompress(in, in_size, out, &output_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return ret != 0;
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -436,6 +533,13 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+static int compression_test_zstd(struct unit_test_state *uts)
+{
+	return run_test(uts, "zstd", compress_using_zstd,
+			uncompress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_zstd, 0);
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -526,12 +630,453 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+static int compression_test_bootm_zstd(struct unit_test_state *uts)
+{
+	return run_bootm_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_bootm_zstd, 0);
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/* Number of bytes to decompress for each algorithm in the speed test */
+#define SPEED_TEST_BYTES	(4 << 20)
+
+/* Algorithms which can only decompress the short test text */
+static const struct {
+	const char *name;
+	mutate_func compress;
+	mutate_func uncompress;
+} speed_algos[] = {
+	{ "bzip2", compress_using_bzip2, uncompress_using_bzip2 },
+	{ "lzma", compress_using_lzma, uncompress_using_lzma },
+	{ "lzo", compress_using_lzo, uncompress_using_lzo },
+	{ "lz4", compress_using_lz4, uncompress_using_lz4 },
+};
+
+static void speed_report(const char *name, ulong comp_size, ulong size,
+			 ulong took)
+{
+	printf("%6s: ratio %3lu%%, %lu bytes in %lu us, %lu MB/s\n", name,
+	       comp_size * 100 / size, size, took, size / took);
+}
+
+/*
+ * Report the decompression throughput of each algorithm, writing a few MB
+ * of the test text repeated. gzip and zstd decompress it all in one call.
+ * There is no compressor here for the others, so they decompress the short
+ * text into each part of the buffer in turn, which includes the overhead of
+ * each call.
+ */
+static int compression_test_speed(struct unit_test_state *uts)
+{
+	ulong comp_size, out_size, plain_size = strlen(plain);
+	ulong start, took, done;
+	char comp[TEST_BUFFER_SIZE];
+	char *plain_buf, *out_buf;
+	uchar *gzip_buf;
+	int i;
+
+	plain_buf = malloc(SPEED_TEST_BYTES);
+	out_buf = malloc(SPEED_TEST_BYTES);
+	gzip_buf = malloc(SPEED_TEST_BYTES);
+	ut_assertnonnull(plain_buf);
+	ut_assertnonnull(out_buf);
+	ut_assertnonnull(gzip_buf);
+	for (done = 0; done < SPEED_TEST_BYTES; done += plain_size)
+		memcpy(plain_buf + done, plain,
+		       min(plain_size, SPEED_TEST_BYTES - done));
+
+	comp_size = SPEED_TEST_BYTES;
+	ut_assertok(gzip(gzip_buf, &comp_size, (uchar *)plain_buf,
+			 SPEED_TEST_BYTES));
+	out_size = comp_size;
+	start = timer_get_us();
+	ut_assertok(gunzip(out_buf, SPEED_TEST_BYTES, gzip_buf, &out_size));
+	took = max(timer_get_us() - start, 1UL);
+	ut_asserteq(SPEED_TEST_BYTES, out_size);
+	ut_assertok(memcmp(plain_buf, out_buf, SPEED_TEST_BYTES));
+	speed_report("gzip", comp_size, SPEED_TEST_BYTES, took);
+
+	memset(out_buf, '\0', SPEED_TEST_BYTES);
+	out_size = SPEED_TEST_BYTES;
+	start = timer_get_us();
+	ut_assertok(zstd_decompress(zstd_speed_compressed,
+				    zstd_speed_compressed_size, out_buf,
+				    &out_size));
+	took = max(timer_get_us() - start, 1UL);
+	ut_asserteq(SPEED_TEST_BYTES, out_size);
+	ut_assertok(memcmp(plain_buf, out_buf, SPEED_TEST_BYTES));
+	speed_report("zstd", zstd_speed_compressed_size, SPEED_TEST_BYTES,
+		     took);
+
+	for (i = 0; i < ARRAY_SIZE(speed_algos); i++) {
+		ut_assertok(speed_algos[i].compress(uts, (void *)plain,
+						    plain_size, comp,
+						    sizeof(comp), &comp_size));
+		start = timer_get_us();
+		for (done = 0; done + plain_size <= SPEED_TEST_BYTES;
+		     done += out_size) {
+			ut_assertok(speed_algos[i].uncompress(uts, comp,
+							      comp_size,
+							      out_buf + done,
+							      SPEED_TEST_BYTES -
+							      done, &out_size));
+			ut_asserteq(plain_size, out_size);
+		}
+		took = max(timer_get_us() - start, 1UL);
+		ut_assertok(memcmp(plain_buf, out_buf, done));
+		speed_report(speed_algos[i].name, comp_size * done / plain_size,
+			     done, took);
+	}
+
+	free(gzip_buf);
+	free(out_buf);
+	free(plain_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_speed, 0);
+
+/* Size of the text used to measure gunzip() speed */
+#define GZIP_SPEED_BYTES	(1 << 20)
+#define GZIP_SPEED_RUNS		5
+
+/* Make some text-like data, which compresses to about a quarter */
+static void make_words(char *buf, int size)
+{
+	static const char *const words[] = {
+		"the", "device", "driver", "returns", "an", "error", "when",
+		"memory", "cannot", "be", "allocated", "for", "buffer", "of",
+		"uclass", "probe", "0x", "struct", "udevice", "int", "ret",
+		"if", "return", "(", ")", ";", "{", "}", "=", "->", "\n\t",
+	};
+	uint seed = 1;
+	int pos = 0;
+
+	while (pos < size) {
+		const char *word;
+		int len;
+
+		seed = seed * 1103515245 + 12345;
+		word = words[(seed >> 16) % ARRAY_SIZE(words)];
+		len = min((int)strlen(word), size - pos);
+		memcpy(buf + pos, word, len);
+		pos += len;
+		if (pos < size && (seed & 0x100))
+			buf[pos++] = ' ';
+	}
+}
+
+/* Report the speed of gunzip() on a larger, more realistic buffer */
+static int compression_test_gzip_speed(struct unit_test_state *uts)
+{
+	ulong comp_size = GZIP_SPEED_BYTES, out_size, start, took, best = ~0UL;
+	char *plain_buf, *out_buf;
+	uchar *comp_buf;
+	int i;
+
+	plain_buf = malloc(GZIP_SPEED_BYTES);
+	comp_buf = malloc(GZIP_SPEED_BYTES);
+	out_buf = malloc(GZIP_SPEED_BYTES);
+	ut_assertnonnull(plain_buf);
+	ut_assertnonnull(comp_buf);
+	ut_assertnonnull(out_buf);
+	make_words(plain_buf, GZIP_SPEED_BYTES);
+	ut_assertok(gzip(comp_buf, &comp_size, (uchar *)plain_buf,
+			 GZIP_SPEED_BYTES));
+
+	for (i = 0; i < GZIP_SPEED_RUNS; i++) {
+		out_size = comp_size;
+		start = timer_get_us();
+		ut_assertok(gunzip(out_buf, GZIP_SPEED_BYTES, comp_buf,
+				   &out_size));
+		took = max(timer_get_us() - start, 1UL);
+		best = min(best, took);
+		ut_asserteq(GZIP_SPEED_BYTES, out_size);
+		ut_assertok(memcmp(plain_buf, out_buf, GZIP_SPEED_BYTES));
+	}
+	printf("gunzip (%s loop): %d bytes from %lu in %lu us, %lu MB/s\n",
+	       CONFIG_IS_ENABLED(ZLIB_INFLATE_WIDE) ? "wide" : "standard",
+	       GZIP_SPEED_BYTES, comp_size, best, GZIP_SPEED_BYTES / best);
+
+	free(out_buf);
+	free(comp_buf);
+	free(plain_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_gzip_speed, 0);
+
+/* Number and size of the blocks stored uncompressed in the LZ4 test frame */
+#define LZ4_TEST_BLOCKS		7
+#define LZ4_TEST_BLOCK_SIZE	(64 << 10)
+#define LZ4_TEST_PLAIN_SIZE	(LZ4_TEST_BLOCKS * LZ4_TEST_BLOCK_SIZE + \
+				 TEST_BUFFER_SIZE)
+
+/*
+ * Make an LZ4 frame with 64KB blocks: some full ones stored uncompressed,
+ * then the compressed block from lz4_compressed. The uncompressed data is
+ * placed in @plain_buf and its size returned in @plain_sizep. Returns the
+ * size of the frame.
+ */
+static ulong make_lz4_frame(u8 *buf, char *plain_buf, ulong *plain_sizep)
+{
+	static const u8 hdr[] = { 0x04, 0x22, 0x4d, 0x18, 0x60, 0x40, 0x82 };
+	/* skip the frame header, then take the block header and block */
+	const ulong lz4_block_size = lz4_compressed_size - 7 - 8;
+	ulong text_size = LZ4_TEST_BLOCKS * LZ4_TEST_BLOCK_SIZE;
+	ulong size = sizeof(hdr);
+	int i;
+
+	make_words(plain_buf, text_size);
+	strcpy(plain_buf + text_size, plain);
+	*plain_sizep = text_size + strlen(plain);
+
+	memcpy(buf, hdr, sizeof(hdr));
+	for (i = 0; i < LZ4_TEST_BLOCKS; i++) {
+		put_unaligned_le32(LZ4_TEST_BLOCK_SIZE | BIT(31), buf + size);
+		memcpy(buf + size + 4, plain_buf + i * LZ4_TEST_BLOCK_SIZE,
+		       LZ4_TEST_BLOCK_SIZE);
+		size += 4 + LZ4_TEST_BLOCK_SIZE;
+	}
+	memcpy(buf + size, lz4_compressed + 7, lz4_block_size);
+	size += lz4_block_size;
+	put_unaligned_le32(0, buf + size);
+
+	return size + 4;
+}
+
+/* Check decompressing LZ4 data supplied in pieces */
+static int compression_test_lz4_stream(struct unit_test_state *uts)
+{
+	ulong plain_size = strlen(plain), frame_size, piece;
+	struct ulz4f_stream strm;
+	char out[TEST_BUFFER_SIZE];
+	char *plain_buf, *out_buf;
+	u8 *frame;
+	int i;
+
+	/* a byte at a time */
+	ulz4f_stream_init(&strm, out, sizeof(out));
+	for (i = 0; i < lz4_compressed_size - 1; i++)
+		ut_assertok(ulz4f_stream_decompress(&strm, lz4_compressed + i,
+						    1));
+	ut_asserteq(1, ulz4f_stream_decompress(&strm, lz4_compressed + i, 1));
+	ut_asserteq(plain_size, ulz4f_stream_end(&strm));
+	ut_assertok(memcmp(plain, out, plain_size));
+
+	/* blocks split across pieces */
+	plain_buf = malloc(LZ4_TEST_PLAIN_SIZE);
+	out_buf = malloc(LZ4_TEST_PLAIN_SIZE);
+	frame = malloc(LZ4_TEST_PLAIN_SIZE + 1024);
+	ut_assertnonnull(plain_buf);
+	ut_assertnonnull(out_buf);
+	ut_assertnonnull(frame);
+	frame_size = make_lz4_frame(frame, plain_buf, &plain_size);
+	ulz4f_stream_init(&strm, out_buf, LZ4_TEST_PLAIN_SIZE);
+	for (i = 0; i < frame_size; i += piece) {
+		piece = min(frame_size - i, 1000UL);
+		ut_asserteq(i + piece == frame_size,
+			    ulz4f_stream_decompress(&strm, frame + i, piece));
+	}
+	ut_asserteq(plain_size, ulz4f_stream_end(&strm));
+	ut_assertok(memcmp(plain_buf, out_buf, plain_size));
+
+	/* too little space */
+	ulz4f_stream_init(&strm, out_buf, plain_size - 1);
+	ut_asserteq(-ENOBUFS, ulz4f_stream_decompress(&strm, frame,
+						      frame_size));
+	ulz4f_stream_end(&strm);
+
+	free(frame);
+	free(out_buf);
+	free(plain_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lz4_stream, 0);
+
+/* Check decompressing LZ4 data placed at the end of the output buffer */
+static int compression_test_lz4_inplace(struct unit_test_state *uts)
+{
+	ulong plain_size = strlen(plain), frame_size;
+	ulong buf_size = plain_size + ULZ4F_INPLACE_MARGIN(lz4_compressed_size);
+	char buf[TEST_BUFFER_SIZE];
+	char *src = buf + buf_size - lz4_compressed_size;
+	size_t out_size = src + lz4_compressed_size -
+		ULZ4F_INPLACE_MARGIN(lz4_compressed_size) - buf;
+	char *plain_buf, *out_buf;
+	u8 *frame;
+
+	ut_assert(buf_size <= sizeof(buf));
+	memcpy(src, lz4_compressed, lz4_compressed_size);
+	ut_assertok(ulz4fn(src, lz4_compressed_size, buf, &out_size));
+	ut_asserteq(plain_size, out_size);
+	ut_assertok(memcmp(plain, buf, plain_size));
+
+	/* several blocks, most of them stored uncompressed */
+	plain_buf = malloc(LZ4_TEST_PLAIN_SIZE);
+	frame = malloc(LZ4_TEST_PLAIN_SIZE + 1024);
+	ut_assertnonnull(plain_buf);
+	ut_assertnonnull(frame);
+	frame_size = make_lz4_frame(frame, plain_buf, &plain_size);
+	buf_size = plain_size + ULZ4F_INPLACE_MARGIN(frame_size);
+	out_buf = malloc(buf_size);
+	ut_assertnonnull(out_buf);
+	src = out_buf + buf_size - frame_size;
+	memcpy(src, frame, frame_size);
+	out_size = plain_size;
+	ut_assertok(ulz4fn(src, frame_size, out_buf, &out_size));
+	ut_asserteq(plain_size, out_size);
+	ut_assertok(memcmp(plain_buf, out_buf, plain_size));
+
+	free(out_buf);
+	free(frame);
+	free(plain_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lz4_inplace, 0);
+
+#ifdef CONFIG_DECOMP_PARALLEL
+/* Number of gzip members or zstd frames in the test images */
+#define PARALLEL_PARTS		8
+
+/* Check decompressing a gzip file made by concatenating several others */
+static int compression_test_parallel_gzip(struct unit_test_state *uts)
+{
+	ulong part_size = GZIP_SPEED_BYTES / PARALLEL_PARTS;
+	ulong comp_size = 0, size, out_size;
+	char *plain_buf, *out_buf;
+	uchar *comp_buf;
+	int i;
+
+	plain_buf = malloc(GZIP_SPEED_BYTES);
+	comp_buf = malloc(GZIP_SPEED_BYTES);
+	out_buf = malloc(GZIP_SPEED_BYTES);
+	ut_assertnonnull(plain_buf);
+	ut_assertnonnull(comp_buf);
+	ut_assertnonnull(out_buf);
+	make_words(plain_buf, GZIP_SPEED_BYTES);
+	for (i = 0; i < PARALLEL_PARTS; i++) {
+		size = GZIP_SPEED_BYTES - comp_size;
+		ut_assertok(gzip(comp_buf + comp_size, &size,
+				 (uchar *)plain_buf + i * part_size,
+				 part_size));
+		comp_size += size;
+	}
+
+	ut_assertok(decomp_parallel(IH_COMP_GZIP, out_buf, GZIP_SPEED_BYTES,
+				    comp_buf, comp_size, &out_size));
+	ut_asserteq(GZIP_SPEED_BYTES, out_size);
+	ut_assertok(memcmp(plain_buf, out_buf, GZIP_SPEED_BYTES));
+
+	/* too little space */
+	ut_asserteq(-ENOSPC, decomp_parallel(IH_COMP_GZIP, out_buf,
+					     GZIP_SPEED_BYTES - 1, comp_buf,
+					     comp_size, &out_size));
+
+	/* truncated data */
+	ut_assert(decomp_parallel(IH_COMP_GZIP, out_buf, GZIP_SPEED_BYTES,
+				  comp_buf, comp_size - 1, &out_size));
+
+	/* a single member is left to gunzip() */
+	size = GZIP_SPEED_BYTES;
+	ut_assertok(gzip(comp_buf, &size, (uchar *)plain_buf, part_size));
+	ut_asserteq(-ENOENT, decomp_parallel(IH_COMP_GZIP, out_buf,
+					     GZIP_SPEED_BYTES, comp_buf, size,
+					     &out_size));
+
+	free(out_buf);
+	free(comp_buf);
+	free(plain_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_parallel_gzip, 0);
+
+/* Check decompressing a zstd file with several frames */
+static int compression_test_parallel_zstd(struct unit_test_state *uts)
+{
+	ulong comp_size = zstd_compressed_size * PARALLEL_PARTS;
+	ulong plain_size = strlen(plain);
+	char comp[TEST_BUFFER_SIZE * PARALLEL_PARTS];
+	char out[TEST_BUFFER_SIZE * PARALLEL_PARTS];
+	ulong out_size;
+	int i;
+
+	for (i = 0; i < PARALLEL_PARTS; i++)
+		memcpy(comp + i * zstd_compressed_size, zstd_compressed,
+		       zstd_compressed_size);
+	ut_assertok(decomp_parallel(IH_COMP_ZSTD, out, sizeof(out), comp,
+				    comp_size, &out_size));
+	ut_asserteq(plain_size * PARALLEL_PARTS, out_size);
+	for (i = 0; i < PARALLEL_PARTS; i++)
+		ut_assertok(memcmp(plain, out + i * plain_size, plain_size));
+
+	ut_asserteq(-ENOSPC, decomp_parallel(IH_COMP_ZSTD, out,
+					     plain_size * PARALLEL_PARTS - 1,
+					     comp, comp_size, &out_size));
+	ut_asserteq(-ENOENT, decomp_parallel(IH_COMP_ZSTD, out, sizeof(out),
+					     comp, zstd_compressed_size,
+					     &out_size));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_parallel_zstd, 0);
+
+/* Check decompressing an LZ4 frame with several blocks */
+static int compression_test_parallel_lz4(struct unit_test_state *uts)
+{
+	ulong frame_size, plain_size, out_size, block_size;
+	char *plain_buf, *out_buf;
+	u8 *frame;
+
+	plain_buf = malloc(LZ4_TEST_PLAIN_SIZE);
+	out_buf = malloc(LZ4_TEST_PLAIN_SIZE);
+	frame = malloc(LZ4_TEST_PLAIN_SIZE + 1024);
+	ut_assertnonnull(plain_buf);
+	ut_assertnonnull(out_buf);
+	ut_assertnonnull(frame);
+	frame_size = make_lz4_frame(frame, plain_buf, &plain_size);
+
+	ut_assertok(decomp_parallel(IH_COMP_LZ4, out_buf, LZ4_TEST_PLAIN_SIZE,
+				    frame, frame_size, &out_size));
+	ut_asserteq(plain_size, out_size);
+	ut_assertok(memcmp(plain_buf, out_buf, plain_size));
+
+	/*
+	 * A compressed block which is not full cannot be placed correctly,
+	 * so put one first and check it is detected
+	 */
+	block_size = lz4_compressed_size - 7 - 8;
+	memmove(frame + 7 + block_size, frame + 7, 4 + LZ4_TEST_BLOCK_SIZE);
+	memcpy(frame + 7, lz4_compressed + 7, block_size);
+	frame_size = 7 + block_size + 4 + LZ4_TEST_BLOCK_SIZE;
+	put_unaligned_le32(0, frame + frame_size);
+	frame_size += 4;
+	ut_asserteq(-EINVAL, decomp_parallel(IH_COMP_LZ4, out_buf,
+					     LZ4_TEST_PLAIN_SIZE, frame,
+					     frame_size, &out_size));
+
+	/* a single block is left to ulz4fn() */
+	ut_asserteq(-ENOENT, decomp_parallel(IH_COMP_LZ4, out_buf,
+					     TEST_BUFFER_SIZE, lz4_compressed,
+					     lz4_compressed_size, &out_size));
+
+	free(frame);
+	free(out_buf);
+	free(plain_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_parallel_lz4, 0);
+#endif /* CONFIG_DECOMP_PARALLEL */
+
 int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	struct unit_test *tests = ll_entry_start(struct unit_test,
@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -70,6 +71,23 @@ static struct driver_info driver_info_act_dma = {
 	.name = "test_act_dma_drv",
 };
 
+static const struct dm_test_pdata test_pdata_async[] = {
+	{ .ping_add		= 3, },
+	{ .ping_add		= 3, },
+	{ .ping_add		= 1, },
+};
+
+static struct driver_info driver_info_async[] = {
+	{ .name = "test_async_drv", .platdata = &test_pdata_async[0], },
+	{ .name = "test_async_drv", .platdata = &test_pdata_async[1], },
+	{ .name = "test_async_drv", .platdata = &test_pdata_async[2], },
+};
+
+static struct driver_info driver_info_async_user = {
+	.name = "test_async_user_drv",
+	.platdata = &test_pdata_async[2],
+};
+
 void dm_leak_check_start(struct unit_test_state *uts)
 {
 	uts->start = mallinfo();
@@ -659,6 +677,153 @@ static int dm_test_pre_reloc(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_pre_reloc, 0);
 
+/* Test that a driver can ask to be probed again later */
+static int dm_test_probe_async(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	struct dm_test_async_priv *priv;
+	struct udevice *dev;
+
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_async[0],
+					&dev));
+	ut_asserteq(-EINPROGRESS, device_probe_async(dev));
+	ut_assert(dev->flags & DM_FLAG_PROBE_PENDING);
+	ut_assert(!device_active(dev));
+	priv = dev_get_priv(dev);
+	ut_asserteq(1, priv->calls);
+
+	ut_asserteq(-EINPROGRESS, device_probe_async(dev));
+	ut_asserteq(2, priv->calls);
+
+	/* A user of the device waits for it to be ready */
+	ut_assertok(device_probe(dev));
+	ut_asserteq(4, priv->calls);
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_assert(device_active(dev));
+
+	/* Nothing more to do */
+	ut_assertok(device_probe_async(dev));
+	ut_asserteq(4, priv->calls);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async, 0);
+
+/* Test that probing a list of devices overlaps their waits */
+static int dm_test_probe_list(struct unit_test_state *uts)
+{
+	struct dm_test_async_priv *priv1, *priv2, *priv_child;
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *devs[3];
+
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_async[0],
+					&devs[1]));
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_async[1],
+					&devs[2]));
+	ut_assertok(device_bind_by_name(devs[1], false, &driver_info_async[2],
+					&devs[0]));
+
+	/* The child is first in the list but must wait for its parent */
+	ut_assertok(device_probe_list(devs, ARRAY_SIZE(devs)));
+	ut_assert(device_active(devs[0]));
+	ut_assert(device_active(devs[1]));
+	ut_assert(device_active(devs[2]));
+
+	priv_child = dev_get_priv(devs[0]);
+	priv1 = dev_get_priv(devs[1]);
+	priv2 = dev_get_priv(devs[2]);
+	ut_asserteq(2, priv_child->calls);
+	ut_asserteq(4, priv1->calls);
+	ut_asserteq(4, priv2->calls);
+
+	/* The two independent devices waited at the same time */
+	ut_assert(priv2->first_call < priv1->last_call);
+	ut_assert(priv1->first_call < priv2->last_call);
+
+	/* The child did not start until its parent was ready */
+	ut_assert(priv_child->first_call > priv1->last_call);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_list, 0);
+
+/* Test that devices in a list complete in order, even if they finish early */
+static int dm_test_probe_list_order(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	struct dm_test_async_priv *priv;
+	struct udevice *devs[2];
+	int post_probes;
+
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_async[0],
+					&devs[0]));
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_async[2],
+					&devs[1]));
+	post_probes = dm_testdrv_op_count[DM_TEST_OP_POST_PROBE];
+	ut_assertok(device_probe_list(devs, ARRAY_SIZE(devs)));
+	ut_asserteq(post_probes + 2,
+		    dm_testdrv_op_count[DM_TEST_OP_POST_PROBE]);
+
+	/* The second device's probe() finished first but it did not complete */
+	priv = dev_get_priv(devs[0]);
+	ut_asserteq(4, priv->calls);
+	ut_asserteq(post_probes, priv->post_probes);
+	priv = dev_get_priv(devs[1]);
+	ut_asserteq(2, priv->calls);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_list_order, 0);
+
+/* Test that a device using another one in a list waits without blocking */
+static int dm_test_probe_list_supplier(struct unit_test_state *uts)
+{
+	struct dm_test_async_priv *priv_user, *priv_supplier;
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *devs[2];
+
+	ut_assertok(device_bind_by_name(dms->root, false,
+					&driver_info_async_user, &devs[0]));
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_async[0],
+					&devs[1]));
+	dm_testdrv_async_supplier = devs[1];
+
+	ut_assertok(device_probe_list(devs, ARRAY_SIZE(devs)));
+	ut_assert(device_active(devs[0]));
+	ut_assert(device_active(devs[1]));
+
+	/* The user was called again until the supplier was ready */
+	priv_user = dev_get_priv(devs[0]);
+	priv_supplier = dev_get_priv(devs[1]);
+	ut_asserteq(4, priv_supplier->calls);
+	ut_assert(priv_user->calls > 1);
+	ut_assert(priv_user->last_call > priv_supplier->last_call);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_list_supplier, 0);
+
+/* Test that removing a device waits for its probe to finish */
+static int dm_test_probe_async_remove(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *dev;
+	int seq;
+
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_async[0],
+					&dev));
+	ut_asserteq(-EINPROGRESS, device_probe_async(dev));
+	seq = dm_testdrv_async_seq;
+
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_asserteq(seq + 3, dm_testdrv_async_seq);
+	ut_assert(!(dev->flags & DM_FLAG_ACTIVATED));
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_remove, 0);
+
 /*
  * Test that removal of devices, either via the "normal" device_remove()
  * API or via the device driver selective flag works as expected
@@ -794,6 +959,72 @@ static int dm_test_uclass_devices_find_by_name(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_uclass_devices_find_by_name, DM_TESTF_SCAN_FDT);
 
+/* Test finding devices in a uclass which is large enough to be indexed */
+static int dm_test_uclass_index(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	static char names[20][10];
+	struct udevice *devs[20];
+	const struct driver *drv;
+	struct udevice *dev;
+	int i;
+
+	drv = lists_driver_lookup_name("test_drv");
+	ut_assertnonnull(drv);
+	for (i = 0; i < ARRAY_SIZE(devs); i++) {
+		snprintf(names[i], sizeof(names[i]), "index%d", i);
+		ut_assertok(device_bind(dms->root, drv, names[i],
+					(void *)&test_pdata[0], -1, &devs[i]));
+	}
+
+	for (i = 0; i < ARRAY_SIZE(devs); i++) {
+		ut_assertok(uclass_find_device(UCLASS_TEST, i, &dev));
+		ut_asserteq_ptr(devs[i], dev);
+
+		/* "index1" must not find "index10", etc. */
+		ut_assertok(uclass_find_device_by_name(UCLASS_TEST, names[i],
+						       &dev));
+		ut_asserteq_ptr(devs[i], dev);
+	}
+	ut_asserteq(-ENODEV, uclass_find_device(UCLASS_TEST, ARRAY_SIZE(devs),
+						&dev));
+
+	/* A partial name finds the first device which matches */
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST, "index", &dev));
+	ut_asserteq_ptr(devs[0], dev);
+
+	/* Sequence numbers are allocated in probe order */
+	ut_assertok(device_probe(devs[5]));
+	ut_assertok(device_probe(devs[2]));
+	ut_assertok(uclass_find_device_by_seq(UCLASS_TEST, 0, false, &dev));
+	ut_asserteq_ptr(devs[5], dev);
+	ut_assertok(uclass_find_device_by_seq(UCLASS_TEST, 1, false, &dev));
+	ut_asserteq_ptr(devs[2], dev);
+	ut_asserteq(-ENODEV,
+		    uclass_find_device_by_seq(UCLASS_TEST, 2, false, &dev));
+
+	ut_assertok(device_remove(devs[5], DM_REMOVE_NORMAL));
+	ut_asserteq(-ENODEV,
+		    uclass_find_device_by_seq(UCLASS_TEST, 0, false, &dev));
+
+	/* Renaming a device moves it in the index */
+	ut_assertok(device_set_name(devs[3], "renamed"));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST, "renamed", &dev));
+	ut_asserteq_ptr(devs[3], dev);
+	ut_asserteq(-ENODEV,
+		    uclass_find_device_by_name(UCLASS_TEST, "index3", &dev));
+
+	/* Unbinding a device removes it */
+	ut_assertok(device_unbind(devs[0]));
+	ut_assertok(uclass_find_device(UCLASS_TEST, 0, &dev));
+	ut_asserteq_ptr(devs[1], dev);
+	ut_asserteq(-ENODEV,
+		    uclass_find_device_by_name(UCLASS_TEST, "index0", &dev));
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_index, 0);
+
 static int dm_test_uclass_devices_get(struct unit_test_state *uts)
 {
 	struct udevice *dev;
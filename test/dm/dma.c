@@ -10,7 +10,9 @@
 #include <dm.h>
 #include <dm/test.h>
 #include <dma.h>
+#include <malloc.h>
 #include <test/ut.h>
+#include <u-boot/crc.h>
 
 static int dm_test_dma_m2m(struct unit_test_state *uts)
 {
@@ -121,3 +123,71 @@ static int dm_test_dma_rx(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_dma_rx, DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_DMA_COPY
+/* Copy memory in the background with dma_copy_start() */
+static int dm_test_dma_copy(struct unit_test_state *uts)
+{
+	const size_t len = CONFIG_DMA_COPY_THRESHOLD * 2 + 100;
+	const size_t half = len / 2;
+	const size_t size = len + 16;
+	struct dma_copy copy, copy2;
+	u8 *src, *dst, *expect;
+	u32 crc;
+	int i;
+
+	src = malloc(size);
+	dst = malloc(size);
+	expect = malloc(size);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	ut_assertnonnull(expect);
+	for (i = 0; i < size; i++)
+		src[i] = i * 7 + (i >> 9);
+
+	/*
+	 * The ends are copied by the CPU straight away and the middle by the
+	 * engine, while the CPU works out a CRC of the source
+	 */
+	memset(dst, '\xaa', size);
+	memcpy(expect, dst, size);
+	memcpy(expect + 3, src + 5, len);
+	dma_copy_start(&copy, dst + 3, src + 5, len);
+	ut_assertnonnull(copy.dev);
+	ut_asserteq(src[5], dst[3]);
+	ut_asserteq(0xaa, dst[half]);
+	crc = crc32(0, src + 5, len);
+	dma_copy_wait(&copy);
+	ut_assertnull(copy.dev);
+	ut_asserteq_mem(expect, dst, size);
+	ut_asserteq(crc, crc32(0, dst + 3, len));
+
+	/* While the engine is busy, the CPU does other copies */
+	memset(dst, '\0', size);
+	dma_copy_start(&copy, dst, src, half);
+	ut_assertnonnull(copy.dev);
+	dma_copy_start(&copy2, dst + half, src + half, half);
+	ut_assertnull(copy2.dev);
+	dma_copy_wait(&copy);
+	ut_asserteq_mem(src, dst, half * 2);
+
+	/* Small copies are done by the CPU */
+	memset(dst, '\0', size);
+	dma_copy_start(&copy, dst, src, 100);
+	ut_assertnull(copy.dev);
+	ut_asserteq_mem(src, dst, 100);
+
+	/* So are overlapping ones */
+	memcpy(expect, src, size);
+	memmove(expect + 10, expect, len);
+	dma_copy(src + 10, src, len);
+	ut_asserteq_mem(expect, src, size);
+
+	free(expect);
+	free(dst);
+	free(src);
+
+	return 0;
+}
+DM_TEST(dm_test_dma_copy, DM_TESTF_SCAN_FDT);
+#endif
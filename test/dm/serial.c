@@ -9,6 +9,8 @@
 #include <dm/test.h>
 #include <test/ut.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static int dm_test_serial(struct unit_test_state *uts)
 {
 	struct serial_device_info info_serial = {0};
@@ -67,3 +69,44 @@ static int dm_test_serial(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_serial, DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+static int tx_pending(struct serial_dev_priv *upriv)
+{
+	return (upriv->tx_wr - upriv->tx_rd + CONFIG_SERIAL_TX_BUFFER_SIZE) %
+		CONFIG_SERIAL_TX_BUFFER_SIZE;
+}
+
+/* Test that output goes through the TX buffer and is held while silent */
+static int dm_test_serial_tx_buffer(struct unit_test_state *uts)
+{
+	struct serial_dev_priv *upriv;
+	ulong flags = gd->flags;
+
+	ut_assertnonnull(gd->cur_serial_dev);
+	upriv = dev_get_uclass_priv(gd->cur_serial_dev);
+	ut_assertnonnull(upriv->tx_buf);
+
+	/* sandbox_serial takes everything at once */
+	serial_puts("tx buffer\n");
+	ut_asserteq(0, tx_pending(upriv));
+
+	if (!IS_ENABLED(CONFIG_SERIAL_TX_BUFFER_SILENT))
+		return 0;
+
+	gd->flags |= GD_FLG_SILENT;
+	serial_puts("held\n");
+	serial_putc('x');
+	serial_tx_poll();
+	serial_flush();
+	/* the newline is sent as \r\n */
+	ut_asserteq(7, tx_pending(upriv));
+
+	gd->flags = flags;
+	serial_flush();
+	ut_asserteq(0, tx_pending(upriv));
+
+	return 0;
+}
+DM_TEST(dm_test_serial_tx_buffer, 0);
+#endif
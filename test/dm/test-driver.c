@@ -10,11 +10,14 @@
 #include <dm.h>
 #include <errno.h>
 #include <malloc.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <test/ut.h>
 #include <asm/io.h>
 
 int dm_testdrv_op_count[DM_TEST_OP_COUNT];
+int dm_testdrv_async_seq;
+struct udevice *dm_testdrv_async_supplier;
 static struct unit_test_state *uts = &global_dm_test_state;
 
 static int testdrv_ping(struct udevice *dev, int pingval, int *pingret)
@@ -167,3 +170,50 @@ U_BOOT_DRIVER(test_act_dma_drv) = {
 	.unbind	= test_manual_unbind,
 	.flags	= DM_FLAG_ACTIVE_DMA,
 };
+
+/*
+ * Pretend to wait for the hardware: the probe() method asks to be called
+ * again ping_add times before it completes
+ */
+static int test_async_probe(struct udevice *dev)
+{
+	const struct dm_test_pdata *pdata = dev_get_platdata(dev);
+	struct dm_test_async_priv *priv = dev_get_priv(dev);
+
+	if (!priv->calls++)
+		priv->first_call = dm_testdrv_async_seq;
+	priv->last_call = dm_testdrv_async_seq++;
+	priv->post_probes = dm_testdrv_op_count[DM_TEST_OP_POST_PROBE];
+	if (priv->calls <= pdata->ping_add)
+		return -EINPROGRESS;
+
+	return 0;
+}
+
+U_BOOT_DRIVER(test_async_drv) = {
+	.name	= "test_async_drv",
+	.id	= UCLASS_TEST,
+	.probe	= test_async_probe,
+	.priv_auto_alloc_size = sizeof(struct dm_test_async_priv),
+	.flags	= DM_FLAG_PROBE_ASYNC,
+};
+
+/* Use another device while probing, like a driver looking up a phandle */
+static int test_async_user_probe(struct udevice *dev)
+{
+	struct dm_test_async_priv *priv = dev_get_priv(dev);
+
+	if (!priv->calls++)
+		priv->first_call = dm_testdrv_async_seq;
+	priv->last_call = dm_testdrv_async_seq++;
+
+	return device_probe(dm_testdrv_async_supplier);
+}
+
+U_BOOT_DRIVER(test_async_user_drv) = {
+	.name	= "test_async_user_drv",
+	.id	= UCLASS_TEST,
+	.probe	= test_async_user_probe,
+	.priv_auto_alloc_size = sizeof(struct dm_test_async_priv),
+	.flags	= DM_FLAG_PROBE_ASYNC,
+};
@@ -10,79 +10,132 @@
 #include <test/env.h>
 #include <test/ut.h>
 
-static int env_test_attrs_lookup(struct unit_test_state *uts)
+typedef int (*lookup_func)(const char *attr_list, const char *name,
+			   char *attributes);
+
+/* Look up a name using an index built for the list */
+static int index_lookup(const char *attr_list, const char *name,
+			char *attributes)
+{
+	struct env_attr_index idx;
+	int ret;
+
+	memset(&idx, '\0', sizeof(idx));
+	ret = env_attr_index_build(&idx, attr_list);
+	if (!ret)
+		ret = env_attr_index_lookup(&idx, name, attributes);
+	env_attr_index_free(&idx);
+
+	return ret;
+}
+
+static int check_attrs_lookup(struct unit_test_state *uts,
+			      lookup_func lookup)
 {
 	char attrs[32];
 
-	ut_assertok(env_attr_lookup("foo:bar", "foo", attrs));
+	ut_assertok(lookup("foo:bar", "foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup(",foo:bar", "foo", attrs));
+	ut_assertok(lookup(",foo:bar", "foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup(",foo:bar,", "foo", attrs));
+	ut_assertok(lookup(",foo:bar,", "foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup(" foo:bar", "foo", attrs));
+	ut_assertok(lookup(" foo:bar", "foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup("foo : bar", "foo", attrs));
+	ut_assertok(lookup("foo : bar", "foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup(" foo: bar ", "foo", attrs));
+	ut_assertok(lookup(" foo: bar ", "foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup("foo:bar ", "foo", attrs));
+	ut_assertok(lookup("foo:bar ", "foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup(",foo:bar,goo:baz", "foo", attrs));
+	ut_assertok(lookup(",foo:bar,goo:baz", "foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_asserteq(-ENOENT, env_attr_lookup(",,", "foo", attrs));
+	ut_asserteq(-ENOENT, lookup(",,", "foo", attrs));
 
-	ut_asserteq(-ENOENT, env_attr_lookup("goo:baz", "foo", attrs));
+	ut_asserteq(-ENOENT, lookup("goo:baz", "foo", attrs));
 
-	ut_assertok(env_attr_lookup("foo:bar,foo:bat,foo:baz", "foo", attrs));
+	ut_assertok(lookup("foo:bar,foo:bat,foo:baz", "foo", attrs));
 	ut_asserteq_str("baz", attrs);
 
-	ut_assertok(env_attr_lookup(
+	ut_assertok(lookup(
 		" foo : bar , foo : bat , foot : baz ", "foo", attrs));
 	ut_asserteq_str("bat", attrs);
 
-	ut_assertok(env_attr_lookup(
+	ut_assertok(lookup(
 		" foo : bar , foo : bat , ufoo : baz ", "foo", attrs));
 	ut_asserteq_str("bat", attrs);
 
-	ut_asserteq(-EINVAL, env_attr_lookup(NULL, "foo", attrs));
-	ut_asserteq(-EINVAL, env_attr_lookup("foo:bar", "foo", NULL));
+	ut_asserteq(-EINVAL, lookup(NULL, "foo", attrs));
+	ut_asserteq(-EINVAL, lookup("foo:bar", "foo", NULL));
 
 	return 0;
 }
+
+static int env_test_attrs_lookup(struct unit_test_state *uts)
+{
+	return check_attrs_lookup(uts, env_attr_lookup);
+}
 ENV_TEST(env_test_attrs_lookup, 0);
 
+static int env_test_attrs_index(struct unit_test_state *uts)
+{
+	return check_attrs_lookup(uts, index_lookup);
+}
+ENV_TEST(env_test_attrs_index, 0);
+
 #ifdef CONFIG_REGEX
-static int env_test_attrs_lookup_regex(struct unit_test_state *uts)
+static int check_attrs_lookup_regex(struct unit_test_state *uts,
+				    lookup_func lookup)
 {
 	char attrs[32];
 
-	ut_assertok(env_attr_lookup("foo1?:bar", "foo", attrs));
+	ut_assertok(lookup("foo1?:bar", "foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup("foo1?:bar", "foo1", attrs));
+	ut_assertok(lookup("foo1?:bar", "foo1", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup(".foo:bar", ".foo", attrs));
+	ut_assertok(lookup(".foo:bar", ".foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup(".foo:bar", "ufoo", attrs));
+	ut_assertok(lookup(".foo:bar", "ufoo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_assertok(env_attr_lookup("\\.foo:bar", ".foo", attrs));
+	ut_assertok(lookup("\\.foo:bar", ".foo", attrs));
 	ut_asserteq_str("bar", attrs);
 
-	ut_asserteq(-ENOENT, env_attr_lookup("\\.foo:bar", "ufoo", attrs));
+	ut_asserteq(-ENOENT, lookup("\\.foo:bar", "ufoo", attrs));
+
+	/* The last matching entry wins, whether or not it is a regex */
+	ut_assertok(lookup("eth\\d*addr:mac,ethaddr:bar", "ethaddr", attrs));
+	ut_asserteq_str("bar", attrs);
+
+	ut_assertok(lookup("ethaddr:bar,eth\\d*addr:mac", "ethaddr", attrs));
+	ut_asserteq_str("mac", attrs);
+
+	ut_assertok(lookup("ethaddr:bar,eth\\d*addr:mac", "eth1addr", attrs));
+	ut_asserteq_str("mac", attrs);
 
 	return 0;
 }
+
+static int env_test_attrs_lookup_regex(struct unit_test_state *uts)
+{
+	return check_attrs_lookup_regex(uts, env_attr_lookup);
+}
 ENV_TEST(env_test_attrs_lookup_regex, 0);
+
+static int env_test_attrs_index_regex(struct unit_test_state *uts)
+{
+	return check_attrs_lookup_regex(uts, index_lookup);
+}
+ENV_TEST(env_test_attrs_index_regex, 0);
 #endif
@@ -13,6 +13,7 @@
 
 #define SIZE 32
 #define ITERATIONS 10000
+#define BENCH_SIZE 4096
 
 static int htab_fill(struct unit_test_state *uts,
 		     struct hsearch_data *htab, size_t size)
@@ -123,3 +124,76 @@ static int env_test_htab_deletes(struct unit_test_state *uts)
 }
 
 ENV_TEST(env_test_htab_deletes, 0);
+
+/* Add many more elements than the table was created for, so that it grows */
+static int env_test_htab_grow(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	ENTRY *ritem;
+	int idx, count;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(SIZE, &htab));
+
+	ut_assertok(htab_fill(uts, &htab, SIZE * 64));
+	ut_assertok(htab_check_fill(uts, &htab, SIZE * 64));
+	ut_asserteq(SIZE * 64, htab.filled);
+	ut_assert(htab.size > SIZE * 64);
+
+	ut_assertok(htab_create_delete(uts, &htab, ITERATIONS));
+	ut_assertok(htab_check_fill(uts, &htab, SIZE * 64));
+	ut_asserteq(SIZE * 64, htab.filled);
+
+	/* hmatch_r() must visit every element exactly once */
+	for (idx = 0, count = 0; (idx = hmatch_r("", idx, &ritem, &htab));)
+		count++;
+	ut_asserteq(SIZE * 64, count);
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_grow, 0);
+
+/* Time adding, finding and deleting a large number of elements */
+static int env_test_htab_bench(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	ulong start, enter_us, find_us, delete_us;
+	ENTRY item;
+	ENTRY *ritem;
+	char key[20];
+	int i;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(CONFIG_ENV_SIZE / 64, &htab));
+
+	start = timer_get_us();
+	ut_assertok(htab_fill(uts, &htab, BENCH_SIZE));
+	enter_us = timer_get_us() - start;
+
+	start = timer_get_us();
+	ut_assertok(htab_check_fill(uts, &htab, BENCH_SIZE));
+	find_us = timer_get_us() - start;
+
+	start = timer_get_us();
+	for (i = 0; i < BENCH_SIZE; i++) {
+		sprintf(key, "%d", i);
+		ut_asserteq(1, hdelete_r(key, &htab, 0));
+	}
+	delete_us = timer_get_us() - start;
+	ut_asserteq(0, htab.filled);
+
+	item.callback = NULL;
+	item.flags = 0;
+	item.key = "0";
+	ut_asserteq(0, hsearch_r(item, FIND, &ritem, &htab, 0));
+
+	printf("%d elements: enter %lu us, find %lu us, delete %lu us\n",
+	       BENCH_SIZE, enter_us, find_us, delete_us);
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_bench, 0);
@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the environment journal
+ */
+
+#include <common.h>
+#include <command.h>
+#include <env_journal.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+#define JOURNAL_SIZE	4096
+#define BLOCK_SIZE	512
+#define BASE_CRC	0x12345678
+
+static u8 journal_area[JOURNAL_SIZE];
+
+static int test_read(struct env_journal *jnl, ulong offset, ulong size,
+		     void *buf)
+{
+	memcpy(buf, journal_area + offset, size);
+
+	return 0;
+}
+
+/* Like NOR flash, writing can only clear bits */
+static int test_write_nor(struct env_journal *jnl, ulong offset, ulong size,
+			  const void *buf)
+{
+	const u8 *src = buf;
+	ulong i;
+
+	for (i = 0; i < size; i++)
+		journal_area[offset + i] &= src[i];
+
+	return 0;
+}
+
+static int test_erase_nor(struct env_journal *jnl)
+{
+	memset(journal_area, 0xff, JOURNAL_SIZE);
+
+	return 0;
+}
+
+static int test_write_blk(struct env_journal *jnl, ulong offset, ulong size,
+			  const void *buf)
+{
+	if (offset % BLOCK_SIZE || size % BLOCK_SIZE)
+		return -EINVAL;
+	memcpy(journal_area + offset, buf, size);
+
+	return 0;
+}
+
+static void setup_journal(struct env_journal *jnl, bool nor)
+{
+	memset(jnl, '\0', sizeof(*jnl));
+	jnl->read = test_read;
+	if (nor) {
+		jnl->write = test_write_nor;
+		jnl->erase = test_erase_nor;
+		jnl->write_size = 1;
+	} else {
+		jnl->write = test_write_blk;
+		jnl->write_size = BLOCK_SIZE;
+	}
+	jnl->size = JOURNAL_SIZE;
+}
+
+static void free_journal(struct env_journal *jnl)
+{
+	free(jnl->buf);
+	free(jnl->saved);
+}
+
+static int set_var(struct hsearch_data *htab, const char *name,
+		   const char *value)
+{
+	ENTRY e, *ep;
+
+	e.key = name;
+	e.data = (char *)value;
+
+	return hsearch_r(e, ENTER, &ep, htab, 0) ? 0 : -EINVAL;
+}
+
+static const char *get_var(struct hsearch_data *htab, const char *name)
+{
+	ENTRY e, *ep;
+
+	e.key = name;
+	e.data = NULL;
+	hsearch_r(e, FIND, &ep, htab, 0);
+
+	return ep ? ep->data : NULL;
+}
+
+/* Set up the environment as stored, before any journal records */
+static int setup_base(struct unit_test_state *uts, struct hsearch_data *htab)
+{
+	memset(htab, '\0', sizeof(*htab));
+	ut_asserteq(1, hcreate_r(64, htab));
+	ut_assertok(set_var(htab, "alpha", "1"));
+	ut_assertok(set_var(htab, "beta", "2"));
+	ut_assertok(set_var(htab, "gamma", "3"));
+
+	return 0;
+}
+
+/* Save some changes, then check that loading replays them */
+static int check_journal(struct unit_test_state *uts, bool nor)
+{
+	struct hsearch_data htab, loaded;
+	struct env_journal jnl, jnl2;
+
+	setup_journal(&jnl, nor);
+	ut_assertok(setup_base(uts, &htab));
+	ut_assertok(env_journal_reset(&jnl, &htab, BASE_CRC));
+
+	/* Nothing has changed yet */
+	ut_assertok(env_journal_append(&jnl, &htab));
+	ut_asserteq(sizeof(struct env_journal_hdr), jnl.end);
+
+	ut_assertok(set_var(&htab, "beta", "20"));
+	ut_asserteq(1, hdelete_r("gamma", &htab, 0));
+	ut_assertok(set_var(&htab, "delta", "4"));
+	ut_assertok(env_journal_append(&jnl, &htab));
+
+	ut_assertok(set_var(&htab, "beta", "21"));
+	ut_assertok(env_journal_append(&jnl, &htab));
+
+	setup_journal(&jnl2, nor);
+	ut_assertok(setup_base(uts, &loaded));
+	ut_assertok(env_journal_load(&jnl2, &loaded, BASE_CRC));
+	ut_assert(jnl2.attached);
+	ut_asserteq(jnl.end, jnl2.end);
+	ut_asserteq_str("1", get_var(&loaded, "alpha"));
+	ut_asserteq_str("21", get_var(&loaded, "beta"));
+	ut_assertnull(get_var(&loaded, "gamma"));
+	ut_asserteq_str("4", get_var(&loaded, "delta"));
+	hdestroy_r(&loaded);
+	free_journal(&jnl2);
+
+	/* A journal for a different environment must be ignored */
+	setup_journal(&jnl2, nor);
+	ut_assertok(setup_base(uts, &loaded));
+	ut_assertok(env_journal_load(&jnl2, &loaded, ~BASE_CRC));
+	ut_assert(!jnl2.attached);
+	ut_asserteq_str("2", get_var(&loaded, "beta"));
+	ut_asserteq(-ENOSPC, env_journal_append(&jnl2, &loaded));
+	hdestroy_r(&loaded);
+	free_journal(&jnl2);
+
+	hdestroy_r(&htab);
+	free_journal(&jnl);
+
+	return 0;
+}
+
+static int env_test_journal_nor(struct unit_test_state *uts)
+{
+	return check_journal(uts, true);
+}
+ENV_TEST(env_test_journal_nor, 0);
+
+static int env_test_journal_blk(struct unit_test_state *uts)
+{
+	return check_journal(uts, false);
+}
+ENV_TEST(env_test_journal_blk, 0);
+
+/* Keep changing a counter until the journal fills up, then reset it */
+static int check_journal_full(struct unit_test_state *uts, bool nor)
+{
+	struct hsearch_data htab, loaded;
+	struct env_journal jnl, jnl2;
+	char count[12];
+	int i, ret;
+
+	setup_journal(&jnl, nor);
+	ut_assertok(setup_base(uts, &htab));
+	ut_assertok(env_journal_reset(&jnl, &htab, BASE_CRC));
+
+	for (i = 0; ; i++) {
+		snprintf(count, sizeof(count), "%d", i);
+		ut_assertok(set_var(&htab, "bootcount", count));
+		ret = env_journal_append(&jnl, &htab);
+		if (ret)
+			break;
+	}
+	ut_asserteq(-ENOSPC, ret);
+	ut_assert(i > 100);
+
+	/* The last change was not saved */
+	setup_journal(&jnl2, nor);
+	ut_assertok(setup_base(uts, &loaded));
+	ut_assertok(env_journal_load(&jnl2, &loaded, BASE_CRC));
+	snprintf(count, sizeof(count), "%d", i - 1);
+	ut_asserteq_str(count, get_var(&loaded, "bootcount"));
+	hdestroy_r(&loaded);
+	free_journal(&jnl2);
+
+	/*
+	 * After a full save, the new journal applies to the new environment.
+	 * On block devices the old records are still there, but must not be
+	 * replayed.
+	 */
+	ut_assertok(env_journal_reset(&jnl, &htab, ~BASE_CRC));
+	ut_assertok(set_var(&htab, "alpha", "10"));
+	ut_assertok(env_journal_append(&jnl, &htab));
+
+	setup_journal(&jnl2, nor);
+	ut_assertok(setup_base(uts, &loaded));
+	ut_assertok(env_journal_load(&jnl2, &loaded, ~BASE_CRC));
+	ut_assert(jnl2.attached);
+	ut_asserteq(jnl.end, jnl2.end);
+	ut_asserteq_str("10", get_var(&loaded, "alpha"));
+	ut_assertnull(get_var(&loaded, "bootcount"));
+	hdestroy_r(&loaded);
+	free_journal(&jnl2);
+
+	hdestroy_r(&htab);
+	free_journal(&jnl);
+
+	return 0;
+}
+
+static int env_test_journal_full_nor(struct unit_test_state *uts)
+{
+	return check_journal_full(uts, true);
+}
+ENV_TEST(env_test_journal_full_nor, 0);
+
+static int env_test_journal_full_blk(struct unit_test_state *uts)
+{
+	return check_journal_full(uts, false);
+}
+ENV_TEST(env_test_journal_full_blk, 0);
+
+/* An interrupted write on NOR flash stops further appends */
+static int env_test_journal_torn(struct unit_test_state *uts)
+{
+	struct hsearch_data htab, loaded;
+	struct env_journal jnl, jnl2;
+	ulong end;
+
+	setup_journal(&jnl, true);
+	ut_assertok(setup_base(uts, &htab));
+	ut_assertok(env_journal_reset(&jnl, &htab, BASE_CRC));
+	ut_assertok(set_var(&htab, "beta", "20"));
+	ut_assertok(env_journal_append(&jnl, &htab));
+	end = jnl.end;
+	ut_assertok(set_var(&htab, "beta", "21"));
+	ut_assertok(env_journal_append(&jnl, &htab));
+
+	/* Lose the end of the last record */
+	memset(journal_area + jnl.end - 4, 0xff, 4);
+
+	setup_journal(&jnl2, true);
+	ut_assertok(setup_base(uts, &loaded));
+	ut_assertok(env_journal_load(&jnl2, &loaded, BASE_CRC));
+	ut_asserteq(end, jnl2.end);
+	ut_assert(jnl2.full);
+	ut_asserteq_str("20", get_var(&loaded, "beta"));
+	ut_asserteq(-ENOSPC, env_journal_append(&jnl2, &loaded));
+	hdestroy_r(&loaded);
+	free_journal(&jnl2);
+
+	hdestroy_r(&htab);
+	free_journal(&jnl);
+
+	return 0;
+}
+ENV_TEST(env_test_journal_torn, 0);
@@ -0,0 +1,395 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for applying bsdiff patches
+ *
+ * A patch is built from a list of control triples, then applied to an old
+ * image in memory or on sandbox host block devices. The result is checked
+ * against a simple reference implementation.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <bspatch.h>
+#include <bzlib.h>
+#include <hash.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <os.h>
+#include <sandboxblockdev.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <asm/unaligned.h>
+
+#define OLD_SIZE	100000
+#define NEW_MAX		200000
+#define PATCH_MAX	100000
+
+/* Host block device images: the old image area, then the new image area */
+#define BLK_SIZE	512
+#define OLD_BLKS	256
+#define NEW_BLKS	768
+
+/* Control triples: bytes to add to the old image, bytes to insert, seek */
+static const s64 triples[][3] = {
+	{ 50000, 1000, 2000 },
+	{ 30000, 0, -90000 },
+	{ 10000, 70000, 94000 },
+	{ 6000, 10, 0 },
+};
+
+/**
+ * struct bspatch_test - Memory-backed images for the tests
+ *
+ * @old:	Old image
+ * @out:	New image, as written by bspatch()
+ * @out_len:	Number of bytes written to @out
+ */
+struct bspatch_test {
+	u8 *old;
+	u8 *out;
+	ulong out_len;
+};
+
+static int bspatch_test_read(struct bspatch_io *io, u64 offset, void *buf,
+			     ulong len)
+{
+	struct bspatch_test *priv = io->priv;
+
+	if (offset + len > OLD_SIZE)
+		return -EFAULT;
+	memcpy(buf, priv->old + offset, len);
+
+	return 0;
+}
+
+static int bspatch_test_write(struct bspatch_io *io, const void *buf,
+			      ulong len)
+{
+	struct bspatch_test *priv = io->priv;
+
+	if (priv->out_len + len > NEW_MAX)
+		return -EFAULT;
+	memcpy(priv->out + priv->out_len, buf, len);
+	priv->out_len += len;
+
+	return 0;
+}
+
+static void offtout(s64 val, u8 *buf)
+{
+	put_unaligned_le64(val < 0 ? -val | 1ULL << 63 : val, buf);
+}
+
+static int compress(u8 *dst, u8 *src, uint len)
+{
+	uint dst_len = PATCH_MAX;
+
+	if (BZ2_bzBuffToBuffCompress((char *)dst, &dst_len, (char *)src, len,
+				     1, 0, 0) != BZ_OK)
+		return -1;
+
+	return dst_len;
+}
+
+/*
+ * Build a patch from the triples, with made-up diff and extra bytes,
+ * returning its size. The new image is written to @expect.
+ */
+static int make_patch(u8 *patch, const u8 *old, u8 *expect, ulong *new_sizep)
+{
+	u8 *ctrl, *diff, *extra;
+	int ctrl_len = 0, diff_len = 0, extra_len = 0;
+	s64 old_pos = 0;
+	ulong new_pos = 0;
+	int i, j, size;
+
+	ctrl = malloc(PATCH_MAX);
+	diff = malloc(NEW_MAX);
+	extra = malloc(NEW_MAX);
+	if (!ctrl || !diff || !extra)
+		return -1;
+
+	for (i = 0; i < ARRAY_SIZE(triples); i++) {
+		offtout(triples[i][0], ctrl + ctrl_len);
+		offtout(triples[i][1], ctrl + ctrl_len + 8);
+		offtout(triples[i][2], ctrl + ctrl_len + 16);
+		ctrl_len += 24;
+
+		for (j = 0; j < triples[i][0]; j++) {
+			u8 val = j % 97 ? 0 : j;
+
+			diff[diff_len++] = val;
+			if (old_pos + j >= 0 && old_pos + j < OLD_SIZE)
+				val += old[old_pos + j];
+			expect[new_pos++] = val;
+		}
+		old_pos += triples[i][0];
+		for (j = 0; j < triples[i][1]; j++) {
+			extra[extra_len++] = j * 7;
+			expect[new_pos++] = j * 7;
+		}
+		old_pos += triples[i][2];
+	}
+	*new_sizep = new_pos;
+
+	memcpy(patch, BSPATCH_MAGIC, 8);
+	offtout(new_pos, patch + 24);
+	size = BSPATCH_HDR_SIZE;
+	ctrl_len = compress(patch + size, ctrl, ctrl_len);
+	offtout(ctrl_len, patch + 8);
+	size += ctrl_len;
+	diff_len = compress(patch + size, diff, diff_len);
+	offtout(diff_len, patch + 16);
+	size += diff_len;
+	size += compress(patch + size, extra, extra_len);
+
+	free(extra);
+	free(diff);
+	free(ctrl);
+
+	return size;
+}
+
+static void make_old(u8 *old)
+{
+	int i;
+
+	for (i = 0; i < OLD_SIZE; i++)
+		old[i] = i * 13 + (i >> 8);
+}
+
+/* Apply a patch and check the new image */
+static int lib_test_bspatch(struct unit_test_state *uts)
+{
+	struct bspatch_test priv;
+	struct bspatch_io io;
+	u8 *patch, *expect;
+	ulong new_size;
+	u64 size;
+	int len;
+
+	priv.old = malloc(OLD_SIZE);
+	priv.out = malloc(NEW_MAX);
+	expect = malloc(NEW_MAX);
+	patch = malloc(PATCH_MAX);
+	ut_assertnonnull(priv.old);
+	ut_assertnonnull(priv.out);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(patch);
+	make_old(priv.old);
+	len = make_patch(patch, priv.old, expect, &new_size);
+	ut_assert(len > 0);
+
+	ut_assertok(bspatch_new_size(patch, len, &size));
+	ut_asserteq(new_size, size);
+
+	io.read_old = bspatch_test_read;
+	io.write_new = bspatch_test_write;
+	io.priv = &priv;
+	priv.out_len = 0;
+	ut_assertok(bspatch(patch, len, OLD_SIZE, &io));
+	ut_asserteq(new_size, priv.out_len);
+	ut_asserteq_mem(expect, priv.out, new_size);
+
+	/* Truncated patch */
+	priv.out_len = 0;
+	ut_asserteq(-EINVAL, bspatch(patch, len - 100, OLD_SIZE, &io));
+
+	/* New image larger than the control data allows for */
+	offtout(new_size + 1, patch + 24);
+	priv.out_len = 0;
+	ut_asserteq(-EINVAL, bspatch(patch, len, OLD_SIZE, &io));
+
+	/* Bad header */
+	patch[0] = 'X';
+	ut_asserteq(-EINVAL, bspatch_new_size(patch, len, &size));
+	ut_asserteq(-EINVAL, bspatch(patch, len, OLD_SIZE, &io));
+
+	free(patch);
+	free(expect);
+	free(priv.out);
+	free(priv.old);
+
+	return 0;
+}
+LIB_TEST(lib_test_bspatch, 0);
+
+#ifdef CONFIG_SANDBOX
+/*
+ * Write a host block device image of @blks blocks, with @old at the start and
+ * the rest filled with 0xff, and bind it to host device @devnum
+ */
+static int bspatch_test_bind(struct unit_test_state *uts, int devnum,
+			     const char *fname, const u8 *old, ulong blks,
+			     struct blk_desc **descp)
+{
+	ulong size = blks * BLK_SIZE;
+	u8 *buf;
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	memset(buf, 0xff, size);
+	if (old)
+		memcpy(buf, old, OLD_SIZE);
+	ut_assertok(os_write_file(fname, buf, size));
+	free(buf);
+	ut_assertok(host_dev_bind(devnum, (char *)fname));
+	*descp = blk_get_dev("host", devnum);
+	ut_assertnonnull(*descp);
+
+	return 0;
+}
+
+/* Check the new image at block @start of @desc, including its padding */
+static int bspatch_test_check(struct unit_test_state *uts,
+			      struct blk_desc *desc, lbaint_t start,
+			      const u8 *expect, ulong new_size)
+{
+	ulong blks = DIV_ROUND_UP(new_size, BLK_SIZE);
+	u8 *buf;
+	ulong i;
+
+	buf = malloc(blks * BLK_SIZE);
+	ut_assertnonnull(buf);
+	ut_asserteq(blks, blk_dread(desc, start, blks, buf));
+	ut_asserteq_mem(expect, buf, new_size);
+	for (i = new_size; i < blks * BLK_SIZE; i++)
+		ut_asserteq(0, buf[i]);
+	free(buf);
+
+	return 0;
+}
+
+/* Apply a patch from one area of a host block device to another */
+static int lib_test_bspatch_blk(struct unit_test_state *uts)
+{
+	disk_partition_t old_part, new_part;
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+	struct blk_desc *desc;
+	u8 *old, *expect, *patch;
+	int len, digest_len;
+	ulong new_size;
+
+	old = malloc(OLD_SIZE);
+	expect = malloc(NEW_MAX);
+	patch = malloc(PATCH_MAX);
+	ut_assertnonnull(old);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(patch);
+	make_old(old);
+	len = make_patch(patch, old, expect, &new_size);
+	ut_assert(len > 0);
+	digest_len = sizeof(digest);
+	ut_assertok(hash_block("sha256", expect, new_size, digest,
+			       &digest_len));
+
+	ut_assertok(bspatch_test_bind(uts, 0, "bspatch.img", old,
+				      OLD_BLKS + NEW_BLKS, &desc));
+	memset(&old_part, '\0', sizeof(old_part));
+	old_part.size = OLD_BLKS;
+	old_part.blksz = BLK_SIZE;
+	new_part = old_part;
+	new_part.start = OLD_BLKS;
+	new_part.size = NEW_BLKS;
+
+	ut_assertok(bspatch_blk(patch, len, desc, &old_part, OLD_SIZE, desc,
+				&new_part, "sha256", digest));
+	ut_assertok(bspatch_test_check(uts, desc, OLD_BLKS, expect, new_size));
+
+	/* Wrong digest */
+	digest[0] ^= 1;
+	ut_asserteq(-EBADMSG, bspatch_blk(patch, len, desc, &old_part,
+					  OLD_SIZE, desc, &new_part, "sha256",
+					  digest));
+
+	/* Old image larger than its area */
+	ut_asserteq(-ENOSPC, bspatch_blk(patch, len, desc, &old_part,
+					 OLD_BLKS * BLK_SIZE + 1, desc,
+					 &new_part, NULL, NULL));
+
+	/* Too little space for the new image */
+	new_part.size = new_size / BLK_SIZE;
+	ut_asserteq(-ENOSPC, bspatch_blk(patch, len, desc, &old_part,
+					 OLD_SIZE, desc, &new_part, NULL,
+					 NULL));
+
+	/* Overlapping areas */
+	new_part.start = OLD_BLKS - 1;
+	new_part.size = NEW_BLKS;
+	ut_asserteq(-EINVAL, bspatch_blk(patch, len, desc, &old_part,
+					 OLD_SIZE, desc, &new_part, NULL,
+					 NULL));
+
+	ut_assertok(host_dev_bind(0, NULL));
+	os_unlink("bspatch.img");
+	free(patch);
+	free(expect);
+	free(old);
+
+	return 0;
+}
+LIB_TEST(lib_test_bspatch_blk, 0);
+
+#ifdef CONFIG_CMD_BSPATCH
+/* Apply a patch with the bspatch command, from one host device to another */
+static int lib_test_bspatch_cmd(struct unit_test_state *uts)
+{
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+	char hex[HASH_MAX_DIGEST_SIZE * 2 + 1];
+	struct blk_desc *old_desc, *new_desc;
+	u8 *old, *expect, *patch;
+	int len, digest_len, i;
+	char cmd[200];
+	ulong new_size;
+
+	old = malloc(OLD_SIZE);
+	expect = malloc(NEW_MAX);
+	patch = malloc(PATCH_MAX);
+	ut_assertnonnull(old);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(patch);
+	make_old(old);
+	len = make_patch(patch, old, expect, &new_size);
+	ut_assert(len > 0);
+	digest_len = sizeof(digest);
+	ut_assertok(hash_block("sha256", expect, new_size, digest,
+			       &digest_len));
+	for (i = 0; i < digest_len; i++)
+		sprintf(hex + i * 2, "%02x", digest[i]);
+
+	ut_assertok(bspatch_test_bind(uts, 0, "bspatch0.img", old, OLD_BLKS,
+				      &old_desc));
+	ut_assertok(bspatch_test_bind(uts, 1, "bspatch1.img", NULL, NEW_BLKS,
+				      &new_desc));
+
+	snprintf(cmd, sizeof(cmd), "bspatch host 0 1 %lx %x sha256 %s %x",
+		 (ulong)map_to_sysmem(patch), len, hex, OLD_SIZE);
+	ut_assertok(run_command(cmd, 0));
+	ut_assertok(bspatch_test_check(uts, new_desc, 0, expect, new_size));
+
+	/* Wrong digest */
+	hex[0] = hex[0] == '0' ? '1' : '0';
+	snprintf(cmd, sizeof(cmd), "bspatch host 0 1 %lx %x sha256 %s %x",
+		 (ulong)map_to_sysmem(patch), len, hex, OLD_SIZE);
+	ut_assert(run_command(cmd, 0));
+
+	/* Missing digest */
+	snprintf(cmd, sizeof(cmd), "bspatch host 0 1 %lx %x sha256",
+		 (ulong)map_to_sysmem(patch), len);
+	ut_assert(run_command(cmd, 0));
+
+	ut_assertok(host_dev_bind(1, NULL));
+	ut_assertok(host_dev_bind(0, NULL));
+	os_unlink("bspatch1.img");
+	os_unlink("bspatch0.img");
+	free(patch);
+	free(expect);
+	free(old);
+
+	return 0;
+}
+LIB_TEST(lib_test_bspatch_cmd, 0);
+#endif
+#endif
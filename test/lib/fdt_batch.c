@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for batched device tree edits
+ */
+
+#include <common.h>
+#include <fdt_batch.h>
+#include <fdt_support.h>
+#include <fdtdec.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define FDT_BATCH_TEST_SIZE	1024
+
+static const u8 fdt_batch_mac[] = { 0x02, 0x00, 0x11, 0x22, 0x33, 0x44 };
+
+/* Set up a small tree to edit */
+static int fdt_batch_test_setup(struct unit_test_state *uts, void *fdt)
+{
+	int node;
+
+	ut_assertok(fdt_create_empty_tree(fdt, FDT_BATCH_TEST_SIZE));
+	ut_assertok(fdt_setprop_string(fdt, 0, "model", "test"));
+	ut_assertok(fdt_add_mem_rsv(fdt, 0x1000, 0x100));
+	node = fdt_add_subnode(fdt, 0, "chosen");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop_string(fdt, node, "bootargs", "old"));
+	node = fdt_add_subnode(fdt, 0, "eth@1");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop_string(fdt, node, "status", "okay"));
+	ut_assertok(fdt_setprop(fdt, node, "mac-address", fdt_batch_mac, 6));
+	node = fdt_add_subnode(fdt, 0, "eth@2");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop_string(fdt, node, "status", "okay"));
+	node = fdt_add_subnode(fdt, node, "phy");
+	ut_assert(node >= 0);
+
+	return 0;
+}
+
+static int lib_test_fdt_batch(struct unit_test_state *uts)
+{
+	static const u8 mac[] = { 0x02, 0x00, 0xaa, 0xbb, 0xcc, 0xdd };
+	char fdt[FDT_BATCH_TEST_SIZE];
+	struct fdt_batch batch;
+	const void *val;
+	int root, node, child, len;
+	u64 addr, size;
+
+	ut_assertok(fdt_batch_test_setup(uts, fdt));
+	ut_assertok(fdt_batch_init(&batch, fdt));
+
+	node = fdt_batch_path(&batch, "/chosen");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_batch_setprop_string(&batch, node, "bootargs",
+					     "console=ttyS0"));
+	ut_assertok(fdt_batch_setprop_u32(&batch, node, "count", 3));
+	ut_asserteq(-FDT_ERR_NOTFOUND, fdt_batch_path(&batch, "/missing"));
+
+	ut_assertok(fdt_batch_fixup_by_path(&batch, "/eth@1", "mac-address",
+					    mac, 6, false));
+	ut_assertok(fdt_batch_fixup_by_path(&batch, "/eth@2", "mac-address",
+					    mac, 6, false));
+	ut_assertok(fdt_batch_fixup_by_path(&batch, "/eth@2",
+					    "local-mac-address", mac, 6, true));
+	node = fdt_batch_path(&batch, "/eth@1");
+	ut_assertok(fdt_batch_delprop(&batch, node, "status"));
+	node = fdt_batch_path(&batch, "/eth@2/phy");
+	ut_assertok(fdt_batch_delnode(&batch, node));
+
+	root = fdt_batch_node(&batch, 0);
+	ut_assert(root >= 0);
+	node = fdt_batch_subnode(&batch, root, "reserved-memory");
+	ut_assert(node >= 0);
+	child = fdt_batch_subnode(&batch, node, "region@0");
+	ut_assert(child >= 0);
+	ut_assertok(fdt_batch_setprop_string(&batch, child, "compatible",
+					     "shared-dma-pool"));
+
+	/* Existing and pending nodes are found again, not added */
+	ut_asserteq(node, fdt_batch_subnode(&batch, root, "reserved-memory"));
+	ut_asserteq(fdt_batch_path(&batch, "/chosen"),
+		    fdt_batch_subnode(&batch, root, "chosen"));
+
+	/* Nothing changes until the batch is applied */
+	ut_asserteq_str("old", fdt_getprop(fdt, fdt_path_offset(fdt, "/chosen"),
+					   "bootargs", NULL));
+	ut_assertok(fdt_batch_apply(&batch));
+	ut_asserteq(0, batch.node_count);
+
+	node = fdt_path_offset(fdt, "/chosen");
+	ut_assert(node >= 0);
+	ut_asserteq_str("console=ttyS0", fdt_getprop(fdt, node, "bootargs",
+						     NULL));
+	ut_asserteq(3, fdtdec_get_int(fdt, node, "count", 0));
+	ut_asserteq_str("test", fdt_getprop(fdt, 0, "model", NULL));
+
+	node = fdt_path_offset(fdt, "/eth@1");
+	val = fdt_getprop(fdt, node, "mac-address", &len);
+	ut_asserteq(6, len);
+	ut_asserteq_mem(mac, val, 6);
+	ut_assertnull(fdt_getprop(fdt, node, "status", NULL));
+
+	node = fdt_path_offset(fdt, "/eth@2");
+	ut_assertnull(fdt_getprop(fdt, node, "mac-address", NULL));
+	ut_asserteq_mem(mac, fdt_getprop(fdt, node, "local-mac-address", NULL),
+			6);
+	ut_asserteq_str("okay", fdt_getprop(fdt, node, "status", NULL));
+	ut_asserteq(-FDT_ERR_NOTFOUND, fdt_path_offset(fdt, "/eth@2/phy"));
+
+	node = fdt_path_offset(fdt, "/reserved-memory/region@0");
+	ut_assert(node >= 0);
+	ut_asserteq_str("shared-dma-pool", fdt_getprop(fdt, node, "compatible",
+						       NULL));
+
+	/* The new node goes before the existing ones, as fdt_add_subnode() */
+	ut_asserteq_str("reserved-memory",
+			fdt_get_name(fdt, fdt_first_subnode(fdt, 0), NULL));
+
+	ut_asserteq(1, fdt_num_mem_rsv(fdt));
+	ut_assertok(fdt_get_mem_rsv(fdt, 0, &addr, &size));
+	ut_asserteq(0x1000, addr);
+	ut_asserteq(0x100, size);
+	ut_asserteq(FDT_BATCH_TEST_SIZE, fdt_totalsize(fdt));
+
+	return 0;
+}
+LIB_TEST(lib_test_fdt_batch, 0);
+
+/* Check that a batch which does not fit leaves the tree alone */
+static int lib_test_fdt_batch_nospace(struct unit_test_state *uts)
+{
+	char fdt[FDT_BATCH_TEST_SIZE];
+	char big[FDT_BATCH_TEST_SIZE];
+	struct fdt_batch batch;
+	int node;
+
+	ut_assertok(fdt_batch_test_setup(uts, fdt));
+	ut_assertok(fdt_pack(fdt));
+	ut_assertok(fdt_batch_init(&batch, fdt));
+
+	memset(big, '\xa5', sizeof(big));
+	node = fdt_batch_path(&batch, "/chosen");
+	ut_assertok(fdt_batch_setprop(&batch, node, "big", big, 200));
+	ut_asserteq(-FDT_ERR_NOSPACE, fdt_batch_apply(&batch));
+	ut_assertnull(fdt_getprop(fdt, fdt_path_offset(fdt, "/chosen"), "big",
+				  NULL));
+
+	/* The batch can be applied once there is room */
+	ut_assertok(fdt_open_into(fdt, fdt, sizeof(fdt)));
+	ut_assertok(fdt_batch_apply(&batch));
+	ut_asserteq_mem(big, fdt_getprop(fdt, fdt_path_offset(fdt, "/chosen"),
+					 "big", NULL), 200);
+	fdt_batch_uninit(&batch);
+
+	return 0;
+}
+LIB_TEST(lib_test_fdt_batch_nospace, 0);
+
+/* Check that a batch which does not fit is retried with a larger tree */
+static int lib_test_fdt_batch_resize(struct unit_test_state *uts)
+{
+	char fdt[FDT_BATCH_TEST_SIZE];
+	char big[FDT_BATCH_TEST_SIZE];
+	struct fdt_batch batch;
+	int node, size;
+
+	ut_assertok(fdt_batch_test_setup(uts, fdt));
+	ut_assertok(fdt_pack(fdt));
+	size = fdt_totalsize(fdt);
+	ut_assertok(fdt_batch_init(&batch, fdt));
+
+	memset(big, '\xa5', sizeof(big));
+	node = fdt_batch_path(&batch, "/chosen");
+	ut_assertok(fdt_batch_setprop(&batch, node, "big", big, 200));
+	ut_assertok(fdt_batch_apply_resize(&batch));
+	ut_assert(fdt_totalsize(fdt) > size);
+	ut_assert(fdt_totalsize(fdt) <= sizeof(fdt));
+	ut_asserteq_mem(big, fdt_getprop(fdt, fdt_path_offset(fdt, "/chosen"),
+					 "big", NULL), 200);
+	fdt_batch_uninit(&batch);
+
+	return 0;
+}
+LIB_TEST(lib_test_fdt_batch_resize, 0);
+
+/* Check the standard fixups, which use a batch, on a tree with no room */
+static int lib_test_fdt_batch_fixups(struct unit_test_state *uts)
+{
+	const fdt32_t mem_reg[] = {
+		0, cpu_to_fdt32(0x1000000), 0, cpu_to_fdt32(0x100000),
+		0, cpu_to_fdt32(0x4000000), 0, cpu_to_fdt32(0x200000),
+	};
+	const fdt32_t rsv_reg[] = {
+		0, cpu_to_fdt32(0x1080000), 0, cpu_to_fdt32(0x10000),
+	};
+	struct fdt_memory carveout = {
+		.start = 0x1080000,
+		.end = 0x108ffff,
+	};
+	u64 start[] = { 0x1000000, 0x4000000 };
+	u64 size[] = { 0x100000, 0x200000 };
+	char fdt[FDT_BATCH_TEST_SIZE * 2];
+	u32 phandle, phandle2;
+	char *old_bootargs;
+	const char *str;
+	int node, len;
+
+	ut_assertok(fdt_batch_test_setup(uts, fdt));
+	ut_assertok(fdt_setprop_u32(fdt, 0, "#address-cells", 2));
+	ut_assertok(fdt_setprop_u32(fdt, 0, "#size-cells", 2));
+	ut_assertok(fdt_pack(fdt));
+
+	str = env_get("bootargs");
+	old_bootargs = str ? strdup(str) : NULL;
+	ut_assertok(env_set("bootargs", "console=ttyS0 quiet"));
+	ut_assertok(fdt_chosen(fdt));
+	ut_assertok(env_set("bootargs", old_bootargs));
+	free(old_bootargs);
+	node = fdt_path_offset(fdt, "/chosen");
+	ut_asserteq_str("console=ttyS0 quiet",
+			fdt_getprop(fdt, node, "bootargs", NULL));
+
+	ut_assertok(fdt_initrd(fdt, 0x2000000, 0x2100000));
+	node = fdt_path_offset(fdt, "/chosen");
+	ut_asserteq(0x2000000, fdtdec_get_uint64(fdt, node,
+						 "linux,initrd-start", 0));
+	ut_asserteq(0x2100000, fdtdec_get_uint64(fdt, node,
+						 "linux,initrd-end", 0));
+	ut_asserteq(2, fdt_num_mem_rsv(fdt));
+
+	ut_assertok(fdt_fixup_memory_banks(fdt, start, size, 2));
+	node = fdt_path_offset(fdt, "/memory");
+	ut_assert(node >= 0);
+	ut_asserteq_str("memory", fdt_getprop(fdt, node, "device_type", NULL));
+	ut_asserteq_mem(mem_reg, fdt_getprop(fdt, node, "reg", &len),
+			sizeof(mem_reg));
+	ut_asserteq(sizeof(mem_reg), len);
+
+	ut_assertok(fdtdec_add_reserved_memory(fdt, "rsv", &carveout,
+					       &phandle));
+	node = fdt_path_offset(fdt, "/reserved-memory/rsv@1080000");
+	ut_assert(node >= 0);
+	ut_asserteq(phandle, fdt_get_phandle(fdt, node));
+	ut_asserteq_mem(rsv_reg, fdt_getprop(fdt, node, "reg", &len),
+			sizeof(rsv_reg));
+	ut_asserteq(2, fdtdec_get_int(fdt, fdt_parent_offset(fdt, node),
+				      "#address-cells", 0));
+
+	/* The same region gives the same node */
+	ut_assertok(fdtdec_add_reserved_memory(fdt, "rsv", &carveout,
+					       &phandle2));
+	ut_asserteq(phandle, phandle2);
+
+	/* Each fixup grew the tree as needed, within the buffer */
+	ut_assert(fdt_totalsize(fdt) <= sizeof(fdt));
+	ut_assertok(fdt_check_header(fdt));
+
+	return 0;
+}
+LIB_TEST(lib_test_fdt_batch_fixups, 0);
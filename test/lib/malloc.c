@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests and benchmark for the malloc() implementation
+ *
+ * These work with whichever allocator is selected, so that dlmalloc and TLSF
+ * can be compared by running them on both.
+ */
+
+#include <common.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Number of allocations kept live by the benchmark */
+#define BENCH_SLOTS	1000
+/* Number of malloc()/free() calls made by the benchmark */
+#define BENCH_OPS	20000
+
+struct bench_slot {
+	u8 *ptr;
+	size_t size;
+};
+
+static struct bench_slot slots[BENCH_SLOTS];
+
+/* Simple pseudo-random generator, so that every run does the same thing */
+static uint bench_rand(uint *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+
+	return *seed >> 8;
+}
+
+/* Mostly small requests, some larger ones, as driver model makes */
+static size_t bench_size(uint *seed)
+{
+	uint pct = bench_rand(seed) % 100;
+
+	if (pct < 70)
+		return bench_rand(seed) % 256;
+	if (pct < 95)
+		return bench_rand(seed) % 4096;
+
+	return bench_rand(seed) % 65536;
+}
+
+/* Find the largest block which can be allocated at present */
+static size_t largest_alloc(size_t limit)
+{
+	size_t lo = 0, hi = limit + 1;
+
+	while (hi - lo > 16) {
+		size_t mid = lo + (hi - lo) / 2;
+		void *ptr = malloc(mid);
+
+		if (ptr) {
+			free(ptr);
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/* Test memalign(), realloc() and calloc() */
+static int lib_test_malloc_align(struct unit_test_state *uts)
+{
+	struct mallinfo start = mallinfo();
+	u8 *ptr, *ptr2;
+	size_t align;
+	int i;
+
+	for (align = 1; align <= 8192; align <<= 1) {
+		ptr = memalign(align, 100);
+		ut_assertnonnull(ptr);
+		ut_asserteq(0, (ulong)ptr & (align - 1));
+		free(ptr);
+	}
+
+	ptr = malloc(16);
+	ut_assertnonnull(ptr);
+	for (i = 0; i < 16; i++)
+		ptr[i] = i;
+	ptr = realloc(ptr, 5000);
+	ut_assertnonnull(ptr);
+	for (i = 0; i < 16; i++)
+		ut_asserteq(i, ptr[i]);
+	ptr = realloc(ptr, 8);
+	ut_assertnonnull(ptr);
+	for (i = 0; i < 8; i++)
+		ut_asserteq(i, ptr[i]);
+	free(ptr);
+
+	ptr = malloc(300);
+	ut_assertnonnull(ptr);
+	memset(ptr, 0xaa, 300);
+	free(ptr);
+	ptr2 = calloc(30, 10);
+	ut_assertnonnull(ptr2);
+	for (i = 0; i < 300; i++)
+		ut_asserteq(0, ptr2[i]);
+	free(ptr2);
+
+	ut_assertnull(calloc(SIZE_MAX / 2, 4));
+	ut_asserteq(start.uordblks, mallinfo().uordblks);
+
+	return 0;
+}
+LIB_TEST(lib_test_malloc_align, 0);
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_TLSF) && CONFIG_VAL(SYS_MALLOC_F_LEN)
+/* Test realloc() of memory allocated before relocation */
+static int lib_test_malloc_realloc_simple(struct unit_test_state *uts)
+{
+	u8 *old, *ptr;
+
+	ut_assert(gd->malloc_ptr >= 16);
+	old = map_sysmem(gd->malloc_base, gd->malloc_ptr);
+	ptr = realloc(old, 64);
+	ut_assertnonnull(ptr);
+	ut_assert(ptr != old);
+	ut_asserteq_mem(old, ptr, 16);
+	free(ptr);
+
+	/* Not from either heap */
+	ut_assertnull(realloc(old + gd->malloc_ptr, 64));
+
+	return 0;
+}
+LIB_TEST(lib_test_malloc_realloc_simple, 0);
+#endif
+
+/*
+ * Time a mix of allocations and frees of random sizes, then free every other
+ * block and see how much of the free space can be allocated in one piece
+ */
+static int lib_test_malloc_bench(struct unit_test_state *uts)
+{
+	struct mallinfo start = mallinfo();
+	struct mallinfo info;
+	ulong base, begin, took, worst = 0, total;
+	size_t largest;
+	uint seed = 1;
+	int i, op;
+
+	memset(slots, '\0', sizeof(slots));
+	base = timer_get_us();
+	for (op = 0; op < BENCH_OPS; op++) {
+		struct bench_slot *slot;
+
+		slot = &slots[bench_rand(&seed) % BENCH_SLOTS];
+		begin = timer_get_us();
+		if (slot->ptr) {
+			free(slot->ptr);
+			slot->ptr = NULL;
+		} else {
+			slot->size = bench_size(&seed);
+			slot->ptr = malloc(slot->size);
+		}
+		took = timer_get_us() - begin;
+		worst = max(worst, took);
+		if (slot->ptr) {
+			/* touch the memory, as a caller would */
+			memset(slot->ptr, op, slot->size);
+		}
+	}
+	total = timer_get_us() - base;
+
+	for (i = 0; i < BENCH_SLOTS; i += 2) {
+		free(slots[i].ptr);
+		slots[i].ptr = NULL;
+	}
+	info = mallinfo();
+	largest = largest_alloc(info.fordblks);
+
+	printf("malloc: %d ops in %lu us, worst %lu us\n", BENCH_OPS, total,
+	       worst);
+	printf("malloc: %d bytes in use, %d free in %d blocks, largest %zu (%d%% fragmented)\n",
+	       info.uordblks - start.uordblks, info.fordblks, info.ordblks,
+	       largest, info.fordblks ?
+	       (int)(100 - (u64)largest * 100 / info.fordblks) : 0);
+	ut_assert(largest > 0);
+
+	for (i = 0; i < BENCH_SLOTS; i++)
+		free(slots[i].ptr);
+	ut_asserteq(start.uordblks, mallinfo().uordblks);
+
+	return 0;
+}
+LIB_TEST(lib_test_malloc_bench, 0);
@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing Android sparse images
+ *
+ * The image is written to memory, in one piece and in small pieces, checking
+ * the result and that small chunks are combined into a few large writes.
+ */
+
+#include <common.h>
+#include <hexdump.h>
+#include <image-sparse.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Sparse image block size */
+#define SP_BLKSZ	4096
+/* Storage block size, and blocks per sparse block */
+#define DEV_BLKSZ	512
+#define DEV_PER_SP	(SP_BLKSZ / DEV_BLKSZ)
+/* First block of the partition, chosen to be unaligned to the erase group */
+#define DEV_START	8
+/* Size of the partition in storage blocks */
+#define DEV_SIZE	(32 * DEV_PER_SP)
+/* Erase group size in storage blocks */
+#define DEV_ERASE_GRP	48
+/* Value in blocks which have not been written */
+#define UNWRITTEN	0xaa
+
+#define FILL_VAL	0x12345678
+
+/* Number of sparse blocks in the image */
+#define SP_TOTAL_BLKS	29
+
+/**
+ * struct sparse_test - Memory-backed storage for the tests
+ *
+ * @disk:	Contents of the storage
+ * @writes:	Number of calls to write()
+ * @erases:	Number of calls to erase()
+ */
+struct sparse_test {
+	u8 *disk;
+	int writes;
+	int erases;
+};
+
+static lbaint_t sparse_test_write(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt, const void *buffer)
+{
+	struct sparse_test *priv = info->priv;
+
+	priv->writes++;
+	memcpy(priv->disk + blk * DEV_BLKSZ, buffer, blkcnt * DEV_BLKSZ);
+
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_short_write(struct sparse_storage *info,
+					lbaint_t blk, lbaint_t blkcnt,
+					const void *buffer)
+{
+	return blkcnt - 1;
+}
+
+static lbaint_t sparse_test_reserve(struct sparse_storage *info, lbaint_t blk,
+				    lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_erase(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt)
+{
+	struct sparse_test *priv = info->priv;
+
+	priv->erases++;
+	memset(priv->disk + blk * DEV_BLKSZ, '\0', blkcnt * DEV_BLKSZ);
+
+	return blkcnt;
+}
+
+static u8 *add_chunk(u8 *ptr, uint type, uint blks, uint data_len)
+{
+	chunk_header_t *chunk = (chunk_header_t *)ptr;
+
+	chunk->chunk_type = cpu_to_le16(type);
+	chunk->reserved1 = 0;
+	chunk->chunk_sz = cpu_to_le32(blks);
+	chunk->total_sz = cpu_to_le32(sizeof(*chunk) + data_len);
+
+	return ptr + sizeof(*chunk);
+}
+
+static u8 *add_raw(u8 *ptr, u8 **outp, uint blks, u8 val)
+{
+	ptr = add_chunk(ptr, CHUNK_TYPE_RAW, blks, blks * SP_BLKSZ);
+	memset(ptr, val, blks * SP_BLKSZ);
+	memset(*outp, val, blks * SP_BLKSZ);
+	*outp += blks * SP_BLKSZ;
+
+	return ptr + blks * SP_BLKSZ;
+}
+
+static u8 *add_fill(u8 *ptr, u8 **outp, uint blks, u32 val)
+{
+	u32 le_val = cpu_to_le32(val);
+	int i;
+
+	ptr = add_chunk(ptr, CHUNK_TYPE_FILL, blks, sizeof(le_val));
+	memcpy(ptr, &le_val, sizeof(le_val));
+	for (i = 0; i < blks * SP_BLKSZ; i += sizeof(le_val))
+		memcpy(*outp + i, &le_val, sizeof(le_val));
+	*outp += blks * SP_BLKSZ;
+
+	return ptr + sizeof(le_val);
+}
+
+/*
+ * Create a sparse image with each type of chunk, returning its size. The
+ * expected contents of the partition are written to @expect.
+ */
+static int make_image(u8 *img, u8 *expect)
+{
+	sparse_header_t *hdr = (sparse_header_t *)img;
+	u8 *out = expect;
+	u8 *ptr;
+
+	hdr->magic = cpu_to_le32(SPARSE_HEADER_MAGIC);
+	hdr->major_version = cpu_to_le16(1);
+	hdr->minor_version = 0;
+	hdr->file_hdr_sz = cpu_to_le16(sizeof(*hdr));
+	hdr->chunk_hdr_sz = cpu_to_le16(sizeof(chunk_header_t));
+	hdr->blk_sz = cpu_to_le32(SP_BLKSZ);
+	hdr->total_blks = cpu_to_le32(SP_TOTAL_BLKS);
+	hdr->total_chunks = cpu_to_le32(7);
+	hdr->image_checksum = 0;
+	ptr = img + sizeof(*hdr);
+
+	ptr = add_raw(ptr, &out, 2, 'a');
+	ptr = add_raw(ptr, &out, 1, 'b');
+	ptr = add_fill(ptr, &out, 3, FILL_VAL);
+	ptr = add_chunk(ptr, CHUNK_TYPE_DONT_CARE, 2, 0);
+	out += 2 * SP_BLKSZ;
+	ptr = add_fill(ptr, &out, 20, 0);
+	ptr = add_chunk(ptr, CHUNK_TYPE_CRC32, 0, sizeof(u32));
+	memset(ptr, '\0', sizeof(u32));
+	ptr += sizeof(u32);
+	ptr = add_raw(ptr, &out, 1, 'c');
+
+	return ptr - img;
+}
+
+static void setup_storage(struct sparse_storage *info, struct sparse_test *priv,
+			  u8 *disk)
+{
+	memset(disk, UNWRITTEN, (DEV_START + DEV_SIZE) * DEV_BLKSZ);
+	priv->disk = disk;
+	priv->writes = 0;
+	priv->erases = 0;
+
+	info->blksz = DEV_BLKSZ;
+	info->start = DEV_START;
+	info->size = DEV_SIZE;
+	info->priv = priv;
+	info->write = sparse_test_write;
+	info->reserve = sparse_test_reserve;
+	info->erase = sparse_test_erase;
+	info->erase_grp = DEV_ERASE_GRP;
+	info->mssg = NULL;
+}
+
+/* Write a sparse image in pieces of various sizes */
+static int lib_test_sparse_write(struct unit_test_state *uts)
+{
+	static const int piece_sizes[] = { 0, 1, 7, SP_BLKSZ + 3 };
+	const int size = (DEV_START + DEV_SIZE) * DEV_BLKSZ;
+	struct sparse_storage info;
+	struct sparse_stream strm;
+	struct sparse_test priv;
+	u8 *img, *expect, *disk;
+	int i, len, pos;
+
+	img = malloc(size);
+	expect = malloc(size);
+	disk = malloc(size);
+	ut_assertnonnull(img);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(disk);
+	memset(expect, UNWRITTEN, size);
+	len = make_image(img, expect + DEV_START * DEV_BLKSZ);
+
+	for (i = 0; i < ARRAY_SIZE(piece_sizes); i++) {
+		int piece = piece_sizes[i];
+
+		setup_storage(&info, &priv, disk);
+		if (!piece) {
+			ut_assertok(write_sparse_image(&info, "test", img,
+						       NULL));
+		} else {
+			ut_assertok(sparse_stream_init(&strm, &info, "test",
+						       NULL));
+			for (pos = 0; pos < len; pos += piece) {
+				int n = min(piece, len - pos);
+
+				ut_assertok(sparse_stream_write(&strm, img + pos,
+								n));
+			}
+			ut_assertok(sparse_stream_finish(&strm));
+		}
+		ut_asserteq_mem(expect, disk, size);
+
+		/*
+		 * The first three chunks are written together, then the start
+		 * of the zero fill. The rest of the fill is erased apart from
+		 * the end, which is written with the last chunk.
+		 */
+		ut_asserteq(3, priv.writes);
+		ut_asserteq(1, priv.erases);
+	}
+
+	/* Without erase, zeroes are written */
+	setup_storage(&info, &priv, disk);
+	info.erase = NULL;
+	ut_assertok(write_sparse_image(&info, "test", img, NULL));
+	ut_asserteq_mem(expect, disk, size);
+	ut_asserteq(0, priv.erases);
+
+	free(disk);
+	free(expect);
+	free(img);
+
+	return 0;
+}
+LIB_TEST(lib_test_sparse_write, 0);
+
+/* Check that bad images are rejected */
+static int lib_test_sparse_errors(struct unit_test_state *uts)
+{
+	const int size = (DEV_START + DEV_SIZE) * DEV_BLKSZ;
+	struct sparse_storage info;
+	struct sparse_stream strm;
+	struct sparse_test priv;
+	u8 *img, *expect, *disk;
+	int len;
+
+	img = malloc(size);
+	expect = malloc(size);
+	disk = malloc(size);
+	ut_assertnonnull(img);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(disk);
+	len = make_image(img, expect);
+
+	/* Truncated image */
+	setup_storage(&info, &priv, disk);
+	ut_assertok(sparse_stream_init(&strm, &info, "test", NULL));
+	ut_assertok(sparse_stream_write(&strm, img, len - 1));
+	ut_asserteq(-EINVAL, sparse_stream_finish(&strm));
+
+	/* Partition too small */
+	setup_storage(&info, &priv, disk);
+	info.size = (SP_TOTAL_BLKS - 1) * DEV_PER_SP;
+	ut_asserteq(-ENOSPC, write_sparse_image(&info, "test", img, NULL));
+
+	/* Sparse block size not a multiple of the storage block size */
+	setup_storage(&info, &priv, disk);
+	info.blksz = 3000;
+	ut_asserteq(-EINVAL, write_sparse_image(&info, "test", img, NULL));
+
+	/* Write failure */
+	setup_storage(&info, &priv, disk);
+	info.write = sparse_test_short_write;
+	ut_asserteq(-EIO, write_sparse_image(&info, "test", img, NULL));
+
+	free(disk);
+	free(expect);
+	free(img);
+
+	return 0;
+}
+LIB_TEST(lib_test_sparse_errors, 0);
@@ -19,7 +19,8 @@
 /* 4k ought to be enough for anybody */
 #define FDT_COPY_SIZE	(4 * SZ_1K)
 
-extern u32 __dtb_test_fdt_base_begin;
+/* Typed as a header, since fdt_totalsize() is read from the base tree */
+extern struct fdt_header __dtb_test_fdt_base_begin;
 extern u32 __dtb_test_fdt_overlay_begin;
 extern u32 __dtb_test_fdt_overlay_stacked_begin;
 
@@ -274,6 +275,24 @@ int do_ut_overlay(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	ret = cmd_ut_category("overlay", tests, n_ents, argc, argv);
 
+	/* Applying both overlays in one pass must give the same result */
+	if (CONFIG_IS_ENABLED(OF_OVERLAY_STACK) && !ret) {
+		void *fdtos[] = { fdt_overlay_copy, fdt_overlay_stacked_copy };
+
+		/* Leave no free space, so the tree must be grown */
+		ut_assertok(fdt_open_into(fdt_base, fdt,
+					  fdt_totalsize(fdt_base)));
+		ut_assertok(fdt_open_into(fdt_overlay, fdt_overlay_copy,
+					  FDT_COPY_SIZE));
+		ut_assertok(fdt_open_into(fdt_overlay_stacked,
+					  fdt_overlay_stacked_copy,
+					  FDT_COPY_SIZE));
+		ut_assertok(fdt_overlay_apply_stack(fdt, FDT_COPY_SIZE, fdtos,
+						    ARRAY_SIZE(fdtos)));
+
+		ret = cmd_ut_category("overlay", tests, n_ents, argc, argv);
+	}
+
 	free(fdt_overlay_stacked_copy);
 err3:
 	free(fdt_overlay_copy);
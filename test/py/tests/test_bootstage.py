@@ -0,0 +1,51 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+"""
+Test the 'bootstage export' command, which writes out the spans recorded
+while booting
+"""
+
+import json
+import pytest
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+@pytest.mark.buildconfigspec('bootstage_spans')
+def test_bootstage_export_chrome(u_boot_console):
+    """Test that the Chrome trace output is valid JSON with probe spans"""
+    cons = u_boot_console
+    output = cons.run_command('bootstage export chrome')
+    events = json.loads(output.replace('\r', ''))['traceEvents']
+
+    marks = [ev for ev in events if ev['ph'] == 'i']
+    assert 'reset' in [ev['name'] for ev in marks]
+
+    probes = [ev for ev in events if ev['ph'] == 'X' and ev['cat'] == 'probe']
+    assert probes
+    for ev in probes:
+        assert ev['dur'] >= 0
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+@pytest.mark.buildconfigspec('bootstage_spans')
+def test_bootstage_export_folded(u_boot_console):
+    """Test that the folded output has a stack and a time on each line"""
+    cons = u_boot_console
+    output = cons.run_command('bootstage export folded')
+    lines = output.replace('\r', '').splitlines()
+    assert lines
+    for line in lines:
+        stack, count = line.rsplit(' ', 1)
+        assert int(count) > 0
+        for frame in stack.split(';'):
+            assert ':' in frame
+    assert [line for line in lines if line.startswith('probe:')]
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+@pytest.mark.buildconfigspec('bootstage_spans')
+def test_bootstage_export_mem(u_boot_console):
+    """Test writing to memory, which sets 'filesize'"""
+    cons = u_boot_console
+    output = cons.run_command('bootstage export folded 1000 10')
+    assert 'Not enough space' in output
+    cons.run_command('bootstage export folded 1000 100000')
+    output = cons.run_command('echo $filesize')
+    assert int(output, 16) > 0
@@ -10,7 +10,7 @@ and checks that the output is correct.
 
 import pytest
 
-LOGL_FIRST, LOGL_WARNING, LOGL_INFO = (0, 4, 6)
+LOGL_FIRST, LOGL_WARNING, LOGL_INFO, LOGL_COUNT = (0, 4, 6, 10)
 
 @pytest.mark.buildconfigspec('cmd_log')
 def test_log(u_boot_console):
@@ -130,3 +130,24 @@ def test_log_format(u_boot_console):
         run_with_format('FLfm', 'file.c:123-func() msg')
         run_with_format('lm', 'NOTICE. msg')
         run_with_format('m', 'msg')
+
+@pytest.mark.buildconfigspec('cmd_log')
+@pytest.mark.buildconfigspec('log_ring')
+def test_log_dump(u_boot_console):
+    """Test that 'log dump' shows the records in the ring buffer"""
+    cons = u_boot_console
+    with cons.log.section('dump'):
+        cons.run_command('log format fm')
+        cons.run_command('log test 0')
+        output = cons.run_command('log dump')
+        cons.run_command('log format default')
+
+    # Drop the timestamp from each line
+    lines = [line.split('] ', 1)[1]
+             for line in output.replace('\r', '').splitlines() if '] ' in line]
+
+    # The ring buffer records all levels, not just those shown on the console
+    for i in range(LOGL_INFO):
+        assert 'log_run() log %d' % i in lines
+    for i in range(LOGL_COUNT):
+        assert 'func() _log %d' % i in lines
@@ -40,3 +40,56 @@ def test_ofplatdata(u_boot_console):
     cons.restart_uboot_with_flags(['--show_of_platdata'])
     output = cons.get_spawn_output().replace('\r', '')
     assert OF_PLATDATA_OUTPUT in output
+
+def parse_dm_tree(output):
+    """Parse the output of 'dm tree' into a dict of devices
+
+    Args:
+        output: Output from dm_dump_all()
+
+    Returns:
+        dict:
+            key: Device path, made up of the device names from the root
+                device down, separated by '/'
+            value: Tuple of (uclass name, driver name)
+    """
+    devices = {}
+    stack = []
+    for line in output.splitlines():
+        # The fixed-width columns take up 47 characters, then the tree
+        if len(line) < 48 or '[' not in line[:47]:
+            continue
+        uclass = line[:12].strip()
+        driver = line[25:45].strip()
+        tree = line[47:]
+        name = tree.lstrip('|`- ')
+        depth = (len(tree) - len(name)) // 4
+        del stack[depth:]
+        stack.append(name)
+        devices['/'.join(stack)] = (uclass, driver)
+    return devices
+
+@pytest.mark.buildconfigspec('spl_of_platdata_bind')
+def test_ofplatdata_bind(u_boot_console):
+    """Test that dtoc binds SPL devices as U-Boot does at run-time"""
+    cons = u_boot_console
+    cons.restart_uboot_with_flags(['--show_spl_dm_tree'])
+    output = cons.get_spawn_output().replace('\r', '')
+    spl_devs = parse_dm_tree(output[:output.index('U-Boot 20')])
+    assert spl_devs
+
+    uboot_devs = parse_dm_tree(cons.run_command('dm tree'))
+    paths_by_name = {}
+    for path in uboot_devs:
+        paths_by_name.setdefault(path.split('/')[-1], []).append(path)
+
+    # Every SPL device known to U-Boot must have the same parents and driver
+    checked = 0
+    for path, info in spl_devs.items():
+        name = path.split('/')[-1]
+        if name not in paths_by_name:
+            continue
+        assert path in paths_by_name[name]
+        assert info == uboot_devs[path]
+        checked += 1
+    assert checked
@@ -0,0 +1,30 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+"""
+Test the 'profile' command, which controls the statistical profiler
+"""
+
+import pytest
+import re
+
+@pytest.mark.buildconfigspec('cmd_profile')
+@pytest.mark.boardspec('sandbox')
+def test_profile_samples(u_boot_console):
+    """Test that samples are taken while busy and can be dumped"""
+    cons = u_boot_console
+    output = cons.run_command('profile start 100')
+    assert output == ''
+    output = cons.run_command('profile start')
+    assert 'err=' in output
+    cons.run_command('crc32 0 4000000')
+    cons.run_command('profile stop')
+
+    output = cons.run_command('profile stats')
+    assert 'Profiler stopped' in output
+    count = int(re.search(r'(\d+) samples', output).group(1))
+    assert count > 0
+
+    output = cons.run_command('profile samples 1000000 1000000')
+    assert 'Samples dumped to 01000000' in output
+    output = cons.run_command('profile samples 1000000 4')
+    assert 'not enough space' in output
@@ -139,8 +139,11 @@ class DtbPlatdata(object):
         _include_disabled: true to include nodes marked status = "disabled"
         _outfile: The current output file (sys.stdout or a real file)
         _lines: Stashed list of output lines for outputting in the future
+        _bind: True to emit the pre-computed device binding (parent links,
+            driver references and alias sequence numbers) for each device
+        _seq_aliases: Dict of alias sequence numbers, keyed by node path
     """
-    def __init__(self, dtb_fname, include_disabled):
+    def __init__(self, dtb_fname, include_disabled, bind=False):
         self._fdt = None
         self._dtb_fname = dtb_fname
         self._valid_nodes = None
@@ -148,6 +151,8 @@ class DtbPlatdata(object):
         self._outfile = None
         self._lines = []
         self._aliases = {}
+        self._bind = bind
+        self._seq_aliases = {}
 
     def setup_output(self, fname):
         """Set up the output destination
@@ -278,6 +283,47 @@ class DtbPlatdata(object):
         self._valid_nodes = []
         return self.scan_node(self._fdt.GetRoot())
 
+    def get_valid_parent(self, node):
+        """Get the closest ancestor of a node which is also a device
+
+        Args:
+            node: Node to check
+
+        Returns:
+            Parent Node object, or None if the device should be bound to the
+            root device
+        """
+        parent = node.parent
+        while parent:
+            if parent in self._valid_nodes:
+                return parent
+            parent = parent.parent
+        return None
+
+    def scan_aliases(self):
+        """Scan the /aliases node to obtain requested sequence numbers
+
+        This fills in self._seq_aliases with the sequence number requested by
+        each node which is the target of exactly one alias of the form
+        <stem><number>, e.g. 'serial2'. Nodes with several aliases are left
+        to be numbered at run-time, since dtoc cannot tell which uclass each
+        stem refers to.
+        """
+        aliases = self._fdt.GetRoot().FindNode('aliases')
+        if not aliases:
+            return
+        seqs = collections.defaultdict(list)
+        for name, prop in aliases.props.items():
+            if prop.type != fdt.TYPE_STRING or isinstance(prop.value, list):
+                continue
+            stem = name.rstrip('0123456789')
+            if stem == name:
+                continue
+            seqs[prop.value].append(int(name[len(stem):]))
+        for path, seq_list in seqs.items():
+            if len(seq_list) == 1:
+                self._seq_aliases[path] = seq_list[0]
+
     @staticmethod
     def get_num_cells(node):
         """Get the number of cells in addresses and sizes for this node
@@ -513,6 +559,17 @@ class DtbPlatdata(object):
         self.buf('\t.name\t\t= "%s",\n' % struct_name)
         self.buf('\t.platdata\t= &%s%s,\n' % (VAL_PREFIX, var_name))
         self.buf('\t.platdata_size\t= sizeof(%s%s),\n' % (VAL_PREFIX, var_name))
+        if self._bind:
+            self.buf('\t.driver\t\t= DM_REF_DRIVER(%s),\n' % struct_name)
+            self.buf('\t.dev_name\t= "%s",\n' % node.name)
+            parent = self.get_valid_parent(node)
+            if parent:
+                self.buf('\t.parent\t\t= DM_REF_DEVICE(%s),\n' %
+                         conv_name_to_c(parent.name))
+            seq = self._seq_aliases.get(node.path)
+            if seq is not None:
+                self.buf('\t.flags\t\t= DM_INFO_FLAG_REQ_SEQ,\n')
+                self.buf('\t.req_seq\t= %d,\n' % seq)
         self.buf('};\n')
         self.buf('\n')
 
@@ -525,6 +582,12 @@ class DtbPlatdata(object):
         U_BOOT_DEVICE() declarations for each valid node. Where a node has
         multiple compatible strings, a #define is used to make them equivalent.
 
+        With binding enabled, each declaration also references its driver
+        and its parent device, so parents are always output before their
+        children. Drivers are declared weak, so a node whose driver is not
+        built in (or whose U_BOOT_DRIVER() name does not match) falls back to
+        a run-time lookup by name.
+
         See the documentation in doc/driver-model/of-plat.txt for more
         information.
         """
@@ -533,21 +596,40 @@ class DtbPlatdata(object):
         self.out('#include <dm.h>\n')
         self.out('#include <dt-structs.h>\n')
         self.out('\n')
+        if self._bind:
+            drivers = set([get_compat_name(node)[0]
+                           for node in self._valid_nodes])
+            for driver in sorted(drivers):
+                self.out('DM_DECL_DRIVER(%s) __weak;\n' % driver)
+            if drivers:
+                self.out('\n')
         nodes_to_output = list(self._valid_nodes)
 
         # Keep outputing nodes until there is none left
         while nodes_to_output:
-            node = nodes_to_output[0]
-            # Output all the node's dependencies first
-            for req_node in node.phandles:
-                if req_node in nodes_to_output:
-                    self.output_node(req_node)
-                    nodes_to_output.remove(req_node)
-            self.output_node(node)
-            nodes_to_output.remove(node)
+            self._output_with_deps(nodes_to_output[0], nodes_to_output)
 
+    def _output_with_deps(self, node, nodes_to_output):
+        """Output a node, after any nodes it depends on
 
-def run_steps(args, dtb_file, include_disabled, output):
+        Args:
+            node: Node to output
+            nodes_to_output: List of nodes not yet output. This is updated
+                as nodes are output
+        """
+        deps = list(node.phandles)
+        if self._bind:
+            parent = self.get_valid_parent(node)
+            if parent:
+                deps.insert(0, parent)
+        for req_node in deps:
+            if req_node in nodes_to_output:
+                self._output_with_deps(req_node, nodes_to_output)
+        self.output_node(node)
+        nodes_to_output.remove(node)
+
+
+def run_steps(args, dtb_file, include_disabled, output, bind=False):
     """Run all the steps of the dtoc tool
 
     Args:
@@ -555,13 +637,15 @@ def run_steps(args, dtb_file, include_disabled, output):
         dtb_file: Filename of dtb file to process
         include_disabled: True to include disabled nodes
         output: Name of output file
+        bind: True to output the pre-computed device binding
     """
     if not args:
         raise ValueError('Please specify a command: struct, platdata')
 
-    plat = DtbPlatdata(dtb_file, include_disabled)
+    plat = DtbPlatdata(dtb_file, include_disabled, bind)
     plat.scan_dtb()
     plat.scan_tree()
+    plat.scan_aliases()
     plat.scan_reg_sizes()
     plat.setup_output(output)
     structs = plat.scan_structs()
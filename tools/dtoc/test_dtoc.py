@@ -687,6 +687,49 @@ U_BOOT_DEVICE(spl_test2) = {
 
 ''', data)
 
+    def test_bind(self):
+        """Test output of the pre-computed device binding"""
+        dtb_file = get_dtb_file('dtoc_test_bind.dts')
+        output = tools.GetOutputFilename('output')
+        dtb_platdata.run_steps(['platdata'], dtb_file, False, output, True)
+        with open(output) as infile:
+            data = infile.read()
+        self._CheckStrings(C_HEADER + '''
+DM_DECL_DRIVER(sandbox_spl_test) __weak;
+DM_DECL_DRIVER(sandbox_spl_test_2) __weak;
+
+static const struct dtd_sandbox_spl_test dtv_spl_test = {
+};
+U_BOOT_DEVICE(spl_test) = {
+\t.name\t\t= "sandbox_spl_test",
+\t.platdata\t= &dtv_spl_test,
+\t.platdata_size\t= sizeof(dtv_spl_test),
+\t.driver\t\t= DM_REF_DRIVER(sandbox_spl_test),
+\t.dev_name\t= "spl-test",
+\t.flags\t\t= DM_INFO_FLAG_REQ_SEQ,
+\t.req_seq\t= 3,
+};
+
+static const struct dtd_sandbox_spl_test_2 dtv_child_test = {
+};
+U_BOOT_DEVICE(child_test) = {
+\t.name\t\t= "sandbox_spl_test_2",
+\t.platdata\t= &dtv_child_test,
+\t.platdata_size\t= sizeof(dtv_child_test),
+\t.driver\t\t= DM_REF_DRIVER(sandbox_spl_test_2),
+\t.dev_name\t= "child-test",
+\t.parent\t\t= DM_REF_DEVICE(spl_test),
+};
+
+''', data)
+
+        # Without binding the hierarchy is not output
+        dtb_platdata.run_steps(['platdata'], dtb_file, False, output)
+        with open(output) as infile:
+            data = infile.read()
+        self.assertNotIn('DM_REF_DEVICE', data)
+        self.assertNotIn('DM_DECL_DRIVER', data)
+
     def testStdout(self):
         """Test output to stdout"""
         dtb_file = get_dtb_file('dtoc_test_simple.dts')
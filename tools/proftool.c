@@ -55,6 +55,9 @@ struct func_info *func_list;
 int func_count;
 struct trace_call *call_list;
 int call_count;
+uint32_t *sample_list;	/* samples, each a depth followed by offsets */
+int sample_count;
+int sample_words;
 int verbose;	/* Verbosity level 0=none, 1=warn, 2=notice, 3=info, 4=debug */
 unsigned long text_offset;		/* text address of first function */
 
@@ -85,6 +88,7 @@ static void usage(void)
 		"\n"
 		"Commands\n"
 		"   dump-ftrace\t\tDump out textual data in ftrace format\n"
+		"   dump-folded\t\tDump out profiler samples as folded stacks\n"
 		"\n"
 		"Options:\n"
 		"   -m <map>\tSpecify Systen.map file\n"
@@ -226,6 +230,36 @@ static int read_calls(FILE *fin, int count)
 	return 0;
 }
 
+static int read_samples(FILE *fin, int count)
+{
+	uint32_t depth;
+	int alloced = 0;
+	int i;
+
+	notice("sample count: %d\n", count);
+	sample_count = count;
+	for (i = 0; i < count; i++) {
+		if (read_data(fin, &depth, sizeof(depth)))
+			return 1;
+		if (!depth || depth > 0x10000) {
+			error("Invalid depth %u in sample %d\n", depth, i);
+			return 1;
+		}
+		if (sample_words + 1 + depth > alloced) {
+			alloced += 1 + depth + 0x10000;
+			sample_list = realloc(sample_list,
+					      sizeof(uint32_t) * alloced);
+			assert(sample_list);
+		}
+		sample_list[sample_words++] = depth;
+		if (read_data(fin, &sample_list[sample_words],
+			      sizeof(uint32_t) * depth))
+			return 1;
+		sample_words += depth;
+	}
+	return 0;
+}
+
 static int read_profile(FILE *fin, int *not_found)
 {
 	struct trace_output_hdr hdr;
@@ -249,6 +283,11 @@ static int read_profile(FILE *fin, int *not_found)
 			if (read_calls(fin, hdr.rec_count))
 				return 1;
 			break;
+
+		case TRACE_CHUNK_SAMPLES:
+			if (read_samples(fin, hdr.rec_count))
+				return 1;
+			break;
 		}
 	}
 	return 0;
@@ -532,6 +571,83 @@ static int make_ftrace(void)
 	return 0;
 }
 
+static int h_cmp_str(const void *v1, const void *v2)
+{
+	return strcmp(*(char * const *)v1, *(char * const *)v2);
+}
+
+/*
+ * Output one line for each distinct call stack seen by the profiler, with
+ * the functions separated by semicolons, outermost first, and then the
+ * number of samples:
+ *
+ *    board_init_r;run_main_loop;bootm_run;memmove 42
+ *
+ * This is the input format used by flamegraph.pl
+ */
+static int make_folded(void)
+{
+	char **stacks;
+	int missing_count = 0;
+	int pos, i, j;
+
+	if (!sample_count) {
+		error("No profiler samples found\n");
+		return -1;
+	}
+	stacks = calloc(sample_count, sizeof(*stacks));
+	assert(stacks);
+	for (i = 0, pos = 0; i < sample_count; i++) {
+		uint32_t depth = sample_list[pos++];
+		size_t len = 0, size = 0;
+		char *str = NULL;
+
+		/* the first offset is the PC, the rest are return addresses */
+		for (j = depth - 1; j >= 0; j--) {
+			uint32_t offset = sample_list[pos + j];
+			struct func_info *func;
+			char name[MAX_LINE_LEN];
+			size_t add;
+
+			/* a return address may be just past the caller's end */
+			if (j)
+				offset--;
+			func = find_caller_by_offset(offset);
+			if (func && offset < func->offset + func->code_size) {
+				snprintf(name, sizeof(name), "%s", func->name);
+			} else {
+				snprintf(name, sizeof(name), "%x", offset);
+				missing_count++;
+			}
+			add = strlen(name) + 1;
+			if (len + add + 1 > size) {
+				size += add + MAX_LINE_LEN;
+				str = realloc(str, size);
+				assert(str);
+			}
+			sprintf(str + len, "%s%s", len ? ";" : "", name);
+			len += add - !len;
+		}
+		stacks[i] = str;
+		pos += depth;
+	}
+
+	qsort(stacks, sample_count, sizeof(*stacks), h_cmp_str);
+	for (i = 0; i < sample_count; i = j) {
+		for (j = i + 1; j < sample_count; j++) {
+			if (strcmp(stacks[i], stacks[j]))
+				break;
+		}
+		printf("%s %d\n", stacks[i], j - i);
+	}
+	for (i = 0; i < sample_count; i++)
+		free(stacks[i]);
+	free(stacks);
+	info("folded: %d addresses not found\n", missing_count);
+
+	return 0;
+}
+
 static int prof_tool(int argc, char * const argv[],
 		     const char *prof_fname, const char *map_fname,
 		     const char *trace_config_fname)
@@ -552,6 +668,8 @@ static int prof_tool(int argc, char * const argv[],
 
 		if (0 == strcmp(cmd, "dump-ftrace"))
 			err = make_ftrace();
+		else if (0 == strcmp(cmd, "dump-folded"))
+			err = make_folded();
 		else
 			warn("Unknown command '%s'\n", cmd);
 	}